@@ -0,0 +1,298 @@
+/*
+ * autosave.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#include "autosave.h"
+#include "oregano.h"
+#include "dialogs.h"
+#include "save-schematic.h"
+#include "schematic-view.h"
+
+#include "debug.h"
+
+#define AUTOSAVE_PATH_KEY "autosave-path"
+#define AUTOSAVE_CHANGES_KEY "autosave-changes"
+
+typedef struct
+{
+	// NULL to remove the file
+	SchematicSnapshot *snapshot;
+	gchar *path;
+	gboolean compress;
+} AutosaveJob;
+
+// a single thread, so the jobs for a file run in order
+static GThreadPool *pool = NULL;
+static guint timeout = 0;
+
+static void autosave_job_run (AutosaveJob *job, gpointer user_data)
+{
+	GError *e = NULL;
+
+	if (job->snapshot) {
+		if (!schematic_snapshot_save (job->snapshot, job->path, job->compress, &e)) {
+			g_warning ("Autosave to %s failed: %s", job->path, e->message);
+			g_clear_error (&e);
+		}
+		schematic_snapshot_free (job->snapshot);
+	} else if (g_unlink (job->path) == 0) {
+		NG_DEBUG ("removed recovery file %s", job->path);
+	}
+
+	g_free (job->path);
+	g_free (job);
+}
+
+static void autosave_push (SchematicSnapshot *snapshot, const gchar *path)
+{
+	AutosaveJob *job = g_new0 (AutosaveJob, 1);
+
+	if (pool == NULL)
+		pool = g_thread_pool_new ((GFunc)autosave_job_run, NULL, 1, FALSE, NULL);
+
+	job->snapshot = snapshot;
+	job->path = g_strdup (path);
+	job->compress = oregano.compress_files;
+	g_thread_pool_push (pool, job, NULL);
+}
+
+/**
+ * @returns the directory of the recovery files, free with g_free
+ */
+gchar *autosave_get_dir (void)
+{
+	return g_build_filename (g_get_user_data_dir (), "oregano", "recovery", NULL);
+}
+
+/**
+ * @returns the recovery file of the schematic, named after its file and
+ * unique to it
+ */
+static const gchar *autosave_get_path (Schematic *sm)
+{
+	gchar *path, *dir, *base, *name, *checksum, *key;
+	const gchar *filename;
+
+	path = g_object_get_data (G_OBJECT (sm), AUTOSAVE_PATH_KEY);
+	if (path)
+		return path;
+
+	filename = schematic_get_filename (sm);
+	if (filename) {
+		base = g_path_get_basename (filename);
+		if (g_str_has_suffix (base, ".oregano"))
+			base[strlen (base) - strlen (".oregano")] = '\0';
+		key = g_strdup (filename);
+	} else {
+		base = g_strdup ("Untitled");
+		key = g_strdup_printf ("%d-%p-%" G_GINT64_FORMAT, getpid (), sm, g_get_real_time ());
+	}
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+	checksum[8] = '\0';
+	name = g_strdup_printf ("%s-%s.oregano", base, checksum);
+
+	dir = autosave_get_dir ();
+	path = g_build_filename (dir, name, NULL);
+	g_object_set_data_full (G_OBJECT (sm), AUTOSAVE_PATH_KEY, path, g_free);
+
+	g_free (dir);
+	g_free (name);
+	g_free (checksum);
+	g_free (key);
+	g_free (base);
+
+	return path;
+}
+
+/**
+ * \brief writes a schematic to its recovery file in the background, if
+ * it changed since it was saved or autosaved
+ */
+void autosave_schematic (Schematic *sm)
+{
+	guint changes;
+	gchar *dir;
+
+	g_return_if_fail (IS_SCHEMATIC (sm));
+
+	changes = schematic_get_changes (sm);
+	if (!schematic_is_dirty (sm) ||
+	    GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (sm), AUTOSAVE_CHANGES_KEY)) == changes)
+		return;
+
+	dir = autosave_get_dir ();
+	if (g_mkdir_with_parents (dir, 0700) != 0) {
+		g_warning ("Could not create %s: %s", dir, g_strerror (errno));
+		g_free (dir);
+		return;
+	}
+	g_free (dir);
+
+	autosave_push (schematic_snapshot_new (sm), autosave_get_path (sm));
+	g_object_set_data (G_OBJECT (sm), AUTOSAVE_CHANGES_KEY, GUINT_TO_POINTER (changes));
+}
+
+/**
+ * \brief removes the recovery file of a schematic, once it is saved or
+ * closed
+ */
+void autosave_discard (Schematic *sm)
+{
+	const gchar *path;
+
+	g_return_if_fail (IS_SCHEMATIC (sm));
+
+	path = g_object_get_data (G_OBJECT (sm), AUTOSAVE_PATH_KEY);
+	if (path == NULL)
+		return;
+
+	// after the pending save of the same file
+	autosave_push (NULL, path);
+	g_object_set_data (G_OBJECT (sm), AUTOSAVE_CHANGES_KEY, NULL);
+	// a saved schematic may get a new name
+	g_object_set_data (G_OBJECT (sm), AUTOSAVE_PATH_KEY, NULL);
+}
+
+/**
+ * \brief waits for the pending autosaves, before quitting
+ */
+void autosave_flush (void)
+{
+	if (pool) {
+		g_thread_pool_free (pool, FALSE, TRUE);
+		pool = NULL;
+	}
+}
+
+static gboolean autosave_timeout (gpointer user_data)
+{
+	GList *iter;
+
+	for (iter = schematic_get_list (); iter; iter = iter->next)
+		autosave_schematic (iter->data);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * \brief (re)starts the periodic autosave, 0 turns it off
+ */
+void autosave_set_interval (guint minutes)
+{
+	if (timeout) {
+		g_source_remove (timeout);
+		timeout = 0;
+	}
+	if (minutes > 0)
+		timeout = g_timeout_add_seconds (minutes * 60, autosave_timeout, NULL);
+}
+
+/**
+ * \brief offers to open the recovery files left behind by a crash
+ *
+ * Recovered schematics keep autosaving to their recovery file, without
+ * a file name of their own.
+ */
+void autosave_recover (void)
+{
+	GDir *dir;
+	const gchar *name;
+	gchar *dirname;
+	GPtrArray *paths;
+	GString *msg;
+	guint i;
+	static gboolean recovered = FALSE;
+
+	// the files found later belong to the open schematics
+	if (recovered)
+		return;
+	recovered = TRUE;
+
+	dirname = autosave_get_dir ();
+	dir = g_dir_open (dirname, 0, NULL);
+	if (dir == NULL) {
+		g_free (dirname);
+		return;
+	}
+
+	paths = g_ptr_array_new_with_free_func (g_free);
+	while ((name = g_dir_read_name (dir)) != NULL)
+		if (g_str_has_suffix (name, ".oregano"))
+			g_ptr_array_add (paths, g_build_filename (dirname, name, NULL));
+	g_dir_close (dir);
+	g_free (dirname);
+
+	if (paths->len == 0) {
+		g_ptr_array_unref (paths);
+		return;
+	}
+
+	msg = g_string_new (_ ("Oregano did not quit properly, these schematics were saved "
+	                       "automatically:\n"));
+	for (i = 0; i < paths->len; i++) {
+		gchar *base = g_path_get_basename (g_ptr_array_index (paths, i));
+		gchar *escaped = g_markup_escape_text (base, -1);
+
+		g_string_append_printf (msg, "\n%s", escaped);
+		g_free (escaped);
+		g_free (base);
+	}
+	g_string_append (msg, _ ("\n\nDo you want to open them?"));
+
+	if (oregano_question (msg->str)) {
+		for (i = 0; i < paths->len; i++) {
+			const gchar *path = g_ptr_array_index (paths, i);
+			GError *e = NULL;
+			Schematic *sm = schematic_read (path, &e);
+			SchematicView *sv;
+			gchar *title;
+
+			if (sm == NULL) {
+				g_warning ("Could not recover %s: %s", path, e->message);
+				g_clear_error (&e);
+				continue;
+			}
+
+			schematic_set_dirty (sm, TRUE);
+			g_object_set_data_full (G_OBJECT (sm), AUTOSAVE_PATH_KEY, g_strdup (path), g_free);
+
+			sv = schematic_view_new (sm);
+			// only the window tells it is recovered, the saved title stays
+			title = g_path_get_basename (path);
+			gtk_window_set_title (GTK_WINDOW (schematic_view_get_toplevel (sv)), title);
+			g_free (title);
+			gtk_widget_show_all (schematic_view_get_toplevel (sv));
+		}
+	} else {
+		for (i = 0; i < paths->len; i++)
+			g_unlink (g_ptr_array_index (paths, i));
+	}
+
+	g_string_free (msg, TRUE);
+	g_ptr_array_unref (paths);
+}
@@ -0,0 +1,45 @@
+/*
+ * autosave.h
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __AUTOSAVE_H
+#define __AUTOSAVE_H
+
+#include <glib.h>
+
+#include "schematic.h"
+
+/*
+ * Periodic saves of the changed schematics into recovery files, which
+ * are offered to be opened again after a crash.
+ *
+ * A snapshot of the schematic is taken on the main thread, it is
+ * written on a background thread while editing goes on.
+ */
+void autosave_set_interval (guint minutes);
+void autosave_schematic (Schematic *sm);
+void autosave_discard (Schematic *sm);
+void autosave_flush (void);
+gchar *autosave_get_dir (void);
+void autosave_recover (void);
+
+#endif
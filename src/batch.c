@@ -0,0 +1,403 @@
+/*
+ * batch.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <locale.h>
+#include <string.h>
+#include <glib/gi18n.h>
+
+#include "batch.h"
+#include "engine.h"
+#include "library-index.h"
+#include "options.h"
+#include "oregano.h"
+#include "oregano-config.h"
+#include "schematic.h"
+#include "simulation-store.h"
+
+// the CSV is written in pieces of about this size
+#define BATCH_CSV_BUFFER_SIZE 65536
+
+typedef struct
+{
+	GMainLoop *loop;
+	gboolean finished;
+	gboolean aborted;
+} BatchSimulation;
+
+static void batch_engine_done (OreganoEngine *engine, BatchSimulation *sim)
+{
+	sim->finished = TRUE;
+	g_main_loop_quit (sim->loop);
+}
+
+static void batch_engine_aborted (OreganoEngine *engine, BatchSimulation *sim)
+{
+	sim->finished = TRUE;
+	sim->aborted = TRUE;
+	g_main_loop_quit (sim->loop);
+}
+
+/**
+ * runs the engine until it is done, the engines report back through
+ * the main loop
+ *
+ * @returns FALSE if the simulation was aborted
+ */
+static gboolean batch_simulate (OreganoEngine *engine)
+{
+	BatchSimulation sim = {g_main_loop_new (NULL, FALSE), FALSE, FALSE};
+	gulong done_id, aborted_id;
+
+	done_id = g_signal_connect (engine, "done", G_CALLBACK (batch_engine_done), &sim);
+	aborted_id = g_signal_connect (engine, "aborted", G_CALLBACK (batch_engine_aborted), &sim);
+
+	oregano_engine_start (engine);
+	// engines which fail to start abort right away
+	if (!sim.finished)
+		g_main_loop_run (sim.loop);
+
+	g_signal_handler_disconnect (engine, done_id);
+	g_signal_handler_disconnect (engine, aborted_id);
+	g_main_loop_unref (sim.loop);
+
+	return !sim.aborted;
+}
+
+/**
+ * prints what the engine logged to the schematic, which tells why a
+ * simulation was aborted
+ */
+static void batch_print_log (Schematic *sm)
+{
+	GtkTextBuffer *buffer = schematic_get_log_text (sm);
+	GtkTextIter start, end;
+	gchar *text;
+
+	gtk_text_buffer_get_bounds (buffer, &start, &end);
+	text = gtk_text_buffer_get_text (buffer, &start, &end, FALSE);
+	if (text[0] != '\0')
+		g_printerr ("%s\n", text);
+	g_free (text);
+}
+
+/**
+ * @param path the path given on the command line
+ * @param schematic the path of the schematic
+ * @param extension the extension of the written file, without the dot
+ * @returns path, or the file named after the schematic inside path if
+ * path is a directory
+ */
+gchar *batch_get_output_path (const gchar *path, const gchar *schematic, const gchar *extension)
+{
+	gchar *basename, *dot, *name, *output;
+
+	if (!g_file_test (path, G_FILE_TEST_IS_DIR))
+		return g_strdup (path);
+
+	basename = g_path_get_basename (schematic);
+	dot = strrchr (basename, '.');
+	if (dot && dot != basename)
+		*dot = '\0';
+	name = g_strconcat (basename, ".", extension, NULL);
+	output = g_build_filename (path, name, NULL);
+
+	g_free (name);
+	g_free (basename);
+	return output;
+}
+
+static void batch_append_csv_field (GString *csv, const gchar *field)
+{
+	const gchar *c;
+
+	if (field == NULL)
+		return;
+	if (strpbrk (field, ",\"\r\n") == NULL) {
+		g_string_append (csv, field);
+		return;
+	}
+
+	g_string_append_c (csv, '"');
+	for (c = field; *c; c++) {
+		if (*c == '"')
+			g_string_append_c (csv, '"');
+		g_string_append_c (csv, *c);
+	}
+	g_string_append_c (csv, '"');
+}
+
+/**
+ * writes the analyses one after the other, each as a comment with the
+ * name of the analysis, a row of variable names and a row for each
+ * point, numbers are written in the C locale and read back exactly
+ */
+gboolean batch_write_csv (GList *analyses, GOutputStream *out, GError **error)
+{
+	GString *csv = g_string_sized_new (BATCH_CSV_BUFFER_SIZE + 1024);
+	gchar number[G_ASCII_DTOSTR_BUF_SIZE];
+	GList *iter;
+	gboolean success = TRUE;
+
+	for (iter = analyses; iter && success; iter = iter->next) {
+		SimulationData *data = iter->data;
+		const gdouble **columns;
+		gchar *name;
+		guint len, n_points = G_MAXUINT;
+		guint i, j;
+
+		name = oregano_engine_get_analysis_name (data);
+		if (iter != analyses)
+			g_string_append_c (csv, '\n');
+		g_string_append_printf (csv, "# %s\n", name);
+		g_free (name);
+
+		if (data->n_variables <= 0)
+			continue;
+
+		columns = g_new (const gdouble *, data->n_variables);
+		for (i = 0; i < data->n_variables; i++) {
+			columns[i] = simulation_data_get_column (data, i, &len);
+			n_points = MIN (n_points, len);
+			if (i > 0)
+				g_string_append_c (csv, ',');
+			batch_append_csv_field (csv, data->var_names[i]);
+		}
+		g_string_append_c (csv, '\n');
+
+		for (j = 0; j < n_points && success; j++) {
+			for (i = 0; i < data->n_variables; i++) {
+				if (i > 0)
+					g_string_append_c (csv, ',');
+				g_string_append (csv, g_ascii_dtostr (number, sizeof(number), columns[i][j]));
+			}
+			g_string_append_c (csv, '\n');
+
+			if (csv->len >= BATCH_CSV_BUFFER_SIZE) {
+				success = g_output_stream_write_all (out, csv->str, csv->len, NULL, NULL, error);
+				g_string_truncate (csv, 0);
+			}
+		}
+		g_free (columns);
+	}
+
+	if (success)
+		success = g_output_stream_write_all (out, csv->str, csv->len, NULL, NULL, error);
+	g_string_free (csv, TRUE);
+	return success;
+}
+
+static gboolean batch_export (OreganoEngine *engine, const gchar *path, GError **error)
+{
+	GFile *file = g_file_new_for_path (path);
+	GFileOutputStream *out;
+	gboolean success;
+
+	out = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+	g_object_unref (file);
+	if (out == NULL)
+		return FALSE;
+
+	success = batch_write_csv (oregano_engine_get_results (engine), G_OUTPUT_STREAM (out), error);
+	// a failed write already set error
+	if (success)
+		success = g_output_stream_close (G_OUTPUT_STREAM (out), NULL, error);
+	else
+		g_output_stream_close (G_OUTPUT_STREAM (out), NULL, NULL);
+	g_object_unref (out);
+	return success;
+}
+
+static gdouble batch_lap (GTimer *timer)
+{
+	gdouble ms = 1000. * g_timer_elapsed (timer, NULL);
+
+	g_timer_start (timer);
+	return ms;
+}
+
+/**
+ * loads, netlists, simulates and exports a single schematic, as far as
+ * the options ask for, and prints a line of timings
+ *
+ * @returns FALSE if any step failed
+ */
+static gboolean batch_process (const gchar *filename)
+{
+	const gchar *netlist = oregano_options_batch_netlist ();
+	const gchar *export = oregano_options_batch_export ();
+	gboolean simulate = oregano_options_batch_simulate ();
+	gdouble load_ms, netlist_ms = 0., simulate_ms = 0., export_ms = 0.;
+	GTimer *timer = g_timer_new ();
+	OreganoEngine *engine = NULL;
+	Schematic *sm;
+	const gchar *status = "ok";
+	GError *e = NULL;
+
+	sm = schematic_read (filename, &e);
+	load_ms = batch_lap (timer);
+	if (sm == NULL) {
+		g_printerr (_ ("%s: Could not load the schematic: %s\n"), filename,
+		            e ? e->message : _ ("unknown error"));
+		g_clear_error (&e);
+		status = "load-failed";
+		goto done;
+	}
+	schematic_set_filename (sm, filename);
+
+	if (netlist || simulate) {
+		engine = oregano_engine_factory_create_engine (oregano.engine, sm);
+		if (engine == NULL) {
+			g_printerr (_ ("%s: No simulation engine is available\n"), filename);
+			status = "no-engine";
+			goto done;
+		}
+	}
+
+	if (netlist) {
+		gchar *path = batch_get_output_path (netlist, filename, "cir");
+
+		g_timer_start (timer);
+		if (!oregano_engine_generate_netlist (engine, path, &e)) {
+			g_printerr (_ ("%s: Could not write the netlist to %s: %s\n"), filename, path,
+			            e ? e->message : _ ("unknown error"));
+			g_clear_error (&e);
+			status = "netlist-failed";
+		}
+		netlist_ms = batch_lap (timer);
+		g_free (path);
+		if (g_strcmp0 (status, "ok") != 0)
+			goto done;
+	}
+
+	if (simulate) {
+		g_timer_start (timer);
+		if (!batch_simulate (engine)) {
+			g_printerr (_ ("%s: The simulation was aborted\n"), filename);
+			batch_print_log (sm);
+			status = "simulate-failed";
+		}
+		simulate_ms = batch_lap (timer);
+		if (g_strcmp0 (status, "ok") != 0)
+			goto done;
+	}
+
+	if (export) {
+		gchar *path = batch_get_output_path (export, filename, "csv");
+
+		g_timer_start (timer);
+		if (!batch_export (engine, path, &e)) {
+			g_printerr (_ ("%s: Could not export the results to %s: %s\n"), filename, path,
+			            e->message);
+			g_clear_error (&e);
+			status = "export-failed";
+		}
+		export_ms = batch_lap (timer);
+		g_free (path);
+	}
+
+done:
+	g_print ("%s\t%.1f\t%.1f\t%.1f\t%.1f\t%s\n", filename, load_ms, netlist_ms, simulate_ms,
+	         export_ms, status);
+
+	if (engine)
+		g_object_unref (engine);
+	if (sm)
+		g_object_unref (sm);
+	g_timer_destroy (timer);
+	return g_strcmp0 (status, "ok") == 0;
+}
+
+/**
+ * the --batch mode, which never touches the display
+ *
+ * @param files the schematics to process
+ * @returns the exit status, 0 if every schematic was processed
+ */
+int batch_run (gchar **files, gint n_files)
+{
+	const gchar *const outputs[] = {oregano_options_batch_netlist (),
+	                                oregano_options_batch_export ()};
+	gint i;
+	guint n_failed = 0;
+	GTimer *timer, *total;
+
+	if (n_files <= 0) {
+		g_printerr (_ ("No schematics given to process.\n"));
+		return 1;
+	}
+
+	// several schematics would overwrite each other's output
+	for (i = 0; i < (gint)G_N_ELEMENTS (outputs); i++)
+		if (n_files > 1 && outputs[i] && !g_file_test (outputs[i], G_FILE_TEST_IS_DIR)) {
+			g_printerr (_ ("%s must be a directory when processing several schematics.\n"),
+			            outputs[i]);
+			return 1;
+		}
+
+	// Keep non localized input for ngspice
+	setlocale (LC_NUMERIC, "C");
+
+	timer = g_timer_new ();
+	oregano_config_load ();
+	if (oregano_options_batch_netlist () || oregano_options_batch_simulate ()) {
+		gint configured = oregano.engine;
+
+		// prefer an installed engine, as the interactive mode does
+		oregano_config_find_engine ();
+		if (oregano.engine < 0 || oregano.engine >= OREGANO_ENGINE_COUNT) {
+			if (oregano_options_batch_simulate ()) {
+				g_printerr (_ ("No simulation engine is installed.\n"));
+				g_object_unref (oregano.settings);
+				g_timer_destroy (timer);
+				return 1;
+			}
+			// a netlist is written without running the engine
+			oregano.engine = configured;
+		}
+	}
+
+	oregano_lookup_libraries (NULL);
+	if (oregano.libraries == NULL) {
+		g_printerr (_ ("Could not find a parts library, supposed to be in %s\n"),
+		            OREGANO_LIBRARYDIR);
+		g_object_unref (oregano.settings);
+		g_timer_destroy (timer);
+		return 1;
+	}
+	g_print ("# libraries\t%.1f ms\n", batch_lap (timer));
+	total = g_timer_new ();
+	g_print ("# schematic\tload ms\tnetlist ms\tsimulate ms\texport ms\tstatus\n");
+
+	for (i = 0; i < n_files; i++)
+		if (!batch_process (files[i]))
+			n_failed++;
+
+	g_print ("# %d schematics, %u failed, %.3f s\n", n_files, n_failed,
+	         g_timer_elapsed (total, NULL));
+
+	library_index_clear ();
+	g_object_unref (oregano.settings);
+	g_timer_destroy (total);
+	g_timer_destroy (timer);
+	return n_failed ? 1 : 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * batch.h
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BATCH_H
+#define __BATCH_H
+
+#include <gio/gio.h>
+
+/*
+ * Processing of schematics from the command line (--batch), without a
+ * display: each schematic is loaded, its netlist written, simulated and
+ * the results exported as CSV, as asked for by the options. The time
+ * each step took is reported on stdout, one line per schematic.
+ */
+int batch_run (gchar **files, gint n_files);
+gchar *batch_get_output_path (const gchar *path, const gchar *schematic, const gchar *extension);
+gboolean batch_write_csv (GList *analyses, GOutputStream *out, GError **error);
+
+#endif
@@ -38,9 +38,18 @@
 
 #include "dialogs.h"
 #include "oregano.h"
+#include "options.h"
 
 #include "pixmaps/logo.xpm"
 
+static void oregano_print_title_msg (const gchar *title, const gchar *msg)
+{
+	if (msg && msg[0] != '\0')
+		g_printerr ("%s: %s\n", title, msg);
+	else
+		g_printerr ("%s\n", title);
+}
+
 /*
  * Schedule a call to the oregano_error() function so that it is
  * called whenever there are no higher priority events pending.
@@ -76,6 +85,12 @@ void oregano_error_with_title (gchar *title, gchar *msg)
 	GString *span_msg;
 	pid_t tid = 0;
 
+	// batch mode has no display to show dialogs on
+	if (oregano_options_batch ()) {
+		oregano_print_title_msg (title, msg);
+		return;
+	}
+
 #ifdef SYS_gettid
 	tid = syscall(SYS_gettid);
 #endif
@@ -147,6 +162,12 @@ void oregano_warning_with_title (gchar *title, gchar *msg)
 	GString *span_msg;
 	pid_t tid = 0;
 
+	// batch mode has no display to show dialogs on
+	if (oregano_options_batch ()) {
+		oregano_print_title_msg (title, msg);
+		return;
+	}
+
 #ifdef SYS_gettid
 	tid = syscall(SYS_gettid);
 #endif
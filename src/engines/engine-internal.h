@@ -53,7 +53,9 @@ struct _OreganoEngineClass
 	void (*progress_solver)(OreganoEngine *engine, double *p);
 	void (*progress_reader)(OreganoEngine *engine, double *p);
 	gboolean (*get_netlist)(OreganoEngine *engine, const gchar *sm, GError **error);
+	gboolean (*write_netlist)(OreganoEngine *engine, GOutputStream *stream, GError **error);
 	GList *(*get_results)(OreganoEngine *engine);
+	SimulationData *(*get_live_results)(OreganoEngine *engine, gboolean *grew);
 	gchar *(*get_operation_solver)(OreganoEngine *engine);
 	gchar *(*get_operation_reader)(OreganoEngine *engine);
 	gboolean (*has_warnings)(OreganoEngine *engine);
@@ -35,6 +35,7 @@
 #include "engine-internal.h"
 #include "gnucap.h"
 #include "ngspice.h"
+#include "errors.h"
 
 static gchar *analysis_names[] = {
 	[ANALYSIS_TYPE_NONE]             = N_ ("None"),
@@ -137,11 +138,43 @@ gboolean oregano_engine_generate_netlist (OreganoEngine *self, const gchar *file
 	return OREGANO_ENGINE_GET_CLASS (self)->get_netlist (self, file, error);
 }
 
+/**
+ * \brief stream the netlist to a file descriptor, pipe, ...
+ *
+ * Engines which can not stream fail with OREGANO_SIMULATE_ERROR_IO_ERROR.
+ */
+gboolean oregano_engine_write_netlist (OreganoEngine *self, GOutputStream *stream, GError **error)
+{
+	if (OREGANO_ENGINE_GET_CLASS (self)->write_netlist == NULL) {
+		g_set_error_literal (error, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_IO_ERROR,
+		                     _ ("The engine can not stream its netlist."));
+		return FALSE;
+	}
+	return OREGANO_ENGINE_GET_CLASS (self)->write_netlist (self, stream, error);
+}
+
 GList *oregano_engine_get_results (OreganoEngine *self)
 {
 	return OREGANO_ENGINE_GET_CLASS (self)->get_results (self);
 }
 
+/**
+ * \brief the transient analysis while the engine still produces it
+ *
+ * Main thread only. Engines which can not show partial results always
+ * return NULL.
+ *
+ * @param grew [out] TRUE if rows or variables were added since the last call
+ * @returns the partial results, owned by the engine, or NULL
+ */
+SimulationData *oregano_engine_get_live_results (OreganoEngine *self, gboolean *grew)
+{
+	*grew = FALSE;
+	if (OREGANO_ENGINE_GET_CLASS (self)->get_live_results == NULL)
+		return NULL;
+	return OREGANO_ENGINE_GET_CLASS (self)->get_live_results (self, grew);
+}
+
 gchar *oregano_engine_get_current_operation_solver (OreganoEngine *self)
 {
 	g_return_val_if_fail(OREGANO_ENGINE_GET_CLASS (self)->get_operation_solver != NULL, NULL);
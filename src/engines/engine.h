@@ -52,7 +52,10 @@ gboolean oregano_engine_has_warnings (OreganoEngine *engine);
 void oregano_engine_get_progress_solver (OreganoEngine *engine, double *p);
 void oregano_engine_get_progress_reader (OreganoEngine *engine, double *p);
 gboolean oregano_engine_generate_netlist (OreganoEngine *engine, const gchar *file, GError **error);
+gboolean oregano_engine_write_netlist (OreganoEngine *engine, GOutputStream *stream,
+                                       GError **error);
 GList *oregano_engine_get_results (OreganoEngine *engine);
+SimulationData *oregano_engine_get_live_results (OreganoEngine *engine, gboolean *grew);
 gchar *oregano_engine_get_current_operation_solver (OreganoEngine *);
 gchar *oregano_engine_get_current_operation_reader (OreganoEngine *);
 gboolean oregano_engine_is_available (OreganoEngine *);
@@ -36,6 +36,7 @@
 
 #include "gnucap.h"
 #include "netlist-helper.h"
+#include "model-index.h"
 #include "dialogs.h"
 #include "engine-internal.h"
 
@@ -151,7 +152,8 @@ static void gnucap_finalize (GObject *object)
 		g_free (data->var_names);
 		g_free (data->var_units);
 		for (i = 0; i < data->n_variables; i++)
-			g_array_free (data->data[i], TRUE);
+			// plot functions may still share the column
+			g_array_unref (data->data[i]);
 		g_free (data->min_data);
 		g_free (data->max_data);
 
@@ -187,6 +189,7 @@ static gboolean gnucap_generate_netlist (OreganoEngine *engine, const gchar *fil
 	SimOption *so;
 	GList *iter;
 	FILE *file;
+	GString *models;
 	GError *local_error = NULL;
 
 	gnucap = OREGANO_GNUCAP (engine);
@@ -200,6 +203,8 @@ static gboolean gnucap_generate_netlist (OreganoEngine *engine, const gchar *fil
 	file = fopen (filename, "w");
 	if (!file) {
 		oregano_error (g_strdup_printf ("Creation of file %s not possible\n", filename));
+		if (output.subckts)
+			g_string_free (output.subckts, TRUE);
 		return FALSE;
 	}
 
@@ -228,11 +233,25 @@ static gboolean gnucap_generate_netlist (OreganoEngine *engine, const gchar *fil
 
 	// Include of subckt models
 	fputs ("*------------- Models -------------------------\n", file);
-	for (iter = output.models; iter; iter = iter->next) {
-		gchar *model;
-		model = (gchar *)iter->data;
-		g_fprintf (file, ".include %s/%s.model\n", OREGANO_MODELDIR, model);
+	models = g_string_new ("");
+	if (!model_index_write_models (output.models, models, &local_error)) {
+		g_propagate_error (error, local_error);
+		g_string_free (models, TRUE);
+		if (output.subckts)
+			g_string_free (output.subckts, TRUE);
+		fclose (file);
+		return FALSE;
+	}
+	fputs (models->str, file);
+	g_string_free (models, TRUE);
+
+	// Prints hierarchical blocks
+	if (output.subckts && output.subckts->len > 0) {
+		fputs ("*------------- Subcircuits --------------------\n", file);
+		fputs (output.subckts->str, file);
 	}
+	if (output.subckts)
+		g_string_free (output.subckts, TRUE);
 
 	// Prints template parts
 	fputs ("*------------- Circuit Description-------------\n", file);
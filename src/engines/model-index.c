@@ -0,0 +1,589 @@
+/*
+ * model-index.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#include "model-index.h"
+#include "errors.h"
+
+#include "debug.h"
+
+#define MODEL_INDEX_MAGIC "oregano-model-index 1"
+#define MODEL_INDEX_SUFFIX ".model"
+
+typedef struct
+{
+	gchar *name;  ///< model name, as used by the "model" property
+	gsize offset; ///< offset within the preprocessed library
+	gsize length;
+	gchar **deps; ///< models this one instantiates
+} ModelIndexEntry;
+
+struct _ModelIndex
+{
+	GBytes *library; ///< preprocessed library, usually memory mapped
+	GHashTable *entries; ///< name -> ModelIndexEntry
+};
+
+// the index is shared by all netlisting engines
+G_LOCK_DEFINE_STATIC (model_index);
+static ModelIndex *model_index = NULL;
+static gchar *model_index_stamp = NULL;
+// NULL for OREGANO_MODELDIR and the user cache directory
+static gchar *model_index_model_dir = NULL;
+static gchar *model_index_cache_dir = NULL;
+
+static const gchar *model_index_get_model_dir (void)
+{
+	return model_index_model_dir ? model_index_model_dir : OREGANO_MODELDIR;
+}
+
+static void model_index_entry_free (ModelIndexEntry *entry)
+{
+	g_free (entry->name);
+	g_strfreev (entry->deps);
+	g_free (entry);
+}
+
+static ModelIndex *model_index_new (void)
+{
+	ModelIndex *index = g_new0 (ModelIndex, 1);
+
+	index->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+	                                        (GDestroyNotify)model_index_entry_free);
+	return index;
+}
+
+static void model_index_free (ModelIndex *index)
+{
+	if (index->library)
+		g_bytes_unref (index->library);
+	g_hash_table_destroy (index->entries);
+	g_free (index);
+}
+
+static gint model_index_compare_names (gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0 (*(const gchar **)a, *(const gchar **)b);
+}
+
+/**
+ * lists the model files of dir in alphabetical order, together with a
+ * stamp which changes whenever a model file is added, removed or changed
+ *
+ * @returns array of model names (without suffix), free with g_ptr_array_unref
+ */
+static GPtrArray *model_index_scan_dir (const gchar *dir, gchar **stamp, GError **error)
+{
+	GDir *gdir;
+	const gchar *filename;
+	GPtrArray *names;
+	GStatBuf st;
+	gint64 newest = 0;
+	gchar *path;
+
+	gdir = g_dir_open (dir, 0, error);
+	if (!gdir)
+		return NULL;
+
+	names = g_ptr_array_new_with_free_func (g_free);
+	while ((filename = g_dir_read_name (gdir))) {
+		if (!g_str_has_suffix (filename, MODEL_INDEX_SUFFIX))
+			continue;
+
+		path = g_build_filename (dir, filename, NULL);
+		if (g_stat (path, &st) == 0 && (gint64)st.st_mtime > newest)
+			newest = st.st_mtime;
+		g_free (path);
+
+		g_ptr_array_add (names, g_strndup (filename,
+		                                   strlen (filename) - strlen (MODEL_INDEX_SUFFIX)));
+	}
+	g_dir_close (gdir);
+
+	g_ptr_array_sort (names, model_index_compare_names);
+
+	if (g_stat (dir, &st) == 0 && (gint64)st.st_mtime > newest)
+		newest = st.st_mtime;
+	*stamp = g_strdup_printf ("%s\t%u\t%" G_GINT64_FORMAT, dir, names->len, newest);
+
+	return names;
+}
+
+/**
+ * collects the names a model file defines (.subckt, .model) and the
+ * names its element cards refer to
+ */
+static void model_index_scan_model (const gchar *content, GHashTable *defines,
+                                    GHashTable *references)
+{
+	gchar **lines, **tokens, *line;
+	gchar *last;
+	gint i, j;
+
+	lines = g_strsplit (content, "\n", 0);
+	for (i = 0; lines[i]; i++) {
+		line = g_strstrip (lines[i]);
+
+		if (!g_ascii_strncasecmp (line, ".subckt", 7) ||
+		    !g_ascii_strncasecmp (line, ".model", 6)) {
+			tokens = g_strsplit_set (line, " \t", 0);
+			for (j = 1; tokens[j]; j++) {
+				if (*tokens[j]) {
+					g_hash_table_add (defines, g_ascii_strup (tokens[j], -1));
+					break;
+				}
+			}
+			g_strfreev (tokens);
+			continue;
+		}
+
+		// subcircuit instances and semiconductors refer to a model by
+		// their last positional argument
+		if (*line == '\0' || !strchr ("XxDdQqMmJjZz", *line))
+			continue;
+
+		tokens = g_strsplit_set (line, " \t", 0);
+		last = NULL;
+		for (j = 1; tokens[j]; j++) {
+			if (!g_ascii_strcasecmp (tokens[j], "params:"))
+				break;
+			if (*tokens[j] && !strchr (tokens[j], '=') && !g_ascii_isdigit (*tokens[j]))
+				last = tokens[j];
+		}
+		if (last)
+			g_hash_table_add (references, g_ascii_strup (last, -1));
+		g_strfreev (tokens);
+	}
+	g_strfreev (lines);
+}
+
+static gboolean model_index_map_library (ModelIndex *index, const gchar *library_file,
+                                         GError **error)
+{
+	GMappedFile *mapped;
+
+	mapped = g_mapped_file_new (library_file, FALSE, error);
+	if (!mapped)
+		return FALSE;
+
+	index->library = g_mapped_file_get_bytes (mapped);
+	g_mapped_file_unref (mapped);
+	return TRUE;
+}
+
+/**
+ * builds the preprocessed library and the index from scratch and stores
+ * both in the cache directory
+ */
+static ModelIndex *model_index_build (const gchar *dir, GPtrArray *names, const gchar *stamp,
+                                      const gchar *library_file, const gchar *index_file)
+{
+	ModelIndex *index;
+	GString *library, *index_buffer;
+	GHashTable *defined_by, **defines, **references;
+	GHashTableIter iter;
+	gpointer key;
+	GPtrArray *deps;
+	gchar *path, *content;
+	gsize length;
+	guint i;
+	GError *e = NULL;
+
+	index = model_index_new ();
+	library = g_string_new ("");
+	defined_by = g_hash_table_new (g_str_hash, g_str_equal);
+	defines = g_new0 (GHashTable *, names->len);
+	references = g_new0 (GHashTable *, names->len);
+
+	for (i = 0; i < names->len; i++) {
+		ModelIndexEntry *entry;
+		gchar *filename;
+
+		filename = g_strconcat (g_ptr_array_index (names, i), MODEL_INDEX_SUFFIX, NULL);
+		path = g_build_filename (dir, filename, NULL);
+		g_free (filename);
+
+		defines[i] = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		references[i] = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+		if (!g_file_get_contents (path, &content, &length, &e)) {
+			g_warning ("Failed to index model %s: %s", path, e->message);
+			g_clear_error (&e);
+			g_free (path);
+			continue;
+		}
+		g_free (path);
+
+		entry = g_new0 (ModelIndexEntry, 1);
+		entry->name = g_strdup (g_ptr_array_index (names, i));
+		entry->offset = library->len;
+		entry->length = length;
+		g_string_append_len (library, content, length);
+		if (length > 0 && content[length - 1] != '\n') {
+			g_string_append_c (library, '\n');
+			entry->length++;
+		}
+		g_hash_table_insert (index->entries, entry->name, entry);
+
+		model_index_scan_model (content, defines[i], references[i]);
+		g_free (content);
+
+		// the first model file (alphabetically) defining a name wins
+		g_hash_table_iter_init (&iter, defines[i]);
+		while (g_hash_table_iter_next (&iter, &key, NULL))
+			if (!g_hash_table_contains (defined_by, key))
+				g_hash_table_insert (defined_by, key, g_ptr_array_index (names, i));
+	}
+
+	// resolve references which are not defined within the file itself
+	index_buffer = g_string_new (MODEL_INDEX_MAGIC "\n");
+	g_string_append_printf (index_buffer, "%s\n", stamp);
+	for (i = 0; i < names->len; i++) {
+		ModelIndexEntry *entry;
+		const gchar *dep;
+
+		entry = g_hash_table_lookup (index->entries, g_ptr_array_index (names, i));
+		if (!entry)
+			continue;
+
+		deps = g_ptr_array_new ();
+		g_hash_table_iter_init (&iter, references[i]);
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			if (g_hash_table_contains (defines[i], key))
+				continue;
+			dep = g_hash_table_lookup (defined_by, key);
+			if (dep && g_strcmp0 (dep, entry->name))
+				g_ptr_array_add (deps, g_strdup (dep));
+		}
+		g_ptr_array_sort (deps, model_index_compare_names);
+		g_ptr_array_add (deps, NULL);
+		entry->deps = (gchar **)g_ptr_array_free (deps, FALSE);
+
+		content = g_strjoinv (",", entry->deps);
+		g_string_append_printf (index_buffer, "%s\t%" G_GSIZE_FORMAT "\t%" G_GSIZE_FORMAT "\t%s\n",
+		                        entry->name, entry->offset, entry->length, content);
+		g_free (content);
+	}
+
+	for (i = 0; i < names->len; i++) {
+		g_hash_table_destroy (defines[i]);
+		g_hash_table_destroy (references[i]);
+	}
+	g_free (defines);
+	g_free (references);
+	g_hash_table_destroy (defined_by);
+
+	// write the library first, the index is only valid if both exist
+	if (!g_file_set_contents (library_file, library->str, library->len, &e) ||
+	    !g_file_set_contents (index_file, index_buffer->str, index_buffer->len, &e) ||
+	    !model_index_map_library (index, library_file, &e)) {
+		g_warning ("Failed to cache the model index: %s", e->message);
+		g_clear_error (&e);
+		g_unlink (index_file);
+	}
+
+	g_string_free (index_buffer, TRUE);
+	if (index->library)
+		g_string_free (library, TRUE);
+	else // keep going with the library held in memory
+		index->library = g_string_free_to_bytes (library);
+
+	return index;
+}
+
+/**
+ * loads a previously built index from the cache directory
+ *
+ * @returns NULL if there is none or it is stale
+ */
+static ModelIndex *model_index_load (const gchar *stamp, const gchar *library_file,
+                                     const gchar *index_file)
+{
+	ModelIndex *index;
+	gchar *content, **lines, **fields;
+	gsize library_length;
+	gint i;
+
+	if (!g_file_get_contents (index_file, &content, NULL, NULL))
+		return NULL;
+
+	lines = g_strsplit (content, "\n", 0);
+	g_free (content);
+
+	if (!lines[0] || g_strcmp0 (lines[0], MODEL_INDEX_MAGIC) || !lines[1] ||
+	    g_strcmp0 (lines[1], stamp)) {
+		g_strfreev (lines);
+		return NULL;
+	}
+
+	index = model_index_new ();
+	if (!model_index_map_library (index, library_file, NULL)) {
+		model_index_free (index);
+		g_strfreev (lines);
+		return NULL;
+	}
+	library_length = g_bytes_get_size (index->library);
+
+	for (i = 2; lines[i]; i++) {
+		ModelIndexEntry *entry;
+
+		if (!*lines[i])
+			continue;
+
+		fields = g_strsplit (lines[i], "\t", 4);
+		if (g_strv_length (fields) != 4) {
+			g_strfreev (fields);
+			continue;
+		}
+
+		entry = g_new0 (ModelIndexEntry, 1);
+		entry->name = g_strdup (fields[0]);
+		entry->offset = g_ascii_strtoull (fields[1], NULL, 10);
+		entry->length = g_ascii_strtoull (fields[2], NULL, 10);
+		entry->deps = *fields[3] ? g_strsplit (fields[3], ",", 0) : g_new0 (gchar *, 1);
+		g_strfreev (fields);
+
+		if (entry->offset + entry->length > library_length) {
+			// truncated library, rebuild everything
+			model_index_entry_free (entry);
+			model_index_free (index);
+			g_strfreev (lines);
+			return NULL;
+		}
+		g_hash_table_insert (index->entries, entry->name, entry);
+	}
+	g_strfreev (lines);
+
+	return index;
+}
+
+/**
+ * makes sure model_index is up to date, must be called with the lock held
+ */
+static gboolean model_index_update (GError **error)
+{
+	GPtrArray *names;
+	gchar *stamp, *cache_dir, *library_file, *index_file;
+	ModelIndex *index;
+
+	const gchar *model_dir = model_index_get_model_dir ();
+
+	names = model_index_scan_dir (model_dir, &stamp, error);
+	if (!names)
+		return FALSE;
+
+	if (model_index && !g_strcmp0 (stamp, model_index_stamp)) {
+		g_free (stamp);
+		g_ptr_array_unref (names);
+		return TRUE;
+	}
+
+	if (model_index_cache_dir)
+		cache_dir = g_strdup (model_index_cache_dir);
+	else
+		cache_dir = g_build_filename (g_get_user_cache_dir (), "oregano", NULL);
+	g_mkdir_with_parents (cache_dir, 0755);
+	library_file = g_build_filename (cache_dir, "models.lib", NULL);
+	index_file = g_build_filename (cache_dir, "models.idx", NULL);
+
+	index = model_index_load (stamp, library_file, index_file);
+	if (!index) {
+		NG_DEBUG ("Building model index of %u models.\n", names->len);
+		index = model_index_build (model_dir, names, stamp, library_file, index_file);
+	}
+
+	if (model_index)
+		model_index_free (model_index);
+	model_index = index;
+	g_free (model_index_stamp);
+	model_index_stamp = stamp;
+
+	g_free (index_file);
+	g_free (library_file);
+	g_free (cache_dir);
+	g_ptr_array_unref (names);
+
+	return TRUE;
+}
+
+/**
+ * @returns the start of the line after the one at line, or stop
+ */
+static const gchar *model_index_next_line (const gchar *line, const gchar *stop)
+{
+	const gchar *end = memchr (line, '\n', stop - line);
+
+	return end ? end + 1 : stop;
+}
+
+/**
+ * @returns TRUE if the line at line continues the card before it
+ */
+static gboolean model_index_is_continuation (const gchar *line, const gchar *stop)
+{
+	while (line < stop && (*line == ' ' || *line == '\t'))
+		line++;
+	return line < stop && *line == '+';
+}
+
+/**
+ * appends the model and all models it depends on, dependencies first
+ */
+static gboolean model_index_append_model (ModelIndex *index, const gchar *name,
+                                          GHashTable *emitted, GHashTable *cards,
+                                          GString *out, GError **error)
+{
+	ModelIndexEntry *entry;
+	const gchar *library, *line, *end, *stop;
+	gboolean in_subckt = FALSE;
+	gchar *card;
+	gint i;
+
+	if (g_hash_table_contains (emitted, name))
+		return TRUE;
+
+	entry = g_hash_table_lookup (index->entries, name);
+	if (!entry) {
+		g_set_error (error, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_NO_SUCH_PART,
+		             _ ("Could not find model %s in %s."), name,
+		             model_index_get_model_dir ());
+		return FALSE;
+	}
+	g_hash_table_add (emitted, entry->name);
+
+	for (i = 0; entry->deps[i]; i++)
+		if (!model_index_append_model (index, entry->deps[i], emitted, cards, out, error))
+			return FALSE;
+
+	g_string_append_printf (out, "* %s%s\n", entry->name, MODEL_INDEX_SUFFIX);
+
+	// Many model files carry identical helper models (e.g. the diodes of
+	// darlington transistors), only emit the first copy of those.
+	library = g_bytes_get_data (index->library, NULL);
+	stop = library + entry->offset + entry->length;
+	for (line = library + entry->offset; line < stop; line = end) {
+		end = model_index_next_line (line, stop);
+
+		if (!g_ascii_strncasecmp (line, ".subckt", 7))
+			in_subckt = TRUE;
+		else if (!g_ascii_strncasecmp (line, ".ends", 5))
+			in_subckt = FALSE;
+		else if (!in_subckt && !g_ascii_strncasecmp (line, ".model", 6)) {
+			// the card goes on in the + lines after it
+			while (end < stop && model_index_is_continuation (end, stop))
+				end = model_index_next_line (end, stop);
+
+			card = g_strndup (line, end - line);
+			if (g_hash_table_contains (cards, card)) {
+				g_free (card);
+				continue;
+			}
+			g_hash_table_add (cards, card);
+		}
+		g_string_append_len (out, line, end - line);
+	}
+
+	return TRUE;
+}
+
+/**
+ * \brief write the models used by a netlist
+ *
+ * Emits one concatenated block with every model and all models it
+ * depends on exactly once, instead of one .include per model which
+ * ngspice would have to open and parse on every run. If the index is
+ * not available the models are included from OREGANO_MODELDIR.
+ *
+ * @param models list of model names, as collected by netlist_helper_create
+ * @param out the netlist to append to
+ * @param error [allow-none]
+ */
+gboolean model_index_write_models (GList *models, GString *out, GError **error)
+{
+	GHashTable *emitted, *cards;
+	GError *e = NULL;
+	gboolean ret = TRUE;
+	GList *iter;
+
+	if (!models)
+		return TRUE;
+
+	G_LOCK (model_index);
+
+	if (!model_index_update (&e)) {
+		g_warning ("Failed to index the models: %s", e->message);
+		g_clear_error (&e);
+
+		for (iter = models; iter; iter = iter->next) {
+			gchar *model_with_ext = g_strdup_printf ("%s%s", (gchar *)iter->data,
+			                                         MODEL_INDEX_SUFFIX);
+			gchar *model_path =
+			    g_build_filename (model_index_get_model_dir (), model_with_ext, NULL);
+			g_string_append_printf (out, ".include %s\n", model_path);
+			g_free (model_path);
+			g_free (model_with_ext);
+		}
+		G_UNLOCK (model_index);
+		return TRUE;
+	}
+
+	emitted = g_hash_table_new (g_str_hash, g_str_equal);
+	cards = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	for (iter = models; iter && ret; iter = iter->next)
+		ret = model_index_append_model (model_index, iter->data, emitted, cards, out, error);
+
+	g_hash_table_destroy (cards);
+	g_hash_table_destroy (emitted);
+
+	G_UNLOCK (model_index);
+	return ret;
+}
+
+/**
+ * reads the models from model_dir and caches the index in cache_dir
+ * instead of the defaults, NULL for the default
+ *
+ * The index in memory is dropped, so it is loaded from the cache or
+ * built again on the next use.
+ */
+void model_index_set_dirs (const gchar *model_dir, const gchar *cache_dir)
+{
+	G_LOCK (model_index);
+
+	g_free (model_index_model_dir);
+	model_index_model_dir = g_strdup (model_dir);
+	g_free (model_index_cache_dir);
+	model_index_cache_dir = g_strdup (cache_dir);
+
+	if (model_index)
+		model_index_free (model_index);
+	model_index = NULL;
+	g_clear_pointer (&model_index_stamp, g_free);
+
+	G_UNLOCK (model_index);
+}
@@ -0,0 +1,42 @@
+/*
+ * model-index.h
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __MODEL_INDEX_H
+#define __MODEL_INDEX_H
+
+#include <glib.h>
+
+/**
+ * Index over all model files of OREGANO_MODELDIR.
+ *
+ * All model files are concatenated once into a preprocessed library in
+ * the user cache directory, the index maps every model name to its
+ * offset and length within that library and to the models it depends
+ * on. Both files are rebuilt whenever the model directory changes.
+ */
+typedef struct _ModelIndex ModelIndex;
+
+gboolean model_index_write_models (GList *models, GString *out, GError **error);
+void model_index_set_dirs (const gchar *model_dir, const gchar *cache_dir);
+
+#endif
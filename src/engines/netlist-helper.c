@@ -48,6 +48,7 @@
 #include "part-private.h"
 #include "part-property.h"
 #include "netlist-helper.h"
+#include "model-index.h"
 #include "errors.h"
 #include "dialogs.h"
 
@@ -63,6 +64,8 @@ static gboolean netlist_helper_foreach_model_save (gpointer key, gpointer model,
                                                    gpointer user_data);
 static char *netlist_helper_linebreak (char *str);
 static void netlist_helper_nl_node_traverse (Node *node, GSList **lst);
+static char *netlist_helper_analysis_string (NodeStore *store, NetlistData *data,
+                                             gchar **node2real, gboolean do_ac);
 
 static void netlist_helper_nl_wire_traverse (Wire *wire, GSList **lst)
 {
@@ -365,23 +368,49 @@ void update_schematic(Schematic *sm) {
 	return;
 }
 
-// FIXME this one piece of ugly+bad code
-void netlist_helper_create (Schematic *sm, Netlist *out, GError **error)
+/**
+ * \brief subcircuit definitions collected while netlisting
+ *
+ * Every hierarchical block (a part with a "Subckt" property) is
+ * netlisted exactly once per unique block name, no matter how many
+ * instances of it are placed. Instances only emit their X card.
+ */
+typedef struct
 {
-	NetlistData data;
-	GList *iter;
-	Part *part;
-	gint pin_nr, num_nodes, num_gnd_nodes, i, j, num_clamps;
-	Pin *pins;
-	gchar *template, **template_split;
-	NodeStore *store;
+	GString *definitions; ///< .subckt ... .ends blocks, nested ones first
+	GHashTable *names;    ///< block names already defined
+	GHashTable *active;   ///< block names being netlisted, to find cycles
+	GHashTable *models;   ///< models of the top level netlist, shared
+	GHashTable *blocks;   ///< preloaded sub-schematics by path, or NULL
+	gchar *dirname;       ///< directory of the schematic being netlisted
+	guint depth;
+} SubcktData;
+
+struct _NetlistSnapshot
+{
+	NetlistData data;     ///< the traversed original, pins are the ones of parts
 	gchar **node2real;
+	GList *parts;         ///< private copies of the parts, in the order of originals
+	GPtrArray *originals; ///< parts of the original
+	gchar *filename;
+	SimSettings *settings; ///< private copy of the simulation settings
+	gchar *analysis;       ///< clamps to print, only if needed by settings
+	GHashTable *blocks;    ///< sub-schematics of hierarchical blocks by path
+};
 
-	out->models = NULL;
-	out->title = schematic_get_filename (sm);
-	out->settings = schematic_get_sim_settings (sm);
-	store = schematic_get_store (sm);
-	out->store = store;
+#define NETLIST_HELPER_SUBCKT_MAX_DEPTH 32
+
+static gboolean netlist_helper_subckt_build (Schematic *sm, const gchar *name,
+                                             const gchar *ports, SubcktData *sd,
+                                             GError **error);
+
+/**
+ * resets all visited flags and collects nodes, pins, markers and models
+ * of the given schematic into data
+ */
+static void netlist_helper_traverse (NodeStore *store, NetlistData *data)
+{
+	GList *iter;
 
 	node_store_node_foreach (store, (GHFunc *)netlist_helper_node_foreach_reset, NULL);
 
@@ -390,184 +419,929 @@ void netlist_helper_create (Schematic *sm, Netlist *out, GError **error)
 		wire_set_visited (wire, FALSE);
 	}
 
-	netlist_helper_init_data (&data);
-	data.store = store;
+	netlist_helper_init_data (data);
+	data->store = store;
+
+	node_store_node_foreach (store, (GHFunc *)netlist_helper_node_foreach_traverse, data);
+}
+
+static void netlist_helper_clear_data (NetlistData *data)
+{
+	g_hash_table_foreach (data->models, (GHFunc)netlist_helper_foreach_model_free, NULL);
+	g_hash_table_destroy (data->models);
+	g_hash_table_destroy (data->pins);
+	g_list_free_full (data->node_and_number_list, (GDestroyNotify)g_free);
+}
+
+/**
+ * Build an array for going from node nr to "real node nr",
+ * where gnd nodes are nr 0 and the rest of the nodes are
+ * 1, 2, 3, ... Nodes with a marker get the name of the marker.
+ *
+ * @returns a NULL terminated array, free with g_strfreev
+ */
+static gchar **netlist_helper_create_node2real (NetlistData *data)
+{
+	gchar **node2real;
+	gint num_nodes, i, j;
+	GList *iter;
+
+	num_nodes = data->node_nr - 1;
+
+	node2real = g_new0 (gchar *, num_nodes + 1 + 1);
+	node2real[0] = g_strdup ("");    // node numbers start at 1
+	node2real[num_nodes + 1] = NULL; // so we can use g_strfreev
+
+	for (i = 1, j = 1; i <= num_nodes; i++) {
+		GSList *mlist;
+
+		if (g_slist_find (data->gnd_list, GINT_TO_POINTER (i))) {
+			node2real[i] = g_strdup ("0");
+		} else if ((mlist = g_slist_find_custom (data->mark_list, GINT_TO_POINTER (i),
+		                                         compare_marker))) {
+			Marker *marker = mlist->data;
+			node2real[i] = g_strdup (marker->name);
+		} else {
+			node2real[i] = g_strdup_printf ("%d", j++);
+		}
+	}
+
+	// Fill in the netlist node names for all the used nodes.
+	for (iter = data->node_and_number_list; iter; iter = iter->next) {
+		NodeAndNumber *nan = iter->data;
+		if (nan->node_nr > 0) {
+			g_free (nan->node->netlist_node_name);
+			nan->node->netlist_node_name = g_strdup (node2real[nan->node_nr]);
+		}
+	}
+
+	return node2real;
+}
+
+/**
+ * resolves the "Schematic" property of a block relative to dirname,
+ * the directory of the schematic the block is placed on
+ */
+static gchar *netlist_helper_subckt_path (const gchar *dirname, const gchar *filename)
+{
+	if (g_path_is_absolute (filename) || !dirname)
+		return g_strdup (filename);
+	return g_build_filename (dirname, filename, NULL);
+}
+
+/**
+ * makes sure the block an instance refers to is defined in sd
+ *
+ * The part has to carry a "Subckt" property (the block name, which is
+ * also used by the X card template, i.e. "X@refdes %1 %2 @Subckt") and
+ * a "Schematic" property pointing to the sub-schematic. The optional
+ * "Ports" property lists the sub-schematic node labels in pin order.
+ */
+static gboolean netlist_helper_subckt_require (Part *part, SubcktData *sd, GError **error)
+{
+	gchar *name, *filename, *ports, *path;
+	Schematic *sub;
+	GError *e = NULL;
+	gboolean ret = FALSE;
+
+	name = part_get_property (part, "Subckt");
+	if (!name)
+		return TRUE;
+
+	if (g_hash_table_contains (sd->names, name)) {
+		g_free (name);
+		return TRUE;
+	}
+
+	if (g_hash_table_contains (sd->active, name)) {
+		g_set_error (error, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_NO_SUCH_PART,
+		             _ ("Block %s includes itself."), name);
+		g_free (name);
+		return FALSE;
+	}
+
+	filename = part_get_property (part, "Schematic");
+	if (!filename) {
+		g_set_error (error, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_NO_SUCH_PART,
+		             _ ("Block %s does not refer to a sub-schematic."), name);
+		g_free (name);
+		return FALSE;
+	}
+
+	if (sd->depth >= NETLIST_HELPER_SUBCKT_MAX_DEPTH) {
+		g_set_error (error, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_NO_SUCH_PART,
+		             _ ("Block %s is nested too deep, is it including itself?"), name);
+		g_free (filename);
+		g_free (name);
+		return FALSE;
+	}
+
+	path = netlist_helper_subckt_path (sd->dirname, filename);
+
+	if (sd->blocks) {
+		sub = g_hash_table_lookup (sd->blocks, path);
+		if (sub)
+			g_object_ref (sub);
+		else
+			g_set_error (&e, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_NO_SUCH_PART,
+			             _ ("Sub-schematic %s of block %s is not loaded."), path, name);
+	} else {
+		sub = schematic_read (path, &e);
+	}
+	if (!sub) {
+		g_propagate_error (error, e);
+	} else {
+		// blocks nested in sub are found next to it
+		gchar *dirname = sd->dirname;
+
+		sd->dirname = g_path_get_dirname (path);
+		g_hash_table_add (sd->active, g_strdup (name));
+		ports = part_get_property (part, "Ports");
+		sd->depth++;
+		ret = netlist_helper_subckt_build (sub, name, ports, sd, error);
+		sd->depth--;
+		g_free (ports);
+		g_hash_table_remove (sd->active, name);
+		g_free (sd->dirname);
+		sd->dirname = dirname;
+		g_object_unref (sub);
+
+		// only a complete definition counts as defined
+		if (ret)
+			g_hash_table_add (sd->names, g_strdup (name));
+	}
+
+	g_free (path);
+	g_free (filename);
+	g_free (name);
+	return ret;
+}
+
+/**
+ * expands the template of a single part into its card and appends it
+ * to out, clamps only get their node number assigned
+ *
+ * Only reads the part's properties and writes its own pins, so this may
+ * run on several parts of the same store concurrently.
+ */
+static gboolean netlist_helper_render_card (NetlistData *data, gchar **node2real, Part *part,
+                                            GRegex *regex, GString *out, GError **error)
+{
+	gint pin_nr;
+	Pin *pins;
+	gchar *template, **template_split;
+	gchar *tmp, *internal;
+	gsize start = out->len;
+
+	internal = part_get_property (part, "internal");
+	if (internal != NULL) {
+		gint node_nr;
+		Pin *pins;
+		if (g_ascii_strcasecmp (internal, "clamp") != 0) {
+			g_free (internal);
+			return TRUE;
+		}
+
+		// Got a clamp!, set node number
+		pins = part_get_pins (part);
+		node_nr = GPOINTER_TO_INT (g_hash_table_lookup (data->pins, &pins[0]));
+		if (!node_nr) {
+			g_warning ("Couldn't find part, pin_nr %d.", 0);
+		} else {
+			// need to substrac 1, netlist starts in 0, and node_nr in 1
+			pins[0].node_nr = atoi (node2real[node_nr]);
+		}
+		g_free (internal);
+		return TRUE;
+	}
+
+	tmp = part_get_property (part, "template");
+	if (!tmp) {
+		return TRUE;
+	}
+
+	template = part_property_expand_macros (part, tmp);
+	NG_DEBUG ("Template: '%s'\n"
+	          "macro   : '%s'\n",
+	          tmp, template);
+
+	g_free (tmp);
+	tmp = netlist_helper_linebreak (template);
 
-	node_store_node_foreach (store, (GHFunc *)netlist_helper_node_foreach_traverse, &data);
-	num_gnd_nodes = g_slist_length (data.gnd_list);
-	num_clamps = g_slist_length (data.clamp_list);
+	g_free (template);
+	template = tmp;
+
+	pins = part_get_pins (part);
+
+	GMatchInfo *match_info;
+	GError *error_match = NULL;
+
+	g_regex_match_full (regex, template, -1, 0, 0, &match_info, &error_match);
+	template_split = g_regex_split (regex, template, 0);
+
+	NG_DEBUG ("Reading pins.\n)");
+
+	int i;
+	for (i = 0; g_match_info_matches (match_info); i++) {
+		g_string_append (out, template_split[i]);
+
+		gchar *word = g_match_info_fetch (match_info, 0);
+
+		pin_nr = g_ascii_strtoll (word + 1, NULL, 10) - 1;
+		gint node_nr = 0;
+		node_nr = GPOINTER_TO_INT (g_hash_table_lookup (data->pins, &pins[pin_nr]));
+		g_free (word);
+		if (!node_nr) {
+			g_set_error (error, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_NO_SUCH_PART,
+			             _ ("Could not find part in library, pin #%d."), pin_nr);
+			g_match_info_free (match_info);
+			g_strfreev (template_split);
+			g_free (template);
+			g_string_truncate (out, start);
+			return FALSE;
+		} else {
+			gchar *tmp;
+			tmp = node2real[node_nr];
+
+			// need to substrac 1, netlist starts in 0, and node_nr in 1
+			pins[pin_nr].node_nr = atoi (node2real[node_nr]);
+			g_string_append (out, tmp);
+		}
+
+		g_match_info_next (match_info, NULL);
+	}
+	g_match_info_free (match_info);
+	g_free (template);
+	template = NULL;
+	if (template_split[i] != NULL) {
+		g_string_append (out, template_split[i]);
+	}
+	g_strfreev (template_split);
+	if (error_match != NULL) {
+		g_printerr ("Error while matching: %s\n", error_match->message);
+		g_error_free (error_match);
+	}
+
+	NG_DEBUG ("Done with pins, i = %d\n", i);
+
+	g_string_append_c (out, '\n');
+	return TRUE;
+}
+
+// parts per chunk of the parallel card generation, 0 renders serially
+static guint netlist_helper_chunk_size = NETLIST_HELPER_CHUNK_SIZE;
+
+void netlist_helper_set_chunk_size (guint chunk_size)
+{
+	netlist_helper_chunk_size = chunk_size;
+}
+
+typedef struct
+{
+	GList *first; ///< first part of the chunk
+	guint length; ///< number of parts in the chunk
+	GString *cards;
+	GError *error;
+	gboolean done;
+} NetlistChunk;
+
+//data wrapper
+typedef struct
+{
+	NetlistData *data;
+	gchar **node2real;
+	GRegex *regex;
+	GMutex mutex;
+	GCond cond;
+} NetlistChunkShared;
+
+static void netlist_helper_render_chunk (NetlistChunk *chunk, NetlistChunkShared *shared)
+{
+	GList *iter;
+	guint i;
+
+	for (iter = chunk->first, i = 0; i < chunk->length; iter = iter->next, i++) {
+		if (!netlist_helper_render_card (shared->data, shared->node2real, iter->data,
+		                                 shared->regex, chunk->cards, &chunk->error))
+			break;
+	}
+
+	g_mutex_lock (&shared->mutex);
+	chunk->done = TRUE;
+	g_cond_broadcast (&shared->cond);
+	g_mutex_unlock (&shared->mutex);
+}
+
+static gboolean netlist_helper_emit_cards (GString *cards, GString *template_out,
+                                           GOutputStream *stream, GError **error)
+{
+	if (!stream) {
+		g_string_append_len (template_out, cards->str, cards->len);
+		return TRUE;
+	}
+	return g_output_stream_write_all (stream, cards->str, cards->len, NULL, NULL, error);
+}
+
+/**
+ * renders the cards of all parts on a thread pool, one chunk of parts
+ * per task, and emits the chunks in the order of the parts
+ *
+ * A chunk is emitted as soon as it and all chunks before it are done,
+ * so the result is identical to the serial one.
+ */
+static gboolean netlist_helper_create_cards_parallel (NetlistData *data, gchar **node2real,
+                                                      GList *parts, GRegex *regex,
+                                                      GString *template_out,
+                                                      GOutputStream *stream, GError **error)
+{
+	NetlistChunkShared shared;
+	NetlistChunk *chunks;
+	GThreadPool *pool;
+	GList *iter;
+	guint num_parts, num_chunks, i;
+	gboolean ret = TRUE;
+
+	num_parts = g_list_length (parts);
+	num_chunks = (num_parts + netlist_helper_chunk_size - 1) / netlist_helper_chunk_size;
+
+	shared.data = data;
+	shared.node2real = node2real;
+	shared.regex = regex;
+	g_mutex_init (&shared.mutex);
+	g_cond_init (&shared.cond);
+
+	pool = g_thread_pool_new ((GFunc)netlist_helper_render_chunk, &shared,
+	                          g_get_num_processors (), FALSE, NULL);
+
+	chunks = g_new0 (NetlistChunk, num_chunks);
+	for (iter = parts, i = 0; i < num_chunks; i++) {
+		chunks[i].first = iter;
+		chunks[i].length = MIN (netlist_helper_chunk_size, num_parts - i * netlist_helper_chunk_size);
+		chunks[i].cards = g_string_new ("");
+		iter = g_list_nth (iter, chunks[i].length);
+		g_thread_pool_push (pool, &chunks[i], NULL);
+	}
+
+	for (i = 0; i < num_chunks; i++) {
+		g_mutex_lock (&shared.mutex);
+		while (!chunks[i].done)
+			g_cond_wait (&shared.cond, &shared.mutex);
+		g_mutex_unlock (&shared.mutex);
+
+		if (ret) {
+			// cards before a failing one are emitted, like the serial path does
+			ret = netlist_helper_emit_cards (chunks[i].cards, template_out, stream, error);
+			if (ret && chunks[i].error) {
+				g_propagate_error (error, chunks[i].error);
+				chunks[i].error = NULL;
+				ret = FALSE;
+			}
+		}
+		g_clear_error (&chunks[i].error);
+		g_string_free (chunks[i].cards, TRUE);
+		chunks[i].cards = NULL;
+	}
+
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_free (chunks);
+	g_cond_clear (&shared.cond);
+	g_mutex_clear (&shared.mutex);
+
+	return ret;
+}
+
+/**
+ * expands the templates of the given parts into cards, their pins are
+ * looked up in data->pins
+ *
+ * Large schematics are rendered in parallel, see
+ * netlist_helper_create_cards_parallel.
+ *
+ * @param template_out receives the cards, unless stream is set
+ * @param stream [allow-none] if set, every card is written to it right away
+ * @param sd [allow-none] if set, sub-schematics of hierarchical blocks
+ *  are netlisted into sd->definitions
+ */
+static gboolean netlist_helper_create_cards (NetlistData *data, gchar **node2real, GList *parts,
+                                             GString *template_out, GOutputStream *stream,
+                                             SubcktData *sd, GError **error)
+{
+	GList *iter;
+	GRegex *regex;
+	GString *card;
+	gboolean ret = TRUE;
+
+	// Loading sub-schematics is not thread safe, do it upfront
+	if (sd) {
+		for (iter = parts; iter; iter = iter->next) {
+			if (part_get_property_ref (iter->data, "internal"))
+				continue;
+			if (!netlist_helper_subckt_require (iter->data, sd, error))
+				return FALSE;
+		}
+	}
+
+	regex = g_regex_new ("%\\d*", G_REGEX_OPTIMIZE, 0, NULL);
+
+	if (netlist_helper_chunk_size > 0 &&
+	    g_list_length (parts) > netlist_helper_chunk_size) {
+		ret = netlist_helper_create_cards_parallel (data, node2real, parts, regex, template_out,
+		                                            stream, error);
+		g_regex_unref (regex);
+		return ret;
+	}
+
+	card = g_string_new ("");
+	for (iter = parts; iter && ret; iter = iter->next) {
+		ret = netlist_helper_render_card (data, node2real, iter->data, regex, card, error);
+		NG_DEBUG ("str: %s\n", card->str);
+		if (ret)
+			ret = netlist_helper_emit_cards (card, template_out, stream, error);
+		g_string_truncate (card, 0);
+	}
+	g_string_free (card, TRUE);
+	g_regex_unref (regex);
+
+	return ret;
+}
+
+static void marker_free (Marker *marker)
+{
+	g_free (marker->name);
+	g_free (marker);
+}
+
+static gint netlist_helper_compare_marker_name (gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0 (((const Marker *)a)->name, ((const Marker *)b)->name);
+}
+
+/**
+ * netlists sm as ".subckt name ports" block and appends it to
+ * sd->definitions, the models used inside are merged into sd->models
+ *
+ * @param ports [allow-none] node labels in pin order, if NULL all node
+ *  labels of sm in alphabetical order are used
+ */
+static gboolean netlist_helper_subckt_build (Schematic *sm, const gchar *name,
+                                             const gchar *ports, SubcktData *sd,
+                                             GError **error)
+{
+	NetlistData data;
+	gchar **node2real, **port_split, *tmp;
+	GString *body;
+	GList *models, *iter;
+	GSList *markers, *walker;
+	gboolean ret;
+	gint i;
+
+	netlist_helper_traverse (schematic_get_store (sm), &data);
+
+	body = g_string_new ("");
+	g_string_append_printf (body, ".subckt %s", name);
+
+	if (ports && *ports) {
+		tmp = g_strstrip (g_strdup (ports));
+		port_split = g_strsplit_set (tmp, " \t,", 0);
+		g_free (tmp);
+		for (i = 0; port_split[i]; i++) {
+			if (!*port_split[i])
+				continue;
+			walker = data.mark_list;
+			while (walker && g_strcmp0 (((Marker *)walker->data)->name, port_split[i]))
+				walker = walker->next;
+			if (!walker) {
+				g_set_error (error, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_NO_SUCH_PART,
+				             _ ("Block %s has no node label %s."), name, port_split[i]);
+				g_strfreev (port_split);
+				g_string_free (body, TRUE);
+				netlist_helper_clear_data (&data);
+				g_slist_free_full (data.mark_list, (GDestroyNotify)marker_free);
+				return FALSE;
+			}
+			g_string_append_printf (body, " %s", port_split[i]);
+		}
+		g_strfreev (port_split);
+	} else {
+		const gchar *prev = NULL;
+
+		markers = g_slist_sort (g_slist_copy (data.mark_list),
+		                        netlist_helper_compare_marker_name);
+		for (walker = markers; walker; walker = walker->next) {
+			const gchar *label = ((Marker *)walker->data)->name;
+			// the same label may be placed more than once
+			if (g_strcmp0 (prev, label))
+				g_string_append_printf (body, " %s", label);
+			prev = label;
+		}
+		g_slist_free (markers);
+	}
+	g_string_append_c (body, '\n');
+
+	node2real = netlist_helper_create_node2real (&data);
+	ret = netlist_helper_create_cards (&data, node2real, data.store->parts, body, NULL, sd, error);
+	g_strfreev (node2real);
+
+	if (ret) {
+		g_string_append_printf (body, ".ends %s\n", name);
+		g_string_append (sd->definitions, body->str);
+
+		models = NULL;
+		g_hash_table_foreach (data.models, (GHFunc)netlist_helper_foreach_model_save, &models);
+		for (iter = models; iter; iter = iter->next) {
+			if (g_hash_table_contains (sd->models, iter->data))
+				g_free (iter->data);
+			else
+				g_hash_table_add (sd->models, iter->data);
+		}
+		g_list_free (models);
+	}
+
+	g_string_free (body, TRUE);
+	netlist_helper_clear_data (&data);
+	g_slist_free_full (data.mark_list, (GDestroyNotify)marker_free);
+	return ret;
+}
+
+static void subckt_data_init (SubcktData *sd, const gchar *filename, GHashTable *models,
+                              GHashTable *blocks)
+{
+	sd->definitions = g_string_new ("");
+	sd->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	sd->active = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	sd->models = models;
+	sd->blocks = blocks;
+	sd->depth = 0;
+	sd->dirname = filename ? g_path_get_dirname (filename) : NULL;
+}
+
+static void subckt_data_clear (SubcktData *sd)
+{
+	g_hash_table_destroy (sd->names);
+	g_hash_table_destroy (sd->active);
+	g_free (sd->dirname);
+}
+
+/**
+ * checks for ground and clamps and netlists the parts of a traversed
+ * schematic into out, data and node2real stay owned by the caller
+ */
+// FIXME this one piece of ugly+bad code
+static void netlist_helper_create_from_data (NetlistData *data, gchar **node2real, GList *parts,
+                                             gchar *filename, SimSettings *settings,
+                                             GHashTable *blocks, Netlist *out,
+                                             GOutputStream *stream, GError **error)
+{
+	gint num_gnd_nodes, num_clamps;
+	SubcktData sd;
+
+	out->models = NULL;
+	out->subckts = NULL;
+	out->template = NULL;
+	out->title = filename;
+	out->settings = settings;
+	out->store = data->store;
+
+	num_gnd_nodes = g_slist_length (data->gnd_list);
+	num_clamps = g_slist_length (data->clamp_list);
 
 	// Check if there is a Ground node
 	if (num_gnd_nodes == 0) {
 		g_set_error (error, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_NO_GND,
 		             _ ("At least one GND is required. Add at least one and try again."));
+		return;
 	}
 
-	else if (num_clamps == 0) {
+	if (num_clamps == 0) {
 		// FIXME put a V/I clamp on each and every subtree
 		// FIXME and let the user toggle visibility in the plot window
 		// FIXME see also TODO/FIXME above
 		g_set_error (error, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_NO_CLAMP,
 		             _ ("No test clamps found. Add at least one and try again."));
+		return;
 	}
 
-	else {
+	// Initialize out->template
+	out->template = stream ? NULL : g_string_new ("");
+	subckt_data_init (&sd, filename, data->models, blocks);
+	if (!netlist_helper_create_cards (data, node2real, parts, out->template, stream, &sd,
+	                                  error)) {
+		if (out->template)
+			g_string_free (out->template, TRUE);
+		out->template = NULL;
+		g_string_free (sd.definitions, TRUE);
+		subckt_data_clear (&sd);
+		return;
+	}
 
-		num_nodes = data.node_nr - 1;
+	out->subckts = sd.definitions;
+	subckt_data_clear (&sd);
 
-		// Build an array for going from node nr to "real node nr",
-		// where gnd nodes are nr 0 and the rest of the nodes are
-		// 1, 2, 3, ...
-		node2real = g_new0 (gchar *, num_nodes + 1 + 1);
-		node2real[num_nodes + 1] = NULL; // so we can use g_strfreev
+	g_hash_table_foreach (data->models, (GHFunc)netlist_helper_foreach_model_save, &out->models);
+}
 
-		for (i = 1, j = 1; i <= num_nodes; i++) {
-			GSList *mlist;
+static void netlist_helper_create_full (NodeStore *store, gchar *filename, SimSettings *settings,
+                                        Netlist *out, GOutputStream *stream, GError **error)
+{
+	NetlistData data;
+	gchar **node2real;
 
-			if (g_slist_find (data.gnd_list, GINT_TO_POINTER (i))) {
-				node2real[i] = g_strdup ("0");
-			} else if ((mlist = g_slist_find_custom (data.mark_list, GINT_TO_POINTER (i),
-			                                         compare_marker))) {
-				Marker *marker = mlist->data;
-				node2real[i] = g_strdup (marker->name);
-			} else {
-				node2real[i] = g_strdup_printf ("%d", j++);
-			}
-		}
+	netlist_helper_traverse (store, &data);
+	node2real = netlist_helper_create_node2real (&data);
 
-		// Fill in the netlist node names for all the used nodes.
-		for (iter = data.node_and_number_list; iter; iter = iter->next) {
-			NodeAndNumber *nan = iter->data;
-			if (nan->node_nr > 0) {
-				g_free (nan->node->netlist_node_name);
-				nan->node->netlist_node_name = g_strdup (node2real[nan->node_nr]);
-			}
+	netlist_helper_create_from_data (&data, node2real, store->parts, filename, settings, NULL,
+	                                 out, stream, error);
+
+	g_strfreev (node2real);
+	netlist_helper_clear_data (&data);
+}
+
+void netlist_helper_create (Schematic *sm, Netlist *out, GError **error)
+{
+	netlist_helper_create_full (schematic_get_store (sm), schematic_get_filename (sm),
+	                            schematic_get_sim_settings (sm), out, NULL, error);
+}
+
+/**
+ * \brief like netlist_helper_create, but streams the cards
+ *
+ * The cards of the circuit description are written to stream as they
+ * are generated instead of being collected in out->template, which is
+ * left NULL.
+ */
+void netlist_helper_create_stream (Schematic *sm, Netlist *out, GOutputStream *stream,
+                                   GError **error)
+{
+	g_return_if_fail (G_IS_OUTPUT_STREAM (stream));
+
+	netlist_helper_create_full (schematic_get_store (sm), schematic_get_filename (sm),
+	                            schematic_get_sim_settings (sm), out, stream, error);
+}
+
+/**
+ * reads the sub-schematics of all blocks placed on store into blocks,
+ * including the ones nested inside of them
+ */
+static gboolean netlist_helper_snapshot_load_blocks (NodeStore *store, const gchar *dirname,
+                                                     GHashTable *blocks, GError **error)
+{
+	GList *iter;
+	gboolean ret = TRUE;
+
+	for (iter = store->parts; iter && ret; iter = iter->next) {
+		gchar *filename, *path, *sub_dirname;
+		Schematic *sub;
+
+		if (part_get_property_ref (iter->data, "internal") ||
+		    !part_get_property_ref (iter->data, "Subckt"))
+			continue;
+		filename = part_get_property (iter->data, "Schematic");
+		if (!filename)
+			continue;
+
+		path = netlist_helper_subckt_path (dirname, filename);
+		g_free (filename);
+		if (g_hash_table_contains (blocks, path)) {
+			g_free (path);
+			continue;
 		}
 
-		// Initialize out->template
-		out->template = g_string_new ("");
-		for (iter = store->parts; iter; iter = iter->next) {
-			part = iter->data;
+		sub = schematic_read (path, error);
+		if (!sub) {
+			g_free (path);
+			return FALSE;
+		}
+		// insert before descending, so recursive blocks terminate
+		g_hash_table_insert (blocks, path, sub);
+		sub_dirname = g_path_get_dirname (path);
+		ret = netlist_helper_snapshot_load_blocks (schematic_get_store (sub), sub_dirname, blocks,
+		                                           error);
+		g_free (sub_dirname);
+	}
 
-			gchar *tmp, *internal;
-			GString *str;
+	return ret;
+}
 
-			internal = part_get_property (part, "internal");
-			if (internal != NULL) {
-				gint node_nr;
-				Pin *pins;
-				if (g_ascii_strcasecmp (internal, "clamp") != 0) {
-					g_free (internal);
-					continue;
-				}
+/**
+ * \brief takes a copy of everything netlisting sm needs
+ *
+ * The schematic is traversed right away, so only the node numbers of
+ * the pins are kept, together with copies of the parts and the
+ * simulation settings. The sub-schematics of hierarchical blocks are
+ * read as well, so the netlist can be generated from the snapshot in
+ * another thread while sm is being edited. This has to be called from
+ * the main thread.
+ *
+ * @returns the snapshot or NULL if a sub-schematic could not be read,
+ *  free with netlist_helper_snapshot_free
+ */
+NetlistSnapshot *netlist_helper_snapshot_new (Schematic *sm, GError **error)
+{
+	NetlistSnapshot *snapshot;
+	NodeStore *store;
+	GHashTable *pins;
+	GList *iter;
+	gchar *dirname;
+	gboolean ret;
 
-				// Got a clamp!, set node number
-				pins = part_get_pins (part);
-				node_nr = GPOINTER_TO_INT (g_hash_table_lookup (data.pins, &pins[0]));
-				if (!node_nr) {
-					g_warning ("Couldn't find part, pin_nr %d.", 0);
-				} else {
-					// need to substrac 1, netlist starts in 0, and node_nr in 1
-					pins[0].node_nr = atoi (node2real[node_nr]);
-				}
-				g_free (internal);
-				continue;
-			}
+	g_return_val_if_fail (sm != NULL, NULL);
+	g_return_val_if_fail (IS_SCHEMATIC (sm), NULL);
 
-			tmp = part_get_property (part, "template");
-			if (!tmp) {
-				continue;
-			}
+	store = schematic_get_store (sm);
 
-			template = part_property_expand_macros (part, tmp);
-			NG_DEBUG ("Template: '%s'\n"
-			          "macro   : '%s'\n",
-			          tmp, template);
+	snapshot = g_new0 (NetlistSnapshot, 1);
+	snapshot->originals = g_ptr_array_new_with_free_func (g_object_unref);
+	snapshot->filename = g_strdup (schematic_get_filename (sm));
+	snapshot->settings = sim_settings_copy (schematic_get_sim_settings (sm));
+	snapshot->blocks = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+
+	netlist_helper_traverse (store, &snapshot->data);
+	snapshot->node2real = netlist_helper_create_node2real (&snapshot->data);
+
+	if (sim_settings_get_trans (snapshot->settings) &&
+	    !sim_settings_get_trans_analyze_all (snapshot->settings))
+		snapshot->analysis = netlist_helper_analysis_string (store, &snapshot->data,
+		                                                     snapshot->node2real, FALSE);
+
+	// the copies take the node numbers of the pins they were made of
+	pins = g_hash_table_new (g_direct_hash, g_direct_equal);
+	for (iter = store->parts; iter; iter = iter->next) {
+		Part *copy = PART (item_data_clone (ITEM_DATA (iter->data)));
+		Pin *copy_pins = part_get_pins (copy);
+		Pin *original_pins = part_get_pins (iter->data);
+		gint num_pins, j;
+
+		num_pins = MIN (part_get_num_pins (copy), part_get_num_pins (iter->data));
+		for (j = 0; j < num_pins; j++) {
+			gpointer node_nr = g_hash_table_lookup (snapshot->data.pins, &original_pins[j]);
+			if (node_nr)
+				g_hash_table_insert (pins, &copy_pins[j], node_nr);
+		}
 
-			g_free (tmp);
-			tmp = netlist_helper_linebreak (template);
+		g_ptr_array_add (snapshot->originals, g_object_ref (iter->data));
+		snapshot->parts = g_list_prepend (snapshot->parts, copy);
+	}
+	snapshot->parts = g_list_reverse (snapshot->parts);
 
-			g_free (template);
-			template = tmp;
+	// nothing may refer to the original any more
+	g_hash_table_destroy (snapshot->data.pins);
+	snapshot->data.pins = pins;
+	g_list_free_full (snapshot->data.node_and_number_list, (GDestroyNotify)g_free);
+	snapshot->data.node_and_number_list = NULL;
+	snapshot->data.store = NULL;
 
-			pins = part_get_pins (part);
+	dirname = snapshot->filename ? g_path_get_dirname (snapshot->filename) : NULL;
+	ret = netlist_helper_snapshot_load_blocks (store, dirname, snapshot->blocks, error);
+	g_free (dirname);
 
+	if (!ret) {
+		netlist_helper_snapshot_free (snapshot);
+		return NULL;
+	}
+	return snapshot;
+}
 
+/**
+ * \brief drops the snapshot, call from the main thread
+ */
+void netlist_helper_snapshot_free (NetlistSnapshot *snapshot)
+{
+	if (!snapshot)
+		return;
 
+	netlist_helper_clear_data (&snapshot->data);
+	g_slist_free (snapshot->data.gnd_list);
+	g_slist_free (snapshot->data.clamp_list);
+	g_slist_free_full (snapshot->data.mark_list, (GDestroyNotify)marker_free);
+	g_strfreev (snapshot->node2real);
+	g_list_free_full (snapshot->parts, g_object_unref);
+	g_ptr_array_unref (snapshot->originals);
+	g_hash_table_destroy (snapshot->blocks);
+	sim_settings_finalize (snapshot->settings);
+	g_free (snapshot->analysis);
+	g_free (snapshot->filename);
+	g_free (snapshot);
+}
 
-			GRegex *regex;
-			GMatchInfo *match_info;
-			GError *error = NULL;
+SimSettings *netlist_helper_snapshot_get_sim_settings (NetlistSnapshot *snapshot)
+{
+	return snapshot->settings;
+}
 
-			regex = g_regex_new("%\\d*", 0, 0, NULL);
-			g_regex_match_full(regex, template, -1, 0, 0, &match_info, &error);
-			template_split = g_regex_split(regex, template, 0);
+gchar *netlist_helper_snapshot_get_filename (NetlistSnapshot *snapshot)
+{
+	return snapshot->filename;
+}
 
-			str = g_string_new ("");
+/**
+ * @returns the vectors of the clamps to print for the transient
+ *  analysis, NULL if the settings do not ask for them
+ */
+const gchar *netlist_helper_snapshot_get_analysis_string (NetlistSnapshot *snapshot)
+{
+	return snapshot->analysis;
+}
 
-			NG_DEBUG ("Reading pins.\n)");
+/**
+ * \brief like netlist_helper_create_stream, but netlists a snapshot
+ *
+ * Only touches the snapshot, so this may run in any thread. out->store
+ * is left NULL.
+ */
+void netlist_helper_snapshot_create_stream (NetlistSnapshot *snapshot, Netlist *out,
+                                            GOutputStream *stream, GError **error)
+{
+	g_return_if_fail (snapshot != NULL);
+	g_return_if_fail (G_IS_OUTPUT_STREAM (stream));
 
-			int i;
-			for (i = 0; g_match_info_matches(match_info); i++) {
-				g_string_append (str, template_split[i]);
+	netlist_helper_create_from_data (&snapshot->data, snapshot->node2real, snapshot->parts,
+	                                 snapshot->filename, snapshot->settings, snapshot->blocks,
+	                                 out, stream, error);
+}
 
-				gchar *word = g_match_info_fetch(match_info, 0);
+/**
+ * \brief copies the node numbers of a netlisted snapshot back to the
+ * parts of the original schematic, call from the main thread
+ *
+ * The node numbers are shown next to the pins and on the test clamps.
+ */
+void netlist_helper_snapshot_apply (NetlistSnapshot *snapshot)
+{
+	GList *iter;
+	guint i;
 
+	g_return_if_fail (snapshot != NULL);
 
-				pin_nr = g_ascii_strtoll(word + 1, NULL, 10) - 1;
-				gint node_nr = 0;
-				node_nr = GPOINTER_TO_INT (g_hash_table_lookup (data.pins, &pins[pin_nr]));
-				if (!node_nr) {
-					g_set_error (&error, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_NO_SUCH_PART,
-					             _ ("Could not find part in library, pin #%d."), pin_nr);
-					return; // FIXME wtf?? this leaks like hell and did for ages!
-				} else {
-					gchar *tmp;
-					tmp = node2real[node_nr];
+	for (iter = snapshot->parts, i = 0; iter && i < snapshot->originals->len;
+	     iter = iter->next, i++) {
+		Part *original = g_ptr_array_index (snapshot->originals, i);
+		Pin *pins = part_get_pins (iter->data);
+		Pin *original_pins = part_get_pins (original);
+		gint num_pins, j;
 
-					// need to substrac 1, netlist starts in 0, and node_nr in 1
-					pins[pin_nr].node_nr = atoi (node2real[node_nr]);
-					g_string_append (str, tmp);
-					NG_DEBUG ("str: %s\n", str->str);
-				}
+		num_pins = MIN (part_get_num_pins (iter->data), part_get_num_pins (original));
+		for (j = 0; j < num_pins; j++)
+			original_pins[j].node_nr = pins[j].node_nr;
+	}
+}
 
-				g_free(word);
-				g_match_info_next(match_info, NULL);
-			}
-			g_match_info_free(match_info);
-			g_free (template);
-			template = NULL;
-			g_regex_unref(regex);
-			if (template_split[i] != NULL) {
-				g_string_append (str, template_split[i]);
-			}
-			g_strfreev (template_split);
-			if (error != NULL) {
-				g_printerr("Error while matching: %s\n", error->message);
-				g_error_free(error);
-			}
+/**
+ * \brief netlist a schematic as reusable subcircuit
+ *
+ * Hierarchical blocks placed on sm are emitted as nested definitions in
+ * front of the requested one. The models used are prepended.
+ *
+ * @param sm the sub-schematic
+ * @param name the block name used by the ".subckt" and X cards
+ * @param ports [allow-none] node labels in pin order, defaults to all
+ *  node labels in alphabetical order
+ * @returns the definition text, free with g_free
+ */
+gchar *netlist_helper_create_subckt (Schematic *sm, const gchar *name, const gchar *ports,
+                                     GError **error)
+{
+	SubcktData sd;
+	GHashTable *models;
+	GList *model_list;
+	GString *out;
+	gboolean ret;
 
-			NG_DEBUG ("Done with pins, i = %d\n", i);
+	g_return_val_if_fail (sm != NULL, NULL);
+	g_return_val_if_fail (name != NULL, NULL);
 
-			NG_DEBUG ("str: %s\n", str->str);
-			out->template = g_string_append (out->template, str->str);
-			out->template = g_string_append_c (out->template, '\n');
-			g_string_free (str, TRUE);
-		}
+	models = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	subckt_data_init (&sd, schematic_get_filename (sm), models, NULL);
+	g_hash_table_add (sd.active, g_strdup (name));
 
-		g_strfreev (node2real);
+	ret = netlist_helper_subckt_build (sm, name, ports, &sd, error);
 
-		g_hash_table_foreach (data.models, (GHFunc)netlist_helper_foreach_model_save, &out->models);
-		return;
+	out = NULL;
+	if (ret) {
+		out = g_string_new ("");
+		g_string_append_printf (out, "* Subcircuit %s\n", name);
+		model_list = g_list_sort (g_hash_table_get_keys (models), (GCompareFunc)g_strcmp0);
+		ret = model_index_write_models (model_list, out, error);
+		g_list_free (model_list);
+		g_string_append (out, sd.definitions->str);
 	}
+	if (!ret && out) {
+		g_string_free (out, TRUE);
+		out = NULL;
+	}
+
+	g_string_free (sd.definitions, TRUE);
+	subckt_data_clear (&sd);
+	g_hash_table_destroy (models);
 
-	g_hash_table_foreach (data.models, (GHFunc)netlist_helper_foreach_model_free, NULL);
-	g_hash_table_destroy (data.models);
-	g_hash_table_destroy (data.pins);
-	g_list_free_full (data.node_and_number_list, (GDestroyNotify)g_free);
+	return out ? g_string_free (out, FALSE) : NULL;
 }
 
-char *netlist_helper_create_analysis_string (NodeStore *store, gboolean do_ac)
+/**
+ * @param data [allow-none] if set, the node numbers of the clamps are
+ *  looked up in data instead of being taken from their pins
+ */
+static char *netlist_helper_analysis_string (NodeStore *store, NetlistData *data,
+                                             gchar **node2real, gboolean do_ac)
 {
 	GList *iter;
 	Part *part;
@@ -583,12 +1357,19 @@ char *netlist_helper_create_analysis_string (NodeStore *store, gboolean do_ac)
 		if (prop) {
 			if (!g_ascii_strcasecmp (prop, "clamp")) {
 				Pin *pins = part_get_pins (part);
+				gint node_nr = pins[0].node_nr;
+
+				if (data) {
+					// what netlist_helper_render_card assigns to the clamp
+					gint nr = GPOINTER_TO_INT (g_hash_table_lookup (data->pins, &pins[0]));
+					node_nr = nr ? atoi (node2real[nr]) : 0;
+				}
 
 				prop = part_get_property (part, "type");
 
 				if (!g_ascii_strcasecmp (prop, "v")) {
 					if (!do_ac) {
-						g_string_append_printf (out, " %s(%d)", prop, pins[0].node_nr);
+						g_string_append_printf (out, " %s(%d)", prop, node_nr);
 					} else {
 						gchar *ac_type, *ac_db;
 						ac_type = part_get_property (part, "ac_type");
@@ -596,10 +1377,10 @@ char *netlist_helper_create_analysis_string (NodeStore *store, gboolean do_ac)
 
 						if (!g_ascii_strcasecmp (ac_db, "true"))
 							g_string_append_printf (out, " %s%sdb(%d)", prop, ac_type,
-							                        pins[0].node_nr);
+							                        node_nr);
 						else
 							g_string_append_printf (out, " %s%s(%d)", prop, ac_type,
-							                        pins[0].node_nr);
+							                        node_nr);
 					}
 				} else {
 					Node *node;
@@ -633,6 +1414,11 @@ char *netlist_helper_create_analysis_string (NodeStore *store, gboolean do_ac)
 	return ret;
 }
 
+char *netlist_helper_create_analysis_string (NodeStore *store, gboolean do_ac)
+{
+	return netlist_helper_analysis_string (store, NULL, NULL, do_ac);
+}
+
 GSList *netlist_helper_get_voltmeters_list (Schematic *sm, GError **error, gboolean with_type)
 {
 	Netlist netlist_data;
@@ -35,6 +35,7 @@
 #define __NETLIST_HELPER_H
 
 #include <glib.h>
+#include <gio/gio.h>
 
 #include "schematic.h"
 #include "sim-settings.h"
@@ -55,7 +56,8 @@ typedef struct
 {
 	gchar *cmd;
 	gchar *title;
-	GString *template;
+	GString *template; ///< NULL if the cards were streamed
+	GString *subckts; ///< definitions of the hierarchical blocks used
 	SimSettings *settings;
 	NodeStore *store;
 	GList *models;
@@ -67,15 +69,34 @@ typedef struct
 	gchar *name;
 } Marker;
 
+// private copy of a schematic which can be netlisted in any thread
+typedef struct _NetlistSnapshot NetlistSnapshot;
+
 typedef struct
 {
 	gint node_nr;
 	Node *node;
 } NodeAndNumber;
 
+// parts per chunk of the parallel netlist card generation
+#define NETLIST_HELPER_CHUNK_SIZE 128
+
 void update_schematic(Schematic *sm);
 void netlist_helper_init_data (NetlistData *data);
 void netlist_helper_create (Schematic *sm, Netlist *out, GError **error);
+void netlist_helper_create_stream (Schematic *sm, Netlist *out, GOutputStream *stream,
+                                   GError **error);
+void netlist_helper_set_chunk_size (guint chunk_size);
+NetlistSnapshot *netlist_helper_snapshot_new (Schematic *sm, GError **error);
+void netlist_helper_snapshot_free (NetlistSnapshot *snapshot);
+SimSettings *netlist_helper_snapshot_get_sim_settings (NetlistSnapshot *snapshot);
+gchar *netlist_helper_snapshot_get_filename (NetlistSnapshot *snapshot);
+const gchar *netlist_helper_snapshot_get_analysis_string (NetlistSnapshot *snapshot);
+void netlist_helper_snapshot_create_stream (NetlistSnapshot *snapshot, Netlist *out,
+                                            GOutputStream *stream, GError **error);
+void netlist_helper_snapshot_apply (NetlistSnapshot *snapshot);
+gchar *netlist_helper_create_subckt (Schematic *sm, const gchar *name, const gchar *ports,
+                                     GError **error);
 char *netlist_helper_create_analysis_string (NodeStore *store, gboolean do_ac);
 GSList *netlist_helper_get_voltmeters_list (Schematic *sm, GError **error, gboolean with_type);
 GSList *netlist_helper_get_voltage_sources_list (Schematic *sm, GError **error, gboolean ac_only);
@@ -40,6 +40,8 @@
 #include "dialogs.h"
 #include "engine-internal.h"
 #include "ngspice-analysis.h"
+#include "simulation-store.h"
+#include "simulation-column.h"
 #include "../tools/thread-pipe.h"
 #include "../tools/cancel-info.h"
 
@@ -206,6 +208,9 @@ static ThreadPipe *parse_dc_analysis (NgspiceAnalysisResources *resources)
 			found = TRUE;
 	}
 
+	if (sim_settings_get_dc_compact (sim_settings))
+		simulation_data_compact (sdata);
+
 	*analysis = g_list_append (*analysis, sdata);
 	(*num_analysis)++;
 
@@ -317,6 +322,9 @@ static ThreadPipe *parse_ac_analysis (NgspiceAnalysisResources *resources)
 			found = TRUE;
 	}
 
+	if (sim_settings_get_ac_compact (sim_settings))
+		simulation_data_compact (sdata);
+
 	*analysis = g_list_append (*analysis, sdata);
 	(*num_analysis)++;
 
@@ -421,7 +429,7 @@ static void ngspice_table_destroy(NgspiceTable *ngspice_table) {
 
 		for (int i = 0; i < len; i++) {
 			NgspiceColumn *column = ngspice_table->ngspice_columns->pdata[i];
-			if (column != NULL)
+			if (column != NULL && column->data != NULL)
 				g_array_free(column->data, TRUE);
 		}
 
@@ -547,8 +555,144 @@ typedef struct {
 	NgspiceTable *table;
 	ThreadPipe *pipe;
 	gboolean is_cancel;
+	// the unfinished store, if the analysis did not make it into one
+	SimulationStore *store;
 } ParseTransientAnalysisReturnResources;
 
+/**
+ * Moves the finished variable columns to the store and frees them.
+ *
+ * A column is finished once ngspice moved on to the next block of
+ * variables. The index column stays in the table, the time column is
+ * moved with the last block.
+ *
+ * @all: also move the columns that are still referenced
+ */
+static gboolean ngspice_table_flush(NgspiceTable *ngspice_table, SimulationStore *store, gboolean all) {
+	GError *e = NULL;
+
+	for (guint i = 1; i < ngspice_table->ngspice_columns->len; i++) {
+		NgspiceColumn *column = ngspice_table->ngspice_columns->pdata[i];
+		gboolean current = FALSE;
+
+		if (column == NULL || column->data == NULL)
+			continue;
+		for (guint j = 0; j < ngspice_table->current_variables->len && !all; j++)
+			if (g_array_index(ngspice_table->current_variables, guint, j) == i)
+				current = TRUE;
+		if (current)
+			continue;
+
+		if (!simulation_store_add_column(store, i - 1, column->name->str, column->unit->str,
+		                                 (const gdouble *)column->data->data, column->data->len,
+		                                 column->min, column->max, &e)) {
+			g_warning ("Could not store the column %s: %s", column->name->str, e->message);
+			g_clear_error (&e);
+			return FALSE;
+		}
+		g_array_free(column->data, TRUE);
+		column->data = NULL;
+	}
+	return TRUE;
+}
+
+/**
+ * Locks the table against the GUI thread, if it is shared.
+ */
+static void ngspice_live_lock(LiveTransientShared *live) {
+	if (live != NULL)
+		g_mutex_lock(&live->mutex);
+}
+
+static void ngspice_live_unlock(LiveTransientShared *live) {
+	if (live != NULL)
+		g_mutex_unlock(&live->mutex);
+}
+
+/**
+ * Stops sharing the table, before its columns are moved or freed.
+ */
+static void ngspice_live_detach(LiveTransientShared *live, NgspiceTable *table) {
+	if (live == NULL)
+		return;
+	g_mutex_lock(&live->mutex);
+	if (live->table == table) {
+		live->table = NULL;
+		live->finished = TRUE;
+	}
+	g_mutex_unlock(&live->mutex);
+}
+
+/**
+ * Copies the rows parsed since the last call into the live
+ * SimulationData. GUI thread only.
+ *
+ * The copies are sized for the announced number of rows up front and
+ * never grow beyond, so plot functions may keep pointers into them
+ * while they are drawn on another thread.
+ *
+ * @grew: set if there are new rows or new variables
+ * @returns the live data, NULL until the first transient rows arrived
+ */
+SimulationData *ngspice_analysis_live_update(LiveTransientShared *live, gboolean *grew) {
+	NgspiceTable *table;
+	SimulationData *sdata;
+
+	*grew = FALSE;
+
+	g_mutex_lock(&live->mutex);
+	table = live->table;
+	// the index, the time and at least one variable
+	if (table == NULL || live->rows == 0 || table->ngspice_columns->len < 3) {
+		g_mutex_unlock(&live->mutex);
+		return live->data;
+	}
+
+	guint columns = table->ngspice_columns->len - 1;
+	sdata = live->data;
+	if (sdata == NULL) {
+		sdata = SIM_DATA (g_new0 (Analysis, 1));
+		sdata->type = ANALYSIS_TYPE_TRANSIENT;
+		live->data = sdata;
+	}
+
+	if (columns > sdata->n_variables) {
+		sdata->var_names = g_renew (gchar *, sdata->var_names, columns);
+		sdata->var_units = g_renew (gchar *, sdata->var_units, columns);
+		sdata->data = g_renew (GArray *, sdata->data, columns);
+		sdata->min_data = g_renew (gdouble, sdata->min_data, columns);
+		sdata->max_data = g_renew (gdouble, sdata->max_data, columns);
+
+		for (guint i = sdata->n_variables; i < columns; i++) {
+			NgspiceColumn *column = table->ngspice_columns->pdata[i+1];
+			sdata->var_names[i] = g_strdup(column->name->str);
+			sdata->var_units[i] = g_strdup(column->unit->str);
+			sdata->data[i] = g_array_sized_new(FALSE, FALSE, sizeof(gdouble), live->rows);
+		}
+		sdata->n_variables = columns;
+		sdata->got_var = columns;
+		*grew = TRUE;
+	}
+
+	for (guint i = 0; i < columns; i++) {
+		NgspiceColumn *column = table->ngspice_columns->pdata[i+1];
+		GArray *copy = sdata->data[i];
+		guint len = MIN (column->data->len, live->rows);
+
+		if (len > copy->len) {
+			g_array_append_vals(copy, &g_array_index(column->data, gdouble, copy->len), len - copy->len);
+			*grew = TRUE;
+		}
+		sdata->min_data[i] = column->min;
+		sdata->max_data[i] = column->max;
+	}
+	sdata->got_points = sdata->data[0]->len;
+
+	g_mutex_unlock(&live->mutex);
+
+	return sdata;
+}
+
 /**
  * @resources: caller frees
  */
@@ -580,10 +724,37 @@ static ParseTransientAnalysisReturnResources parse_transient_analysis_resources
 
 	NgspiceTable *ngspice_table = ngspice_table_new();
 
+	// results too large for RAM go to a store, column by column
+	SimulationStore *store = NULL;
+	if (no_of_data_rows * no_of_variables >= SIMULATION_STORE_MIN_VALUES) {
+		GError *e = NULL;
+
+		store = simulation_store_new(NULL, ANALYSIS_TYPE_TRANSIENT, &e);
+		if (store == NULL) {
+			g_warning ("Keeping the transient results in memory: %s", e->message);
+			g_clear_error (&e);
+		}
+	}
+
+	// only the first transient listing is shown while it is parsed,
+	// stored columns leave the table before the listing is done
+	LiveTransientShared *live = store == NULL ? resources->live : NULL;
+	if (live != NULL) {
+		g_mutex_lock(&live->mutex);
+		if (live->finished || live->table != NULL) {
+			live = NULL;
+		} else {
+			live->table = ngspice_table;
+			live->rows = no_of_data_rows;
+		}
+		g_mutex_unlock(&live->mutex);
+	}
+
 	ParseTransientAnalysisReturnResources ret_val;
 	ret_val.table = ngspice_table;
 	ret_val.pipe = resources->pipe;
 	ret_val.is_cancel = TRUE;
+	ret_val.store = store;
 
 	enum STATE state = NGSPICE_ANALYSIS_STATE_DATA_LARGE_BLOCK_END;
 
@@ -598,10 +769,15 @@ static ParseTransientAnalysisReturnResources parse_transient_analysis_resources
 			{
 				gchar **splitted_line = g_regex_split_simple(" +", *buf, 0, 0);
 
+				ngspice_live_lock(live);
 				ngspice_table_new_columns(ngspice_table, splitted_line, no_of_data_rows);
+				ngspice_live_unlock(live);
 
 				g_strfreev(splitted_line);
 
+				if (store != NULL && !ngspice_table_flush(ngspice_table, store, FALSE))
+					return ret_val;
+
 				state = NGSPICE_ANALYSIS_STATE_READ_VARIABLES_OLD;
 				break;
 			}
@@ -609,7 +785,9 @@ static ParseTransientAnalysisReturnResources parse_transient_analysis_resources
 			{
 				gchar **splitted_line = g_regex_split_simple("\\t+|-{2,}", *buf, 0, 0);
 
+				ngspice_live_lock(live);
 				ngspice_table_add_data(ngspice_table, splitted_line);
+				ngspice_live_unlock(live);
 
 				g_strfreev(splitted_line);
 
@@ -678,7 +856,37 @@ static ParseTransientAnalysisReturnResources parse_transient_analysis_resources
 
 	ret_val.is_cancel = FALSE;
 
-	SimulationData *sdata = SIM_DATA (g_new0 (Analysis, 1));
+	// the columns are moved into the results below
+	ngspice_live_detach(resources->live, ngspice_table);
+
+	SimulationData *sdata;
+
+	if (store != NULL) {
+		GError *e = NULL;
+
+		if (!ngspice_table_flush(ngspice_table, store, TRUE)) {
+			ret_val.is_cancel = TRUE;
+			return ret_val;
+		}
+		sdata = simulation_store_finish(store, &e);
+		ret_val.store = NULL;
+		if (sdata == NULL) {
+			g_warning ("Could not map the transient results: %s", e->message);
+			g_clear_error (&e);
+			ret_val.is_cancel = TRUE;
+			return ret_val;
+		}
+		ANALYSIS (sdata)->transient.sim_length =
+		    sim_settings_get_trans_stop (sim_settings) - sim_settings_get_trans_start (sim_settings);
+		ANALYSIS (sdata)->transient.step_size = sim_settings_get_trans_step (sim_settings);
+
+		(*num_analysis)++;
+		*resources->analysis = g_list_append (*resources->analysis, sdata);
+
+		return ret_val;
+	}
+
+	sdata = SIM_DATA (g_new0 (Analysis, 1));
 	sdata->type = ANALYSIS_TYPE_TRANSIENT;
 	sdata->functions = NULL;
 
@@ -709,6 +917,9 @@ static ParseTransientAnalysisReturnResources parse_transient_analysis_resources
 	sdata->got_points = column->data->len;
 	sdata->got_var = nodes_nb + 1;
 
+	if (sim_settings_get_trans_compact (sim_settings))
+		simulation_data_compact (sdata);
+
 	(*num_analysis)++;
 	*resources->analysis = g_list_append (*resources->analysis, sdata);
 
@@ -718,7 +929,9 @@ static ParseTransientAnalysisReturnResources parse_transient_analysis_resources
 static ThreadPipe *parse_transient_analysis (NgspiceAnalysisResources *resources) {
 	ParseTransientAnalysisReturnResources ret_res = parse_transient_analysis_resources(resources);
 
+	ngspice_live_detach(resources->live, ret_res.table);
 	ngspice_table_destroy(ret_res.table);
+	simulation_store_discard(ret_res.store);
 
 	if (ret_res.is_cancel && ret_res.pipe) {
 		thread_pipe_set_read_eof(ret_res.pipe);
@@ -960,6 +1173,9 @@ static ThreadPipe *parse_noise_analysis (NgspiceAnalysisResources *resources)
 
 	sdata->got_var = 3;
 
+	if (sim_settings_get_noise_compact (sim_settings))
+		simulation_data_compact (sdata);
+
 	*analysis = g_list_append (*analysis, sdata);
 	(*num_analysis)++;
 
@@ -72,6 +72,23 @@ typedef struct {
 	GMutex mutex;
 } AnalysisTypeShared;
 
+/**
+ * The transient analysis while it is parsed. The parser thread fills
+ * its table under the mutex, the GUI thread copies the rows that came
+ * in since it last looked.
+ */
+typedef struct {
+	GMutex mutex;
+	// the table being parsed, NULL outside of the first transient listing
+	gpointer table;
+	// rows announced by the listing, the copies never grow beyond
+	guint64 rows;
+	// set once the first transient listing is done
+	gboolean finished;
+	// the copy owned by the GUI thread
+	SimulationData *data;
+} LiveTransientShared;
+
 typedef struct {
 	ThreadPipe *pipe;
 	gchar *buf;
@@ -88,6 +105,7 @@ typedef struct {
 	guint64 no_of_data_rows_noise;
 	guint no_of_variables;
 	CancelInfo *cancel_info;
+	LiveTransientShared *live;
 } NgspiceAnalysisResources;
 
 // Parser STATUS
@@ -108,9 +126,12 @@ struct _OreganoNgSpicePriv
 
 	ProgressResources progress_ngspice;
 	ProgressResources progress_reader;
+
+	LiveTransientShared live;
 };
 
 void ngspice_analysis (NgspiceAnalysisResources *resources);
+SimulationData *ngspice_analysis_live_update (LiveTransientShared *live, gboolean *grew);
 void ngspice_save (const gchar *path_to_file, ThreadPipe *pipe, CancelInfo *cancel_info);
 
 #endif
@@ -593,6 +593,7 @@ void ngspice_watcher_build_and_launch(const NgspiceWatcherBuildAndLaunchResource
 	ngspice_worker_resources->progress_reader = progress_reader;
 	ngspice_worker_resources->sim_settings = sim_settings;
 	ngspice_worker_resources->cancel_info = resources->cancel_info;
+	ngspice_worker_resources->live = resources->live;
 	cancel_info_subscribe(ngspice_worker_resources->cancel_info);
 
 	GThread *worker = g_thread_new("spice worker", (GThreadFunc)ngspice_worker, ngspice_worker_resources);
@@ -704,6 +705,8 @@ NgspiceWatcherBuildAndLaunchResources *ngspice_watcher_build_and_launch_resource
 	resources->cancel_info = ngspice->priv->cancel_info;
 	cancel_info_subscribe(resources->cancel_info);
 
+	resources->live = &ngspice->priv->live;
+
 	return resources;
 }
 
@@ -40,10 +40,12 @@
 
 #include "ngspice.h"
 #include "netlist-helper.h"
+#include "model-index.h"
 #include "dialogs.h"
 #include "engine-internal.h"
 #include "ngspice-analysis.h"
 #include "errors.h"
+#include "simulation-store.h"
 
 #include "ngspice-watcher.h"
 
@@ -98,26 +100,14 @@ static void ngspice_finalize (GObject *object)
 {
 	OreganoNgSpice *ngspice;
 	GList *iter;
-	int i;
 
 	ngspice = OREGANO_NGSPICE (object);
-	iter = ngspice->priv->analysis;
-	for (; iter; iter = iter->next) {
-		SimulationData *data = SIM_DATA (iter->data);
-		for (i = 0; i < data->n_variables; i++) {
-			g_free(data->var_names[i]);
-			g_free(data->var_units[i]);
-			g_array_free (data->data[i], TRUE);
-		}
-		g_free (data->var_names);
-		g_free (data->var_units);
-		g_free (data->data);
-		g_free (data->min_data);
-		g_free (data->max_data);
-
-		g_free (data);
-	}
+	// plot functions may still share the columns
+	for (iter = ngspice->priv->analysis; iter; iter = iter->next)
+		simulation_data_free (SIM_DATA (iter->data));
 	g_list_free (ngspice->priv->analysis);
+	simulation_data_free (ngspice->priv->live.data);
+	g_mutex_clear(&ngspice->priv->live.mutex);
 	g_mutex_clear(&ngspice->priv->progress_ngspice.progress_mutex);
 	g_mutex_clear(&ngspice->priv->progress_reader.progress_mutex);
 	g_mutex_clear(&ngspice->priv->current.mutex);
@@ -152,73 +142,114 @@ static gboolean ngspice_is_available (OreganoEngine *self)
 }
 
 /**
- * \brief create a netlist buffer from the engine inernals
+ * \brief write out what has been accumulated in chunk and reset it
+ */
+static gboolean ngspice_flush_chunk (GOutputStream *stream, GString *chunk, GError **error)
+{
+	gboolean success;
+
+	success = g_output_stream_write_all (stream, chunk->str, chunk->len, NULL, NULL, error);
+	g_string_truncate (chunk, 0);
+	return success;
+}
+
+/**
+ * \brief check the analysis settings before netlisting, from the main thread
+ */
+static gboolean ngspice_check_settings (SimSettings *settings)
+{
+	if (sim_settings_get_trans (settings) &&
+	    sim_settings_get_trans_stop (settings) - sim_settings_get_trans_start (settings) <= 0) {
+		// FIXME ask for swapping or cancel simulation
+		oregano_error (_ ("Transient: Start time is after Stop time - fix this."
+		                  "stop figure\n"));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * \brief stream the netlist of a schematic snapshot
+ *
+ * Sections are emitted as soon as they are complete and the circuit
+ * description is written card by card while it is generated, so memory
+ * does not grow with the size of the netlist. Subcircuits and models are
+ * only known after all cards are generated and therefore follow them.
  *
  * @engine
+ * @stream target, e.g. a file or the input of the simulator
  * @error [allow-none]
  */
-static GString *ngspice_generate_netlist_buffer (OreganoEngine *engine, GError **error)
+static gboolean ngspice_write_netlist_snapshot (NetlistSnapshot *snapshot,
+                                                GOutputStream *stream, GError **error)
 {
-	OreganoNgSpice *ngspice;
 	Netlist output;
+	SimSettings *settings;
 	GList *iter;
 	GError *e = NULL;
-	GString *buffer = NULL;
+	GString *chunk = NULL;
+	gchar *title;
 
-	ngspice = OREGANO_NGSPICE (engine);
+	settings = netlist_helper_snapshot_get_sim_settings (snapshot);
+	output.models = NULL;
+	output.subckts = NULL;
 
-	netlist_helper_create (ngspice->priv->schematic, &output, &e);
-	if (e) {
-		g_propagate_error (error, e);
-		return NULL;
-	}
-
-	buffer = g_string_sized_new (500);
-	if (!buffer) {
+	chunk = g_string_sized_new (500);
+	if (!chunk) {
 		g_set_error_literal (&e, OREGANO_ERROR, OREGANO_OOM,
 		                     "Failed to allocate intermediate buffer.");
 		g_propagate_error (error, e);
-		return NULL;
+		return FALSE;
 	}
 	// Prints title
-	g_string_append (buffer, "* ");
-	g_string_append (buffer, output.title ? output.title : "Title: <unset>");
-	g_string_append (buffer, "\n"
-	                         "*----------------------------------------------"
-	                         "\n"
-	                         "*\tngspice - NETLIST"
-	                         "\n");
+	title = netlist_helper_snapshot_get_filename (snapshot);
+	g_string_append (chunk, "* ");
+	g_string_append (chunk, title ? title : "Title: <unset>");
+	g_string_append (chunk, "\n"
+	                        "*----------------------------------------------"
+	                        "\n"
+	                        "*\tngspice - NETLIST"
+	                        "\n");
 
 	// Prints Options
-	g_string_append (buffer, ".options OUT=120 ");
+	g_string_append (chunk, ".options OUT=120 ");
 
-	iter = sim_settings_get_options (output.settings);
+	iter = sim_settings_get_options (settings);
 	for (; iter; iter = iter->next) {
 		const SimOption *so = iter->data;
 		// Prevent send NULL text
 		if (so->value) {
 			if (strlen (so->value) > 0) {
-				g_string_append_printf (buffer, "%s=%s ", so->name, so->value);
+				g_string_append_printf (chunk, "%s=%s ", so->name, so->value);
 			}
 		}
 	}
-	g_string_append_c (buffer, '\n');
+	g_string_append_c (chunk, '\n');
 
-	// Include of subckt models
-	g_string_append (buffer, "*------------- Models -------------------------\n");
-	for (iter = output.models; iter; iter = iter->next) {
-		const gchar *model = iter->data;
-		gchar *model_with_ext = g_strdup_printf ("%s.model", model);
-		gchar *model_path = g_build_filename (OREGANO_MODELDIR, model_with_ext, NULL);
-		g_string_append_printf (buffer, ".include %s\n", model_path);
-		g_free (model_path);
-		g_free (model_with_ext);
+	// Prints template parts, straight into the stream
+	g_string_append (chunk, "*------------- Circuit Description-------------\n");
+	if (!ngspice_flush_chunk (stream, chunk, &e))
+		goto error;
+
+	netlist_helper_snapshot_create_stream (snapshot, &output, stream, &e);
+	if (e)
+		goto error;
+
+	g_string_append (chunk, "\n");
+
+	// Prints hierarchical blocks, once per block no matter how often placed
+	if (output.subckts && output.subckts->len > 0) {
+		g_string_append (chunk, "*------------- Subcircuits --------------------\n");
+		g_string_append (chunk, output.subckts->str);
 	}
 
-	// Prints template parts
-	g_string_append (buffer, "*------------- Circuit Description-------------\n");
-	g_string_append (buffer, output.template->str);
-	g_string_append (buffer, "\n*----------------------------------------------\n");
+	// Include of subckt models
+	g_string_append (chunk, "*------------- Models -------------------------\n");
+	if (!model_index_write_models (output.models, chunk, &e))
+		goto error;
+	g_string_append (chunk, "*----------------------------------------------\n");
+	if (!ngspice_flush_chunk (stream, chunk, &e))
+		goto error;
 
 	// Prints Transient Analysis
 	if (sim_settings_get_trans (output.settings)) {
@@ -231,40 +262,32 @@ static GString *ngspice_generate_netlist_buffer (OreganoEngine *engine, GError *
 		else
 			st = (stop - start) / 50;
 
-		if ((stop - start) <= 0) {
-			// FIXME ask for swapping or cancel simulation
-			oregano_error (_ ("Transient: Start time is after Stop time - fix this."
-			                  "stop figure\n"));
-			g_string_free (buffer, TRUE);
-			return NULL;
-		}
-
-		g_string_append_printf (buffer, ".tran %e %e %e", st, stop, start);
+		g_string_append_printf (chunk, ".tran %e %e %e", st, stop, start);
 		if (sim_settings_get_trans_init_cond (output.settings)) {
-			g_string_append_printf (buffer, " uic");
+			g_string_append_printf (chunk, " uic");
 		}
-		g_string_append_printf (buffer, "\n");
+		g_string_append_printf (chunk, "\n");
 
 		if (sim_settings_get_trans_analyze_all(output.settings)) {
-			g_string_append_printf (buffer, ".print tran all\n");
+			g_string_append_printf (chunk, ".print tran all\n");
 		} else {
-			gchar *tmp_str = netlist_helper_create_analysis_string (output.store, FALSE);
-			g_string_append_printf (buffer, ".print tran %s\n", tmp_str);
-			g_free (tmp_str);
+			// the clamps were looked up in the schematic when the snapshot was taken
+			g_string_append_printf (chunk, ".print tran %s\n",
+			                        netlist_helper_snapshot_get_analysis_string (snapshot));
 		}
-		g_string_append_c (buffer, '\n');
+		g_string_append_c (chunk, '\n');
 	}
 
 	// Prints DC Analysis
 	if (sim_settings_get_dc (output.settings)) {
-		g_string_append (buffer, ".dc ");
+		g_string_append (chunk, ".dc ");
 		if (sim_settings_get_dc_vsrc (output.settings)) {
-			g_string_append_printf (buffer, "V_%s %g %g %g\n",
+			g_string_append_printf (chunk, "V_%s %g %g %g\n",
 			                        sim_settings_get_dc_vsrc (output.settings),
 			                        sim_settings_get_dc_start (output.settings),
 			                        sim_settings_get_dc_stop (output.settings),
 			                        sim_settings_get_dc_step (output.settings));
-			g_string_append_printf (buffer, ".print dc V(%s)\n",
+			g_string_append_printf (chunk, ".print dc V(%s)\n",
 			                        sim_settings_get_dc_vout (output.settings));
 		}
 	}
@@ -272,12 +295,12 @@ static GString *ngspice_generate_netlist_buffer (OreganoEngine *engine, GError *
 	// Prints AC Analysis
 	if (sim_settings_get_ac (output.settings)) {
 		if (sim_settings_get_ac_vout (output.settings)) {
-			g_string_append_printf (buffer, ".ac %s %d %g %g\n",
+			g_string_append_printf (chunk, ".ac %s %d %g %g\n",
 		                        sim_settings_get_ac_type (output.settings),
 		                        sim_settings_get_ac_npoints (output.settings),
 		                        sim_settings_get_ac_start (output.settings),
 		                        sim_settings_get_ac_stop (output.settings));
-	                g_string_append_printf (buffer, ".print ac %s\n",
+	                g_string_append_printf (chunk, ".print ac %s\n",
 	                                        sim_settings_get_ac_vout (output.settings));
 		}
 	}
@@ -286,7 +309,7 @@ static GString *ngspice_generate_netlist_buffer (OreganoEngine *engine, GError *
 	if (sim_settings_get_fourier (output.settings)) {
 		if (sim_settings_get_fourier_frequency (output.settings) &&
 		    sim_settings_get_fourier_nodes (output.settings)) {
-			g_string_append_printf (buffer, ".four %.3f %s\n",
+			g_string_append_printf (chunk, ".four %.3f %s\n",
 			                        sim_settings_get_fourier_frequency (output.settings),
 			                        sim_settings_get_fourier_nodes (output.settings));
 		}
@@ -295,20 +318,106 @@ static GString *ngspice_generate_netlist_buffer (OreganoEngine *engine, GError *
 	// Prints Noise Analysis
 	if (sim_settings_get_noise (output.settings)) {
 		if (sim_settings_get_noise_vout (output.settings)) {
-			g_string_append_printf (buffer, ".noise V(%s) V_%s %s %d %g %g\n",
+			g_string_append_printf (chunk, ".noise V(%s) V_%s %s %d %g %g\n",
 						sim_settings_get_noise_vout (output.settings),
 						sim_settings_get_noise_vsrc (output.settings),
 						sim_settings_get_noise_type (output.settings),
 						sim_settings_get_noise_npoints (output.settings),
 						sim_settings_get_noise_start (output.settings),
 						sim_settings_get_noise_stop (output.settings));
-			g_string_append (buffer, ".print noise inoise_spectrum onoise_spectrum\n");
+			g_string_append (chunk, ".print noise inoise_spectrum onoise_spectrum\n");
 		}
 	}
 
-	g_string_append (buffer, ".op\n\n.END\n");
+	g_string_append (chunk, ".op\n\n.END\n");
+	if (!ngspice_flush_chunk (stream, chunk, &e))
+		goto error;
+
+	g_string_free (chunk, TRUE);
+	if (output.subckts)
+		g_string_free (output.subckts, TRUE);
+	g_list_free_full (output.models, g_free);
+	return TRUE;
+
+error:
+	g_propagate_error (error, e);
+	g_string_free (chunk, TRUE);
+	if (output.subckts)
+		g_string_free (output.subckts, TRUE);
+	g_list_free_full (output.models, g_free);
+	return FALSE;
+}
+
+/**
+ * \brief stream the netlist of the engine's schematic
+ *
+ * @engine
+ * @stream target, e.g. a file or the input of the simulator
+ * @error [allow-none]
+ */
+static gboolean ngspice_write_netlist (OreganoEngine *engine, GOutputStream *stream,
+                                       GError **error)
+{
+	OreganoNgSpice *ngspice = OREGANO_NGSPICE (engine);
+	NetlistSnapshot *snapshot;
+	gboolean success;
+
+	if (!ngspice_check_settings (schematic_get_sim_settings (ngspice->priv->schematic)))
+		return FALSE;
+
+	snapshot = netlist_helper_snapshot_new (ngspice->priv->schematic, error);
+	if (!snapshot)
+		return FALSE;
 
-	return buffer;
+	success = ngspice_write_netlist_snapshot (snapshot, stream, error);
+	if (success)
+		netlist_helper_snapshot_apply (snapshot);
+	netlist_helper_snapshot_free (snapshot);
+	return success;
+}
+
+/**
+ * \brief write the netlist of a snapshot to a file
+ *
+ * Does not touch the user interface, so this may run in any thread.
+ */
+static gboolean ngspice_generate_netlist_snapshot (NetlistSnapshot *snapshot,
+                                                   const gchar *filename, GError **error)
+{
+	GError *e = NULL;
+	GFile *file;
+	GFileOutputStream *file_stream;
+	GOutputStream *stream;
+	gboolean success = FALSE;
+
+	file = g_file_new_for_path (filename);
+	file_stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &e);
+	g_object_unref (file);
+	if (!file_stream) {
+		g_propagate_error (error, e);
+		return FALSE;
+	}
+
+	// cards are small, let them pile up before they hit the disk
+	stream = g_buffered_output_stream_new_sized (G_OUTPUT_STREAM (file_stream), 64 * 1024);
+	g_object_unref (file_stream);
+
+	success = ngspice_write_netlist_snapshot (snapshot, stream, &e);
+	if (success) {
+		success = g_output_stream_close (stream, NULL, &e);
+	} else {
+		// a cancelled close leaves the previous netlist as it was
+		GCancellable *cancellable = g_cancellable_new ();
+
+		g_cancellable_cancel (cancellable);
+		g_output_stream_close (stream, cancellable, NULL);
+		g_object_unref (cancellable);
+	}
+	g_object_unref (stream);
+
+	if (!success)
+		g_propagate_error (error, e);
+	return success;
 }
 
 /**
@@ -321,23 +430,28 @@ static GString *ngspice_generate_netlist_buffer (OreganoEngine *engine, GError *
 static gboolean ngspice_generate_netlist (OreganoEngine *engine, const gchar *filename,
                                           GError **error)
 {
+	OreganoNgSpice *ngspice = OREGANO_NGSPICE (engine);
+	NetlistSnapshot *snapshot;
 	GError *e = NULL;
-	GString *buffer;
-	gboolean success = FALSE;
+	gboolean success;
 
-	buffer = ngspice_generate_netlist_buffer (engine, &e);
-	if (!buffer) {
-		oregano_error (g_strdup_printf ("Failed generate netlist buffer\n"));
+	if (!ngspice_check_settings (schematic_get_sim_settings (ngspice->priv->schematic)))
+		return FALSE;
+
+	snapshot = netlist_helper_snapshot_new (ngspice->priv->schematic, &e);
+	if (!snapshot) {
 		g_propagate_error (error, e);
 		return FALSE;
 	}
 
-	success = g_file_set_contents (filename, buffer->str, buffer->len, &e);
-	g_string_free (buffer, TRUE);
+	success = ngspice_generate_netlist_snapshot (snapshot, filename, &e);
+	if (success)
+		netlist_helper_snapshot_apply (snapshot);
+	netlist_helper_snapshot_free (snapshot);
 
 	if (!success) {
+		oregano_error (g_strdup_printf ("Failed generate netlist\n"));
 		g_propagate_error (error, e);
-		oregano_error (g_strdup_printf ("Failed to open file \"%s\" in 'w' mode.\n", filename));
 		return FALSE;
 	}
 	return TRUE;
@@ -373,26 +487,96 @@ static void ngspice_stop (OreganoEngine *self)
 	}
 }
 
+//data wrapper
+typedef struct {
+	OreganoNgSpice *ngspice;
+	NetlistSnapshot *snapshot;
+	GError *error;
+} NgspiceNetlistJob;
+
+static void ngspice_netlist_failed (OreganoNgSpice *ngspice, GError *e)
+{
+	OreganoNgSpicePriv *priv = ngspice->priv;
+
+	priv->aborted = TRUE;
+	if (e)
+		schematic_log_append_error (priv->schematic, e->message);
+	else
+		schematic_log_append_error(priv->schematic, "Error at netlist generation.");
+	g_signal_emit_by_name (G_OBJECT (ngspice), "aborted");
+}
+
+/**
+ * Back in the main thread after the netlist is written, launches
+ * ngspice or reports why there is nothing to simulate.
+ */
+static gboolean ngspice_netlist_done (NgspiceNetlistJob *job)
+{
+	OreganoNgSpice *ngspice = job->ngspice;
+
+	if (cancel_info_is_cancel (ngspice->priv->cancel_info)) {
+		ngspice->priv->aborted = TRUE;
+		g_signal_emit_by_name (G_OBJECT (ngspice), "aborted");
+	} else if (job->error) {
+		ngspice_netlist_failed (ngspice, job->error);
+	} else {
+		netlist_helper_snapshot_apply (job->snapshot);
+
+		NgspiceWatcherBuildAndLaunchResources *resources = ngspice_watcher_build_and_launch_resources_new(ngspice);
+		ngspice_watcher_build_and_launch(resources);
+		ngspice_watcher_build_and_launch_resources_finalize(resources);
+	}
+
+	// the snapshot holds GObjects of the user interface, free it here
+	netlist_helper_snapshot_free (job->snapshot);
+	g_clear_error (&job->error);
+	g_object_unref (ngspice);
+	g_free (job);
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * main function of the netlist thread
+ */
+static gpointer ngspice_netlist_main (NgspiceNetlistJob *job)
+{
+	if (!cancel_info_is_cancel (job->ngspice->priv->cancel_info))
+		ngspice_generate_netlist_snapshot (job->snapshot, "/tmp/netlist.tmp", &job->error);
+
+	g_main_context_invoke (NULL, (GSourceFunc)ngspice_netlist_done, job);
+	return NULL;
+}
+
+/**
+ * Only the snapshot of the schematic is taken in the main thread, the
+ * netlist is generated and checked by a worker, so the user interface
+ * stays responsive for large schematics.
+ */
 static void ngspice_start (OreganoEngine *self)
 {
 	OreganoNgSpice *ngspice = OREGANO_NGSPICE (self);
 	OreganoNgSpicePriv *priv = ngspice->priv;
-
+	NgspiceNetlistJob *job;
+	NetlistSnapshot *snapshot;
 	GError *e = NULL;
-	if (!oregano_engine_generate_netlist (self, "/tmp/netlist.tmp", &e)) {
-		priv->aborted = TRUE;
-		if (e)
-			schematic_log_append_error (priv->schematic, e->message);
-		else
-			schematic_log_append_error(priv->schematic, "Error at netlist generation.");
-		g_signal_emit_by_name (G_OBJECT (ngspice), "aborted");
+
+	if (!ngspice_check_settings (schematic_get_sim_settings (priv->schematic))) {
+		ngspice_netlist_failed (ngspice, NULL);
+		return;
+	}
+
+	snapshot = netlist_helper_snapshot_new (priv->schematic, &e);
+	if (!snapshot) {
+		ngspice_netlist_failed (ngspice, e);
 		g_clear_error (&e);
 		return;
 	}
 
-	NgspiceWatcherBuildAndLaunchResources *resources = ngspice_watcher_build_and_launch_resources_new(ngspice);
-	ngspice_watcher_build_and_launch(resources);
-	ngspice_watcher_build_and_launch_resources_finalize(resources);
+	job = g_new0 (NgspiceNetlistJob, 1);
+	job->ngspice = g_object_ref (ngspice);
+	job->snapshot = snapshot;
+
+	g_thread_unref (g_thread_new ("spice netlister", (GThreadFunc)ngspice_netlist_main, job));
 }
 
 static GList *ngspice_get_results (OreganoEngine *self)
@@ -402,6 +586,11 @@ static GList *ngspice_get_results (OreganoEngine *self)
 	return OREGANO_NGSPICE (self)->priv->analysis;
 }
 
+static SimulationData *ngspice_get_live_results (OreganoEngine *self, gboolean *grew)
+{
+	return ngspice_analysis_live_update (&OREGANO_NGSPICE (self)->priv->live, grew);
+}
+
 static gchar *ngspice_get_operation_ngspice (OreganoEngine *self)
 {
 	OreganoNgSpicePriv *priv = OREGANO_NGSPICE (self)->priv;
@@ -435,8 +624,10 @@ static void ngspice_interface_init (gpointer g_iface, gpointer iface_data)
 	klass->progress_solver = ngspice_progress;
 	klass->progress_reader = reader_progress;
 	klass->get_netlist = ngspice_generate_netlist;
+	klass->write_netlist = ngspice_write_netlist;
 	klass->has_warnings = ngspice_has_warnings;
 	klass->get_results = ngspice_get_results;
+	klass->get_live_results = ngspice_get_live_results;
 	klass->get_operation_solver = ngspice_get_operation_ngspice;
 	klass->get_operation_reader = ngspice_get_operation_reader;
 	klass->is_available = ngspice_is_available;
@@ -455,6 +646,7 @@ static void ngspice_instance_init (GTypeInstance *instance, gpointer g_class)
 	g_mutex_init(&self->priv->progress_reader.progress_mutex);
 	self->priv->current.type = ANALYSIS_TYPE_NONE;
 	g_mutex_init(&self->priv->current.mutex);
+	g_mutex_init(&self->priv->live.mutex);
 	self->priv->num_analysis = 0;
 	self->priv->analysis = NULL;
 	self->priv->aborted = FALSE;
@@ -50,6 +50,7 @@ char *dialog_open_file (SchematicView *sv)
 
 	gtk_file_filter_set_name (orefilter, _ ("Oregano Files"));
 	gtk_file_filter_add_pattern (orefilter, "*.oregano");
+	gtk_file_filter_add_pattern (orefilter, "*.orebin");
 	gtk_file_filter_set_name (allfilter, _ ("All Files"));
 	gtk_file_filter_add_pattern (allfilter, "*");
 
@@ -90,6 +91,7 @@ void dialog_save_as (SchematicView *sv)
 	allfilter = gtk_file_filter_new ();
 	gtk_file_filter_set_name (orefilter, _ ("Oregano Files"));
 	gtk_file_filter_add_pattern (orefilter, "*.oregano");
+	gtk_file_filter_add_pattern (orefilter, "*.orebin");
 	gtk_file_filter_set_name (allfilter, _ ("All Files"));
 	gtk_file_filter_add_pattern (allfilter, "*");
 
@@ -66,8 +66,9 @@ struct _GPlotFunctionClass
 {
 	GTypeInterface parent;
 
-	void (*draw)(GPlotFunction *, cairo_t *, GPlotFunctionBBox *);
+	void (*draw)(GPlotFunction *, cairo_t *, GPlotFunctionBBox *, const GPlotFunctionStyle *);
 	void (*get_bbox)(GPlotFunction *, GPlotFunctionBBox *);
+	void (*get_style)(GPlotFunction *, GPlotFunctionStyle *);
 };
 
 #endif
@@ -30,6 +30,7 @@
  */
 
 #include <math.h>
+#include <string.h>
 
 #include "gplot-internal.h"
 #include "gplot.h"
@@ -46,6 +47,10 @@ static gboolean g_plot_button_release_cb (GtkWidget *, GdkEventButton *, GPlot *
 static void g_plot_update_bbox (GPlot *);
 static void g_plot_finalize (GObject *object);
 static void g_plot_dispose (GObject *object);
+static void g_plot_invalidate_traces (GPlot *);
+static void g_plot_render_traces (GPlot *, gint width, gint height);
+static void g_plot_invalidate_chrome (GPlot *);
+static void g_plot_function_notify_cb (GPlot *, GParamSpec *);
 
 static void get_order_of_magnitude (gdouble val, gdouble *man, gdouble *pw);
 
@@ -79,11 +84,29 @@ struct _GPlotPriv
 	cairo_matrix_t matrix;
 
 	gboolean window_valid;
+	// the user panned or zoomed, new samples do not move the window
+	gboolean window_user;
 	GPlotFunctionBBox window_bbox;
 	GPlotFunctionBBox viewport_bbox;
 
 	GPlotFunctionBBox rubberband;
 
+	// the traces as last rendered by the worker thread, blitted by
+	// g_plot_draw () with traces_matrix mapped onto matrix
+	cairo_surface_t *traces;
+	cairo_matrix_t traces_matrix;
+	gint traces_width;
+	gint traces_height;
+	guint traces_generation;
+	// border, axes and labels, cached for the window in chrome_matrix
+	cairo_surface_t *chrome;
+	cairo_matrix_t chrome_matrix;
+	gint chrome_width;
+	gint chrome_height;
+	// bumped whenever the functions or their properties change
+	guint generation;
+	gboolean rendering;
+
 #if GTK_CHECK_VERSION(3,22,0)
 	GdkDrawingContext *gdk_ctx;
 
@@ -143,6 +166,10 @@ static void g_plot_finalize (GObject *object)
 
 	g_free (p->priv->xlabel);
 	g_free (p->priv->ylabel);
+	if (p->priv->traces)
+		cairo_surface_destroy (p->priv->traces);
+	if (p->priv->chrome)
+		cairo_surface_destroy (p->priv->chrome);
 
 	G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -157,6 +184,7 @@ static void g_plot_dispose (GObject *object)
 	lst = plot->priv->functions;
 	while (lst) {
 		GPlotFunction *f = (GPlotFunction *)lst->data;
+		g_signal_handlers_disconnect_by_data (f, plot);
 		g_object_unref (G_OBJECT (f));
 		lst = lst->next;
 	}
@@ -303,47 +331,21 @@ static gchar *get_unit_text (int div)
 	return g_strdup_printf ("10e%02d", div);
 }
 
-static gboolean g_plot_draw (GtkWidget *widget, cairo_t *cr)
+/**
+ * draws everything that only depends on the window and the size of
+ * the widget: the border, the red axes, the ticks and the labels
+ */
+static void g_plot_draw_chrome (GPlot *plot, cairo_t *cr, guint width, guint height)
 {
-	static double dashes[] = {3,  // ink
-	                          3,  // skip
-	                          3,  // ink
-	                          3}; // skip
-	static int ndash = sizeof(dashes) / sizeof(dashes[0]);
-	static double offset = -0.2;
-
-	GPlot *plot;
-	GPlotPriv *priv;
-	guint width;
-	guint height;
+	GPlotPriv *priv = plot->priv;
 	guint graph_width;
 	guint graph_height;
-	GPlotFunction *f;
-	GList *lst;
-	gdouble aX, bX, aY, bY;
 	gint div;
 	cairo_text_extents_t extents;
 
-	plot = GPLOT (widget);
-	priv = plot->priv;
-
-	if (!priv->window_valid) {
-		g_plot_update_bbox (plot);
-	}
-
-	width = gtk_widget_get_allocated_width (widget);
-	height = gtk_widget_get_allocated_height (widget);
-
 	graph_width = width - priv->left_border - priv->right_border;
 	graph_height = height - priv->top_border - priv->bottom_border;
 
-	// Paint background
-	cairo_save (cr);
-	cairo_set_source_rgb (cr, 0.0, 0.0, 0.0);
-	cairo_rectangle (cr, 0, 0, width, height);
-	cairo_fill (cr);
-	cairo_restore (cr);
-
 	// Plot Border
 	cairo_save (cr);
 	cairo_set_line_width (cr, 0.5);
@@ -352,36 +354,6 @@ static gboolean g_plot_draw (GtkWidget *widget, cairo_t *cr)
 	cairo_stroke (cr);
 	cairo_restore (cr);
 
-	priv->viewport_bbox.xmax = width - priv->right_border;
-	priv->viewport_bbox.xmin = priv->left_border;
-	priv->viewport_bbox.ymax = height - priv->bottom_border;
-	priv->viewport_bbox.ymin = priv->top_border;
-
-	// Calculating Window to Viewport matrix
-	aX = (priv->viewport_bbox.xmax - priv->viewport_bbox.xmin) /
-	     (priv->window_bbox.xmax - priv->window_bbox.xmin);
-	bX = -aX * priv->window_bbox.xmin + priv->viewport_bbox.xmin;
-	aY = (priv->viewport_bbox.ymax - priv->viewport_bbox.ymin) /
-	     (priv->window_bbox.ymin - priv->window_bbox.ymax);
-	bY = -aY * priv->window_bbox.ymax + priv->viewport_bbox.ymin;
-
-	cairo_matrix_init (&priv->matrix, aX, 0, 0, aY, bX, bY);
-
-	//plot functions
-	cairo_save (cr);
-	cairo_rectangle (cr, priv->left_border, priv->right_border, graph_width, graph_height);
-	cairo_clip (cr);
-
-	cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
-	cairo_transform(cr, &priv->matrix);
-	lst = plot->priv->functions;
-	while (lst) {
-		f = (GPlotFunction *)lst->data;
-		g_plot_function_draw (f, cr, &priv->window_bbox);
-		lst = lst->next;
-	}
-	cairo_restore (cr);
-
 	//plot red axis
 	cairo_save (cr);
 	{
@@ -481,6 +453,103 @@ static gboolean g_plot_draw (GtkWidget *widget, cairo_t *cr)
 		cairo_stroke (cr);
 		cairo_restore (cr);
 	}
+}
+
+static gboolean g_plot_draw (GtkWidget *widget, cairo_t *cr)
+{
+	static double dashes[] = {3,  // ink
+	                          3,  // skip
+	                          3,  // ink
+	                          3}; // skip
+	static int ndash = sizeof(dashes) / sizeof(dashes[0]);
+	static double offset = -0.2;
+
+	GPlot *plot;
+	GPlotPriv *priv;
+	guint width;
+	guint height;
+	guint graph_width;
+	guint graph_height;
+	gdouble aX, bX, aY, bY;
+
+	plot = GPLOT (widget);
+	priv = plot->priv;
+
+	if (!priv->window_valid) {
+		g_plot_update_bbox (plot);
+	}
+
+	width = gtk_widget_get_allocated_width (widget);
+	height = gtk_widget_get_allocated_height (widget);
+
+	graph_width = width - priv->left_border - priv->right_border;
+	graph_height = height - priv->top_border - priv->bottom_border;
+
+	// Paint background
+	cairo_save (cr);
+	cairo_set_source_rgb (cr, 0.0, 0.0, 0.0);
+	cairo_rectangle (cr, 0, 0, width, height);
+	cairo_fill (cr);
+	cairo_restore (cr);
+
+	priv->viewport_bbox.xmax = width - priv->right_border;
+	priv->viewport_bbox.xmin = priv->left_border;
+	priv->viewport_bbox.ymax = height - priv->bottom_border;
+	priv->viewport_bbox.ymin = priv->top_border;
+
+	// Calculating Window to Viewport matrix
+	aX = (priv->viewport_bbox.xmax - priv->viewport_bbox.xmin) /
+	     (priv->window_bbox.xmax - priv->window_bbox.xmin);
+	bX = -aX * priv->window_bbox.xmin + priv->viewport_bbox.xmin;
+	aY = (priv->viewport_bbox.ymax - priv->viewport_bbox.ymin) /
+	     (priv->window_bbox.ymin - priv->window_bbox.ymax);
+	bY = -aY * priv->window_bbox.ymax + priv->viewport_bbox.ymin;
+
+	cairo_matrix_init (&priv->matrix, aX, 0, 0, aY, bX, bY);
+
+	//plot functions, rendered off the main thread
+	if (!priv->traces || priv->traces_generation != priv->generation ||
+	    priv->traces_width != width || priv->traces_height != height ||
+	    memcmp (&priv->traces_matrix, &priv->matrix, sizeof(cairo_matrix_t)) != 0)
+		g_plot_render_traces (plot, width, height);
+
+	if (priv->traces) {
+		cairo_matrix_t t = priv->traces_matrix;
+
+		// until the new traces are ready, the previous ones are moved
+		// to where the current window puts them
+		if (cairo_matrix_invert (&t) == CAIRO_STATUS_SUCCESS) {
+			cairo_save (cr);
+			cairo_rectangle (cr, priv->left_border, priv->right_border, graph_width,
+			                 graph_height);
+			cairo_clip (cr);
+			cairo_matrix_multiply (&t, &t, &priv->matrix);
+			cairo_transform (cr, &t);
+			cairo_set_source_surface (cr, priv->traces, 0., 0.);
+			cairo_paint (cr);
+			cairo_restore (cr);
+		}
+	}
+
+	//axes, ticks and labels, only rendered again when they change
+	if (!priv->chrome || priv->chrome_width != width || priv->chrome_height != height ||
+	    memcmp (&priv->chrome_matrix, &priv->matrix, sizeof(cairo_matrix_t)) != 0) {
+		cairo_t *chrome_cr;
+
+		if (priv->chrome)
+			cairo_surface_destroy (priv->chrome);
+		priv->chrome = gdk_window_create_similar_surface (
+		    gtk_widget_get_window (widget), CAIRO_CONTENT_COLOR_ALPHA, width, height);
+		priv->chrome_matrix = priv->matrix;
+		priv->chrome_width = width;
+		priv->chrome_height = height;
+
+		chrome_cr = cairo_create (priv->chrome);
+		g_plot_draw_chrome (plot, chrome_cr, width, height);
+		cairo_destroy (chrome_cr);
+	}
+	cairo_set_source_surface (cr, priv->chrome, 0., 0.);
+	cairo_paint (cr);
 
 	//plot rubberband (zoom-in-rectangle)
 	if (priv->action == ACTION_REGION) {
@@ -498,7 +567,6 @@ static gboolean g_plot_draw (GtkWidget *widget, cairo_t *cr)
 		cairo_stroke (cr);
 		cairo_restore (cr);
 	}
-	g_list_free_full (lst, g_object_unref);
 
 	return FALSE;
 }
@@ -550,9 +618,181 @@ int g_plot_add_function (GPlot *plot, GPlotFunction *func)
 
 	plot->priv->functions = g_list_append (plot->priv->functions, func);
 	plot->priv->window_valid = FALSE;
+	g_signal_connect_swapped (G_OBJECT (func), "notify", G_CALLBACK (g_plot_function_notify_cb),
+	                          plot);
+	g_plot_invalidate_traces (plot);
 	return 0;
 }
 
+/**
+ * drops a function, the window is kept so the view does not jump
+ */
+void g_plot_remove_function (GPlot *plot, GPlotFunction *func)
+{
+	GList *lst;
+
+	g_return_if_fail (IS_GPLOT (plot));
+
+	lst = g_list_find (plot->priv->functions, func);
+	if (!lst)
+		return;
+
+	plot->priv->functions = g_list_delete_link (plot->priv->functions, lst);
+	g_signal_handlers_disconnect_by_data (func, plot);
+	g_object_unref (G_OBJECT (func));
+	g_plot_invalidate_traces (plot);
+}
+
+/**
+ * the cached axes no longer match the labels, a redraw renders them
+ * again
+ */
+static void g_plot_invalidate_chrome (GPlot *plot)
+{
+	if (plot->priv->chrome) {
+		cairo_surface_destroy (plot->priv->chrome);
+		plot->priv->chrome = NULL;
+	}
+	gtk_widget_queue_draw (GTK_WIDGET (plot));
+}
+
+/**
+ * the cached traces no longer show the functions, a redraw renders
+ * them again
+ */
+static void g_plot_invalidate_traces (GPlot *plot)
+{
+	plot->priv->generation++;
+	gtk_widget_queue_draw (GTK_WIDGET (plot));
+}
+
+static void g_plot_function_notify_cb (GPlot *plot, GParamSpec *spec)
+{
+	// growing functions keep the window fitted, unless the user moved it
+	if (g_strcmp0 (g_param_spec_get_name (spec), "points") == 0 && !plot->priv->window_user)
+		plot->priv->window_valid = FALSE;
+	g_plot_invalidate_traces (plot);
+}
+
+// a function and the style it is drawn with
+typedef struct
+{
+	GPlotFunction *function;
+	GPlotFunctionStyle style;
+} GPlotRenderTrace;
+
+//data wrapper
+typedef struct
+{
+	GPlot *plot;
+	GPlotRenderTrace *traces;
+	guint n_traces;
+	GPlotFunctionBBox window_bbox;
+	GPlotFunctionBBox viewport_bbox;
+	cairo_matrix_t matrix;
+	gint width;
+	gint height;
+	gint scale;
+	guint generation;
+	cairo_surface_t *surface;
+} GPlotRenderJob;
+
+/**
+ * main thread, takes over the traces and redraws, which renders again
+ * if the window moved in the meantime
+ */
+static gboolean g_plot_render_done (GPlotRenderJob *job)
+{
+	GPlotPriv *priv = job->plot->priv;
+	guint i;
+
+	if (priv->traces)
+		cairo_surface_destroy (priv->traces);
+	priv->traces = job->surface;
+	priv->traces_matrix = job->matrix;
+	priv->traces_width = job->width;
+	priv->traces_height = job->height;
+	priv->traces_generation = job->generation;
+	priv->rendering = FALSE;
+
+	gtk_widget_queue_draw (GTK_WIDGET (job->plot));
+
+	for (i = 0; i < job->n_traces; i++)
+		g_object_unref (job->traces[i].function);
+	g_free (job->traces);
+	g_object_unref (job->plot);
+	g_free (job);
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * worker thread, only touches the job, the samples of the functions are
+ * locked while they are drawn and their properties were copied
+ */
+static void g_plot_render_main (GPlotRenderJob *job, gpointer user_data)
+{
+	cairo_t *cr;
+	guint i;
+
+	job->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, job->width * job->scale,
+	                                           job->height * job->scale);
+	cairo_surface_set_device_scale (job->surface, job->scale, job->scale);
+
+	cr = cairo_create (job->surface);
+	cairo_rectangle (cr, job->viewport_bbox.xmin, job->viewport_bbox.ymin,
+	                 job->viewport_bbox.xmax - job->viewport_bbox.xmin,
+	                 job->viewport_bbox.ymax - job->viewport_bbox.ymin);
+	cairo_clip (cr);
+
+	cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+	cairo_transform (cr, &job->matrix);
+	for (i = 0; i < job->n_traces; i++)
+		g_plot_function_draw_with_style (job->traces[i].function, cr, &job->window_bbox,
+		                                 &job->traces[i].style);
+	cairo_destroy (cr);
+	cairo_surface_flush (job->surface);
+
+	g_main_context_invoke (NULL, (GSourceFunc)g_plot_render_done, job);
+}
+
+/**
+ * renders the traces for the current window into an image surface on
+ * the render thread, which all plots share, at most one job per plot
+ */
+static void g_plot_render_traces (GPlot *plot, gint width, gint height)
+{
+	static GThreadPool *pool = NULL;
+	GPlotPriv *priv = plot->priv;
+	GPlotRenderJob *job;
+	GList *lst;
+	guint i;
+
+	if (priv->rendering || width <= 0 || height <= 0)
+		return;
+
+	if (!pool)
+		pool = g_thread_pool_new ((GFunc)g_plot_render_main, NULL, 1, FALSE, NULL);
+
+	job = g_new0 (GPlotRenderJob, 1);
+	job->plot = g_object_ref (plot);
+	job->n_traces = g_list_length (priv->functions);
+	job->traces = g_new (GPlotRenderTrace, job->n_traces);
+	for (lst = priv->functions, i = 0; lst; lst = lst->next, i++) {
+		job->traces[i].function = g_object_ref (lst->data);
+		g_plot_function_get_style (lst->data, &job->traces[i].style);
+	}
+	job->window_bbox = priv->window_bbox;
+	job->viewport_bbox = priv->viewport_bbox;
+	job->matrix = priv->matrix;
+	job->width = width;
+	job->height = height;
+	job->scale = gtk_widget_get_scale_factor (GTK_WIDGET (plot));
+	job->generation = priv->generation;
+
+	priv->rendering = TRUE;
+	g_thread_pool_push (pool, job, NULL);
+}
+
 static gboolean g_plot_motion_cb (GtkWidget *w, GdkEventMotion *e, GPlot *p)
 {
 #if GTK_CHECK_VERSION (3,16,0)
@@ -587,6 +827,7 @@ static gboolean g_plot_motion_cb (GtkWidget *w, GdkEventMotion *e, GPlot *p)
 			p->priv->press_x = e->x;
 			p->priv->press_y = e->y;
 			p->priv->action = ACTION_PAN;
+			p->priv->window_user = TRUE;
 			gtk_widget_queue_draw (w);
 		}
 		break;
@@ -600,6 +841,8 @@ static gboolean g_plot_motion_cb (GtkWidget *w, GdkEventMotion *e, GPlot *p)
 			gdk_window_set_cursor (gtk_widget_get_window (w), cursor);
 			gdk_flush ();
 
+			GPlotFunctionBBox old = p->priv->rubberband;
+
 			p->priv->rubberband.xmin = MIN(e->x, p->priv->press_x);
 			p->priv->rubberband.xmax = MAX(e->x, p->priv->press_x);
 
@@ -607,7 +850,15 @@ static gboolean g_plot_motion_cb (GtkWidget *w, GdkEventMotion *e, GPlot *p)
 			p->priv->rubberband.ymax = MAX(e->y, p->priv->press_y);
 
 			p->priv->action = ACTION_REGION;
-			gtk_widget_queue_draw (w);
+
+			// only the overlay changed, repaint where the old and the new
+			// rubberband are, plus the width of the dashed line
+			old.xmin = MIN (old.xmin, p->priv->rubberband.xmin) - 2;
+			old.ymin = MIN (old.ymin, p->priv->rubberband.ymin) - 2;
+			old.xmax = MAX (old.xmax, p->priv->rubberband.xmax) + 2;
+			old.ymax = MAX (old.ymax, p->priv->rubberband.ymax) + 2;
+			gtk_widget_queue_draw_area (w, old.xmin, old.ymin, old.xmax - old.xmin + 1,
+			                            old.ymax - old.ymin + 1);
 		}
 	}
 
@@ -667,6 +918,7 @@ static gboolean g_plot_button_release_cb (GtkWidget *w, GdkEventButton *e, GPlot
 			p->priv->window_bbox.xmax /= zoom;
 			p->priv->window_bbox.ymin /= zoom;
 			p->priv->window_bbox.ymax /= zoom;
+			p->priv->window_user = TRUE;
 			gtk_widget_queue_draw (w);
 		} else {
 			gdk_window_set_cursor (gtk_widget_get_window (w), NULL);
@@ -697,6 +949,7 @@ static gboolean g_plot_button_release_cb (GtkWidget *w, GdkEventButton *e, GPlot
 				p->priv->window_bbox.xmax = x2;
 				p->priv->window_bbox.ymin = y2;
 				p->priv->window_bbox.ymax = y1;
+				p->priv->window_user = TRUE;
 			}
 		} else if (e->button == 3) {
 			gdk_window_set_cursor (gtk_widget_get_window (w), NULL);
@@ -759,6 +1012,7 @@ static void g_plot_update_bbox (GPlot *p)
 	priv->window_bbox.ymax *= 1.1;
 
 	priv->window_valid = TRUE;
+	priv->window_user = FALSE;
 }
 
 void g_plot_reset_zoom (GPlot *p)
@@ -821,6 +1075,7 @@ void g_plot_set_axis_labels (GPlot *p, gchar *x, gchar *y)
 			p->priv->ylabel = NULL;
 		}
 	}
+	g_plot_invalidate_chrome (p);
 }
 
 void g_plot_clear (GPlot *plot)
@@ -833,6 +1088,7 @@ void g_plot_clear (GPlot *plot)
 	lst = plot->priv->functions;
 
 	while (lst) {
+		g_signal_handlers_disconnect_by_data (lst->data, plot);
 		g_object_unref (G_OBJECT (lst->data));
 		lst = lst->next;
 	}
@@ -840,6 +1096,7 @@ void g_plot_clear (GPlot *plot)
 	plot->priv->functions = NULL;
 	plot->priv->window_valid = FALSE;
 	g_list_free (lst);
+	g_plot_invalidate_traces (plot);
 }
 
 void g_plot_window_to_device (GPlot *plot, double *x, double *y)
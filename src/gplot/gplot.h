@@ -49,6 +49,7 @@ GType g_plot_get_type ();
 GtkWidget *g_plot_new ();
 void g_plot_clear (GPlot *);
 int g_plot_add_function (GPlot *, GPlotFunction *);
+void g_plot_remove_function (GPlot *, GPlotFunction *);
 void g_plot_set_zoom_mode (GPlot *, guint);
 guint g_plot_get_zoom_mode (GPlot *);
 void g_plot_reset_zoom (GPlot *);
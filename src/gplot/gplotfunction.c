@@ -27,6 +27,8 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <string.h>
+
 #include "gplot-internal.h"
 #include "gplotfunction.h"
 
@@ -65,9 +67,29 @@ GType g_plot_function_get_type (void)
 }
 
 void g_plot_function_draw (GPlotFunction *self, cairo_t *cr, GPlotFunctionBBox *bbox)
+{
+	GPlotFunctionStyle style;
+
+	g_plot_function_get_style (self, &style);
+	g_plot_function_draw_with_style (self, cr, bbox, &style);
+}
+
+/**
+ * draws with @style instead of the current properties, which makes
+ * drawing off the main thread safe
+ */
+void g_plot_function_draw_with_style (GPlotFunction *self, cairo_t *cr, GPlotFunctionBBox *bbox,
+                                      const GPlotFunctionStyle *style)
 {
 	if (GPLOT_FUNCTION_GET_CLASS (self)->draw)
-		GPLOT_FUNCTION_GET_CLASS (self)->draw (self, cr, bbox);
+		GPLOT_FUNCTION_GET_CLASS (self)->draw (self, cr, bbox, style);
+}
+
+void g_plot_function_get_style (GPlotFunction *self, GPlotFunctionStyle *style)
+{
+	memset (style, 0, sizeof(GPlotFunctionStyle));
+	if (GPLOT_FUNCTION_GET_CLASS (self)->get_style)
+		GPLOT_FUNCTION_GET_CLASS (self)->get_style (self, style);
 }
 
 void g_plot_function_get_bbox (GPlotFunction *self, GPlotFunctionBBox *bbox)
@@ -43,7 +43,21 @@ typedef struct _GPlotFunctionBBox
 	gdouble ymax;
 } GPlotFunctionBBox;
 
+// the properties a function is drawn with, taken on the main thread so
+// that it can be drawn elsewhere while they change
+typedef struct _GPlotFunctionStyle
+{
+	gboolean visible;
+	gdouble width;
+	GdkRGBA color;
+	gint graphic_type;
+	gdouble shift;
+} GPlotFunctionStyle;
+
 void g_plot_function_draw (GPlotFunction *, cairo_t *, GPlotFunctionBBox *);
+void g_plot_function_draw_with_style (GPlotFunction *, cairo_t *, GPlotFunctionBBox *,
+                                      const GPlotFunctionStyle *);
+void g_plot_function_get_style (GPlotFunction *, GPlotFunctionStyle *);
 void g_plot_function_get_bbox (GPlotFunction *, GPlotFunctionBBox *);
 void g_plot_function_set_visible (GPlotFunction *, gboolean);
 gboolean g_plot_function_get_visible (GPlotFunction *);
@@ -0,0 +1,98 @@
+/*
+ * gplotlines-private.h
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GPLOT_LINES_PRIVATE_H_
+#define _GPLOT_LINES_PRIVATE_H_
+
+#include "gplot-internal.h"
+#include "gplotlines.h"
+
+typedef struct _GPlotLines GPlotLines;
+typedef struct _GPlotLinesPriv GPlotLinesPriv;
+
+struct _GPlotLines
+{
+	GObject parent;
+
+	GPlotLinesPriv *priv;
+};
+
+// functions with fewer samples are always drawn point by point
+#define G_PLOT_LINES_LOD_MIN_POINTS 4096
+
+// One level of the min/max pyramid. Level n splits the samples into
+// buckets of 2^(n+1) and keeps the index of the smallest and the largest
+// sample of each bucket, so spikes survive the decimation.
+typedef struct
+{
+	guint *imin;
+	guint *imax;
+	guint buckets;
+} GPlotLinesLevel;
+
+struct _GPlotLinesPriv
+{
+	gboolean bbox_valid;
+	GPlotFunctionBBox bbox;
+	gdouble *x;
+	gdouble *y;
+	gdouble points;
+	// if set, x and y point into these shared columns instead of being owned
+	GArray *x_column;
+	GArray *y_column;
+	// or into these, e.g. columns mapped from a file
+	GBytes *x_bytes;
+	GBytes *y_bytes;
+	gboolean visible;
+
+	// Line width
+	gdouble width;
+
+	// Line Color
+	gchar *color_string;
+	GdkRGBA color;
+
+	// Graphic type
+	GraphicType graphic_type;
+
+	// Shift for pulse drawings
+	gdouble shift;
+
+	// x is non-decreasing, so the visible samples can be searched for
+	gboolean sorted;
+
+	// min/max pyramid, lod[n] has buckets of 2^(n+1) samples,
+	// NULL if the function is short or x is not sorted
+	GPlotLinesLevel *lod;
+	guint lod_levels;
+
+	// held for reading while drawing, which may happen on the render
+	// thread, and for writing while new samples are picked up
+	GRWLock lock;
+};
+
+void g_plot_lines_extend_lod (GPlotLinesPriv *priv, guint old_points);
+gboolean g_plot_lines_visible_range (GPlotLinesPriv *priv, GPlotFunctionBBox *bbox, guint *first,
+                                     guint *last);
+
+#endif
@@ -28,21 +28,14 @@
  */
 
 #include <string.h>
+#include <math.h>
 
 #include "gplot-internal.h"
 #include "gplotlines.h"
+#include "gplotlines-private.h"
 
-typedef struct _GPlotLines GPlotLines;
-typedef struct _GPlotLinesPriv GPlotLinesPriv;
 typedef struct _GPlotLinesClass GPlotLinesClass;
 
-struct _GPlotLines
-{
-	GObject parent;
-
-	GPlotLinesPriv *priv;
-};
-
 struct _GPlotLinesClass
 {
 	GObjectClass parent;
@@ -52,39 +45,28 @@ GType g_plot_function_get_type ();
 
 static void g_plot_lines_class_init (GPlotLinesClass *class);
 static void g_plot_lines_init (GPlotLines *plot);
-static void g_plot_lines_draw (GPlotFunction *, cairo_t *, GPlotFunctionBBox *);
+static void g_plot_lines_draw (GPlotFunction *, cairo_t *, GPlotFunctionBBox *,
+                               const GPlotFunctionStyle *);
+static void g_plot_lines_get_style (GPlotFunction *, GPlotFunctionStyle *);
 static void g_plot_lines_get_bbox (GPlotFunction *, GPlotFunctionBBox *);
 static void g_plot_lines_function_init (GPlotFunctionClass *iface);
 static void g_plot_lines_set_property (GObject *object, guint prop_id, const GValue *value,
                                        GParamSpec *spec);
 static void g_plot_lines_get_property (GObject *object, guint prop_id, GValue *value,
                                        GParamSpec *spec);
+static void g_plot_lines_free_lod (GPlotLinesPriv *priv);
 
 static GObjectClass *parent_class = NULL;
 
-enum { ARG_0, ARG_WIDTH, ARG_COLOR, ARG_COLOR_GDKRGBA, ARG_VISIBLE, ARG_GRAPH_TYPE, ARG_SHIFT };
-
-struct _GPlotLinesPriv
-{
-	gboolean bbox_valid;
-	GPlotFunctionBBox bbox;
-	gdouble *x;
-	gdouble *y;
-	gdouble points;
-	gboolean visible;
-
-	// Line width
-	gdouble width;
-
-	// Line Color
-	gchar *color_string;
-	GdkRGBA color;
-
-	// Graphic type
-	GraphicType graphic_type;
-
-	// Shift for pulse drawings
-	gdouble shift;
+enum {
+	ARG_0,
+	ARG_WIDTH,
+	ARG_COLOR,
+	ARG_COLOR_GDKRGBA,
+	ARG_VISIBLE,
+	ARG_GRAPH_TYPE,
+	ARG_SHIFT,
+	ARG_POINTS
 };
 
 #define TYPE_GPLOT_LINES (g_plot_lines_get_type ())
@@ -110,6 +92,7 @@ static void g_plot_lines_function_init (GPlotFunctionClass *iface)
 {
 	iface->draw = g_plot_lines_draw;
 	iface->get_bbox = g_plot_lines_get_bbox;
+	iface->get_style = g_plot_lines_get_style;
 }
 
 static void g_plot_lines_dispose (GObject *object)
@@ -124,9 +107,21 @@ static void g_plot_lines_finalize (GObject *object)
 	lines = GPLOT_LINES (object);
 
 	if (lines->priv) {
-		g_free (lines->priv->x);
-		g_free (lines->priv->y);
+		g_plot_lines_free_lod (lines->priv);
+		if (lines->priv->x_column)
+			g_array_unref (lines->priv->x_column);
+		else if (lines->priv->x_bytes)
+			g_bytes_unref (lines->priv->x_bytes);
+		else
+			g_free (lines->priv->x);
+		if (lines->priv->y_column)
+			g_array_unref (lines->priv->y_column);
+		else if (lines->priv->y_bytes)
+			g_bytes_unref (lines->priv->y_bytes);
+		else
+			g_free (lines->priv->y);
 		g_free (lines->priv->color_string);
+		g_rw_lock_clear (&lines->priv->lock);
 		g_free (lines->priv);
 	}
 
@@ -171,6 +166,11 @@ static void g_plot_lines_class_init (GPlotLinesClass *class)
 	                                 g_param_spec_double ("shift", "GPlotLines::shift",
 	                                                      "the shift for multiple pulses", 0.0,
 	                                                      15e+10, 50.0, G_PARAM_READWRITE));
+
+	g_object_class_install_property (object_class, ARG_POINTS,
+	                                 g_param_spec_uint ("points", "GPlotLines::points",
+	                                                    "the number of samples drawn", 0,
+	                                                    G_MAXUINT, 0, G_PARAM_READABLE));
 }
 
 static void g_plot_lines_init (GPlotLines *plot)
@@ -185,6 +185,7 @@ static void g_plot_lines_init (GPlotLines *plot)
 	priv->visible = TRUE;
 	priv->color_string = g_strdup ("white");
 	memset (&priv->color, 0xFF, sizeof(GdkRGBA));
+	g_rw_lock_init (&priv->lock);
 }
 
 static void g_plot_lines_set_property (GObject *object, guint prop_id, const GValue *value,
@@ -236,23 +237,212 @@ static void g_plot_lines_get_property (GObject *object, guint prop_id, GValue *v
 	case ARG_SHIFT:
 		g_value_set_double (value, plot->priv->shift);
 		break;
+	case ARG_POINTS:
+		g_value_set_uint (value, plot->priv->points);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (plot, prop_id, spec);
 	}
 }
 
+static void g_plot_lines_free_lod (GPlotLinesPriv *priv)
+{
+	guint level;
+
+	for (level = 0; level < priv->lod_levels; level++) {
+		g_free (priv->lod[level].imin);
+		g_free (priv->lod[level].imax);
+	}
+	g_free (priv->lod);
+	priv->lod = NULL;
+	priv->lod_levels = 0;
+}
+
+/**
+ * builds the min/max pyramid of a function, each level halves the
+ * number of buckets of the one below until a single bucket is left
+ *
+ * @param old_points the samples the pyramid already covers, only the
+ * buckets from the one holding sample old_points upwards are redone
+ */
+void g_plot_lines_extend_lod (GPlotLinesPriv *priv, guint old_points)
+{
+	guint points = priv->points;
+	guint level, bucket, count, dirty, levels;
+	const gdouble *y = priv->y;
+
+	// buckets are looked up by x, that only works if x is sorted
+	if (points < G_PLOT_LINES_LOD_MIN_POINTS || !priv->sorted)
+		return;
+
+	if (!priv->lod)
+		old_points = 0;
+
+	levels = g_bit_storage (points);
+	priv->lod = g_renew (GPlotLinesLevel, priv->lod, levels);
+	memset (priv->lod + priv->lod_levels, 0, (levels - priv->lod_levels) * sizeof(GPlotLinesLevel));
+
+	// dirty is the first entry of the level below that changed
+	for (level = 0, count = points, dirty = old_points; count > 1; level++) {
+		GPlotLinesLevel *lod = &priv->lod[level];
+		GPlotLinesLevel *below = level > 0 ? &priv->lod[level - 1] : NULL;
+		guint first = MIN (dirty / 2, lod->buckets);
+
+		if (lod->buckets != (count + 1) / 2) {
+			lod->buckets = (count + 1) / 2;
+			lod->imin = g_renew (guint, lod->imin, lod->buckets);
+			lod->imax = g_renew (guint, lod->imax, lod->buckets);
+		}
+
+		for (bucket = first; bucket < lod->buckets; bucket++) {
+			guint a = 2 * bucket, b = MIN (2 * bucket + 1, count - 1);
+			guint amin, amax, bmin, bmax;
+
+			if (below) {
+				amin = below->imin[a];
+				amax = below->imax[a];
+				bmin = below->imin[b];
+				bmax = below->imax[b];
+			} else {
+				amin = amax = a;
+				bmin = bmax = b;
+			}
+			lod->imin[bucket] = y[bmin] < y[amin] ? bmin : amin;
+			lod->imax[bucket] = y[bmax] > y[amax] ? bmax : amax;
+		}
+
+		dirty = first;
+		count = lod->buckets;
+	}
+	priv->lod_levels = MAX (priv->lod_levels, level);
+}
+
 GPlotFunction *g_plot_lines_new (gdouble *x, gdouble *y, guint points)
 {
 	GPlotLines *plot;
+	guint point;
 
 	plot = GPLOT_LINES (g_object_new (TYPE_GPLOT_LINES, NULL));
 	plot->priv->x = x;
 	plot->priv->y = y;
 	plot->priv->points = points;
 
+	plot->priv->sorted = TRUE;
+	for (point = 1; point < points && plot->priv->sorted; point++)
+		plot->priv->sorted = x[point] >= x[point - 1];
+
+	g_plot_lines_extend_lod (plot->priv, 0);
+
+	return GPLOT_FUNCTION (plot);
+}
+
+/**
+ * \brief creates a function which draws straight from columns of doubles
+ *
+ * Instead of copying, a reference to each column is kept, so several
+ * functions can share the same x column.
+ *
+ * @param x the x values
+ * @param y the y values, its length is the number of points drawn
+ */
+GPlotFunction *g_plot_lines_new_from_columns (GArray *x, GArray *y)
+{
+	GPlotLines *plot;
+	guint points;
+
+	g_return_val_if_fail (x != NULL, NULL);
+	g_return_val_if_fail (y != NULL, NULL);
+	g_return_val_if_fail (g_array_get_element_size (x) == sizeof(gdouble), NULL);
+	g_return_val_if_fail (g_array_get_element_size (y) == sizeof(gdouble), NULL);
+
+	points = MIN (x->len, y->len);
+	plot = GPLOT_LINES (g_plot_lines_new ((gdouble *)x->data, (gdouble *)y->data, points));
+	plot->priv->x_column = g_array_ref (x);
+	plot->priv->y_column = g_array_ref (y);
+
+	return GPLOT_FUNCTION (plot);
+}
+
+/**
+ * \brief creates a function which draws straight from read-only doubles
+ *
+ * Like g_plot_lines_new_from_columns (), for columns which are not a
+ * GArray, e.g. results mapped from a file.
+ *
+ * @param x the x values
+ * @param y the y values
+ */
+GPlotFunction *g_plot_lines_new_from_bytes (GBytes *x, GBytes *y)
+{
+	GPlotLines *plot;
+	gsize x_size, y_size;
+	gconstpointer x_data, y_data;
+
+	g_return_val_if_fail (x != NULL, NULL);
+	g_return_val_if_fail (y != NULL, NULL);
+
+	x_data = g_bytes_get_data (x, &x_size);
+	y_data = g_bytes_get_data (y, &y_size);
+	plot = GPLOT_LINES (g_plot_lines_new ((gdouble *)x_data, (gdouble *)y_data,
+	                                      MIN (x_size, y_size) / sizeof(gdouble)));
+	plot->priv->x_bytes = g_bytes_ref (x);
+	plot->priv->y_bytes = g_bytes_ref (y);
+
 	return GPLOT_FUNCTION (plot);
 }
 
+/**
+ * \brief picks up the samples appended to the columns of the function
+ *
+ * Only the new tail is checked for order and added to the bounding box
+ * and to the min/max pyramid. Emits notify::points if samples were
+ * added.
+ *
+ * The columns must not be reallocated while the function may be drawn
+ * on another thread, so reserve their final size up front.
+ */
+void g_plot_lines_update_columns (GPlotFunction *f)
+{
+	GPlotLinesPriv *priv;
+	guint old_points, points, point;
+
+	g_return_if_fail (IS_GPLOT_LINES (f));
+
+	priv = GPLOT_LINES (f)->priv;
+	g_return_if_fail (priv->x_column != NULL && priv->y_column != NULL);
+
+	old_points = priv->points;
+	points = MIN (priv->x_column->len, priv->y_column->len);
+	if (points <= old_points)
+		return;
+
+	g_rw_lock_writer_lock (&priv->lock);
+
+	priv->x = (gdouble *)priv->x_column->data;
+	priv->y = (gdouble *)priv->y_column->data;
+	priv->points = points;
+
+	for (point = MAX (old_points, 1); point < points && priv->sorted; point++)
+		priv->sorted = priv->x[point] >= priv->x[point - 1];
+	if (priv->sorted)
+		g_plot_lines_extend_lod (priv, old_points);
+	else
+		g_plot_lines_free_lod (priv);
+
+	if (priv->bbox_valid) {
+		for (point = old_points; point < points; point++) {
+			priv->bbox.xmin = MIN (priv->bbox.xmin, priv->x[point]);
+			priv->bbox.ymin = MIN (priv->bbox.ymin, priv->y[point]);
+			priv->bbox.xmax = MAX (priv->bbox.xmax, priv->x[point]);
+			priv->bbox.ymax = MAX (priv->bbox.ymax, priv->y[point]);
+		}
+	}
+
+	g_rw_lock_writer_unlock (&priv->lock);
+
+	g_object_notify (G_OBJECT (f), "points");
+}
+
 static void g_plot_lines_get_bbox (GPlotFunction *f, GPlotFunctionBBox *bbox)
 {
 	GPlotLines *plot;
@@ -286,64 +476,194 @@ static void g_plot_lines_get_bbox (GPlotFunction *f, GPlotFunctionBBox *bbox)
 	(*bbox) = plot->priv->bbox;
 }
 
+/**
+ * adds the segment from sample prev to sample point to the path,
+ * segments which end outside of bbox close the current sub path
+ */
+static inline void g_plot_lines_segment (cairo_t *cr, const gdouble *x, const gdouble *y,
+                                         guint prev, guint point, GPlotFunctionBBox *bbox,
+                                         gboolean *first_point)
+{
+	if ((x[point] >= bbox->xmin) && (x[point] <= bbox->xmax) && (y[point] >= bbox->ymin) &&
+	    (y[point] <= bbox->ymax)) {
+
+		if (*first_point) {
+			cairo_move_to (cr, x[prev], y[prev]);
+			*first_point = FALSE;
+		}
+
+		cairo_line_to (cr, x[point], y[point]);
+	} else {
+		if (!*first_point) {
+			cairo_line_to (cr, x[point], y[point]);
+			*first_point = TRUE;
+		}
+	}
+}
+
+/**
+ * @returns the index of the first sample with x >= value, or points
+ */
+static guint g_plot_lines_lower_bound (const gdouble *x, guint points, gdouble value)
+{
+	guint low = 0, high = points;
+
+	while (low < high) {
+		guint mid = low + (high - low) / 2;
+
+		if (x[mid] < value)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+/**
+ * finds the samples inside the x range of bbox, plus the one before
+ * and the one after it, so the lines leaving the window are drawn
+ *
+ * @returns FALSE if there is nothing to draw
+ */
+gboolean g_plot_lines_visible_range (GPlotLinesPriv *priv, GPlotFunctionBBox *bbox, guint *first,
+                                     guint *last)
+{
+	guint points = priv->points;
+
+	if (points == 0)
+		return FALSE;
+
+	if (!priv->sorted) {
+		*first = 0;
+		*last = points - 1;
+		return TRUE;
+	}
+
+	*first = g_plot_lines_lower_bound (priv->x, points, bbox->xmin);
+	*last = g_plot_lines_lower_bound (priv->x, points, bbox->xmax);
+	// the last one equal to xmax is still inside
+	while (*last < points && priv->x[*last] <= bbox->xmax)
+		(*last)++;
+
+	if (*first > 0)
+		(*first)--;
+	if (*last >= points)
+		*last = points - 1;
+	return *first < *last;
+}
+
+/**
+ * picks the pyramid level whose buckets are about one pixel wide
+ *
+ * @returns 0 to draw every sample, else the number of the level + 1
+ */
+static guint g_plot_lines_select_level (GPlotLines *plot, cairo_t *cr, GPlotFunctionBBox *bbox,
+                                        guint samples)
+{
+	gdouble pixels, dy = 0., per_pixel;
+	guint level;
+
+	if (!plot->priv->lod)
+		return 0;
+
+	pixels = bbox->xmax - bbox->xmin;
+	cairo_user_to_device_distance (cr, &pixels, &dy);
+	pixels = fabs (pixels);
+	if (pixels < 1.)
+		return 0;
+
+	per_pixel = samples / pixels;
+
+	// every bucket emits two points, so round up to stay below 2 per pixel
+	for (level = 0; level < plot->priv->lod_levels && (gdouble)(1u << level) < per_pixel;
+	     level++)
+		;
+	return level;
+}
+
+static void g_plot_lines_get_style (GPlotFunction *f, GPlotFunctionStyle *style)
+{
+	GPlotLinesPriv *priv = GPLOT_LINES (f)->priv;
+
+	style->visible = priv->visible;
+	style->width = priv->width;
+	style->color = priv->color;
+	style->graphic_type = priv->graphic_type;
+	style->shift = priv->shift;
+}
+
 // This procedure is in charge to link points with ligne.
 // Modified to only draw spectral ray for Fourier analysis.
-static void g_plot_lines_draw (GPlotFunction *f, cairo_t *cr, GPlotFunctionBBox *bbox)
+static void g_plot_lines_draw (GPlotFunction *f, cairo_t *cr, GPlotFunctionBBox *bbox,
+                               const GPlotFunctionStyle *style)
 {
 	gboolean first_point = TRUE;
-	guint point;
+	guint point, first = 0, last = 0;
 	gdouble *x, x1;
 	gdouble *y, y1;
-	guint points;
+	guint points, level = 0;
 	GPlotLines *plot;
 
 	g_return_if_fail (IS_GPLOT_LINES (f));
 
 	plot = GPLOT_LINES (f);
 
-	if (!plot->priv->visible)
+	if (!style->visible)
 		return;
 
+	g_rw_lock_reader_lock (&plot->priv->lock);
+
 	points = plot->priv->points;
 	x = plot->priv->x;
 	y = plot->priv->y;
 
-	if (plot->priv->graphic_type == FUNCTIONAL_CURVE) {
-		for (point = 1; point < points; point++) {
-			if ((x[point] >= bbox->xmin) && (x[point] <= bbox->xmax) && (y[point] >= bbox->ymin) &&
-			    (y[point] <= bbox->ymax)) {
-
-				if (first_point) {
-					cairo_move_to (cr, x[point - 1], y[point - 1]);
-					first_point = FALSE;
-				}
+	if (style->graphic_type == FUNCTIONAL_CURVE) {
+		if (!g_plot_lines_visible_range (plot->priv, bbox, &first, &last)) {
+			g_rw_lock_reader_unlock (&plot->priv->lock);
+			return;
+		}
+		level = g_plot_lines_select_level (plot, cr, bbox, last - first + 1);
+	}
 
-				cairo_line_to (cr, x[point], y[point]);
-			} else {
-				if (!first_point) {
-					cairo_line_to (cr, x[point], y[point]);
-					first_point = TRUE;
-				}
-			}
+	if (style->graphic_type == FUNCTIONAL_CURVE && level > 0) {
+		GPlotLinesLevel *lod = &plot->priv->lod[level - 1];
+		guint bucket, prev = first;
+
+		// at most two segments per bucket, the extremes in sample order
+		for (bucket = first >> level; bucket <= last >> level; bucket++) {
+			point = MIN (lod->imin[bucket], lod->imax[bucket]);
+			if (point != prev)
+				g_plot_lines_segment (cr, x, y, prev, point, bbox, &first_point);
+			prev = point;
+			point = MAX (lod->imin[bucket], lod->imax[bucket]);
+			if (point != prev)
+				g_plot_lines_segment (cr, x, y, prev, point, bbox, &first_point);
+			prev = point;
 		}
+		point = points;
+	} else if (style->graphic_type == FUNCTIONAL_CURVE) {
+		for (point = first + 1; point <= last; point++)
+			g_plot_lines_segment (cr, x, y, point - 1, point, bbox, &first_point);
+		point = points;
 	} else {
 		for (point = 1; point < points; point++) {
-			x1 = x[point - 1] + plot->priv->shift;
+			x1 = x[point - 1] + style->shift;
 			y1 = 0;
 			NG_DEBUG ("gplotlines: x= %lf\ty= %lf\n", x1, y1);
 			cairo_line_to (cr, x1, y1);
-			cairo_move_to (cr, x[point] + plot->priv->shift, y[point]);
+			cairo_move_to (cr, x[point] + style->shift, y[point]);
 		}
 	}
 	if (point < points) {
 		cairo_line_to (cr, x[point], y[point]);
 	}
 
+	g_rw_lock_reader_unlock (&plot->priv->lock);
+
 	cairo_save (cr);
-	cairo_set_source_rgb (cr, plot->priv->color.red, plot->priv->color.green,
-	                      plot->priv->color.blue);
+	cairo_set_source_rgb (cr, style->color.red, style->color.green, style->color.blue);
 	cairo_identity_matrix (cr);
-	cairo_set_line_width (cr, plot->priv->width);
+	cairo_set_line_width (cr, style->width);
 	cairo_stroke (cr);
 	cairo_restore (cr);
 }
@@ -38,5 +38,8 @@ typedef enum { FUNCTIONAL_CURVE = 0, FREQUENCY_PULSE } GraphicType;
 #define IS_GPLOT_LINES(obj) G_TYPE_CHECK_INSTANCE_TYPE (obj, TYPE_GPLOT_LINES)
 
 GPlotFunction *g_plot_lines_new (gdouble *x, gdouble *y, guint points);
+GPlotFunction *g_plot_lines_new_from_columns (GArray *x, GArray *y);
+GPlotFunction *g_plot_lines_new_from_bytes (GBytes *x, GBytes *y);
+void g_plot_lines_update_columns (GPlotFunction *f);
 
 #endif
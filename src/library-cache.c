@@ -0,0 +1,548 @@
+/*
+ * library-cache.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <goocanvas.h>
+#include <glib/gstdio.h>
+
+#include "library-cache.h"
+#include "load-library.h"
+#include "part-label.h"
+
+#include "debug.h"
+
+/*
+ * A parts library compiled into a serialized GVariant, which is mapped
+ * and read in place instead of parsing the XML source again.
+ *
+ * The header identifies the source, the body mirrors the structures
+ * built by the XML parser, all lists in their order in memory.
+ */
+#define LIBRARY_CACHE_MAGIC 0x4f52474cu
+
+// magic, version, source path, source mtime, source size, source checksum
+#define LIBRARY_CACHE_HEADER "(uusxxs)"
+// symbol name, connections, objects as (type, spline, coordinates, text)
+#define LIBRARY_CACHE_SYMBOL "(sa(dd)a(ubads))"
+// name, description, symbol, rotation, refdes, template, model,
+// labels as (name, text, x, y), properties as (name, value)
+#define LIBRARY_CACHE_PART "(msmsmsimsmsmsa(msmsdd)a(msms))"
+// name, author, version, symbols, parts
+#define LIBRARY_CACHE_LIBRARY "(msmsmsa" LIBRARY_CACHE_SYMBOL "a" LIBRARY_CACHE_PART ")"
+#define LIBRARY_CACHE_TYPE "(" LIBRARY_CACHE_HEADER LIBRARY_CACHE_LIBRARY ")"
+
+/**
+ * @returns the cache file of a library in the user cache directory,
+ * free with g_free
+ */
+gchar *library_cache_get_path (const gchar *source)
+{
+	gchar *checksum, *name, *path;
+
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, source, -1);
+	name = g_strconcat (checksum, ".cache", NULL);
+	path = g_build_filename (g_get_user_cache_dir (), "oregano", "libraries", name, NULL);
+	g_free (name);
+	g_free (checksum);
+
+	return path;
+}
+
+static gchar *library_cache_checksum (const gchar *source)
+{
+	gchar *contents, *checksum;
+	gsize length;
+
+	if (!g_file_get_contents (source, &contents, &length, NULL))
+		return NULL;
+	checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1, (const guchar *)contents, length);
+	g_free (contents);
+
+	return checksum;
+}
+
+static GVariant *library_cache_symbol (LibrarySymbol *symbol)
+{
+	GVariantBuilder connections, objects;
+	GSList *iter;
+
+	g_variant_builder_init (&connections, G_VARIANT_TYPE ("a(dd)"));
+	for (iter = symbol->connections; iter; iter = iter->next) {
+		Connection *connection = iter->data;
+		g_variant_builder_add (&connections, "(dd)", connection->pos.x, connection->pos.y);
+	}
+
+	g_variant_builder_init (&objects, G_VARIANT_TYPE ("a(ubads)"));
+	for (iter = symbol->symbol_objects; iter; iter = iter->next) {
+		SymbolObject *object = iter->data;
+		GVariant *coords;
+		gboolean spline = FALSE;
+		const gchar *text = "";
+
+		switch (object->type) {
+		case SYMBOL_OBJECT_LINE:
+			spline = object->u.uline.spline;
+			coords = g_variant_new_fixed_array (G_VARIANT_TYPE_DOUBLE, object->u.uline.line->coords,
+			                                    2 * object->u.uline.line->num_points,
+			                                    sizeof(gdouble));
+			break;
+		case SYMBOL_OBJECT_ARC: {
+			gdouble arc[4] = {object->u.arc.x1, object->u.arc.y1, object->u.arc.x2,
+			                  object->u.arc.y2};
+			coords = g_variant_new_fixed_array (G_VARIANT_TYPE_DOUBLE, arc, 4, sizeof(gdouble));
+		} break;
+		case SYMBOL_OBJECT_TEXT:
+		default: {
+			gdouble pos[2] = {object->u.text.x, object->u.text.y};
+			coords = g_variant_new_fixed_array (G_VARIANT_TYPE_DOUBLE, pos, 2, sizeof(gdouble));
+			text = object->u.text.str;
+		} break;
+		}
+		g_variant_builder_add (&objects, "(ub@ads)", object->type, spline, coords, text);
+	}
+
+	return g_variant_new ("(sa(dd)a(ubads))", symbol->name, &connections, &objects);
+}
+
+static GVariant *library_cache_part (LibraryPart *part)
+{
+	GVariantBuilder labels, properties;
+	GSList *iter;
+
+	g_variant_builder_init (&labels, G_VARIANT_TYPE ("a(msmsdd)"));
+	for (iter = part->labels; iter; iter = iter->next) {
+		PartLabel *label = iter->data;
+		g_variant_builder_add (&labels, "(msmsdd)", label->name, label->text, label->pos.x,
+		                       label->pos.y);
+	}
+
+	g_variant_builder_init (&properties, G_VARIANT_TYPE ("a(msms)"));
+	for (iter = part->properties; iter; iter = iter->next) {
+		Property *property = iter->data;
+		g_variant_builder_add (&properties, "(msms)", property->name, property->value);
+	}
+
+	return g_variant_new (LIBRARY_CACHE_PART, part->name, part->description, part->symbol_name,
+	                      part->symbol_rotation, part->refdes, part->template, part->model,
+	                      &labels, &properties);
+}
+
+static void library_cache_add_symbol (gpointer key, LibrarySymbol *symbol, GVariantBuilder *symbols)
+{
+	g_variant_builder_add_value (symbols, library_cache_symbol (symbol));
+}
+
+static void library_cache_add_part (gpointer key, LibraryPart *part, GVariantBuilder *parts)
+{
+	g_variant_builder_add_value (parts, library_cache_part (part));
+}
+
+/**
+ * \brief writes the cache of a library parsed from source
+ *
+ * The cache is replaced atomically, so concurrent readers see either
+ * the old or the new one.
+ */
+gboolean library_cache_save (const gchar *cache, const gchar *source, Library *library,
+                             GError **error)
+{
+	GVariantBuilder symbols, parts;
+	GVariant *variant;
+	GStatBuf st;
+	gchar *checksum, *dir;
+	gboolean ret;
+
+	g_return_val_if_fail (library != NULL, FALSE);
+
+	if (g_stat (source, &st) != 0) {
+		g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+		             "Could not stat %s", source);
+		return FALSE;
+	}
+	checksum = library_cache_checksum (source);
+	if (checksum == NULL) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "Could not read %s", source);
+		return FALSE;
+	}
+
+	g_variant_builder_init (&symbols, G_VARIANT_TYPE ("a" LIBRARY_CACHE_SYMBOL));
+	g_hash_table_foreach (library->symbol_hash, (GHFunc)library_cache_add_symbol, &symbols);
+	g_variant_builder_init (&parts, G_VARIANT_TYPE ("a" LIBRARY_CACHE_PART));
+	g_hash_table_foreach (library->part_hash, (GHFunc)library_cache_add_part, &parts);
+
+	variant = g_variant_new ("(" LIBRARY_CACHE_HEADER "(msmsms@a" LIBRARY_CACHE_SYMBOL
+	                         "@a" LIBRARY_CACHE_PART "))",
+	                         LIBRARY_CACHE_MAGIC, LIBRARY_CACHE_VERSION, source,
+	                         (gint64)st.st_mtime, (gint64)st.st_size, checksum, library->name,
+	                         library->author, library->version, g_variant_builder_end (&symbols),
+	                         g_variant_builder_end (&parts));
+	g_variant_ref_sink (variant);
+	g_free (checksum);
+
+	dir = g_path_get_dirname (cache);
+	g_mkdir_with_parents (dir, 0700);
+	g_free (dir);
+
+	ret = g_file_set_contents (cache, g_variant_get_data (variant), g_variant_get_size (variant),
+	                           error);
+	g_variant_unref (variant);
+
+	return ret;
+}
+
+/**
+ * \brief checks the header of a cache against its source
+ *
+ * The checksum is only computed if the modification time changed, so
+ * a touched but unchanged source keeps its cache.
+ */
+static gboolean library_cache_is_valid (GVariant *header, const gchar *source)
+{
+	guint32 magic, version;
+	const gchar *path, *checksum;
+	gint64 mtime, size;
+	GStatBuf st;
+	gchar *current;
+	gboolean ret;
+
+	g_variant_get (header, "(uu&sxx&s)", &magic, &version, &path, &mtime, &size, &checksum);
+
+	// a byte swapped magic also means the cache is not ours
+	if (magic != LIBRARY_CACHE_MAGIC || version != LIBRARY_CACHE_VERSION)
+		return FALSE;
+	if (strcmp (path, source) != 0 || g_stat (source, &st) != 0 || st.st_size != size)
+		return FALSE;
+	if (st.st_mtime == mtime)
+		return TRUE;
+
+	current = library_cache_checksum (source);
+	ret = g_strcmp0 (current, checksum) == 0;
+	g_free (current);
+
+	return ret;
+}
+
+static LibrarySymbol *library_cache_read_symbol (GVariant *value)
+{
+	LibrarySymbol *symbol;
+	GVariantIter *connections, *objects;
+	GVariant *coords;
+	gdouble x, y;
+	guint32 type;
+	gboolean spline;
+	const gchar *text;
+
+	symbol = g_new0 (LibrarySymbol, 1);
+	g_variant_get (value, "(sa(dd)a(ubads))", &symbol->name, &connections, &objects);
+
+	while (g_variant_iter_next (connections, "(dd)", &x, &y)) {
+		Connection *connection = g_new0 (Connection, 1);
+		connection->pos.x = x;
+		connection->pos.y = y;
+		symbol->connections = g_slist_prepend (symbol->connections, connection);
+	}
+	symbol->connections = g_slist_reverse (symbol->connections);
+	g_variant_iter_free (connections);
+
+	// the coordinates and the text are only borrowed until the next loop
+	while (g_variant_iter_loop (objects, "(ub@ad&s)", &type, &spline, &coords, &text)) {
+		SymbolObject *object = g_new0 (SymbolObject, 1);
+		gsize n;
+		const gdouble *c = g_variant_get_fixed_array (coords, &n, sizeof(gdouble));
+
+		object->type = type;
+		switch (type) {
+		case SYMBOL_OBJECT_LINE:
+			object->u.uline.spline = spline;
+			object->u.uline.line = goo_canvas_points_new (n / 2);
+			memcpy (object->u.uline.line->coords, c, (n / 2) * 2 * sizeof(gdouble));
+			break;
+		case SYMBOL_OBJECT_ARC:
+			if (n == 4) {
+				object->u.arc.x1 = c[0];
+				object->u.arc.y1 = c[1];
+				object->u.arc.x2 = c[2];
+				object->u.arc.y2 = c[3];
+			}
+			break;
+		case SYMBOL_OBJECT_TEXT:
+			if (n == 2) {
+				object->u.text.x = c[0];
+				object->u.text.y = c[1];
+			}
+			g_strlcpy (object->u.text.str, text, sizeof(object->u.text.str));
+			break;
+		}
+		symbol->symbol_objects = g_slist_prepend (symbol->symbol_objects, object);
+	}
+	symbol->symbol_objects = g_slist_reverse (symbol->symbol_objects);
+	g_variant_iter_free (objects);
+
+	return symbol;
+}
+
+static LibraryPart *library_cache_read_part (GVariant *value, Library *library)
+{
+	LibraryPart *part;
+	GVariantIter *labels, *properties;
+	PartLabel *label;
+	Property *property;
+	gchar *name, *text;
+	gdouble x, y;
+
+	part = g_new0 (LibraryPart, 1);
+	part->library = library;
+	g_variant_get (value, LIBRARY_CACHE_PART, &part->name, &part->description, &part->symbol_name,
+	               &part->symbol_rotation, &part->refdes, &part->template, &part->model, &labels,
+	               &properties);
+
+	while (g_variant_iter_next (labels, "(msmsdd)", &name, &text, &x, &y)) {
+		label = g_new0 (PartLabel, 1);
+		label->name = name;
+		label->text = text;
+		label->pos.x = x;
+		label->pos.y = y;
+		part->labels = g_slist_prepend (part->labels, label);
+	}
+	part->labels = g_slist_reverse (part->labels);
+	g_variant_iter_free (labels);
+
+	while (g_variant_iter_next (properties, "(msms)", &name, &text)) {
+		property = g_new0 (Property, 1);
+		property->name = name;
+		property->value = text;
+		part->properties = g_slist_prepend (part->properties, property);
+	}
+	part->properties = g_slist_reverse (part->properties);
+	g_variant_iter_free (properties);
+
+	return part;
+}
+
+/**
+ * maps the names of the entries of a cache list to their position
+ */
+static GHashTable *library_cache_index (GVariant *list)
+{
+	GHashTable *index;
+	gsize i, n;
+
+	n = g_variant_n_children (list);
+	index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (i = 0; i < n; i++) {
+		GVariant *value = g_variant_get_child_value (list, i);
+		GVariant *name = g_variant_get_child_value (value, 0);
+		const gchar *str;
+
+		// the name of a part may be missing, a symbol always has one
+		if (g_variant_is_of_type (name, G_VARIANT_TYPE_MAYBE)) {
+			GVariant *just = g_variant_get_maybe (name);
+
+			str = just ? g_variant_get_string (just, NULL) : NULL;
+			if (just)
+				g_variant_unref (just);
+		} else {
+			str = g_variant_get_string (name, NULL);
+		}
+		if (str)
+			g_hash_table_insert (index, g_strdup (str), GSIZE_TO_POINTER (i + 1));
+		g_variant_unref (name);
+		g_variant_unref (value);
+	}
+
+	return index;
+}
+
+/**
+ * \brief opens a library from its cache
+ *
+ * Only the names of the parts and symbols are read, each is built on
+ * first use by library_cache_get_part () or library_cache_get_symbol ().
+ *
+ * @returns NULL if there is no cache, or if it is stale or damaged
+ */
+Library *library_cache_load (const gchar *cache, const gchar *source)
+{
+	GMappedFile *mapped;
+	GBytes *bytes;
+	GVariant *variant, *header, *body;
+	Library *library = NULL;
+
+	mapped = g_mapped_file_new (cache, FALSE, NULL);
+	if (!mapped)
+		return NULL;
+	bytes = g_mapped_file_get_bytes (mapped);
+	g_mapped_file_unref (mapped);
+
+	// not trusted, a damaged cache reads as default values instead of crashing
+	variant = g_variant_new_from_bytes (G_VARIANT_TYPE (LIBRARY_CACHE_TYPE), bytes, FALSE);
+	g_variant_ref_sink (variant);
+	g_bytes_unref (bytes);
+
+	header = g_variant_get_child_value (variant, 0);
+	if (!library_cache_is_valid (header, source)) {
+		NG_DEBUG ("library cache %s of %s is stale", cache, source);
+		g_variant_unref (header);
+		g_variant_unref (variant);
+		return NULL;
+	}
+	g_variant_unref (header);
+
+	body = g_variant_get_child_value (variant, 1);
+	library = g_new0 (Library, 1);
+	g_variant_get_child (body, 0, "ms", &library->name);
+	g_variant_get_child (body, 1, "ms", &library->author);
+	g_variant_get_child (body, 2, "ms", &library->version);
+	library->part_hash = g_hash_table_new (g_str_hash, g_str_equal);
+	library->symbol_hash = g_hash_table_new (g_str_hash, g_str_equal);
+
+	// the lists keep the mapped cache alive
+	library->symbols = g_variant_get_child_value (body, 3);
+	library->parts = g_variant_get_child_value (body, 4);
+	library->symbol_index = library_cache_index (library->symbols);
+	library->part_index = library_cache_index (library->parts);
+
+	g_variant_unref (body);
+	g_variant_unref (variant);
+
+	return library;
+}
+
+// parts and symbols may be looked up from several threads
+G_LOCK_DEFINE_STATIC (library_cache);
+
+/**
+ * @returns the symbol, built from the cache on first use, or NULL if
+ * the library has no such symbol
+ */
+LibrarySymbol *library_cache_get_symbol (Library *library, const gchar *name)
+{
+	LibrarySymbol *symbol;
+	gpointer position;
+
+	G_LOCK (library_cache);
+	symbol = g_hash_table_lookup (library->symbol_hash, name);
+	if (symbol == NULL && library->symbol_index &&
+	    (position = g_hash_table_lookup (library->symbol_index, name)) != NULL) {
+		GVariant *value =
+		    g_variant_get_child_value (library->symbols, GPOINTER_TO_SIZE (position) - 1);
+
+		symbol = library_cache_read_symbol (value);
+		g_hash_table_insert (library->symbol_hash, symbol->name, symbol);
+		g_variant_unref (value);
+	}
+	G_UNLOCK (library_cache);
+
+	return symbol;
+}
+
+/**
+ * @returns the part, built from the cache on first use, or NULL if the
+ * library has no such part
+ */
+LibraryPart *library_cache_get_part (Library *library, const gchar *name)
+{
+	LibraryPart *part;
+	gpointer position;
+
+	G_LOCK (library_cache);
+	part = g_hash_table_lookup (library->part_hash, name);
+	if (part == NULL && library->part_index &&
+	    (position = g_hash_table_lookup (library->part_index, name)) != NULL) {
+		GVariant *value =
+		    g_variant_get_child_value (library->parts, GPOINTER_TO_SIZE (position) - 1);
+
+		part = library_cache_read_part (value, library);
+		g_hash_table_insert (library->part_hash, part->name, part);
+		g_variant_unref (value);
+	}
+	G_UNLOCK (library_cache);
+
+	return part;
+}
+
+/**
+ * @returns the description of a part without building it, or NULL,
+ * free with g_free
+ */
+gchar *library_cache_get_part_description (Library *library, const gchar *name)
+{
+	LibraryPart *part;
+	gpointer position;
+	gchar *description = NULL;
+
+	G_LOCK (library_cache);
+	part = g_hash_table_lookup (library->part_hash, name);
+	if (part) {
+		description = g_strdup (part->description);
+	} else if (library->part_index &&
+	           (position = g_hash_table_lookup (library->part_index, name)) != NULL) {
+		GVariant *value =
+		    g_variant_get_child_value (library->parts, GPOINTER_TO_SIZE (position) - 1);
+
+		g_variant_get_child (value, 1, "ms", &description);
+		g_variant_unref (value);
+	}
+	G_UNLOCK (library_cache);
+
+	return description;
+}
+
+static void library_cache_prepend_name (gpointer name, gpointer value, GList **names)
+{
+	*names = g_list_prepend (*names, name);
+}
+
+/**
+ * @returns the names of all parts of the library, built or not, free
+ * the list with g_list_free
+ */
+GList *library_cache_get_part_names (Library *library)
+{
+	GList *names = NULL;
+
+	// the index holds every name of a cached library, built parts included
+	G_LOCK (library_cache);
+	g_hash_table_foreach (library->part_index ? library->part_index : library->part_hash,
+	                      (GHFunc)library_cache_prepend_name, &names);
+	G_UNLOCK (library_cache);
+
+	return names;
+}
+
+/**
+ * @returns the names of all symbols of the library, built or not, free
+ * the list with g_list_free
+ */
+GList *library_cache_get_symbol_names (Library *library)
+{
+	GList *names = NULL;
+
+	G_LOCK (library_cache);
+	g_hash_table_foreach (library->symbol_index ? library->symbol_index : library->symbol_hash,
+	                      (GHFunc)library_cache_prepend_name, &names);
+	G_UNLOCK (library_cache);
+
+	return names;
+}
@@ -0,0 +1,44 @@
+/*
+ * library-cache.h
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __LIBRARY_CACHE_H
+#define __LIBRARY_CACHE_H
+
+#include <glib.h>
+
+#include "load-library.h"
+
+// bump whenever the layout of the cache changes
+#define LIBRARY_CACHE_VERSION 1
+
+gchar *library_cache_get_path (const gchar *source);
+Library *library_cache_load (const gchar *cache, const gchar *source);
+gboolean library_cache_save (const gchar *cache, const gchar *source, Library *library,
+                             GError **error);
+LibrarySymbol *library_cache_get_symbol (Library *library, const gchar *name);
+LibraryPart *library_cache_get_part (Library *library, const gchar *name);
+gchar *library_cache_get_part_description (Library *library, const gchar *name);
+GList *library_cache_get_part_names (Library *library);
+GList *library_cache_get_symbol_names (Library *library);
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * library-index.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "library-index.h"
+#include "library-cache.h"
+
+#include "debug.h"
+
+// library names are matched case insensitive, as in the schematic files
+static GHashTable *libraries = NULL;
+// part and symbol names to the library which resolves them
+static GHashTable *parts = NULL;
+static GHashTable *symbols = NULL;
+
+/**
+ * adds the names of a list to an index, the names already present
+ * keep their library
+ */
+static void library_index_add_names (GHashTable *index, GList *names, Library *library)
+{
+	GList *iter;
+
+	for (iter = names; iter; iter = iter->next) {
+		if (g_hash_table_contains (index, iter->data)) {
+			NG_DEBUG ("%s of library %s is shadowed", (gchar *)iter->data, library->name);
+			continue;
+		}
+		g_hash_table_insert (index, g_strdup (iter->data), library);
+	}
+}
+
+/**
+ * adds a library with its parts and symbols to the index
+ */
+void library_index_add (Library *library)
+{
+	GList *names;
+
+	g_return_if_fail (library != NULL);
+
+	if (libraries == NULL) {
+		libraries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		parts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		symbols = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	}
+
+	if (library->name) {
+		gchar *key = g_ascii_strdown (library->name, -1);
+
+		if (g_hash_table_contains (libraries, key))
+			g_free (key);
+		else
+			g_hash_table_insert (libraries, key, library);
+	}
+
+	names = library_cache_get_part_names (library);
+	library_index_add_names (parts, names, library);
+	g_list_free (names);
+
+	names = library_cache_get_symbol_names (library);
+	library_index_add_names (symbols, names, library);
+	g_list_free (names);
+}
+
+/**
+ * forgets all libraries, the libraries themselves are not freed
+ */
+void library_index_clear (void)
+{
+	g_clear_pointer (&libraries, g_hash_table_destroy);
+	g_clear_pointer (&parts, g_hash_table_destroy);
+	g_clear_pointer (&symbols, g_hash_table_destroy);
+}
+
+/**
+ * @returns the library of that name, ignoring case, or NULL
+ */
+Library *library_index_get_library (const gchar *name)
+{
+	Library *library;
+	gchar *key;
+
+	g_return_val_if_fail (name != NULL, NULL);
+
+	if (libraries == NULL)
+		return NULL;
+
+	key = g_ascii_strdown (name, -1);
+	library = g_hash_table_lookup (libraries, key);
+	g_free (key);
+
+	return library;
+}
+
+/**
+ * @returns the library which resolves the part, or NULL
+ */
+Library *library_index_get_part_library (const gchar *part_name)
+{
+	g_return_val_if_fail (part_name != NULL, NULL);
+
+	if (parts == NULL)
+		return NULL;
+	return g_hash_table_lookup (parts, part_name);
+}
+
+/**
+ * @returns the part of the first library which has one of that name, or
+ * NULL
+ */
+LibraryPart *library_index_get_part (const gchar *part_name)
+{
+	Library *library = library_index_get_part_library (part_name);
+
+	if (library == NULL)
+		return NULL;
+	return library_cache_get_part (library, part_name);
+}
+
+/**
+ * @returns the symbol of the first library which has one of that name,
+ * or NULL
+ */
+LibrarySymbol *library_index_get_symbol (const gchar *symbol_name)
+{
+	Library *library;
+
+	g_return_val_if_fail (symbol_name != NULL, NULL);
+
+	if (symbols == NULL)
+		return NULL;
+	library = g_hash_table_lookup (symbols, symbol_name);
+	if (library == NULL)
+		return NULL;
+	return library_cache_get_symbol (library, symbol_name);
+}
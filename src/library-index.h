@@ -0,0 +1,47 @@
+/*
+ * library-index.h
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __LIBRARY_INDEX_H
+#define __LIBRARY_INDEX_H
+
+#include <glib.h>
+
+#include "load-library.h"
+
+/*
+ * Index over the names of all loaded libraries, their parts and their
+ * symbols.
+ *
+ * Libraries are added in the order of oregano.libraries, a name which
+ * appears in several libraries resolves to the first library added
+ * with it. The index is built on the main thread while the libraries
+ * are loaded and only read afterwards.
+ */
+void library_index_add (Library *library);
+void library_index_clear (void);
+Library *library_index_get_library (const gchar *name);
+Library *library_index_get_part_library (const gchar *part_name);
+LibraryPart *library_index_get_part (const gchar *part_name);
+LibrarySymbol *library_index_get_symbol (const gchar *symbol_name);
+
+#endif
@@ -0,0 +1,228 @@
+/*
+ * library-search.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include "library-search.h"
+#include "library-cache.h"
+
+#include "debug.h"
+
+typedef struct
+{
+	Library *library;
+	gchar *name;
+	// folded name and description, searched for the query
+	gchar *text;
+	// sorts the entries by name
+	gchar *key;
+} LibrarySearchEntry;
+
+struct _LibrarySearch
+{
+	// entries ordered by name, their index is the id
+	GArray *entries;
+	// trigram to the ascending ids of the entries which contain it
+	GHashTable *trigrams;
+	// last folded query and its results
+	gchar *query;
+	GArray *result;
+};
+
+#define LIBRARY_SEARCH_TRIGRAM(s) \
+	(((guint)(guchar)(s)[0] << 16) | ((guint)(guchar)(s)[1] << 8) | (guint)(guchar)(s)[2])
+
+static gint library_search_entry_compare (const LibrarySearchEntry *a, const LibrarySearchEntry *b)
+{
+	return strcmp (a->key, b->key);
+}
+
+static void library_search_entry_clear (LibrarySearchEntry *entry)
+{
+	g_free (entry->name);
+	g_free (entry->text);
+	g_free (entry->key);
+}
+
+/**
+ * indexes the parts of the libraries, names found in several libraries
+ * are listed once for each
+ */
+LibrarySearch *library_search_new (GList *libraries)
+{
+	LibrarySearch *search;
+	GList *iter, *names, *name;
+	guint id;
+
+	search = g_new0 (LibrarySearch, 1);
+	search->entries = g_array_new (FALSE, FALSE, sizeof(LibrarySearchEntry));
+	search->trigrams =
+	    g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_array_unref);
+	search->result = g_array_new (FALSE, FALSE, sizeof(guint));
+
+	for (iter = libraries; iter; iter = iter->next) {
+		Library *library = iter->data;
+
+		names = library_cache_get_part_names (library);
+		for (name = names; name; name = name->next) {
+			LibrarySearchEntry entry;
+			gchar *description = library_cache_get_part_description (library, name->data);
+			gchar *text = g_strconcat (name->data, "\n", description, NULL);
+
+			entry.library = library;
+			entry.name = g_strdup (name->data);
+			entry.text = g_utf8_casefold (text, -1);
+			entry.key = g_utf8_collate_key (entry.name, -1);
+			g_array_append_val (search->entries, entry);
+
+			g_free (text);
+			g_free (description);
+		}
+		g_list_free (names);
+	}
+	g_array_sort (search->entries, (GCompareFunc)library_search_entry_compare);
+
+	for (id = 0; id < search->entries->len; id++) {
+		LibrarySearchEntry *entry = &g_array_index (search->entries, LibrarySearchEntry, id);
+		const gchar *s;
+
+		g_clear_pointer (&entry->key, g_free);
+		for (s = entry->text; s[0] && s[1] && s[2]; s++) {
+			gpointer trigram = GUINT_TO_POINTER (LIBRARY_SEARCH_TRIGRAM (s));
+			GArray *ids = g_hash_table_lookup (search->trigrams, trigram);
+
+			if (ids == NULL) {
+				ids = g_array_new (FALSE, FALSE, sizeof(guint));
+				g_hash_table_insert (search->trigrams, trigram, ids);
+			}
+			// the ids are added in order, a repeated trigram is the last one
+			if (ids->len == 0 || g_array_index (ids, guint, ids->len - 1) != id)
+				g_array_append_val (ids, id);
+		}
+	}
+
+	NG_DEBUG ("indexed %u parts by %u trigrams", search->entries->len,
+	          g_hash_table_size (search->trigrams));
+
+	return search;
+}
+
+void library_search_free (LibrarySearch *search)
+{
+	guint i;
+
+	if (search == NULL)
+		return;
+
+	for (i = 0; i < search->entries->len; i++)
+		library_search_entry_clear (&g_array_index (search->entries, LibrarySearchEntry, i));
+	g_array_free (search->entries, TRUE);
+	g_hash_table_destroy (search->trigrams);
+	g_array_free (search->result, TRUE);
+	g_free (search->query);
+	g_free (search);
+}
+
+/**
+ * finds the entries of the index which may contain the folded query,
+ * in ascending order, NULL for all of them
+ *
+ * @returns FALSE if none can
+ */
+static gboolean library_search_candidates (LibrarySearch *search, const gchar *query,
+                                           GArray **candidates)
+{
+	const gchar *s;
+
+	*candidates = NULL;
+
+	// a longer query only drops results
+	if (search->query && strstr (query, search->query))
+		*candidates = search->result;
+
+	for (s = query; s[0] && s[1] && s[2]; s++) {
+		GArray *ids =
+		    g_hash_table_lookup (search->trigrams, GUINT_TO_POINTER (LIBRARY_SEARCH_TRIGRAM (s)));
+
+		if (ids == NULL)
+			return FALSE;
+		if (*candidates == NULL || ids->len < (*candidates)->len)
+			*candidates = ids;
+	}
+
+	return TRUE;
+}
+
+/**
+ * @returns the ids of the parts whose name or description contain the
+ * query, ignoring case, owned by the search and valid until the next
+ * query
+ */
+GArray *library_search_query (LibrarySearch *search, const gchar *query)
+{
+	GArray *candidates, *result;
+	gchar *folded;
+	guint i, n;
+
+	g_return_val_if_fail (search != NULL, NULL);
+	g_return_val_if_fail (query != NULL, NULL);
+
+	folded = g_utf8_casefold (query, -1);
+	if (g_strcmp0 (folded, search->query) == 0) {
+		g_free (folded);
+		return search->result;
+	}
+
+	if (!library_search_candidates (search, folded, &candidates))
+		n = 0;
+	else
+		n = candidates ? candidates->len : search->entries->len;
+	result = g_array_sized_new (FALSE, FALSE, sizeof(guint), n);
+	for (i = 0; i < n; i++) {
+		guint id = candidates ? g_array_index (candidates, guint, i) : i;
+
+		if (strstr (g_array_index (search->entries, LibrarySearchEntry, id).text, folded))
+			g_array_append_val (result, id);
+	}
+
+	g_array_free (search->result, TRUE);
+	search->result = result;
+	g_free (search->query);
+	search->query = folded;
+
+	return result;
+}
+
+const gchar *library_search_get_name (LibrarySearch *search, guint id)
+{
+	g_return_val_if_fail (id < search->entries->len, NULL);
+
+	return g_array_index (search->entries, LibrarySearchEntry, id).name;
+}
+
+Library *library_search_get_library (LibrarySearch *search, guint id)
+{
+	g_return_val_if_fail (id < search->entries->len, NULL);
+
+	return g_array_index (search->entries, LibrarySearchEntry, id).library;
+}
@@ -0,0 +1,47 @@
+/*
+ * library-search.h
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __LIBRARY_SEARCH_H
+#define __LIBRARY_SEARCH_H
+
+#include <glib.h>
+
+#include "load-library.h"
+
+/*
+ * Substring search over the names and descriptions of the parts of
+ * several libraries.
+ *
+ * A trigram index narrows each query to the parts which contain its
+ * rarest trigram. A query which extends the previous one only searches
+ * the previous results. The results are ordered by part name.
+ */
+typedef struct _LibrarySearch LibrarySearch;
+
+LibrarySearch *library_search_new (GList *libraries);
+void library_search_free (LibrarySearch *search);
+GArray *library_search_query (LibrarySearch *search, const gchar *query);
+const gchar *library_search_get_name (LibrarySearch *search, guint id);
+Library *library_search_get_library (LibrarySearch *search, guint id);
+
+#endif
@@ -55,8 +55,16 @@ typedef struct
 	gchar *author;
 	gchar *version;
 
+	// the parts and symbols built so far
 	GHashTable *part_hash;
 	GHashTable *symbol_hash;
+
+	// parts and symbols of a cached library which are built on first
+	// use, by name to their position in the cache, see library-cache.c
+	GVariant *parts;
+	GVariant *symbols;
+	GHashTable *part_index;
+	GHashTable *symbol_index;
 } Library;
 
 typedef struct
@@ -39,6 +39,8 @@
 #include "xml-helper.h"
 #include "load-common.h"
 #include "load-library.h"
+#include "library-cache.h"
+#include "library-index.h"
 #include "part-label.h"
 
 typedef enum {
@@ -136,19 +138,10 @@ static xmlSAXHandler oreganoSAXParser = {
 LibrarySymbol *library_get_symbol (const gchar *symbol_name)
 {
 	LibrarySymbol *symbol;
-	Library *library;
-	GList *iter;
 
 	g_return_val_if_fail (symbol_name != NULL, NULL);
 
-	symbol = NULL;
-	for (iter = oregano.libraries; iter; iter = iter->next) {
-		library = iter->data;
-		symbol = g_hash_table_lookup (library->symbol_hash, symbol_name);
-		if (symbol)
-			break;
-	}
-
+	symbol = library_index_get_symbol (symbol_name);
 	if (symbol == NULL) {
 		g_message (_ ("Could not find the requested symbol: %s\n"), symbol_name);
 	}
@@ -163,7 +156,7 @@ LibraryPart *library_get_part (Library *library, const gchar *part_name)
 	g_return_val_if_fail (library != NULL, NULL);
 	g_return_val_if_fail (part_name != NULL, NULL);
 
-	part = g_hash_table_lookup (library->part_hash, part_name);
+	part = library_cache_get_part (library, part_name);
 	if (part == NULL) {
 		g_message (_ ("Could not find the requested part: %s\n"), part_name);
 	}
@@ -188,6 +181,31 @@ Library *library_parse_xml_file (const gchar *filename)
 	return library;
 }
 
+/**
+ * \brief loads a library from its cache, or parses it and caches it
+ *
+ * The cache is rebuilt whenever the source changed.
+ */
+Library *library_load (const gchar *filename)
+{
+	Library *library;
+	gchar *cache;
+	GError *e = NULL;
+
+	cache = library_cache_get_path (filename);
+	library = library_cache_load (cache, filename);
+	if (library == NULL) {
+		library = library_parse_xml_file (filename);
+		if (library && !library_cache_save (cache, filename, library, &e)) {
+			g_message ("Could not cache the library %s: %s", filename, e->message);
+			g_clear_error (&e);
+		}
+	}
+	g_free (cache);
+
+	return library;
+}
+
 static void start_document (ParseState *state)
 {
 	state->state = PARSE_START;
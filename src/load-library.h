@@ -77,6 +77,7 @@ struct _SymbolObject
 };
 
 Library *library_parse_xml_file (const gchar *filename);
+Library *library_load (const gchar *filename);
 LibrarySymbol *library_get_symbol (const gchar *symbol_name);
 LibraryPart *library_get_part (Library *library, const gchar *part_name);
 
@@ -34,6 +34,7 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <glib/gi18n.h>
 
@@ -42,6 +43,8 @@
 #include "xml-helper.h"
 #include "load-common.h"
 #include "load-schematic.h"
+#include "schematic-binary.h"
+#include "library-index.h"
 #include "coords.h"
 #include "part-label.h"
 #include "schematic.h"
@@ -69,6 +72,7 @@ typedef enum {
 	PARSE_TRANSIENT_STEP_ENABLE,
 	PARSE_TRANSIENT_INIT_COND,
 	PARSE_TRANSIENT_ANALYZE_ALL,
+	PARSE_TRANSIENT_COMPACT,
 
 	PARSE_AC_SETTINGS,
 	PARSE_AC_ENABLED,
@@ -77,6 +81,7 @@ typedef enum {
 	PARSE_AC_NPOINTS,
 	PARSE_AC_START,
 	PARSE_AC_STOP,
+	PARSE_AC_COMPACT,
 
 	PARSE_DC_SETTINGS,
 	PARSE_DC_ENABLED,
@@ -85,6 +90,7 @@ typedef enum {
 	PARSE_DC_START,
 	PARSE_DC_STOP,
 	PARSE_DC_STEP,
+	PARSE_DC_COMPACT,
 
 	PARSE_FOURIER_SETTINGS,
 	PARSE_FOURIER_ENABLED,
@@ -99,6 +105,7 @@ typedef enum {
 	PARSE_NOISE_NPOINTS,
 	PARSE_NOISE_START,
 	PARSE_NOISE_STOP,
+	PARSE_NOISE_COMPACT,
 
 	PARSE_OPTION_LIST,
 	PARSE_OPTION,
@@ -140,6 +147,144 @@ typedef enum {
 	PARSE_ERROR
 } State;
 
+// the elements of a schematic, so they are told apart by a single lookup
+typedef enum {
+	ELEMENT_UNKNOWN,
+	ELEMENT_AC,
+	ELEMENT_ANALYZE_ALL,
+	ELEMENT_AUTHOR,
+	ELEMENT_COMMENTS,
+	ELEMENT_COMPACT,
+	ELEMENT_DC_SWEEP,
+	ELEMENT_ENABLED,
+	ELEMENT_FLIP,
+	ELEMENT_FOURIER,
+	ELEMENT_FREQ,
+	ELEMENT_INIT_CONDITIONS,
+	ELEMENT_LABEL,
+	ELEMENT_LABELS,
+	ELEMENT_LIBRARY,
+	ELEMENT_MODEL,
+	ELEMENT_NAME,
+	ELEMENT_NOISE,
+	ELEMENT_NPOINTS,
+	ELEMENT_OPTION,
+	ELEMENT_OPTIONS,
+	ELEMENT_PART,
+	ELEMENT_PARTS,
+	ELEMENT_POINTS,
+	ELEMENT_POSITION,
+	ELEMENT_PROPERTIES,
+	ELEMENT_PROPERTY,
+	ELEMENT_REFDES,
+	ELEMENT_ROTATION,
+	ELEMENT_SCHEMATIC,
+	ELEMENT_SIMULATION_SETTINGS,
+	ELEMENT_START,
+	ELEMENT_START1,
+	ELEMENT_STEP,
+	ELEMENT_STEP_ENABLED,
+	ELEMENT_STEP1,
+	ELEMENT_STOP,
+	ELEMENT_STOP1,
+	ELEMENT_SYMBOL,
+	ELEMENT_TEMPLATE,
+	ELEMENT_TEXT,
+	ELEMENT_TEXTBOX,
+	ELEMENT_TEXTBOXES,
+	ELEMENT_TITLE,
+	ELEMENT_TRANSIENT,
+	ELEMENT_TYPE,
+	ELEMENT_VALUE,
+	ELEMENT_VERSION,
+	ELEMENT_VOUT,
+	ELEMENT_VOUT1,
+	ELEMENT_VSRC1,
+	ELEMENT_WIRE,
+	ELEMENT_WIRES,
+	ELEMENT_ZOOM,
+} ElementId;
+
+static const struct
+{
+	const gchar *name;
+	ElementId id;
+} element_names[] = {
+    {"ogo:ac", ELEMENT_AC},
+    {"ogo:analyze-all", ELEMENT_ANALYZE_ALL},
+    {"ogo:author", ELEMENT_AUTHOR},
+    {"ogo:comments", ELEMENT_COMMENTS},
+    {"ogo:compact", ELEMENT_COMPACT},
+    {"ogo:dc-sweep", ELEMENT_DC_SWEEP},
+    {"ogo:enabled", ELEMENT_ENABLED},
+    {"ogo:flip", ELEMENT_FLIP},
+    {"ogo:fourier", ELEMENT_FOURIER},
+    {"ogo:freq", ELEMENT_FREQ},
+    {"ogo:init-conditions", ELEMENT_INIT_CONDITIONS},
+    {"ogo:label", ELEMENT_LABEL},
+    {"ogo:labels", ELEMENT_LABELS},
+    {"ogo:library", ELEMENT_LIBRARY},
+    {"ogo:model", ELEMENT_MODEL},
+    {"ogo:name", ELEMENT_NAME},
+    {"ogo:noise", ELEMENT_NOISE},
+    {"ogo:npoints", ELEMENT_NPOINTS},
+    {"ogo:option", ELEMENT_OPTION},
+    {"ogo:options", ELEMENT_OPTIONS},
+    {"ogo:part", ELEMENT_PART},
+    {"ogo:parts", ELEMENT_PARTS},
+    {"ogo:points", ELEMENT_POINTS},
+    {"ogo:position", ELEMENT_POSITION},
+    {"ogo:properties", ELEMENT_PROPERTIES},
+    {"ogo:property", ELEMENT_PROPERTY},
+    {"ogo:refdes", ELEMENT_REFDES},
+    {"ogo:rotation", ELEMENT_ROTATION},
+    {"ogo:schematic", ELEMENT_SCHEMATIC},
+    {"ogo:simulation-settings", ELEMENT_SIMULATION_SETTINGS},
+    {"ogo:start", ELEMENT_START},
+    {"ogo:start1", ELEMENT_START1},
+    {"ogo:step", ELEMENT_STEP},
+    {"ogo:step-enabled", ELEMENT_STEP_ENABLED},
+    {"ogo:step1", ELEMENT_STEP1},
+    {"ogo:stop", ELEMENT_STOP},
+    {"ogo:stop1", ELEMENT_STOP1},
+    {"ogo:symbol", ELEMENT_SYMBOL},
+    {"ogo:template", ELEMENT_TEMPLATE},
+    {"ogo:text", ELEMENT_TEXT},
+    {"ogo:textbox", ELEMENT_TEXTBOX},
+    {"ogo:textboxes", ELEMENT_TEXTBOXES},
+    {"ogo:title", ELEMENT_TITLE},
+    {"ogo:transient", ELEMENT_TRANSIENT},
+    {"ogo:type", ELEMENT_TYPE},
+    {"ogo:value", ELEMENT_VALUE},
+    {"ogo:version", ELEMENT_VERSION},
+    {"ogo:vout", ELEMENT_VOUT},
+    {"ogo:vout1", ELEMENT_VOUT1},
+    {"ogo:vsrc1", ELEMENT_VSRC1},
+    {"ogo:wire", ELEMENT_WIRE},
+    {"ogo:wires", ELEMENT_WIRES},
+    {"ogo:zoom", ELEMENT_ZOOM},
+};
+
+/**
+ * @returns the id of an element name, ELEMENT_UNKNOWN for foreign ones
+ */
+static ElementId element_lookup (const xmlChar *name)
+{
+	static GHashTable *ids = NULL;
+
+	if (g_once_init_enter (&ids)) {
+		GHashTable *table = g_hash_table_new (g_str_hash, g_str_equal);
+		guint i;
+
+		for (i = 0; i < G_N_ELEMENTS (element_names); i++)
+			g_hash_table_insert (table, (gpointer)element_names[i].name,
+			                     GUINT_TO_POINTER (element_names[i].id));
+		g_once_init_leave (&ids, table);
+	}
+
+	return GPOINTER_TO_UINT (g_hash_table_lookup (ids, name));
+}
+
 typedef struct
 {
 	State state;
@@ -170,6 +315,10 @@ typedef struct
 
 	// Temporary place holder for an option
 	SimOption *option;
+
+	// items created by the binary loader, added to the schematic at once
+	gboolean collect_items;
+	GList *items;
 } ParseState;
 
 static xmlEntityPtr get_entity (void *user_data, const xmlChar *name);
@@ -185,6 +334,7 @@ static void my_fatal_error (void *user_data, const char *msg, ...);
 
 static void create_wire (ParseState *state);
 static void create_part (ParseState *state);
+static void set_part_position (ParseState *state);
 
 static xmlSAXHandler oreganoSAXParser = {
     0,                                    // internalSubset
@@ -213,6 +363,14 @@ static xmlSAXHandler oreganoSAXParser = {
     (fatalErrorSAXFunc)my_fatal_error,    // fatalError
 };
 
+static void add_item (ParseState *state, ItemData *data)
+{
+	if (state->collect_items)
+		state->items = g_list_prepend (state->items, data);
+	else
+		schematic_add_item (state->schematic, data);
+}
+
 static void create_textbox (ParseState *state)
 {
 	Textbox *textbox;
@@ -220,7 +378,7 @@ static void create_textbox (ParseState *state)
 	textbox = textbox_new (NULL);
 	textbox_set_text (textbox, state->textbox_text);
 	item_data_set_pos (ITEM_DATA (textbox), &state->pos);
-	schematic_add_item (state->schematic, ITEM_DATA (textbox));
+	add_item (state, ITEM_DATA (textbox));
 }
 
 static void create_wire (ParseState *state)
@@ -237,7 +395,49 @@ static void create_wire (ParseState *state)
 	wire_set_length (wire, &length);
 
 	item_data_set_pos (ITEM_DATA (wire), &state->wire_start);
-	schematic_add_item (state->schematic, ITEM_DATA (wire));
+	add_item (state, ITEM_DATA (wire));
+}
+
+/**
+ * reads a position written as "(x y)" straight from the text, as
+ * sscanf would but without interpreting a format each time
+ *
+ * @returns the text after the position, NULL if it is incomplete
+ */
+static const gchar *parse_coords (const gchar *str, Coords *pos)
+{
+	gchar *end;
+
+	if (*str != '(')
+		return NULL;
+	str++;
+
+	pos->x = strtod (str, &end);
+	if (end == str)
+		return NULL;
+	str = end;
+
+	pos->y = strtod (str, &end);
+	if (end == str || *end != ')')
+		return NULL;
+
+	return end + 1;
+}
+
+static void set_part_position (ParseState *state)
+{
+	Schematic *schematic = state->schematic;
+
+	// Try to fix invalid positions
+	if (state->pos.x < 0)
+		state->pos.x = -state->pos.x;
+	if (state->pos.y < 0)
+		state->pos.y = -state->pos.y;
+	// Determine the maximum parts' coordinates to be used during sheet creation
+	if (state->pos.x > schematic_get_width(schematic))
+		schematic_set_width(schematic, (guint) state->pos.x);
+	if (state->pos.y > schematic_get_height(schematic))
+		schematic_set_height(schematic, (guint) state->pos.y);
 }
 
 static void create_part (ParseState *state)
@@ -258,7 +458,44 @@ static void create_part (ParseState *state)
 	if (state->flip & ID_FLIP_VERT)
 		item_data_flip (ITEM_DATA (part), ID_FLIP_VERT, NULL);
 
-	schematic_add_item (state->schematic, ITEM_DATA (part));
+	add_item (state, ITEM_DATA (part));
+}
+
+static void init_state (ParseState *state, Schematic *sm)
+{
+	state->schematic = sm;
+	state->sim_settings = schematic_get_sim_settings (sm);
+	state->author = NULL;
+	state->title = NULL;
+	state->oregano_version = NULL;
+	state->comments = NULL;
+	state->collect_items = FALSE;
+	state->items = NULL;
+}
+
+// hands the collected information over to the schematic
+static void finish_state (ParseState *state, const char *filename)
+{
+	Schematic *sm = state->schematic;
+
+	if (state->items) {
+		state->items = g_list_reverse (state->items);
+		schematic_add_items (sm, state->items);
+		g_list_free (state->items);
+	}
+
+	schematic_set_filename(sm, filename);
+	schematic_set_author (sm, state->author);
+	schematic_set_title (sm, state->title);
+	schematic_set_version(sm, state->oregano_version);
+	schematic_set_comments (sm, state->comments);
+
+	g_free(state->author);
+	g_free(state->title);
+	g_free(state->oregano_version);
+	g_free(state->comments);
+
+	update_schematic(sm);
 }
 
 int schematic_parse_xml_file (Schematic *sm, const char *filename, GError **error)
@@ -266,12 +503,7 @@ int schematic_parse_xml_file (Schematic *sm, const char *filename, GError **erro
 	ParseState state;
 	int retval = 0;
 
-	state.schematic = sm;
-	state.sim_settings = schematic_get_sim_settings (sm);
-	state.author = NULL;
-	state.title = NULL;
-	state.oregano_version = NULL;
-	state.comments = NULL;
+	init_state (&state, sm);
 
 	if (!oreganoXmlSAXParseFile (&oreganoSAXParser, &state, filename)) {
 		g_warning ("Document not well formed!");
@@ -290,18 +522,281 @@ int schematic_parse_xml_file (Schematic *sm, const char *filename, GError **erro
 		retval = -2;
 	}
 
-	schematic_set_filename(sm, filename);
-	schematic_set_author (sm, state.author);
-	schematic_set_title (sm, state.title);
-	schematic_set_version(sm, state.oregano_version);
-	schematic_set_comments (sm, state.comments);
+	finish_state (&state, filename);
 
-	g_free(state.author);
-	g_free(state.title);
-	g_free(state.oregano_version);
-	g_free(state.comments);
+	return retval;
+}
 
-	update_schematic(sm);
+/*
+ * The binary format, see schematic-binary.h. The file is mapped and its
+ * records are turned into items with the same calls the XML parser
+ * makes, so both formats load into the same schematic.
+ */
+typedef struct
+{
+	const gchar *data;
+	gsize size;
+} BinaryChunk;
+
+static guint32 binary_read_u32 (const gchar *data)
+{
+	guint32 value;
+
+	memcpy (&value, data, sizeof(value));
+	return GUINT32_FROM_LE (value);
+}
+
+static guint64 binary_read_u64 (const gchar *data)
+{
+	guint64 value;
+
+	memcpy (&value, data, sizeof(value));
+	return GUINT64_FROM_LE (value);
+}
+
+/**
+ * @returns the string at an offset into the string table, or NULL if
+ * the offset is not inside of it
+ */
+static gchar *binary_get_string (const BinaryChunk *strings, guint32 offset)
+{
+	offset = GUINT32_FROM_LE (offset);
+	if (offset >= strings->size)
+		return NULL;
+	return (gchar *)strings->data + offset;
+}
+
+/**
+ * splits the file into its chunks, the data stays in the mapped file
+ */
+static gboolean binary_read_chunks (const gchar *data, gsize size, BinaryChunk *chunks,
+                                    const guint32 *tags, guint n_tags, GError **error)
+{
+	gsize offset;
+	guint i;
+
+	if (size < SCHEMATIC_BINARY_HEADER_SIZE ||
+	    memcmp (data, SCHEMATIC_BINARY_MAGIC, sizeof(SCHEMATIC_BINARY_MAGIC)) != 0) {
+		g_set_error (error, OREGANO_ERROR, OREGANO_SCHEMATIC_BAD_FILE_FORMAT,
+		             _ ("Bad file format."));
+		return FALSE;
+	}
+	if (binary_read_u32 (data + 8) > SCHEMATIC_BINARY_VERSION) {
+		g_set_error (error, OREGANO_ERROR, OREGANO_SCHEMATIC_BAD_FILE_FORMAT,
+		             _ ("The file was saved by a newer version of Oregano."));
+		return FALSE;
+	}
+
+	offset = SCHEMATIC_BINARY_HEADER_SIZE;
+	while (offset < size) {
+		guint32 tag;
+		guint64 chunk_size;
+
+		if (size - offset < SCHEMATIC_BINARY_CHUNK_HEADER_SIZE)
+			break;
+		tag = binary_read_u32 (data + offset);
+		chunk_size = binary_read_u64 (data + offset + 8);
+		offset += SCHEMATIC_BINARY_CHUNK_HEADER_SIZE;
+		if (chunk_size > size - offset)
+			break;
+
+		for (i = 0; i < n_tags; i++)
+			if (tags[i] == tag) {
+				chunks[i].data = data + offset;
+				chunks[i].size = chunk_size;
+			}
+
+		offset += chunk_size + (8 - chunk_size % 8) % 8;
+	}
+
+	if (offset < size) {
+		g_set_error (error, OREGANO_ERROR, OREGANO_SCHEMATIC_BAD_FILE_FORMAT,
+		             _ ("The file is truncated."));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+enum {
+	BINARY_HEAD,
+	BINARY_STRINGS,
+	BINARY_LIBRARY_PARTS,
+	BINARY_PARTS,
+	BINARY_PROPERTIES,
+	BINARY_LABELS,
+	BINARY_WIRES,
+	BINARY_TEXTBOXES,
+	BINARY_N_CHUNKS
+};
+
+/**
+ * creates the parts, wires and textboxes of the binary chunks
+ *
+ * @returns FALSE if a record refers to something which is not there
+ */
+static gboolean binary_create_items (ParseState *state, const BinaryChunk *chunks)
+{
+	const BinaryChunk *strings = &chunks[BINARY_STRINGS];
+	gsize n_library_parts, n_parts, n_properties, n_labels, n_wires, n_textboxes;
+	gsize i, j, property = 0, label = 0;
+
+	n_library_parts = chunks[BINARY_LIBRARY_PARTS].size / sizeof(SchematicBinaryLibraryPart);
+	n_parts = chunks[BINARY_PARTS].size / sizeof(SchematicBinaryPart);
+	n_properties = chunks[BINARY_PROPERTIES].size / sizeof(SchematicBinaryProperty);
+	n_labels = chunks[BINARY_LABELS].size / sizeof(SchematicBinaryLabel);
+	n_wires = chunks[BINARY_WIRES].size / sizeof(SchematicBinaryWire);
+	n_textboxes = chunks[BINARY_TEXTBOXES].size / sizeof(SchematicBinaryTextbox);
+
+	// every string ends inside of the table
+	if (strings->size > 0 && strings->data[strings->size - 1] != '\0')
+		return FALSE;
+
+	for (i = 0; i < n_parts; i++) {
+		SchematicBinaryPart record;
+		SchematicBinaryLibraryPart library_record;
+		LibraryPart library_part = {0};
+		Property *props;
+		PartLabel *labels;
+		guint32 library_part_id, n_props, n_part_labels;
+		gchar *library_name;
+		gboolean valid = TRUE;
+
+		memcpy (&record, chunks[BINARY_PARTS].data + i * sizeof(record), sizeof(record));
+		library_part_id = GUINT32_FROM_LE (record.library_part);
+		n_props = GUINT32_FROM_LE (record.n_properties);
+		n_part_labels = GUINT32_FROM_LE (record.n_labels);
+		if (library_part_id >= n_library_parts || n_props > n_properties - property ||
+		    n_part_labels > n_labels - label)
+			return FALSE;
+
+		memcpy (&library_record,
+		        chunks[BINARY_LIBRARY_PARTS].data + library_part_id * sizeof(library_record),
+		        sizeof(library_record));
+		library_name = binary_get_string (strings, library_record.library);
+		library_part.name = binary_get_string (strings, library_record.name);
+		library_part.symbol_name = binary_get_string (strings, library_record.symbol);
+		if (!library_name || !library_part.name || !library_part.symbol_name)
+			return FALSE;
+		library_part.library = library_index_get_library (library_name);
+
+		// prepended as the XML parser does, the part reverses them again
+		props = g_new (Property, n_props);
+		for (j = 0; j < n_props; j++, property++) {
+			SchematicBinaryProperty p;
+
+			memcpy (&p, chunks[BINARY_PROPERTIES].data + property * sizeof(p), sizeof(p));
+			props[j].name = binary_get_string (strings, p.name);
+			props[j].value = binary_get_string (strings, p.value);
+			valid = valid && props[j].name && props[j].value;
+			library_part.properties = g_slist_prepend (library_part.properties, &props[j]);
+		}
+
+		labels = g_new (PartLabel, n_part_labels);
+		for (j = 0; j < n_part_labels; j++, label++) {
+			SchematicBinaryLabel l;
+
+			memcpy (&l, chunks[BINARY_LABELS].data + label * sizeof(l), sizeof(l));
+			labels[j].name = binary_get_string (strings, l.name);
+			labels[j].text = binary_get_string (strings, l.text);
+			labels[j].pos.x = schematic_binary_to_double (l.x);
+			labels[j].pos.y = schematic_binary_to_double (l.y);
+			valid = valid && labels[j].name && labels[j].text;
+			library_part.labels = g_slist_prepend (library_part.labels, &labels[j]);
+		}
+
+		if (valid) {
+			state->part = &library_part;
+			state->pos.x = schematic_binary_to_double (record.x);
+			state->pos.y = schematic_binary_to_double (record.y);
+			set_part_position (state);
+			state->rotation = GINT32_FROM_LE (record.rotation);
+			state->flip = GUINT32_FROM_LE (record.flip) & (ID_FLIP_HORIZ | ID_FLIP_VERT);
+			create_part (state);
+			state->part = NULL;
+		}
+
+		g_slist_free (library_part.properties);
+		g_slist_free (library_part.labels);
+		g_free (props);
+		g_free (labels);
+		if (!valid)
+			return FALSE;
+	}
+
+	for (i = 0; i < n_wires; i++) {
+		SchematicBinaryWire record;
+
+		memcpy (&record, chunks[BINARY_WIRES].data + i * sizeof(record), sizeof(record));
+		state->wire_start.x = schematic_binary_to_double (record.x0);
+		state->wire_start.y = schematic_binary_to_double (record.y0);
+		state->wire_end.x = schematic_binary_to_double (record.x1);
+		state->wire_end.y = schematic_binary_to_double (record.y1);
+		create_wire (state);
+	}
+
+	for (i = 0; i < n_textboxes; i++) {
+		SchematicBinaryTextbox record;
+
+		memcpy (&record, chunks[BINARY_TEXTBOXES].data + i * sizeof(record), sizeof(record));
+		state->textbox_text = binary_get_string (strings, record.text);
+		if (state->textbox_text == NULL)
+			return FALSE;
+		state->pos.x = schematic_binary_to_double (record.x);
+		state->pos.y = schematic_binary_to_double (record.y);
+		create_textbox (state);
+		state->textbox_text = NULL;
+	}
+
+	return TRUE;
+}
+
+int schematic_parse_binary_file (Schematic *sm, const char *filename, GError **error)
+{
+	static const guint32 tags[BINARY_N_CHUNKS] = {
+	    SCHEMATIC_BINARY_TAG_HEAD,       SCHEMATIC_BINARY_TAG_STRINGS,
+	    SCHEMATIC_BINARY_TAG_LIBRARY_PARTS,
+	    SCHEMATIC_BINARY_TAG_PARTS,      SCHEMATIC_BINARY_TAG_PROPERTIES,
+	    SCHEMATIC_BINARY_TAG_LABELS,     SCHEMATIC_BINARY_TAG_WIRES,
+	    SCHEMATIC_BINARY_TAG_TEXTBOXES};
+	BinaryChunk chunks[BINARY_N_CHUNKS] = {{0}};
+	ParseState state;
+	GMappedFile *file;
+	GString *head;
+	gboolean parsed;
+	int retval = 0;
+
+	file = g_mapped_file_new (filename, FALSE, error);
+	if (file == NULL)
+		return -1;
+
+	if (!binary_read_chunks (g_mapped_file_get_contents (file), g_mapped_file_get_length (file),
+	                         chunks, tags, BINARY_N_CHUNKS, error)) {
+		g_mapped_file_unref (file);
+		return -1;
+	}
+
+	init_state (&state, sm);
+
+	// the head is the start of an XML document, closed to be parsed
+	head = g_string_new_len (chunks[BINARY_HEAD].data, chunks[BINARY_HEAD].size);
+	g_string_append (head, "</ogo:schematic>\n");
+	parsed = oreganoXmlSAXParseMemory (&oreganoSAXParser, &state, head->str, head->len);
+	g_string_free (head, TRUE);
+
+	// the records are written from a store, without overlapping wires
+	state.collect_items = TRUE;
+	if (!parsed || state.state == PARSE_ERROR) {
+		g_set_error (error, OREGANO_ERROR, OREGANO_SCHEMATIC_BAD_FILE_FORMAT,
+		             _ ("Bad file format."));
+		retval = -1;
+	} else if (!binary_create_items (&state, chunks)) {
+		g_set_error (error, OREGANO_ERROR, OREGANO_SCHEMATIC_BAD_FILE_FORMAT,
+		             _ ("The file refers to data it does not contain."));
+		retval = -2;
+	}
+
+	finish_state (&state, filename);
+	g_mapped_file_unref (file);
 
 	return retval;
 }
@@ -325,9 +820,11 @@ static void end_document (ParseState *state)
 
 static void start_element (ParseState *state, const xmlChar *name, const xmlChar **attrs)
 {
+	ElementId element = element_lookup (name);
+
 	switch (state->state) {
 	case PARSE_START:
-		if (xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:schematic")) {
+		if (element != ELEMENT_SCHEMATIC) {
 			g_warning ("Expecting 'ogo:schematic'.  Got '%s'", name);
 			state->state = PARSE_ERROR;
 		} else
@@ -335,28 +832,28 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		break;
 
 	case PARSE_SCHEMATIC:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:author")) {
+		if (element == ELEMENT_AUTHOR) {
 			state->state = PARSE_AUTHOR;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:title")) {
+		} else if (element == ELEMENT_TITLE) {
 			state->state = PARSE_TITLE;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:version")) {
+		} else if (element == ELEMENT_VERSION) {
 			state->state = PARSE_VERSION;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:comments")) {
+		} else if (element == ELEMENT_COMMENTS) {
 			state->state = PARSE_COMMENTS;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:zoom")) {
+		} else if (element == ELEMENT_ZOOM) {
 			state->state = PARSE_ZOOM;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:simulation-settings")) {
+		} else if (element == ELEMENT_SIMULATION_SETTINGS) {
 			state->state = PARSE_SIMULATION_SETTINGS;
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:parts")) {
+		} else if (element == ELEMENT_PARTS) {
 			state->state = PARSE_PARTS;
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:wires")) {
+		} else if (element == ELEMENT_WIRES) {
 			state->state = PARSE_WIRES;
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:textboxes")) {
+		} else if (element == ELEMENT_TEXTBOXES) {
 			state->state = PARSE_TEXTBOXES;
 		} else {
 			state->prev_state = state->state;
@@ -366,17 +863,17 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		break;
 
 	case PARSE_SIMULATION_SETTINGS:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:transient")) {
+		if (element == ELEMENT_TRANSIENT) {
 			state->state = PARSE_TRANSIENT_SETTINGS;
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:ac")) {
+		} else if (element == ELEMENT_AC) {
 			state->state = PARSE_AC_SETTINGS;
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:dc-sweep")) {
+		} else if (element == ELEMENT_DC_SWEEP) {
 			state->state = PARSE_DC_SETTINGS;
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:fourier")) {
+		} else if (element == ELEMENT_FOURIER) {
 			state->state = PARSE_FOURIER_SETTINGS;
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:noise")) {
+		} else if (element == ELEMENT_NOISE) {
 			state->state = PARSE_NOISE_SETTINGS;
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:options")) {
+		} else if (element == ELEMENT_OPTIONS) {
 			state->state = PARSE_OPTION_LIST;
 		} else {
 			state->prev_state = state->state;
@@ -386,27 +883,30 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		break;
 
 	case PARSE_TRANSIENT_SETTINGS:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:enabled")) {
+		if (element == ELEMENT_ENABLED) {
 			state->state = PARSE_TRANSIENT_ENABLED;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:start")) {
+		} else if (element == ELEMENT_START) {
 			state->state = PARSE_TRANSIENT_START;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:stop")) {
+		} else if (element == ELEMENT_STOP) {
 			state->state = PARSE_TRANSIENT_STOP;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:step")) {
+		} else if (element == ELEMENT_STEP) {
 			state->state = PARSE_TRANSIENT_STEP;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:step-enabled")) {
+		} else if (element == ELEMENT_STEP_ENABLED) {
 			state->state = PARSE_TRANSIENT_STEP_ENABLE;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:init-conditions")) {
+		} else if (element == ELEMENT_INIT_CONDITIONS) {
 			state->state = PARSE_TRANSIENT_INIT_COND;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:analyze-all")) {
+		} else if (element == ELEMENT_ANALYZE_ALL) {
 			state->state = PARSE_TRANSIENT_ANALYZE_ALL;
 			g_string_truncate (state->content, 0);
+		} else if (element == ELEMENT_COMPACT) {
+			state->state = PARSE_TRANSIENT_COMPACT;
+			g_string_truncate (state->content, 0);
 		} else {
 			state->prev_state = state->state;
 			state->state = PARSE_UNKNOWN;
@@ -415,24 +915,27 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		break;
 
 	case PARSE_AC_SETTINGS:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:enabled")) {
+		if (element == ELEMENT_ENABLED) {
 			state->state = PARSE_AC_ENABLED;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:vout1")) {
+		} else if (element == ELEMENT_VOUT1) {
 			state->state = PARSE_AC_VOUT;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:type")) {
+		} else if (element == ELEMENT_TYPE) {
 			state->state = PARSE_AC_TYPE;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:npoints")) {
+		} else if (element == ELEMENT_NPOINTS) {
 			state->state = PARSE_AC_NPOINTS;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:start")) {
+		} else if (element == ELEMENT_START) {
 			state->state = PARSE_AC_START;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:stop")) {
+		} else if (element == ELEMENT_STOP) {
 			state->state = PARSE_AC_STOP;
 			g_string_truncate (state->content, 0);
+		} else if (element == ELEMENT_COMPACT) {
+			state->state = PARSE_AC_COMPACT;
+			g_string_truncate (state->content, 0);
 		} else {
 			state->prev_state = state->state;
 			state->state = PARSE_UNKNOWN;
@@ -441,24 +944,27 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		break;
 
 	case PARSE_DC_SETTINGS:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:enabled")) {
+		if (element == ELEMENT_ENABLED) {
 			state->state = PARSE_DC_ENABLED;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:vsrc1")) {
+		} else if (element == ELEMENT_VSRC1) {
 			state->state = PARSE_DC_VSRC;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:vout1")) {
+		} else if (element == ELEMENT_VOUT1) {
 			state->state = PARSE_DC_VOUT;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:start1")) {
+		} else if (element == ELEMENT_START1) {
 			state->state = PARSE_DC_START;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:stop1")) {
+		} else if (element == ELEMENT_STOP1) {
 			state->state = PARSE_DC_STOP;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:step1")) {
+		} else if (element == ELEMENT_STEP1) {
 			state->state = PARSE_DC_STEP;
 			g_string_truncate (state->content, 0);
+		} else if (element == ELEMENT_COMPACT) {
+			state->state = PARSE_DC_COMPACT;
+			g_string_truncate (state->content, 0);
 		} else {
 			state->prev_state = state->state;
 			state->state = PARSE_UNKNOWN;
@@ -467,13 +973,13 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		break;
 
 	case PARSE_FOURIER_SETTINGS:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:enabled")) {
+		if (element == ELEMENT_ENABLED) {
 			state->state = PARSE_FOURIER_ENABLED;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:freq")) {
+		} else if (element == ELEMENT_FREQ) {
 			state->state = PARSE_FOURIER_FREQ;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:vout")) {
+		} else if (element == ELEMENT_VOUT) {
 			state->state = PARSE_FOURIER_VOUT;
 			g_string_truncate (state->content, 0);
 		} else {
@@ -484,27 +990,30 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		break;
 
 	case PARSE_NOISE_SETTINGS:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:enabled")) {
+		if (element == ELEMENT_ENABLED) {
 			state->state = PARSE_NOISE_ENABLED;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:vsrc1")) {
+		} else if (element == ELEMENT_VSRC1) {
 			state->state = PARSE_NOISE_VSRC;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:vout1")) {
+		} else if (element == ELEMENT_VOUT1) {
 			state->state = PARSE_NOISE_VOUT;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:type")) {
+		} else if (element == ELEMENT_TYPE) {
 			state->state = PARSE_NOISE_TYPE;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:npoints")) {
+		} else if (element == ELEMENT_NPOINTS) {
 			state->state = PARSE_NOISE_NPOINTS;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:start")) {
+		} else if (element == ELEMENT_START) {
 			state->state = PARSE_NOISE_START;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:stop")) {
+		} else if (element == ELEMENT_STOP) {
 			state->state = PARSE_NOISE_STOP;
 			g_string_truncate (state->content, 0);
+		} else if (element == ELEMENT_COMPACT) {
+			state->state = PARSE_NOISE_COMPACT;
+			g_string_truncate (state->content, 0);
 		} else {
 			state->prev_state = state->state;
 			state->state = PARSE_UNKNOWN;
@@ -513,7 +1022,7 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		break;
 
 	case PARSE_OPTION_LIST:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:option")) {
+		if (element == ELEMENT_OPTION) {
 			state->state = PARSE_OPTION;
 			state->option = g_new0 (SimOption, 1);
 			g_string_truncate (state->content, 0);
@@ -524,10 +1033,10 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		}
 		break;
 	case PARSE_OPTION:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:name")) {
+		if (element == ELEMENT_NAME) {
 			state->state = PARSE_OPTION_NAME;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:value")) {
+		} else if (element == ELEMENT_VALUE) {
 			state->state = PARSE_OPTION_VALUE;
 			g_string_truncate (state->content, 0);
 		} else {
@@ -538,7 +1047,7 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 
 		break;
 	case PARSE_PARTS:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:part")) {
+		if (element == ELEMENT_PART) {
 			state->state = PARSE_PART;
 			state->part = g_new0 (LibraryPart, 1);
 			state->rotation = 0;
@@ -552,36 +1061,36 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		}
 		break;
 	case PARSE_PART:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:name")) {
+		if (element == ELEMENT_NAME) {
 			state->state = PARSE_PART_NAME;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:library")) {
+		} else if (element == ELEMENT_LIBRARY) {
 			state->state = PARSE_PART_LIBNAME;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:refdes")) {
+		} else if (element == ELEMENT_REFDES) {
 			state->state = PARSE_PART_REFDES;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:position")) {
+		} else if (element == ELEMENT_POSITION) {
 			state->state = PARSE_PART_POSITION;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:rotation")) {
+		} else if (element == ELEMENT_ROTATION) {
 			state->state = PARSE_PART_ROTATION;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:flip")) {
+		} else if (element == ELEMENT_FLIP) {
 			state->state = PARSE_PART_FLIP;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:template")) {
+		} else if (element == ELEMENT_TEMPLATE) {
 			state->state = PARSE_PART_TEMPLATE;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:model")) {
+		} else if (element == ELEMENT_MODEL) {
 			state->state = PARSE_PART_MODEL;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:symbol")) {
+		} else if (element == ELEMENT_SYMBOL) {
 			state->state = PARSE_PART_SYMNAME;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:labels")) {
+		} else if (element == ELEMENT_LABELS) {
 			state->state = PARSE_PART_LABELS;
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:properties")) {
+		} else if (element == ELEMENT_PROPERTIES) {
 			state->state = PARSE_PART_PROPERTIES;
 		} else {
 			state->prev_state = state->state;
@@ -590,7 +1099,7 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		}
 		break;
 	case PARSE_PART_LABELS:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:label")) {
+		if (element == ELEMENT_LABEL) {
 			state->state = PARSE_PART_LABEL;
 			state->label = g_new0 (PartLabel, 1);
 		} else {
@@ -600,13 +1109,13 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		}
 		break;
 	case PARSE_PART_LABEL:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:name")) {
+		if (element == ELEMENT_NAME) {
 			state->state = PARSE_PART_LABEL_NAME;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:text")) {
+		} else if (element == ELEMENT_TEXT) {
 			state->state = PARSE_PART_LABEL_TEXT;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:position")) {
+		} else if (element == ELEMENT_POSITION) {
 			state->state = PARSE_PART_LABEL_POS;
 			g_string_truncate (state->content, 0);
 		} else {
@@ -617,7 +1126,7 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		break;
 
 	case PARSE_PART_PROPERTIES:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:property")) {
+		if (element == ELEMENT_PROPERTY) {
 			state->state = PARSE_PART_PROPERTY;
 			state->property = g_new0 (Property, 1);
 		} else {
@@ -627,10 +1136,10 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		}
 		break;
 	case PARSE_PART_PROPERTY:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:name")) {
+		if (element == ELEMENT_NAME) {
 			state->state = PARSE_PART_PROPERTY_NAME;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:value")) {
+		} else if (element == ELEMENT_VALUE) {
 			state->state = PARSE_PART_PROPERTY_VALUE;
 			g_string_truncate (state->content, 0);
 		} else {
@@ -641,7 +1150,7 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		break;
 
 	case PARSE_WIRES:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:wire")) {
+		if (element == ELEMENT_WIRE) {
 			state->state = PARSE_WIRE;
 		} else {
 			state->prev_state = state->state;
@@ -650,7 +1159,7 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		}
 		break;
 	case PARSE_WIRE:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:points")) {
+		if (element == ELEMENT_POINTS) {
 			state->state = PARSE_WIRE_POINTS;
 			g_string_truncate (state->content, 0);
 		} else {
@@ -661,7 +1170,7 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		break;
 
 	case PARSE_TEXTBOXES:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:textbox")) {
+		if (element == ELEMENT_TEXTBOX) {
 			state->state = PARSE_TEXTBOX;
 		} else {
 			state->prev_state = state->state;
@@ -670,10 +1179,10 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 		}
 		break;
 	case PARSE_TEXTBOX:
-		if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:position")) {
+		if (element == ELEMENT_POSITION) {
 			state->state = PARSE_TEXTBOX_POSITION;
 			g_string_truncate (state->content, 0);
-		} else if (!xmlStrcmp (BAD_CAST name, BAD_CAST "ogo:text")) {
+		} else if (element == ELEMENT_TEXT) {
 			state->state = PARSE_TEXTBOX_TEXT;
 			g_string_truncate (state->content, 0);
 		} else {
@@ -688,6 +1197,7 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 	case PARSE_TRANSIENT_STOP:
 	case PARSE_TRANSIENT_STEP:
 	case PARSE_TRANSIENT_STEP_ENABLE:
+	case PARSE_TRANSIENT_COMPACT:
 
 	case PARSE_AC_ENABLED:
 	case PARSE_AC_VOUT:
@@ -695,6 +1205,7 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 	case PARSE_AC_NPOINTS:
 	case PARSE_AC_START:
 	case PARSE_AC_STOP:
+	case PARSE_AC_COMPACT:
 
 	case PARSE_DC_ENABLED:
 	case PARSE_DC_VSRC:
@@ -702,6 +1213,7 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 	case PARSE_DC_START:
 	case PARSE_DC_STOP:
 	case PARSE_DC_STEP:
+	case PARSE_DC_COMPACT:
 
 	case PARSE_FOURIER_ENABLED:
 	case PARSE_FOURIER_FREQ:
@@ -714,6 +1226,7 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 	case PARSE_NOISE_NPOINTS:
 	case PARSE_NOISE_START:
 	case PARSE_NOISE_STOP:
+	case PARSE_NOISE_COMPACT:
 
 	case PARSE_WIRE_POINTS:
 	case PARSE_OPTION_NAME:
@@ -763,9 +1276,6 @@ static void start_element (ParseState *state, const xmlChar *name, const xmlChar
 
 static void end_element (ParseState *state, const xmlChar *name)
 {
-	GList *libs;
-	Schematic *schematic = state->schematic;
-
 	switch (state->state) {
 	case PARSE_UNKNOWN:
 		state->unknown_depth--;
@@ -837,6 +1347,11 @@ static void end_element (ParseState *state, const xmlChar *name)
 		                                !g_ascii_strcasecmp (state->content->str, "true"));
 		state->state = PARSE_TRANSIENT_SETTINGS;
 		break;
+	case PARSE_TRANSIENT_COMPACT:
+		sim_settings_set_trans_compact (state->sim_settings,
+		                                !g_ascii_strcasecmp (state->content->str, "true"));
+		state->state = PARSE_TRANSIENT_SETTINGS;
+		break;
 
 	case PARSE_AC_SETTINGS:
 		state->state = PARSE_SIMULATION_SETTINGS;
@@ -866,6 +1381,11 @@ static void end_element (ParseState *state, const xmlChar *name)
 		sim_settings_set_ac_stop (state->sim_settings, state->content->str);
 		state->state = PARSE_AC_SETTINGS;
 		break;
+	case PARSE_AC_COMPACT:
+		sim_settings_set_ac_compact (state->sim_settings,
+		                     !g_ascii_strcasecmp (state->content->str, "true"));
+		state->state = PARSE_AC_SETTINGS;
+		break;
 
 	case PARSE_DC_SETTINGS:
 		state->state = PARSE_SIMULATION_SETTINGS;
@@ -895,6 +1415,11 @@ static void end_element (ParseState *state, const xmlChar *name)
 		sim_settings_set_dc_step (state->sim_settings, state->content->str);
 		state->state = PARSE_DC_SETTINGS;
 		break;
+	case PARSE_DC_COMPACT:
+		sim_settings_set_dc_compact (state->sim_settings,
+		                     !g_ascii_strcasecmp (state->content->str, "true"));
+		state->state = PARSE_DC_SETTINGS;
+		break;
 
 	case PARSE_FOURIER_SETTINGS:
 		state->state = PARSE_SIMULATION_SETTINGS;
@@ -945,6 +1470,11 @@ static void end_element (ParseState *state, const xmlChar *name)
 		sim_settings_set_noise_stop (state->sim_settings, state->content->str);
 		state->state = PARSE_NOISE_SETTINGS;
 		break;
+	case PARSE_NOISE_COMPACT:
+		sim_settings_set_noise_compact (state->sim_settings,
+		                     !g_ascii_strcasecmp (state->content->str, "true"));
+		state->state = PARSE_NOISE_SETTINGS;
+		break;
 
 	case PARSE_OPTION_LIST:
 		state->state = PARSE_SIMULATION_SETTINGS;
@@ -977,35 +1507,22 @@ static void end_element (ParseState *state, const xmlChar *name)
 		break;
 	case PARSE_PART_LIBNAME:
 		state->state = PARSE_PART;
-		state->part->library = NULL;
-		libs = oregano.libraries;
-		while (libs) {
-			Library *lib = (Library *)libs->data;
-			if (g_ascii_strcasecmp (state->content->str, lib->name) == 0) {
-				state->part->library = lib;
-				break;
-			}
-			libs = libs->next;
-		}
+		state->part->library = library_index_get_library (state->content->str);
 		break;
 	case PARSE_PART_POSITION:
-		sscanf (state->content->str, "(%lf %lf)", &state->pos.x, &state->pos.y);
-		// Try to fix invalid positions
-		if (state->pos.x < 0)
-			state->pos.x = -state->pos.x;
-		if (state->pos.y < 0)
-			state->pos.y = -state->pos.y;
-		// Determine the maximum parts' coordinates to be used during sheet creation
-		if (state->pos.x > schematic_get_width(schematic))
-			schematic_set_width(schematic, (guint) state->pos.x);
-		if (state->pos.y > schematic_get_height(schematic))
-			schematic_set_height(schematic, (guint) state->pos.y);
+		parse_coords (state->content->str, &state->pos);
+		set_part_position (state);
 		state->state = PARSE_PART;
 		break;
-	case PARSE_PART_ROTATION:
-		sscanf (state->content->str, "%d", &state->rotation);
+	case PARSE_PART_ROTATION: {
+		gchar *end;
+		glong rotation = strtol (state->content->str, &end, 10);
+
+		if (end != state->content->str)
+			state->rotation = rotation;
 		state->state = PARSE_PART;
 		break;
+	}
 	case PARSE_PART_FLIP:
 		if (g_ascii_strcasecmp (state->content->str, "horizontal") == 0)
 			state->flip = state->flip | ID_FLIP_HORIZ;
@@ -1045,7 +1562,7 @@ static void end_element (ParseState *state, const xmlChar *name)
 		state->state = PARSE_PART_LABEL;
 		break;
 	case PARSE_PART_LABEL_POS:
-		sscanf (state->content->str, "(%lf %lf)", &state->label->pos.x, &state->label->pos.y);
+		parse_coords (state->content->str, &state->label->pos);
 		state->state = PARSE_PART_LABEL;
 		break;
 	case PARSE_PART_PROPERTIES:
@@ -1070,12 +1587,15 @@ static void end_element (ParseState *state, const xmlChar *name)
 	case PARSE_WIRE:
 		state->state = PARSE_WIRES;
 		break;
-	case PARSE_WIRE_POINTS:
-		sscanf (state->content->str, "(%lf %lf)(%lf %lf)", &state->wire_start.x,
-		        &state->wire_start.y, &state->wire_end.x, &state->wire_end.y);
+	case PARSE_WIRE_POINTS: {
+		const gchar *next = parse_coords (state->content->str, &state->wire_start);
+
+		if (next)
+			parse_coords (next, &state->wire_end);
 		create_wire (state);
 		state->state = PARSE_WIRE;
 		break;
+	}
 
 	case PARSE_TEXTBOXES:
 		state->state = PARSE_SCHEMATIC;
@@ -1085,7 +1605,7 @@ static void end_element (ParseState *state, const xmlChar *name)
 		state->state = PARSE_TEXTBOXES;
 		break;
 	case PARSE_TEXTBOX_POSITION:
-		sscanf (state->content->str, "(%lf %lf)", &state->pos.x, &state->pos.y);
+		parse_coords (state->content->str, &state->pos);
 		state->state = PARSE_TEXTBOX;
 		break;
 	case PARSE_TEXTBOX_TEXT:
@@ -1108,14 +1628,11 @@ static void end_element (ParseState *state, const xmlChar *name)
 
 static void my_characters (ParseState *state, const xmlChar *chars, int len)
 {
-	int i;
-
 	if (state->state == PARSE_FINISH || state->state == PARSE_START ||
 	    state->state == PARSE_PARTS || state->state == PARSE_PART)
 		return;
 
-	for (i = 0; i < len; i++)
-		g_string_append_c (state->content, chars[i]);
+	g_string_append_len (state->content, (const gchar *)chars, len);
 }
 
 static xmlEntityPtr get_entity (void *user_data, const xmlChar *name)
@@ -38,5 +38,6 @@
 #include "schematic.h"
 
 gint schematic_parse_xml_file (Schematic *sm, const gchar *filename, GError **);
+gint schematic_parse_binary_file (Schematic *sm, const gchar *filename, GError **);
 
 #endif
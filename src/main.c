@@ -36,6 +36,7 @@
 #include <gtk/gtk.h>
 #include <glib/gi18n.h>
 
+#include "batch.h"
 #include "oregano.h"
 #include "options.h"
 #include "schematic.h"
@@ -71,6 +72,9 @@ int main (int argc, char *argv[])
 			 " Main Developer: Bernhard Schuster\n");
 		return 0;
 	}
+	// the remaining arguments are the schematics to process
+	if (oregano_options_batch ())
+		return batch_run (argv + 1, argc - 1);
 
 	// required?
 	gtk_init (&argc, &argv);
@@ -506,6 +506,245 @@ gboolean node_store_add_wire (NodeStore *store, Wire *wire)
 	return TRUE;
 }
 
+/*
+ * The wires of a store ordered by the row (horizontal wires) or the
+ * column (vertical wires) they lie on, so that the wires at a point are
+ * found without looking at every other wire.
+ */
+typedef struct
+{
+	gdouble lo, hi; // extent of the wire along its row or column
+	Wire *wire;
+} WireSpan;
+
+typedef struct
+{
+	GArray *spans; // sorted by lo
+	gdouble longest;
+} WireLine;
+
+typedef struct
+{
+	GHashTable *rows;
+	GHashTable *columns;
+	GPtrArray *others; // neither horizontal nor vertical
+} WireIndex;
+
+static void wire_line_free (WireLine *line)
+{
+	g_array_free (line->spans, TRUE);
+	g_free (line);
+}
+
+static gint wire_span_compare (gconstpointer a, gconstpointer b)
+{
+	const WireSpan *sa = a;
+	const WireSpan *sb = b;
+
+	return (sa->lo > sb->lo) - (sa->lo < sb->lo);
+}
+
+static void wire_line_sort (gpointer key, WireLine *line, gpointer user_data)
+{
+	g_array_sort (line->spans, wire_span_compare);
+}
+
+static void wire_index_add (GHashTable *lines, gdouble at, gdouble a, gdouble b, Wire *wire)
+{
+	gpointer key = GINT_TO_POINTER ((gint)rint (at));
+	WireLine *line = g_hash_table_lookup (lines, key);
+	WireSpan span = {MIN (a, b), MAX (a, b), wire};
+
+	if (!line) {
+		line = g_new0 (WireLine, 1);
+		line->spans = g_array_new (FALSE, FALSE, sizeof(WireSpan));
+		g_hash_table_insert (lines, key, line);
+	}
+	g_array_append_val (line->spans, span);
+	line->longest = MAX (line->longest, span.hi - span.lo);
+}
+
+static void wire_index_init (WireIndex *index, GList *wires)
+{
+	GList *iter;
+
+	index->rows =
+	    g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)wire_line_free);
+	index->columns =
+	    g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)wire_line_free);
+	index->others = g_ptr_array_new ();
+
+	for (iter = wires; iter; iter = iter->next) {
+		Wire *wire = iter->data;
+		Coords start, end;
+
+		wire_get_start_and_end_pos (wire, &start, &end);
+		if (IS_EQ (start.x, end.x))
+			wire_index_add (index->columns, start.x, start.y, end.y, wire);
+		else if (IS_EQ (start.y, end.y))
+			wire_index_add (index->rows, start.y, start.x, end.x, wire);
+		else
+			g_ptr_array_add (index->others, wire);
+	}
+
+	g_hash_table_foreach (index->rows, (GHFunc)wire_line_sort, NULL);
+	g_hash_table_foreach (index->columns, (GHFunc)wire_line_sort, NULL);
+}
+
+static void wire_index_clear (WireIndex *index)
+{
+	g_hash_table_destroy (index->rows);
+	g_hash_table_destroy (index->columns);
+	g_ptr_array_free (index->others, TRUE);
+}
+
+static void wire_line_lookup (GHashTable *lines, gdouble at, gdouble along, Coords *pos,
+                              GPtrArray *found)
+{
+	WireLine *line = g_hash_table_lookup (lines, GINT_TO_POINTER ((gint)rint (at)));
+	guint lo = 0, hi;
+
+	if (!line)
+		return;
+
+	// the first span which starts behind the position
+	hi = line->spans->len;
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (g_array_index (line->spans, WireSpan, mid).lo > along + NODE_EPSILON)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	// no span before it which started earlier than the longest can reach
+	while (lo-- > 0) {
+		WireSpan *span = &g_array_index (line->spans, WireSpan, lo);
+
+		if (span->lo < along - line->longest - NODE_EPSILON)
+			break;
+		if (is_point_on_wire (span->wire, pos))
+			g_ptr_array_add (found, span->wire);
+	}
+}
+
+/**
+ * fills @found with the wires at @pos (including endpoints)
+ */
+static void wire_index_lookup (WireIndex *index, Coords *pos, GPtrArray *found)
+{
+	guint i;
+
+	g_ptr_array_set_size (found, 0);
+	wire_line_lookup (index->rows, pos->y, pos->x, pos, found);
+	wire_line_lookup (index->columns, pos->x, pos->y, pos, found);
+	for (i = 0; i < index->others->len; i++) {
+		Wire *wire = g_ptr_array_index (index->others, i);
+
+		if (is_point_on_wire (wire, pos))
+			g_ptr_array_add (found, wire);
+	}
+}
+
+static void node_store_connect_wires (Node *node, GPtrArray *wires)
+{
+	guint i;
+
+	for (i = 0; i < wires->len; i++) {
+		Wire *wire = g_ptr_array_index (wires, i);
+
+		node_add_wire (node, wire);
+		wire_add_node (wire, node);
+	}
+}
+
+/**
+ * add/register many items at once, as loading a schematic does
+ *
+ * The nodes are built in one pass over all the wires of the store,
+ * which are looked up by their row or column instead of checking each
+ * new wire against all others. Unlike <node_store_add_wire> overlapping
+ * wires are not merged, so this is meant for items which were in a
+ * store before, saved schematics do not contain overlapping wires.
+ *
+ * @param store
+ * @param items parts, wires and textboxes
+ */
+void node_store_add_items (NodeStore *store, GList *items)
+{
+	WireIndex index;
+	GPtrArray *found;
+	GList *iter;
+	gint i;
+
+	g_return_if_fail (store);
+	g_return_if_fail (IS_NODE_STORE (store));
+
+	for (iter = items; iter; iter = iter->next) {
+		ItemData *data = iter->data;
+
+		g_object_set (G_OBJECT (data), "store", store, NULL);
+		if (IS_PART (data)) {
+			Part *part = PART (data);
+			Pin *pins = part_get_pins (part);
+			Coords part_pos;
+
+			item_data_get_pos (data, &part_pos);
+			for (i = 0; i < part_get_num_pins (part); i++) {
+				Coords pin_pos = {part_pos.x + pins[i].offset.x,
+				                  part_pos.y + pins[i].offset.y};
+
+				node_add_pin (node_store_get_or_create_node (store, pin_pos), &pins[i]);
+			}
+			store->parts = g_list_prepend (store->parts, part);
+			store->items = g_list_prepend (store->items, part);
+		} else if (IS_WIRE (data)) {
+			store->wires = g_list_prepend (store->wires, data);
+			store->items = g_list_prepend (store->items, data);
+		} else if (IS_TEXTBOX (data)) {
+			store->textbox = g_list_prepend (store->textbox, data);
+		}
+	}
+
+	// every wire which is already in the store is indexed as well, the
+	// connections are only added where they are missing
+	wire_index_init (&index, store->wires);
+	found = g_ptr_array_new ();
+
+	// wires at a pin
+	for (iter = store->parts; iter; iter = iter->next) {
+		Part *part = iter->data;
+		Pin *pins = part_get_pins (part);
+		Coords part_pos;
+
+		item_data_get_pos (ITEM_DATA (part), &part_pos);
+		for (i = 0; i < part_get_num_pins (part); i++) {
+			Coords pin_pos = {part_pos.x + pins[i].offset.x, part_pos.y + pins[i].offset.y};
+
+			wire_index_lookup (&index, &pin_pos, found);
+			if (found->len > 0)
+				node_store_connect_wires (node_store_get_node (store, pin_pos), found);
+		}
+	}
+
+	// T and L crossings, where the end of a wire is on another one
+	for (iter = store->wires; iter; iter = iter->next) {
+		Coords ends[2];
+
+		wire_get_start_and_end_pos (iter->data, &ends[0], &ends[1]);
+		for (i = 0; i < 2; i++) {
+			wire_index_lookup (&index, &ends[i], found);
+			if (found->len > 1)
+				node_store_connect_wires (node_store_get_or_create_node (store, ends[i]),
+				                          found);
+		}
+	}
+
+	g_ptr_array_free (found, TRUE);
+	wire_index_clear (&index);
+}
+
 /**
  * removes/unregisters a wire from the nodestore
  * this does _not_ free the wire itself!
@@ -89,6 +89,7 @@ gboolean node_store_add_part (NodeStore *store, Part *part);
 gboolean node_store_remove_part (NodeStore *store, Part *part);
 void node_store_remove_overlapping_wires (NodeStore *store, Wire *wire);
 gboolean node_store_add_wire (NodeStore *store, Wire *wire);
+void node_store_add_items (NodeStore *store, GList *items);
 gboolean node_store_remove_wire (NodeStore *store, Wire *wire);
 gboolean node_store_add_textbox (NodeStore *self, Textbox *text);
 gboolean node_store_remove_textbox (NodeStore *self, Textbox *text);
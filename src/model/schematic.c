@@ -49,6 +49,7 @@
 #include "errors.h"
 #include "schematic-print-context.h"
 #include "log.h"
+#include "../autosave.h"
 
 #include "debug.h"
 typedef struct _SchematicsPrintOptions
@@ -89,6 +90,8 @@ struct _SchematicPriv
 	double zoom;
 
 	gboolean dirty;
+	// counts the changes, to tell whether it changed since some point
+	guint changes;
 
 	Log *logstore;
 
@@ -114,6 +117,7 @@ static void schematic_finalize (GObject *object);
 static void schematic_dispose (GObject *object);
 static void item_data_destroy_callback (gpointer s, GObject *data);
 static void item_moved_callback (ItemData *data, Coords *pos, Schematic *sm);
+static void schematic_adopt_item (Schematic *sm, ItemData *data);
 
 static int schematic_get_lowest_available_refdes (Schematic *schematic, char *prefix);
 static void schematic_set_lowest_available_refdes (Schematic *schematic, char *prefix, int num);
@@ -260,6 +264,9 @@ static void schematic_dispose (GObject *object)
 
 	g_clear_object (&schematic->priv->log);
 
+	// closed on purpose, nothing to recover
+	autosave_discard (schematic);
+
 	schematic_count_--;
 	schematic_list = g_list_remove (schematic_list, schematic);
 
@@ -558,6 +565,11 @@ GtkTextBuffer *schematic_get_log_text (Schematic *schematic)
 
 int schematic_count (void) { return schematic_count_; }
 
+/**
+ * @returns the open schematics, owned by the schematics
+ */
+GList *schematic_get_list (void) { return schematic_list; }
+
 Schematic *schematic_read (const char *name, GError **error)
 {
 	Schematic *new_sm;
@@ -620,6 +632,7 @@ gint schematic_save_file (Schematic *sm, GError **error)
 	if (ft->save_func (sm, &e)) {
 		schematic_set_title (sm, g_path_get_basename (sm->priv->filename));
 		schematic_set_dirty (sm, FALSE);
+		autosave_discard (sm);
 		return TRUE;
 	}
 
@@ -637,8 +650,6 @@ gint schematic_save_file (Schematic *sm, GError **error)
 void schematic_add_item (Schematic *sm, ItemData *data)
 {
 	NodeStore *store;
-	char *prefix = NULL, *refdes = NULL;
-	int num;
 
 	g_return_if_fail (sm);
 	g_return_if_fail (IS_SCHEMATIC (sm));
@@ -658,6 +669,42 @@ void schematic_add_item (Schematic *sm, ItemData *data)
 		return;
 	}
 
+	schematic_adopt_item (sm, data);
+}
+
+/**
+ * \brief add many ItemData objects to a Schematic at once
+ *
+ * The items are registered with the node store in one go, see
+ * <node_store_add_items>, which is much faster than adding them one by
+ * one when loading large schematics.
+ *
+ * @param sm the schematic the items will be added to
+ * @param items fully initilalized ItemData objects, in the order they
+ * are added in
+ */
+void schematic_add_items (Schematic *sm, GList *items)
+{
+	GList *iter;
+
+	g_return_if_fail (sm);
+	g_return_if_fail (IS_SCHEMATIC (sm));
+
+	node_store_add_items (sm->priv->store, items);
+
+	for (iter = items; iter; iter = iter->next)
+		schematic_adopt_item (sm, iter->data);
+}
+
+/**
+ * makes a registered item part of the schematic, with a reference
+ * designator and a view
+ */
+static void schematic_adopt_item (Schematic *sm, ItemData *data)
+{
+	char *prefix = NULL, *refdes = NULL;
+	int num;
+
 	// Some items need a reference designator, so get a good one
 	prefix = item_data_get_refdes_prefix (data);
 	if (prefix != NULL) {
@@ -674,6 +721,7 @@ void schematic_add_item (Schematic *sm, ItemData *data)
 	g_object_weak_ref (G_OBJECT (data), item_data_destroy_callback, G_OBJECT (sm));
 
 	sm->priv->dirty = TRUE;
+	sm->priv->changes++;
 
 	// if the item gets moved mark the schematic as dirty
 	g_signal_connect_object (data, "moved", G_CALLBACK (item_moved_callback), sm, 0);
@@ -789,6 +837,16 @@ void schematic_set_dirty (Schematic *sm, gboolean b)
 	g_return_if_fail (IS_SCHEMATIC (sm));
 
 	sm->priv->dirty = b;
+	if (b)
+		sm->priv->changes++;
+}
+
+guint schematic_get_changes (Schematic *sm)
+{
+	g_return_val_if_fail (sm != NULL, 0);
+	g_return_val_if_fail (IS_SCHEMATIC (sm), 0);
+
+	return sm->priv->changes;
 }
 
 static void item_moved_callback (ItemData *data, Coords *pos, Schematic *sm)
@@ -112,6 +112,7 @@ void schematic_set_width (Schematic *schematic, const guint width);
 void schematic_set_height (Schematic *schematic, const guint height);
 void schematic_set_zoom (Schematic *schematic, double zoom);
 void schematic_add_item (Schematic *sm, ItemData *data);
+void schematic_add_items (Schematic *sm, GList *items);
 void schematic_parts_foreach (Schematic *schematic, ForeachItemDataFunc func, gpointer user_data);
 void schematic_wires_foreach (Schematic *schematic, ForeachItemDataFunc func, gpointer user_data);
 void schematic_items_foreach (Schematic *schematic, ForeachItemDataFunc func, gpointer user_data);
@@ -128,8 +129,10 @@ void schematic_log_append_error (Schematic *schematic, const char *message);
 void schematic_log_show (Schematic *schematic);
 GtkTextBuffer *schematic_get_log_text (Schematic *schematic);
 int schematic_count (void);
+GList *schematic_get_list (void);
 gboolean schematic_is_dirty (Schematic *sm);
 void schematic_set_dirty (Schematic *sm, gboolean b);
+guint schematic_get_changes (Schematic *sm);
 gint schematic_save_file (Schematic *sm, GError **error);
 Schematic *schematic_read (const char *fname, GError **error);
 void schematic_print (Schematic *sm, GtkPageSetup *p, GtkPrintSettings *s, gboolean preview);
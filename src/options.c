@@ -7,6 +7,15 @@ OreganoOptions opts = {
 GOptionEntry entries[] = {
     {"version", 0, 0, G_OPTION_ARG_NONE, &(opts.version),
      "Print the version and quit.", NULL},
+    {"batch", 0, 0, G_OPTION_ARG_NONE, &(opts.batch.enabled),
+     "Process the given schematics without a window and quit.", NULL},
+    {"netlist", 0, 0, G_OPTION_ARG_FILENAME, &(opts.batch.netlist),
+     "Write the netlist of each schematic to FILE, or into the directory FILE.", "FILE"},
+    {"simulate", 0, 0, G_OPTION_ARG_NONE, &(opts.batch.simulate),
+     "Simulate each schematic with the configured engine.", NULL},
+    {"export", 0, 0, G_OPTION_ARG_FILENAME, &(opts.batch.export),
+     "Write the simulation results of each schematic as CSV to FILE, or into the directory FILE.",
+     "FILE"},
     {"debug-wires", 0, 0, G_OPTION_ARG_NONE, &(opts.debug.wires),
      "Give them randomly alternating colors.", NULL},
     {"debug-boundingboxes", 0, 0, G_OPTION_ARG_NONE, &(opts.debug.boxes),
@@ -32,7 +41,8 @@ gboolean oregano_options_parse (int *argc, char **argv[], GError **e)
 	GOptionContext *context;
 	context = g_option_context_new ("- electrical engineering tool");
 	g_option_context_add_main_entries (context, entries, GETTEXT_PACKAGE);
-	g_option_context_add_group (context, gtk_get_option_group (TRUE));
+	// the display is opened by gtk_init, which batch mode never calls
+	g_option_context_add_group (context, gtk_get_option_group (FALSE));
 	r = g_option_context_parse (context, argc, argv, &error);
 	if (error) {
 		if (e)
@@ -47,6 +57,18 @@ gboolean oregano_options_parse (int *argc, char **argv[], GError **e)
 
 inline gboolean oregano_options_version () { return opts.version; }
 
+inline gboolean oregano_options_batch () { return opts.batch.enabled; }
+
+inline const gchar *oregano_options_batch_netlist () { return opts.batch.netlist; }
+
+// the results can only be exported after simulating
+inline gboolean oregano_options_batch_simulate ()
+{
+	return opts.batch.simulate || opts.batch.export != NULL;
+}
+
+inline const gchar *oregano_options_batch_export () { return opts.batch.export; }
+
 inline gboolean oregano_options_debug_wires () { return opts.debug.wires || opts.debug.all; }
 
 inline gboolean oregano_options_debug_boxes () { return opts.debug.boxes || opts.debug.all; }
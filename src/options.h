@@ -11,6 +11,13 @@ typedef struct
 {
 	gboolean version;
 	struct
+	{
+		gboolean enabled;
+		gchar *netlist;
+		gboolean simulate;
+		gchar *export;
+	} batch;
+	struct
 	{
 		gboolean wires;
 		gboolean boxes;
@@ -25,6 +32,14 @@ gboolean oregano_options_parse (int *argc, char **argv[], GError **e);
 
 gboolean oregano_options_version ();
 
+gboolean oregano_options_batch ();
+
+const gchar *oregano_options_batch_netlist ();
+
+gboolean oregano_options_batch_simulate ();
+
+const gchar *oregano_options_batch_export ();
+
 gboolean oregano_options_debug_wires ();
 
 gboolean oregano_options_debug_boxes ();
@@ -35,10 +35,12 @@
 #include <glib.h>
 #include <string.h>
 #include <glib/gi18n.h>
+#include <libxml/parser.h>
 
 #include "oregano.h"
 #include "oregano-config.h"
 #include "load-library.h"
+#include "library-index.h"
 #include "dialogs.h"
 #include "engine.h"
 
@@ -52,6 +54,7 @@ void oregano_config_load (void)
 	oregano.settings = g_settings_new ("io.ahoi.oregano");
 	oregano.engine = g_settings_get_int (oregano.settings, "engine");
 	oregano.compress_files = g_settings_get_boolean (oregano.settings, "compress-files");
+	oregano.autosave_interval = g_settings_get_uint (oregano.settings, "autosave-interval");
 	oregano.show_log = g_settings_get_boolean (oregano.settings, "show-log");
 	oregano.show_splash = g_settings_get_boolean (oregano.settings, "show-splash");
 
@@ -60,20 +63,82 @@ void oregano_config_load (void)
 		oregano.engine = 0;
 }
 
+/**
+ * keeps the engine of the configuration if it is installed, otherwise
+ * picks one which is, or sets OREGANO_ENGINE_COUNT if there is none
+ */
+void oregano_config_find_engine (void)
+{
+	guint i;
+	gchar *engine_name;
+
+	// check if the engine loaded from the configuration exists...
+	// otherwise pick up the next one !
+	engine_name = oregano_engine_get_engine_name_by_index (oregano.engine);
+	if (g_find_program_in_path (engine_name) == NULL) {
+		oregano.engine = OREGANO_ENGINE_COUNT;
+		for (i = 0; i < OREGANO_ENGINE_COUNT; i++) {
+			g_free (engine_name);
+			engine_name = oregano_engine_get_engine_name_by_index (i);
+			if (g_find_program_in_path (engine_name) != NULL) {
+				oregano.engine = i;
+			}
+		}
+	}
+	g_free (engine_name);
+}
+
 void oregano_config_save (void)
 {
 	g_settings_set_int (oregano.settings, "engine", oregano.engine);
 	g_settings_set_boolean (oregano.settings, "compress-files", oregano.compress_files);
+	g_settings_set_uint (oregano.settings, "autosave-interval", oregano.autosave_interval);
 	g_settings_set_boolean (oregano.settings, "show-log", oregano.show_log);
 	g_settings_set_boolean (oregano.settings, "show-splash", oregano.show_splash);
 }
 
+typedef struct
+{
+	gchar *fname;
+	Library *library;
+	gboolean done;
+} LibraryJob;
+
+typedef struct
+{
+	GMutex mutex;
+	GCond cond;
+} LibraryJobShared;
+
+static void oregano_parse_library (LibraryJob *job, LibraryJobShared *shared)
+{
+	Library *library = library_load (job->fname);
+
+	g_mutex_lock (&shared->mutex);
+	job->library = library;
+	job->done = TRUE;
+	g_cond_broadcast (&shared->cond);
+	g_mutex_unlock (&shared->mutex);
+}
+
+/**
+ * parses the libraries on a thread pool, each into its own Library,
+ * and appends them to oregano.libraries in the order of the directory,
+ * default.oreglib first
+ *
+ * The splash screen is updated from here, the main thread, while the
+ * libraries are parsed.
+ */
 void oregano_lookup_libraries (Splash *sp)
 {
 	gchar *fname;
 	DIR *libdir;
 	struct dirent *libentry;
-	Library *library;
+	GPtrArray *jobs;
+	GList *names, *iter;
+	GThreadPool *pool;
+	LibraryJobShared shared;
+	guint i;
 
 	oregano.libraries = NULL;
 	libdir = opendir (OREGANO_LIBRARYDIR);
@@ -86,38 +151,87 @@ void oregano_lookup_libraries (Splash *sp)
 		return;
 	}
 
-	fname = g_build_filename (OREGANO_LIBRARYDIR, "default.oreglib", NULL);
+	jobs = g_ptr_array_new ();
 
+	fname = g_build_filename (OREGANO_LIBRARYDIR, "default.oreglib", NULL);
 	if (g_file_test (fname, G_FILE_TEST_EXISTS)) {
-		library = library_parse_xml_file (fname);
-		oregano.libraries = g_list_append (oregano.libraries, library);
+		LibraryJob *job = g_new0 (LibraryJob, 1);
+		job->fname = fname;
+		g_ptr_array_add (jobs, job);
+	} else {
+		g_free (fname);
 	}
-	g_free (fname);
 
+	// sorted by name, names found in several libraries resolve the same
+	// on every launch, see library-index.h
+	names = NULL;
 	while ((libentry = readdir (libdir)) != NULL) {
 		if (is_oregano_library_name (libentry->d_name) &&
-		    strcmp (libentry->d_name, "default.oreglib")) {
-			fname = g_build_filename (OREGANO_LIBRARYDIR, libentry->d_name, NULL);
+		    strcmp (libentry->d_name, "default.oreglib"))
+			names = g_list_prepend (names, g_strdup (libentry->d_name));
+	}
+	closedir (libdir);
+	names = g_list_sort (names, (GCompareFunc)g_strcmp0);
+	for (iter = names; iter; iter = iter->next) {
+		LibraryJob *job = g_new0 (LibraryJob, 1);
+		job->fname = g_build_filename (OREGANO_LIBRARYDIR, iter->data, NULL);
+		g_ptr_array_add (jobs, job);
+	}
+	g_list_free_full (names, g_free);
+
+	// libxml2 sets up its globals once, before it is used by several threads
+	xmlInitParser ();
+
+	g_mutex_init (&shared.mutex);
+	g_cond_init (&shared.cond);
+	pool = g_thread_pool_new ((GFunc)oregano_parse_library, &shared, g_get_num_processors (),
+	                          FALSE, NULL);
+	for (i = 0; i < jobs->len; i++)
+		g_thread_pool_push (pool, g_ptr_array_index (jobs, i), NULL);
+
+	for (i = 0; i < jobs->len; i++) {
+		LibraryJob *job = g_ptr_array_index (jobs, i);
 
-			// do the following only if splash is enabled
-			if (sp) {
-				char txt[50];
-				sprintf (txt, _ ("Loading %s ..."), libentry->d_name);
+		// do the following only if splash is enabled
+		if (sp) {
+			gchar *basename = g_path_get_basename (job->fname);
+			gchar *txt = g_strdup_printf (_ ("Loading %s ..."), basename);
 
+			// keep the splash screen alive until the library is parsed
+			g_mutex_lock (&shared.mutex);
+			while (!job->done) {
+				g_mutex_unlock (&shared.mutex);
 				oregano_splash_step (sp, txt);
+				g_mutex_lock (&shared.mutex);
+				if (!job->done)
+					g_cond_wait_until (&shared.cond, &shared.mutex,
+					                   g_get_monotonic_time () + 50 * G_TIME_SPAN_MILLISECOND);
 			}
+			g_mutex_unlock (&shared.mutex);
 
-			library = library_parse_xml_file (fname);
+			g_free (txt);
+			g_free (basename);
+		} else {
+			g_mutex_lock (&shared.mutex);
+			while (!job->done)
+				g_cond_wait (&shared.cond, &shared.mutex);
+			g_mutex_unlock (&shared.mutex);
+		}
 
-			if (library)
-				oregano.libraries = g_list_append (oregano.libraries, library);
-			else
-				load_library_error (fname);
+		if (job->library) {
+			oregano.libraries = g_list_append (oregano.libraries, job->library);
+			library_index_add (job->library);
+		} else
+			load_library_error (job->fname);
 
-			g_free (fname);
-		}
+		g_free (job->fname);
+		g_free (job);
 	}
-	closedir (libdir);
+
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_ptr_array_free (jobs, TRUE);
+	g_cond_clear (&shared.cond);
+	g_mutex_clear (&shared.mutex);
 }
 
 static gboolean is_oregano_library_name (gchar *name)
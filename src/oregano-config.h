@@ -37,6 +37,7 @@
 
 void oregano_config_load (void);
 void oregano_config_save (void);
+void oregano_config_find_engine (void);
 
 /*
  * Feb 2000, Elker Cavina <e.cavina@libero.it>
@@ -54,6 +54,8 @@
 #include "schematic-view.h"
 #include "cursors.h"
 #include "load-library.h"
+#include "library-index.h"
+#include "autosave.h"
 #include "load-schematic.h"
 #include "load-common.h"
 #include "oregano-config.h"
@@ -81,9 +83,13 @@ static void oregano_finalize (GObject *object)
 
 	cursors_shutdown ();
 
+	autosave_set_interval (0);
+	autosave_flush ();
+
 	g_object_unref (oregano.settings);
 
 	// Free the memory used by the parts libraries
+	library_index_clear ();
 	for (iter = oregano.libraries; iter; iter = iter->next) {
 			l = (Library *) iter->data;
 			g_free (l->name);
@@ -106,28 +112,12 @@ static void oregano_class_init (OreganoClass *klass)
 
 static void oregano_init (Oregano *object)
 {
-	guint i;
-	gchar *engine_name;
-
 	cursors_init ();
 	stock_init ();
 
 	oregano_config_load ();
 
-	// check if the engine loaded from the configuration exists...
-	// otherwise pick up the next one !
-	engine_name = oregano_engine_get_engine_name_by_index (oregano.engine);
-	if (g_find_program_in_path (engine_name) == NULL) {
-		oregano.engine = OREGANO_ENGINE_COUNT;
-		for (i = 0; i < OREGANO_ENGINE_COUNT; i++) {
-			g_free (engine_name);
-			engine_name = oregano_engine_get_engine_name_by_index (i);
-			if (g_find_program_in_path (engine_name) != NULL) {
-				oregano.engine = i;
-			}
-		}
-	}
-	g_free (engine_name);
+	oregano_config_find_engine ();
 
 	// simulation cannot run, disable log
 	if (oregano.engine < 0 || oregano.engine >= OREGANO_ENGINE_COUNT)
@@ -217,6 +207,9 @@ static void oregano_application (GApplication *app, GFile *file)
 	g_signal_add_emission_hook (g_signal_lookup ("last_schematic_destroyed", TYPE_SCHEMATIC), 0,
 	                            quit_hook, NULL, NULL);
 
+	autosave_recover ();
+	autosave_set_interval (oregano.autosave_interval);
+
 	if (oregano.show_splash && splash) {
 		oregano_splash_done (splash, _ ("Welcome to Oregano"));
 	}
@@ -67,6 +67,8 @@ typedef struct
 	GSettings *settings;
 	gint engine;
 	gboolean compress_files;
+	// minutes between autosaves, 0 for none
+	guint autosave_interval;
 	gboolean show_log;
 	gboolean show_splash;
 } OreganoApp;
@@ -39,6 +39,8 @@
 
 #include "oregano.h"
 #include "load-library.h"
+#include "library-cache.h"
+#include "library-search.h"
 #include "schematic.h"
 #include "schematic-view.h"
 #include "part-browser.h"
@@ -60,19 +62,18 @@ struct _Browser
 	GooCanvasGroup *preview;
 	Library *library;
 	gboolean hidden;
-	// Models for the TreeView
+	// Model for the TreeView, a part name and its library per row
 	GtkTreeModel *real_model;
-	GtkTreeModel *sort_model;
-	GtkTreeModel *filter_model;
+	// shows the library of each part while searching all of them
+	GtkTreeViewColumn *library_column;
 	GtkEntry *filter_entry;
-	gint filter_len;
 };
 
 typedef struct
 {
 	Browser *br;
 	SchematicView *schematic_view;
-	char *library_name;
+	Library *library;
 	char *part_name;
 } DndData;
 
@@ -80,8 +81,13 @@ typedef struct
 #define PREVIEW_HEIGHT 100
 #define PREVIEW_TEXT_HEIGHT 25
 
+// search results shown at most, the search is refined rather than scrolled
+#define MAX_SEARCH_ROWS 200
+
+// the parts of all libraries, indexed when first searched
+static LibrarySearch *library_search = NULL;
+
 static void update_preview (Browser *br);
-static void add_part (gpointer key, LibraryPart *part, Browser *br);
 static int part_selected (GtkTreeView *list, GtkTreePath *arg1, GtkTreeViewColumn *col,
                           Browser *br);
 static void part_browser_setup_libs (Browser *br, GtkBuilder *gui);
@@ -89,49 +95,37 @@ static void library_switch_cb (GtkWidget *item, Browser *br);
 static void preview_realized (GtkWidget *widget, Browser *br);
 static void wrap_string (char *str, int width);
 static void place_cmd (GtkWidget *widget, Browser *br);
+static void update_list (Browser *br);
 
-static gboolean part_list_filter_func (GtkTreeModel *model, GtkTreeIter *iter, gpointer data)
+/**
+ * @returns FALSE if no part is selected, otherwise its name, free with
+ * g_free, and its library
+ */
+static gboolean get_selected_part (Browser *br, gchar **part_name, Library **library)
 {
-	char *part_name;
-	const char *s;
-	// Auxiliary parameters shall keep their number in upcase
-	char *comp1, *comp2;
-	Browser *br = (Browser *)data;
-
-	s = gtk_entry_get_text (GTK_ENTRY (br->filter_entry));
-	// Without filter, the part is shown
-	if (s == NULL)
-		return TRUE;
-	if (br->filter_len == 0)
-		return TRUE;
-
-	gtk_tree_model_get (model, iter, 0, &part_name, -1);
-
-	if (part_name) {
-		comp1 = g_utf8_strup (s, -1);
-		comp2 = g_utf8_strup (part_name, -1);
-
-		if (g_strrstr (comp2, comp1)) {
-			g_free (comp1);
-			g_free (comp2);
-			return TRUE;
-		}
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	GtkTreeSelection *selection;
 
-		g_free (comp1);
-		g_free (comp2);
+	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (br->list));
+	if (!GTK_IS_TREE_SELECTION (selection))
+		return FALSE;
+	if (!gtk_tree_selection_get_selected (selection, &model, &iter))
+		return FALSE;
+
+	gtk_tree_model_get (model, &iter, 0, part_name, 1, library, -1);
+
+	// the row telling how many results were left out
+	if (*library == NULL) {
+		g_free (*part_name);
+		return FALSE;
 	}
-	return FALSE;
+	return TRUE;
 }
 
 static int part_search_change (GtkWidget *widget, Browser *br)
 {
-	const char *s = gtk_entry_get_text (GTK_ENTRY (widget));
-
-	if (s) {
-		// Keep record of the filter text length for each item.
-		br->filter_len = strlen (s);
-		gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (br->filter_model));
-	}
+	update_list (br);
 
 	return TRUE;
 }
@@ -156,27 +150,21 @@ static void place_cmd (GtkWidget *widget, Browser *br)
 {
 	LibraryPart *library_part;
 	char *part_name;
+	Library *library;
 	Coords pos;
 	Sheet *sheet;
 	Part *part;
-	GtkTreeModel *model;
-	GtkTreeIter iter;
-	GtkTreeSelection *selection;
 
 	schematic_view_reset_tool (br->schematic_view);
 	sheet = schematic_view_get_sheet (br->schematic_view);
 
 	// Get the current selected row
-	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (br->list));
-	model = gtk_tree_view_get_model (GTK_TREE_VIEW (br->list));
-
-	if (!gtk_tree_selection_get_selected (selection, NULL, &iter)) {
+	if (!get_selected_part (br, &part_name, &library)) {
 		return;
 	}
 
-	gtk_tree_model_get (model, &iter, 0, &part_name, -1);
-
-	library_part = library_get_part (br->library, part_name);
+	library_part = library_get_part (library, part_name);
+	g_free (part_name);
 	part = part_new_from_library_part (library_part);
 	if (!part) {
 		oregano_error (_ ("Unable to load required part"));
@@ -210,25 +198,15 @@ static void update_preview (Browser *br)
 	gdouble scale;
 	cairo_matrix_t transf, affine;
 	gchar *part_name;
+	Library *library;
 	char *description;
-	GtkTreeModel *model;
-	GtkTreeIter iter;
-	GtkTreeSelection *selection;
 
 	// Get the current selected row
-	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (br->list));
-	model = gtk_tree_view_get_model (GTK_TREE_VIEW (br->list));
-
-	if (!GTK_IS_TREE_SELECTION (selection))
-		return;
-
-	if (!gtk_tree_selection_get_selected (selection, NULL, &iter)) {
+	if (!get_selected_part (br, &part_name, &library)) {
 		return;
 	}
 
-	gtk_tree_model_get (model, &iter, 0, &part_name, -1);
-
-	library_part = library_get_part (br->library, part_name);
+	library_part = library_get_part (library, part_name);
 
 	// If there is already a preview part-item, destroy its group and create a
 	// new one.
@@ -303,29 +281,70 @@ static gboolean select_row (GtkTreeView *list, Browser *br)
 	return FALSE;
 }
 
-static void add_part (gpointer key, LibraryPart *part, Browser *br)
+static void add_part (GtkListStore *store, const gchar *name, Library *library)
 {
-	GtkTreeIter iter;
-	GtkListStore *model;
+	gtk_list_store_insert_with_values (store, NULL, -1, 0, name, 1, library, -1);
+}
 
-	g_return_if_fail (part != NULL);
-	g_return_if_fail (part->name != NULL);
-	g_return_if_fail (br != NULL);
-	g_return_if_fail (br->list != NULL);
+static void library_cell_data (GtkTreeViewColumn *column, GtkCellRenderer *cell,
+                               GtkTreeModel *model, GtkTreeIter *iter, gpointer data)
+{
+	Library *library;
 
-	model = GTK_LIST_STORE (br->real_model);
-	gtk_list_store_append (model, &iter);
-	gtk_list_store_set (model, &iter, 0, part->name, -1);
+	gtk_tree_model_get (model, iter, 1, &library, -1);
+	g_object_set (cell, "text", library ? library->name : "", NULL);
 }
 
-// Read the available parts from the library and put them in the browser clist.
+// Read the available parts from the library and put them in the browser clist,
+// or the parts of all libraries which match the search text, up to
+// MAX_SEARCH_ROWS of them.
+// Only the names are needed, the parts themselves are built when selected.
 static void update_list (Browser *br)
 {
-	GtkListStore *model;
+	GtkListStore *store;
+	const gchar *text;
+	gboolean searching;
+
+	// a detached store is filled without updating the view for each row
+	store = gtk_list_store_new (2, G_TYPE_STRING, G_TYPE_POINTER);
+	text = gtk_entry_get_text (br->filter_entry);
+	searching = text && *text;
+
+	if (searching) {
+		GArray *result;
+		guint i;
+
+		if (library_search == NULL)
+			library_search = library_search_new (oregano.libraries);
+		result = library_search_query (library_search, text);
+		for (i = 0; i < MIN (result->len, MAX_SEARCH_ROWS); i++) {
+			guint id = g_array_index (result, guint, i);
+
+			add_part (store, library_search_get_name (library_search, id),
+			          library_search_get_library (library_search, id));
+		}
+		if (result->len > MAX_SEARCH_ROWS) {
+			gchar *more =
+			    g_strdup_printf (_ ("%u more parts..."), result->len - MAX_SEARCH_ROWS);
 
-	model = GTK_LIST_STORE (br->real_model);
-	gtk_list_store_clear (model);
-	g_hash_table_foreach (br->library->part_hash, (GHFunc)add_part, br);
+			add_part (store, more, NULL);
+			g_free (more);
+		}
+	} else if (br->library) {
+		GList *names, *iter;
+
+		names = library_cache_get_part_names (br->library);
+		names = g_list_sort (names, (GCompareFunc)g_utf8_collate);
+		for (iter = names; iter; iter = iter->next)
+			add_part (store, iter->data, br->library);
+		g_list_free (names);
+	}
+
+	gtk_tree_view_column_set_visible (br->library_column, searching);
+	gtk_tree_view_set_model (GTK_TREE_VIEW (br->list), GTK_TREE_MODEL (store));
+	if (br->real_model)
+		g_object_unref (br->real_model);
+	br->real_model = GTK_TREE_MODEL (store);
 }
 
 // Show a part browser. If one already exists, just bring it up, otherwise
@@ -368,7 +387,7 @@ void part_browser_dnd (GtkSelectionData *selection_data, int x, int y)
 
 	snap_to_grid (sheet->grid, &pos.x, &pos.y);
 
-	library_part = library_get_part (data->br->library, data->part_name);
+	library_part = library_get_part (data->library, data->part_name);
 	part = part_new_from_library_part (library_part);
 	if (!part) {
 		oregano_error (_ ("Unable to load required part"));
@@ -387,31 +406,23 @@ static void drag_data_get (GtkWidget *widget, GdkDragContext *context,
                            GtkSelectionData *selection_data, guint info, guint time, Browser *br)
 {
 	DndData *data;
-	GtkTreeSelection *selection;
-	GtkTreeModel *model;
-	GtkTreeIter iter;
+	Library *library;
 	gchar *part_name;
 
 	schematic_view_reset_tool (br->schematic_view);
 
-	data = g_new0 (DndData, 1);
-
-	data->schematic_view = br->schematic_view;
-	data->br = br;
-
-	data->library_name = br->library->name;
-
 	// Get the current selected row
-	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (br->list));
-	model = gtk_tree_view_get_model (GTK_TREE_VIEW (br->list));
-
-	if (!gtk_tree_selection_get_selected (selection, NULL, &iter)) {
+	if (!get_selected_part (br, &part_name, &library)) {
 		// No selection, Action canceled
 		return;
 	}
 
-	gtk_tree_model_get (model, &iter, 0, &part_name, -1);
+	data = g_new0 (DndData, 1);
+
+	data->schematic_view = br->schematic_view;
+	data->br = br;
 
+	data->library = library;
 	data->part_name = part_name;
 
 	gtk_selection_data_set (selection_data, gtk_selection_data_get_target (selection_data), 8,
@@ -502,30 +513,19 @@ GtkWidget *part_browser_create (SchematicView *schematic_view)
 	w = GTK_WIDGET (gtk_builder_get_object (builder, "parts_list"));
 	br->list = w;
 
-	// Create the List Model for TreeView, this is a Real model
-	br->real_model = GTK_TREE_MODEL (gtk_list_store_new (1, G_TYPE_STRING));
+	// The List Model for TreeView is created by update_list, sorted by name
 	cell_text = gtk_cell_renderer_text_new ();
 	cell_column = gtk_tree_view_column_new_with_attributes ("", cell_text, "text", 0, NULL);
 
-	// Create the sort model for the items, this sort the real model
-	br->sort_model = gtk_tree_model_sort_new_with_model (GTK_TREE_MODEL (br->real_model));
-
-	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (br->sort_model), 0,
-	                                      GTK_SORT_ASCENDING);
-
-	// Create the filter sorted model. This filter items based on user
-	//   request for fast item search
-	br->filter_model = gtk_tree_model_filter_new (br->sort_model, NULL);
-	gtk_tree_model_filter_set_visible_func (GTK_TREE_MODEL_FILTER (br->filter_model),
-	                                        part_list_filter_func, br, NULL);
-
-	// If we have TreeFilter use it, if not, just use sorting model only
-	if (br->filter_model)
-		gtk_tree_view_set_model (GTK_TREE_VIEW (w), br->filter_model);
-	else
-		gtk_tree_view_set_model (GTK_TREE_VIEW (w), br->sort_model);
-
 	gtk_tree_view_append_column (GTK_TREE_VIEW (w), cell_column);
+
+	cell_text = gtk_cell_renderer_text_new ();
+	g_object_set (cell_text, "foreground", "gray", NULL);
+	br->library_column = gtk_tree_view_column_new ();
+	gtk_tree_view_column_pack_start (br->library_column, cell_text, TRUE);
+	gtk_tree_view_column_set_cell_data_func (br->library_column, cell_text, library_cell_data,
+	                                         NULL, NULL);
+	gtk_tree_view_append_column (GTK_TREE_VIEW (w), br->library_column);
 	update_list (br);
 
 	// Set up TreeView dnd.
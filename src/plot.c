@@ -48,6 +48,9 @@
 #include "gplotfunction.h"
 #include "gplotlines.h"
 #include "plot-add-function.h"
+#include "simulation-function.h"
+#include "simulation-store.h"
+#include "simulation-column.h"
 
 #define PLOT_PADDING_X 50
 #define PLOT_PADDING_Y 40
@@ -64,6 +67,12 @@
 #define PLOT_CURVE_COLOR "medium sea green"
 #include "debug.h"
 
+// seconds a hidden trace is kept before it is freed
+#define PLOT_TRACE_RELEASE_DELAY 30
+
+// milliseconds between two looks at the results of a running simulation
+#define PLOT_LIVE_INTERVAL 250
+
 static guint next_color = 0;
 static guint next_pulse = 0;
 static guint n_curve_colors = 7;
@@ -104,6 +113,9 @@ typedef struct
 
 	gint selected; // the currently selected plot in the clist
 	gint prev_selected;
+
+	guint release_timeout_id; // frees the traces hidden meanwhile
+	guint live_timeout_id;    // picks up new rows while the simulation runs
 } Plot;
 
 static GtkWidget *plot_window_create (Plot *plot);
@@ -112,6 +124,7 @@ static gint delete_event_cb (GtkWidget *widget, GdkEvent *event, Plot *plot);
 static void plot_canvas_movement (GtkWidget *, GdkEventMotion *, Plot *);
 static void add_function (GtkMenuItem *menuitem, Plot *plot);
 static void close_window (GtkMenuItem *menuitem, Plot *plot);
+static void plot_live_stop (Plot *plot);
 
 static gchar *get_variable_units (gchar *str)
 {
@@ -140,6 +153,9 @@ static gchar *get_variable_units (gchar *str)
 
 static gint delete_event_cb (GtkWidget *widget, GdkEvent *event, Plot *plot)
 {
+	if (plot->release_timeout_id != 0)
+		g_source_remove (plot->release_timeout_id);
+	plot_live_stop (plot);
 	plot->window = NULL;
 	g_object_unref (plot->sim);
 	g_free (plot->ytitle);
@@ -151,6 +167,9 @@ static gint delete_event_cb (GtkWidget *widget, GdkEvent *event, Plot *plot)
 // Call this to close the plot window
 static void destroy_window (GtkWidget *widget, Plot *plot)
 {
+	if (plot->release_timeout_id != 0)
+		g_source_remove (plot->release_timeout_id);
+	plot_live_stop (plot);
 	gtk_widget_destroy (plot->canvas);
 	gtk_widget_destroy (plot->coord);
 	gtk_widget_destroy (plot->combo_box);
@@ -162,6 +181,41 @@ static void destroy_window (GtkWidget *widget, Plot *plot)
 	plot = NULL;
 }
 
+static GPlotFunction *create_plot_function_from_simulation_data (guint i, SimulationData *current,
+                                                                 const gchar *color);
+
+static gboolean release_hidden_trace (GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter,
+                                      Plot *plot)
+{
+	GPlotFunction *f;
+	gboolean visible;
+	gint variable;
+
+	gtk_tree_model_get (model, iter, 0, &visible, 4, &f, 5, &variable, -1);
+	// functions can not be recreated, only traces of variables are freed
+	if (f && !visible && variable > 0) {
+		g_plot_remove_function (GPLOT (plot->plot), f);
+		gtk_tree_store_set (GTK_TREE_STORE (model), iter, 4, NULL, -1);
+	}
+	return FALSE;
+}
+
+static gboolean release_hidden_traces (Plot *plot)
+{
+	GtkTreeView *treeview;
+
+	treeview = GTK_TREE_VIEW (g_object_get_data (G_OBJECT (plot->window), "clist"));
+	gtk_tree_model_foreach (gtk_tree_view_get_model (treeview),
+	                        (GtkTreeModelForeachFunc)release_hidden_trace, plot);
+
+	plot->release_timeout_id = 0;
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Traces of variables are only created once they are shown for the
+ * first time, and freed after they have been hidden for a while.
+ */
 static void on_plot_selected (GtkCellRendererToggle *cell_renderer, gchar *path, Plot *plot)
 {
 	GPlotFunction *f;
@@ -169,6 +223,8 @@ static void on_plot_selected (GtkCellRendererToggle *cell_renderer, gchar *path,
 	GtkTreeModel *model;
 	GtkTreeView *treeview;
 	gboolean visible = FALSE;
+	gint variable;
+	gchar *color;
 
 	treeview = GTK_TREE_VIEW (g_object_get_data (G_OBJECT (plot->window), "clist"));
 
@@ -176,46 +232,68 @@ static void on_plot_selected (GtkCellRendererToggle *cell_renderer, gchar *path,
 	if (!gtk_tree_model_get_iter_from_string (model, &iter, path))
 		return;
 
-	gtk_tree_model_get (model, &iter, 0, &visible, 4, &f, -1);
+	gtk_tree_model_get (model, &iter, 0, &visible, 4, &f, 5, &variable, -1);
 	visible = !visible;
 	gtk_tree_store_set (GTK_TREE_STORE (model), &iter, 0, visible, -1);
 
-	g_object_set (G_OBJECT (f), "visible", visible, NULL);
+	if (!f && visible && variable > 0 && plot->current) {
+		gtk_tree_model_get (model, &iter, 3, &color, -1);
+		f = create_plot_function_from_simulation_data (variable, plot->current, color);
+		g_free (color);
+		g_plot_add_function (GPLOT (plot->plot), f);
+		gtk_tree_store_set (GTK_TREE_STORE (model), &iter, 4, f, -1);
+	}
+
+	if (f)
+		g_object_set (G_OBJECT (f), "visible", visible, NULL);
+
+	if (!visible) {
+		if (plot->release_timeout_id != 0)
+			g_source_remove (plot->release_timeout_id);
+		plot->release_timeout_id = g_timeout_add_seconds (
+		    PLOT_TRACE_RELEASE_DELAY, (GSourceFunc)release_hidden_traces, plot);
+	}
 
 	gtk_widget_queue_draw (plot->plot);
 }
 
-static GPlotFunction *create_plot_function_from_simulation_data (guint i, SimulationData *current)
+static GPlotFunction *create_plot_function_from_simulation_data (guint i, SimulationData *current,
+                                                                 const gchar *color)
 {
 	GPlotFunction *f;
-	double *X;
-	double *Y;
-	guint len, j;
 	gdouble width = 1;
 	GraphicType graphic_type = FUNCTIONAL_CURVE;
 	gdouble shift_step = 0;
 
-	len = current->data[i]->len;
-	X = g_new0 (double, len);
-	Y = g_new0 (double, len);
-
-	for (j = 0; j < len; j++) {
-		Y[j] = g_array_index (current->data[i], double, j);
-		X[j] = g_array_index (current->data[0], double, j);
-	}
 	if (current->type == ANALYSIS_TYPE_FOURIER) {
 		graphic_type = FREQUENCY_PULSE;
-		next_pulse++;
+		// traces are created in any order, so the variable decides the shift
+		next_pulse = i;
 		width = 5.0;
-		shift_step = X[1] / 20;
+		guint len;
+		const gdouble *x = simulation_data_get_column (current, 0, &len);
+
+		if (len > 1)
+			shift_step = x[1] / 20;
 		NG_DEBUG ("shift_step = %lf\n", shift_step);
 	} else {
 		next_pulse = 0;
 		width = 1.0;
 	}
 
-	f = g_plot_lines_new (X, Y, len);
-	g_object_set (G_OBJECT (f), "color", plot_curve_colors[(next_color++) % n_curve_colors], NULL);
+	// the columns are shared with the simulation data, compact ones are
+	// decoded: x once for all traces, y for as long as the trace lives
+	if (current->mapped) {
+		f = g_plot_lines_new_from_bytes (current->mapped[0], current->mapped[i]);
+	} else {
+		GArray *x = simulation_data_decode_column (current, 0, TRUE);
+		GArray *y = simulation_data_decode_column (current, i, FALSE);
+
+		f = g_plot_lines_new_from_columns (x, y);
+		g_array_unref (x);
+		g_array_unref (y);
+	}
+	g_object_set (G_OBJECT (f), "color", color, NULL);
 	g_object_set (G_OBJECT (f), "graph-type", graphic_type, NULL);
 	g_object_set (G_OBJECT (f), "shift", shift_step * next_pulse, NULL);
 	g_object_set (G_OBJECT (f), "width", width, NULL);
@@ -224,17 +302,28 @@ static GPlotFunction *create_plot_function_from_simulation_data (guint i, Simula
 	return f;
 }
 
+static void append_variable (GtkTreeModel *model, GtkTreeIter *parent_nodes,
+                             SimulationData *current, gint i)
+{
+	GtkTreeIter iter;
+	//FIXME extra axis scaling for current/voltage
+	//FIXME or extra plot window for current/voltage
+	//FIXME or extra analysis for current/voltage
+	const gchar *color = plot_curve_colors[(next_color++) % n_curve_colors];
+
+	gtk_tree_store_append (GTK_TREE_STORE (model), &iter, parent_nodes);
+	gtk_tree_store_set (GTK_TREE_STORE (model), &iter, 0, FALSE, 1, current->var_names[i], 2, TRUE,
+	                    3, color, 4, NULL, 5, i, -1);
+}
+
+static void plot_set_current (Plot *plot, SimulationData *current);
+
 static void analysis_selected (GtkWidget *combo_box, Plot *plot)
 {
-	int i;
 	const gchar *ca;
-	GtkTreeView *list;
-	GtkTreeModel *model;
-	GtkTreeIter parent_nodes, parent_functions;
 	GList *analysis;
 	SimulationData *sdat;
 
-	list = GTK_TREE_VIEW (g_object_get_data (G_OBJECT (plot->window), "clist"));
 	if (gtk_combo_box_get_active (GTK_COMBO_BOX (combo_box)) == -1) {
 		// Simulation failed?
 		g_warning (_ ("The simulation produced no data!!\n"));
@@ -261,6 +350,22 @@ static void analysis_selected (GtkWidget *combo_box, Plot *plot)
 		return;
 	}
 
+	plot_set_current (plot, plot->current);
+}
+
+/**
+ * lists the variables of an analysis, nothing is plotted yet
+ */
+static void plot_set_current (Plot *plot, SimulationData *current)
+{
+	int i;
+	GtkTreeView *list;
+	GtkTreeModel *model;
+	GtkTreeIter parent_nodes, parent_functions;
+
+	list = GTK_TREE_VIEW (g_object_get_data (G_OBJECT (plot->window), "clist"));
+	plot->current = current;
+
 	g_free (plot->xtitle);
 	plot->xtitle = get_variable_units (plot->current->var_units[0]);
 	g_free (plot->ytitle);
@@ -288,36 +393,9 @@ static void analysis_selected (GtkWidget *combo_box, Plot *plot)
 	g_plot_set_axis_labels (GPLOT (plot->plot), plot->xtitle, plot->ytitle);
 	g_plot_clear (GPLOT (plot->plot));
 
-	for (i = 1; i < plot->current->n_variables; i++) {
-		GtkTreeIter iter;
-		GPlotFunction *f;
-		if (plot->current->type != ANALYSIS_TYPE_DC_TRANSFER) {
-			//FIXME extra axis scaling for current/voltage
-			//FIXME or extra plot window for current/voltage
-			//FIXME or extra analysis for current/voltage
-			gchar *color;
-
-			f = create_plot_function_from_simulation_data (i, plot->current);
-			g_object_set (G_OBJECT (f), "visible", FALSE, NULL);
-			g_object_get (G_OBJECT (f), "color", &color, NULL);
-
-			g_plot_add_function (GPLOT (plot->plot), f);
-			gtk_tree_store_append (GTK_TREE_STORE (model), &iter, &parent_nodes);
-			gtk_tree_store_set (GTK_TREE_STORE (model), &iter, 0, FALSE, 1,
-			                    plot->current->var_names[i], 2, TRUE, 3, color, 4, f, -1);
-		} else {
-			gchar *color;
-
-			f = create_plot_function_from_simulation_data (i, plot->current);
-			g_object_set (G_OBJECT (f), "visible", FALSE, NULL);
-			g_object_get (G_OBJECT (f), "color", &color, NULL);
-
-			g_plot_add_function (GPLOT (plot->plot), f);
-			gtk_tree_store_append (GTK_TREE_STORE (model), &iter, &parent_nodes);
-			gtk_tree_store_set (GTK_TREE_STORE (model), &iter, 0, FALSE, 1,
-			                    plot->current->var_names[i], 2, TRUE, 3, color, 4, f, -1);
-		}
-	}
+	// the traces are created once they are ticked, see on_plot_selected
+	for (i = 1; i < plot->current->n_variables; i++)
+		append_variable (model, &parent_nodes, plot->current, i);
 	gtk_widget_queue_draw (plot->plot);
 }
 
@@ -425,8 +503,9 @@ static GtkWidget *plot_window_create (Plot *plot)
 	g_signal_connect (G_OBJECT (button), "clicked", G_CALLBACK (destroy_window), plot);
 
 	list = GTK_TREE_VIEW (gtk_builder_get_object (gui, "variable_list"));
-	tree_model = gtk_tree_store_new (5, G_TYPE_BOOLEAN, G_TYPE_STRING, G_TYPE_BOOLEAN,
-	                                 G_TYPE_STRING, G_TYPE_POINTER);
+	// visible, name, has toggle, color, GPlotFunction or NULL, variable index or 0
+	tree_model = gtk_tree_store_new (6, G_TYPE_BOOLEAN, G_TYPE_STRING, G_TYPE_BOOLEAN,
+	                                 G_TYPE_STRING, G_TYPE_POINTER, G_TYPE_INT);
 
 	// One Column with 2 CellRenderer. First the Toggle and next a Text
 	column = gtk_tree_view_column_new ();
@@ -467,31 +546,9 @@ static GtkWidget *plot_window_create (Plot *plot)
 	return window;
 }
 
-int plot_show (OreganoEngine *engine)
+static Plot *plot_new (OreganoEngine *engine)
 {
-	GList *analysis = NULL;
-	GList *analysis_backup = NULL;
 	Plot *plot;
-	gchar *str = NULL;
-	gchar *s_current = NULL;
-	SimulationData *first = NULL;
-	SimulationData *sdat = NULL;
-	gboolean abort = TRUE;
-
-	g_return_val_if_fail (engine != NULL, FALSE);
-
-	// Get the analysis we have
-	analysis = analysis_backup = oregano_engine_get_results (engine);
-
-	for (; analysis; analysis = analysis->next) {
-		sdat = SIM_DATA (analysis->data);
-		str = oregano_engine_get_analysis_name (sdat);
-		if (sdat->type != ANALYSIS_TYPE_OP_POINT)
-			abort = FALSE;
-	}
-
-	if (abort)
-		return FALSE;
 
 	plot = g_new0 (Plot, 1);
 
@@ -509,31 +566,212 @@ int plot_show (OreganoEngine *engine)
 
 	next_color = 0;
 
-	for (; analysis_backup; analysis_backup = analysis_backup->next) {
-		sdat = SIM_DATA (analysis_backup->data);
-		str = oregano_engine_get_analysis_name (sdat);
+	return plot;
+}
+
+/**
+ * @returns FALSE if there is nothing but operating points to plot
+ */
+static gboolean has_plottable_analysis (OreganoEngine *engine)
+{
+	GList *analysis;
+
+	for (analysis = oregano_engine_get_results (engine); analysis; analysis = analysis->next)
+		if (SIM_DATA (analysis->data)->type != ANALYSIS_TYPE_OP_POINT)
+			return TRUE;
+	return FALSE;
+}
+
+/**
+ * offers the finished analyses of the engine and shows the first one
+ */
+static void plot_fill_analyses (Plot *plot)
+{
+	GList *analysis = NULL;
+	gchar *str = NULL;
+	gchar *s_current = NULL;
+	SimulationData *first = NULL;
+	SimulationData *sdat = NULL;
+
+	gtk_combo_box_text_remove_all (GTK_COMBO_BOX_TEXT (plot->combo_box));
+
+	for (analysis = oregano_engine_get_results (plot->sim); analysis; analysis = analysis->next) {
+		sdat = SIM_DATA (analysis->data);
 		if (sdat->type == ANALYSIS_TYPE_OP_POINT) {
 			continue;
 		}
+		str = oregano_engine_get_analysis_name (sdat);
 
 		if (s_current == NULL) {
-			s_current = str;
+			s_current = g_strdup (str);
 			first = sdat;
 		}
 
 		gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (plot->combo_box), str);
 		gtk_combo_box_set_active (GTK_COMBO_BOX (plot->combo_box), 0);
+		g_free (str);
 	}
 
 	g_signal_connect (G_OBJECT (plot->combo_box), "changed", G_CALLBACK (analysis_selected), plot);
 
+	g_free (plot->title);
 	plot->title = g_strdup_printf (_ ("Plot - %s"), s_current);
+	g_free (plot->xtitle);
 	plot->xtitle = get_variable_units (first ? first->var_units[0] : "##");
+	g_free (plot->ytitle);
 	plot->ytitle = get_variable_units (first ? first->var_units[1] : "!!");
 
 	g_free (s_current);
 
 	analysis_selected ((plot->combo_box), plot);
+}
+
+int plot_show (OreganoEngine *engine)
+{
+	Plot *plot;
+
+	g_return_val_if_fail (engine != NULL, FALSE);
+
+	if (!has_plottable_analysis (engine))
+		return FALSE;
+
+	plot = plot_new (engine);
+	plot_fill_analyses (plot);
+
+	return TRUE;
+}
+
+static void plot_live_stop (Plot *plot)
+{
+	if (plot->live_timeout_id != 0) {
+		g_source_remove (plot->live_timeout_id);
+		plot->live_timeout_id = 0;
+	}
+	g_signal_handlers_disconnect_by_data (plot->sim, plot);
+}
+
+/**
+ * adds the variables which showed up since the last look and lets the
+ * traces pick up the new rows of their columns
+ */
+static gboolean plot_live_update (Plot *plot)
+{
+	GtkTreeView *treeview;
+	GtkTreeModel *model;
+	GtkTreeIter parent_nodes, iter;
+	SimulationData *current;
+	GPlotFunction *f;
+	gboolean grew;
+	gint i;
+
+	current = oregano_engine_get_live_results (plot->sim, &grew);
+	if (!grew || current != plot->current)
+		return G_SOURCE_CONTINUE;
+
+	treeview = GTK_TREE_VIEW (g_object_get_data (G_OBJECT (plot->window), "clist"));
+	model = gtk_tree_view_get_model (treeview);
+	if (!gtk_tree_model_get_iter_first (model, &parent_nodes))
+		return G_SOURCE_CONTINUE;
+
+	for (i = gtk_tree_model_iter_n_children (model, &parent_nodes) + 1; i < current->n_variables;
+	     i++)
+		append_variable (model, &parent_nodes, current, i);
+
+	if (gtk_tree_model_iter_children (model, &iter, &parent_nodes)) {
+		do {
+			gtk_tree_model_get (model, &iter, 4, &f, -1);
+			if (f)
+				g_plot_lines_update_columns (f);
+		} while (gtk_tree_model_iter_next (model, &iter));
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * the simulation finished, the window moves over to the complete
+ * results and shows the variables again which were ticked meanwhile
+ */
+static void plot_live_done (OreganoEngine *engine, Plot *plot)
+{
+	GtkTreeView *treeview;
+	GtkTreeModel *model;
+	GtkTreeIter parent_nodes, iter;
+	GHashTable *shown;
+	gboolean visible;
+	gchar *name;
+
+	plot_live_stop (plot);
+
+	if (!has_plottable_analysis (engine))
+		return;
+
+	treeview = GTK_TREE_VIEW (g_object_get_data (G_OBJECT (plot->window), "clist"));
+	model = gtk_tree_view_get_model (treeview);
+
+	shown = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	if (gtk_tree_model_get_iter_first (model, &parent_nodes) &&
+	    gtk_tree_model_iter_children (model, &iter, &parent_nodes)) {
+		do {
+			gtk_tree_model_get (model, &iter, 0, &visible, 1, &name, -1);
+			if (visible)
+				g_hash_table_add (shown, name);
+			else
+				g_free (name);
+		} while (gtk_tree_model_iter_next (model, &iter));
+	}
+
+	plot_fill_analyses (plot);
+
+	if (gtk_tree_model_get_iter_first (model, &parent_nodes) &&
+	    gtk_tree_model_iter_children (model, &iter, &parent_nodes)) {
+		do {
+			gtk_tree_model_get (model, &iter, 1, &name, -1);
+			if (g_hash_table_contains (shown, name)) {
+				gchar *path = gtk_tree_model_get_string_from_iter (model, &iter);
+				on_plot_selected (NULL, path, plot);
+				g_free (path);
+			}
+			g_free (name);
+		} while (gtk_tree_model_iter_next (model, &iter));
+	}
+	g_hash_table_destroy (shown);
+}
+
+/**
+ * \brief opens a plot window on the transient analysis of a running simulation
+ *
+ * The window grows with the results and switches to the complete ones
+ * once the engine is done.
+ *
+ * @returns FALSE if the engine has no partial results (yet)
+ */
+int plot_show_live (OreganoEngine *engine)
+{
+	SimulationData *current;
+	Plot *plot;
+	gboolean grew;
+	gchar *name;
+
+	g_return_val_if_fail (engine != NULL, FALSE);
+
+	current = oregano_engine_get_live_results (engine, &grew);
+	if (current == NULL)
+		return FALSE;
+
+	plot = plot_new (engine);
+
+	name = oregano_engine_get_analysis_name (current);
+	gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (plot->combo_box), name);
+	gtk_combo_box_set_active (GTK_COMBO_BOX (plot->combo_box), 0);
+	g_free (name);
+
+	plot_set_current (plot, current);
+
+	plot->live_timeout_id =
+	    g_timeout_add (PLOT_LIVE_INTERVAL, (GSourceFunc)plot_live_update, plot);
+	g_signal_connect (G_OBJECT (engine), "done", G_CALLBACK (plot_live_done), plot);
+	g_signal_connect_swapped (G_OBJECT (engine), "aborted", G_CALLBACK (plot_live_stop), plot);
 
 	return TRUE;
 }
@@ -542,38 +780,13 @@ static GPlotFunction *create_plot_function_from_data (SimulationFunction *func,
                                                       SimulationData *current)
 {
 	GPlotFunction *f;
-	double *X;
-	double *Y;
-	double data;
-	guint j, len;
+	GArray *x, *y;
 	GraphicType graphic_type = FUNCTIONAL_CURVE;
 	gdouble width = 1.0;
 
-	len = current->data[func->first]->len;
-	X = g_new0 (double, len);
-	Y = g_new0 (double, len);
-
-	for (j = 0; j < len; j++) {
-		Y[j] = g_array_index (current->data[func->first], double, j);
-
-		data = g_array_index (current->data[func->second], double, j);
-		switch (func->type) {
-		case FUNCTION_SUBTRACT:
-			Y[j] -= data;
-			break;
-		case FUNCTION_DIVIDE:
-			if (data < 0.000001f) {
-				if (Y[j] < 0)
-					Y[j] = -G_MAXDOUBLE;
-				else
-					Y[j] = G_MAXDOUBLE;
-			} else {
-				Y[j] /= data;
-			}
-		}
+	if (!simulation_function_evaluate (func, current, &x, &y))
+		return NULL;
 
-		X[j] = g_array_index (current->data[0], double, j);
-	}
 	if (current->type == ANALYSIS_TYPE_FOURIER) {
 		graphic_type = FREQUENCY_PULSE;
 		next_pulse++;
@@ -583,7 +796,10 @@ static GPlotFunction *create_plot_function_from_data (SimulationFunction *func,
 		width = 1.0;
 	}
 
-	f = g_plot_lines_new (X, Y, len);
+	// only the derived y values are new, x is usually shared with the simulation data
+	f = g_plot_lines_new_from_columns (x, y);
+	g_array_unref (x);
+	g_array_unref (y);
 	g_object_set (G_OBJECT (f), "color", plot_curve_colors[(next_color++) % n_curve_colors],
 	              "graph-type", graphic_type, "shift", 50.0 * next_pulse, "width", width, NULL);
 
@@ -599,8 +815,9 @@ static void add_function (GtkMenuItem *menuitem, Plot *plot)
 {
 	GtkTreeView *tree;
 	GtkTreeModel *model;
-	GtkTreeIter iter;
+	GtkTreeIter iter, child;
 	GtkTreePath *path;
+	GPlotFunction *f;
 	GList *lst;
 	gchar *color;
 
@@ -613,6 +830,14 @@ static void add_function (GtkMenuItem *menuitem, Plot *plot)
 	gtk_tree_model_get_iter (model, &iter, path);
 	gtk_tree_path_free (path);
 
+	// the functions are all built again below
+	if (gtk_tree_model_iter_children (model, &child, &iter)) {
+		do {
+			gtk_tree_model_get (model, &child, 4, &f, -1);
+			if (f)
+				g_plot_remove_function (GPLOT (plot->plot), f);
+		} while (gtk_tree_model_iter_next (model, &child));
+	}
 	gtk_tree_store_remove (GTK_TREE_STORE (model), &iter);
 
 	gtk_tree_store_append (GTK_TREE_STORE (model), &iter, NULL);
@@ -621,29 +846,16 @@ static void add_function (GtkMenuItem *menuitem, Plot *plot)
 
 	lst = plot->current->functions;
 	while (lst) {
-		GPlotFunction *f;
-		GtkTreeIter child;
-		int i;
-		gchar *str = NULL, *name1 = NULL, *name2 = NULL;
+		gchar *str;
 		SimulationFunction *func = (SimulationFunction *)lst->data;
 
-		for (i = 1; i < plot->current->n_variables; i++) {
-			if (func->first == i) {
-				name1 = g_strdup (plot->current->var_names[i]);
-			}
-			if (func->second == i) {
-				name2 = g_strdup (plot->current->var_names[i]);
-			}
-		}
-		switch (func->type) {
-		case FUNCTION_SUBTRACT:
-			str = g_strdup_printf ("%s - %s", name1, name2);
-			break;
-		case FUNCTION_DIVIDE:
-			str = g_strdup_printf ("%s(%s, %s)", _ ("TRANSFER"), name1, name2);
-		}
-
 		f = create_plot_function_from_data (func, plot->current);
+		if (!f) {
+			g_warning ("Could not compute the function, is x sorted?");
+			lst = lst->next;
+			continue;
+		}
+		str = simulation_function_get_label (func, plot->current);
 		g_object_get (G_OBJECT (f), "color", &color, NULL);
 
 		g_plot_add_function (GPLOT (plot->plot), f);
@@ -651,6 +863,8 @@ static void add_function (GtkMenuItem *menuitem, Plot *plot)
 		gtk_tree_store_append (GTK_TREE_STORE (model), &child, &iter);
 		gtk_tree_store_set (GTK_TREE_STORE (model), &child, 0, TRUE, 1, str, 2, TRUE, 3, color, 4,
 		                    f, -1);
+		g_free (str);
+		g_free (color);
 
 		lst = lst->next;
 	}
@@ -36,5 +36,6 @@
 #include "engine.h"
 
 int plot_show (OreganoEngine *engine);
+int plot_show_live (OreganoEngine *engine);
 
 #endif
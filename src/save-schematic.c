@@ -34,7 +34,9 @@
  * Boston, MA 02110-1301, USA.
  */
 
-#include "xml-compat.h"
+#include <string.h>
+#include <gio/gio.h>
+
 #include "oregano.h"
 #include "schematic.h"
 #include "coords.h"
@@ -47,517 +49,1084 @@
 #include "sim-settings.h"
 #include "node-store.h"
 #include "save-schematic.h"
-#include "xml-helper.h"
+#include "schematic-binary.h"
 
 #include "debug.h"
 
+// bytes collected before they are written to the stream
+#define SAVE_SCHEMATIC_BUFFER_SIZE (64 * 1024)
+
+#define SAVE_SCHEMATIC_NS "https://beerbach.me/project/oregano/ns/v1"
+
+/*
+ * Writes a schematic element by element, in the
+ * layout libxml2 gives a document saved with formatting, so files do
+ * not change with the writer.
+ */
 typedef struct
 {
-	xmlDocPtr doc; // Xml document.
-	xmlNsPtr ns;   // Main namespace.
+	GOutputStream *out;
+	GString *buf;
+	gint depth;
+	// an element has been started, but not yet closed with '>'
+	gboolean open;
+	// the segments of the wire being written
+	GArray *points;
+	GError *error;
+} SaveContext;
+
+static void save_flush (SaveContext *ctxt)
+{
+	// a buffer without a stream is kept as a whole
+	if (ctxt->out == NULL)
+		return;
+	if (ctxt->error == NULL && ctxt->buf->len > 0)
+		g_output_stream_write_all (ctxt->out, ctxt->buf->str, ctxt->buf->len, NULL, NULL,
+		                           &ctxt->error);
+	g_string_truncate (ctxt->buf, 0);
+}
+
+static void save_indent (SaveContext *ctxt)
+{
+	gint i;
+
+	if (ctxt->open) {
+		g_string_append (ctxt->buf, ">\n");
+		ctxt->open = FALSE;
+	}
+	for (i = 0; i < ctxt->depth; i++)
+		g_string_append (ctxt->buf, "  ");
+}
+
+/**
+ * escapes text content as libxml2 does without an output encoding,
+ * characters outside of ASCII become character references
+ */
+static void save_escape (GString *buf, const gchar *text)
+{
+	const gchar *p = text;
+
+	while (*p) {
+		guchar c = *p;
+
+		if (c == '<') {
+			g_string_append (buf, "&lt;");
+		} else if (c == '>') {
+			g_string_append (buf, "&gt;");
+		} else if (c == '&') {
+			g_string_append (buf, "&amp;");
+		} else if ((c >= 0x20 && c < 0x80) || c == '\n' || c == '\t') {
+			g_string_append_c (buf, c);
+		} else if (c == '\r') {
+			g_string_append (buf, "&#xD;");
+		} else if (c >= 0x80) {
+			gunichar u = g_utf8_get_char_validated (p, -1);
+
+			if (u == (gunichar)-1 || u == (gunichar)-2) {
+				g_warning ("Skipping invalid UTF-8 while saving: %s", text);
+				p++;
+				continue;
+			}
+			g_string_append_printf (buf, "&#x%X;", u);
+			p = g_utf8_next_char (p);
+			continue;
+		}
+		// other control characters are not allowed in XML
+		p++;
+	}
+}
 
-	xmlNodePtr node_symbols; // For saving of symbols.
-	xmlNodePtr node_parts;   // For saving of parts.
-	xmlNodePtr node_props;   // For saving of properties.
-	xmlNodePtr node_labels;  // For saving of labels.
-	xmlNodePtr node_wires;   // For saving of wires.
-	xmlNodePtr node_textboxes;
-} parseXmlContext;
+// starts an element which has elements inside
+static void save_start (SaveContext *ctxt, const gchar *name)
+{
+	save_indent (ctxt);
+	g_string_append_printf (ctxt->buf, "<ogo:%s", name);
+	ctxt->open = TRUE;
+	ctxt->depth++;
+}
 
-static void write_xml_sim_settings (xmlNodePtr cur, parseXmlContext *ctxt, Schematic *sm)
+static void save_end (SaveContext *ctxt, const gchar *name)
 {
-	xmlNodePtr sim_settings_node, child, analysis, options;
+	ctxt->depth--;
+	if (ctxt->open) {
+		// nothing inside
+		g_string_append (ctxt->buf, "/>\n");
+		ctxt->open = FALSE;
+	} else {
+		save_indent (ctxt);
+		g_string_append_printf (ctxt->buf, "</ogo:%s>\n", name);
+	}
+
+	if (ctxt->buf->len >= SAVE_SCHEMATIC_BUFFER_SIZE)
+		save_flush (ctxt);
+}
+
+// writes an element with text inside, an element without text is empty
+static void save_text (SaveContext *ctxt, const gchar *name, const gchar *text)
+{
+	save_indent (ctxt);
+	if (text == NULL || *text == '\0') {
+		g_string_append_printf (ctxt->buf, "<ogo:%s/>\n", name);
+		return;
+	}
+	g_string_append_printf (ctxt->buf, "<ogo:%s>", name);
+	save_escape (ctxt->buf, text);
+	g_string_append_printf (ctxt->buf, "</ogo:%s>\n", name);
+}
+
+static void save_printf (SaveContext *ctxt, const gchar *name, const gchar *format, ...)
+    G_GNUC_PRINTF (3, 4);
+
+static void save_printf (SaveContext *ctxt, const gchar *name, const gchar *format, ...)
+{
+	va_list args;
 	gchar *str;
+
+	va_start (args, format);
+	str = g_strdup_vprintf (format, args);
+	va_end (args);
+
+	save_text (ctxt, name, str);
+	g_free (str);
+}
+
+static void save_bool (SaveContext *ctxt, const gchar *name, gboolean value)
+{
+	save_text (ctxt, name, value ? "true" : "false");
+}
+
+static void write_xml_sim_settings (SaveContext *ctxt, Schematic *sm)
+{
 	SimSettings *s;
 	SimOption *so;
 	GList *list;
 
 	s = schematic_get_sim_settings (sm);
 
-	sim_settings_node = xmlNewChild (cur, ctxt->ns, BAD_CAST "simulation-settings", NULL);
-	if (!sim_settings_node) {
-		g_warning ("Failed during save of simulation settings.\n");
-		return;
-	}
+	save_start (ctxt, "simulation-settings");
 
 	// Transient analysis
-	analysis = xmlNewChild (sim_settings_node, ctxt->ns, BAD_CAST "transient", NULL);
-	if (!analysis) {
-		g_warning ("Failed during save of transient analysis settings.\n");
-		return;
+	save_start (ctxt, "transient");
+	save_bool (ctxt, "enabled", sim_settings_get_trans (s));
+	save_printf (ctxt, "start", "%g", sim_settings_get_trans_start (s));
+	save_printf (ctxt, "stop", "%g", sim_settings_get_trans_stop (s));
+	save_printf (ctxt, "step", "%g", sim_settings_get_trans_step (s));
+	save_bool (ctxt, "step-enabled", sim_settings_get_trans_step_enable (s));
+	save_bool (ctxt, "init-conditions", sim_settings_get_trans_init_cond (s));
+	save_bool (ctxt, "analyze-all", sim_settings_get_trans_analyze_all (s));
+	save_bool (ctxt, "compact", sim_settings_get_trans_compact (s));
+	save_end (ctxt, "transient");
+
+	//  AC analysis
+	save_start (ctxt, "ac");
+	save_bool (ctxt, "enabled", sim_settings_get_ac (s));
+	save_bool (ctxt, "compact", sim_settings_get_ac_compact (s));
+	save_text (ctxt, "vout1", sim_settings_get_ac_vout (s));
+	save_text (ctxt, "type", sim_settings_get_ac_type (s));
+	save_printf (ctxt, "npoints", "%d", sim_settings_get_ac_npoints (s));
+	save_printf (ctxt, "start", "%g", sim_settings_get_ac_start (s));
+	save_printf (ctxt, "stop", "%g", sim_settings_get_ac_stop (s));
+	save_end (ctxt, "ac");
+
+	//  DC analysis
+	save_start (ctxt, "dc-sweep");
+	save_bool (ctxt, "enabled", sim_settings_get_dc (s));
+	save_bool (ctxt, "compact", sim_settings_get_dc_compact (s));
+	save_text (ctxt, "vsrc1", sim_settings_get_dc_vsrc (s));
+	save_text (ctxt, "vout1", sim_settings_get_dc_vout (s));
+	save_printf (ctxt, "start1", "%g", sim_settings_get_dc_start (s));
+	save_printf (ctxt, "stop1", "%g", sim_settings_get_dc_stop (s));
+	save_printf (ctxt, "step1", "%g", sim_settings_get_dc_step (s));
+	save_end (ctxt, "dc-sweep");
+
+	//  Fourier analysis
+	save_start (ctxt, "fourier");
+	save_bool (ctxt, "enabled", sim_settings_get_fourier (s));
+	save_printf (ctxt, "freq", "%.3f", sim_settings_get_fourier_frequency (s));
+	save_printf (ctxt, "vout", "%s", sim_settings_get_fourier_vout (s));
+	save_end (ctxt, "fourier");
+
+	//  Noise analysis
+	save_start (ctxt, "noise");
+	save_bool (ctxt, "enabled", sim_settings_get_noise (s));
+	save_bool (ctxt, "compact", sim_settings_get_noise_compact (s));
+	save_text (ctxt, "vsrc1", sim_settings_get_noise_vsrc (s));
+	save_text (ctxt, "vout1", sim_settings_get_noise_vout (s));
+	save_text (ctxt, "type", sim_settings_get_noise_type (s));
+	save_printf (ctxt, "npoints", "%d", sim_settings_get_noise_npoints (s));
+	save_printf (ctxt, "start", "%g", sim_settings_get_noise_start (s));
+	save_printf (ctxt, "stop", "%g", sim_settings_get_noise_stop (s));
+	save_end (ctxt, "noise");
+
+	// Save the options
+	list = sim_settings_get_options (s);
+	if (list) {
+		save_start (ctxt, "options");
+		for (; list; list = list->next) {
+			so = list->data;
+			save_start (ctxt, "option");
+			save_text (ctxt, "name", so->name);
+			save_text (ctxt, "value", so->value);
+			save_end (ctxt, "option");
+		}
+		save_end (ctxt, "options");
 	}
 
-	if (sim_settings_get_trans (s))
-		str = "true";
-	else
-		str = "false";
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "enabled", BAD_CAST str);
+	save_end (ctxt, "simulation-settings");
+}
 
-	str = g_strdup_printf ("%g", sim_settings_get_trans_start (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "start", BAD_CAST str);
-	g_free (str);
+/*
+ * A schematic as it is saved, captured on the main thread and written
+ * from any thread while the schematic keeps changing.
+ *
+ * Names which repeat across parts are interned and shared, everything
+ * else is copied. The head of the document, up to the simulation
+ * settings, is small and written right away.
+ */
+typedef struct
+{
+	const gchar *name;
+	gchar *value;
+} SnapshotProperty;
 
-	str = g_strdup_printf ("%g", sim_settings_get_trans_stop (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "stop", BAD_CAST str);
-	g_free (str);
+typedef struct
+{
+	const gchar *name;
+	gchar *text;
+	Coords pos;
+} SnapshotLabel;
 
-	str = g_strdup_printf ("%g", sim_settings_get_trans_step (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "step", BAD_CAST str);
-	g_free (str);
+typedef struct
+{
+	const gchar *name;
+	const gchar *library;
+	const gchar *symbol;
+	gint rotation;
+	IDFlip flip;
+	Coords pos;
+	GArray *properties;
+	GArray *labels;
+} SnapshotPart;
 
-	if (sim_settings_get_trans_step_enable (s))
-		str = "true";
-	else
-		str = "false";
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "step-enabled", BAD_CAST str);
+typedef struct
+{
+	Coords start;
+	Coords end;
+	// positions of the nodes on the wire, sorted when written
+	GArray *nodes;
+} SnapshotWire;
 
-	if (sim_settings_get_trans_init_cond (s))
-		str = "true";
-	else
-		str = "false";
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "init-conditions", BAD_CAST str);
+typedef struct
+{
+	Coords pos;
+	gchar *text;
+} SnapshotTextbox;
 
-	if (sim_settings_get_trans_analyze_all(s))
-		str = "true";
-	else
-		str = "false";
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "analyze-all", BAD_CAST str);
+struct _SchematicSnapshot
+{
+	GString *head;
+	GArray *parts;
+	GArray *wires;
+	GArray *textboxes;
+};
 
-	//  AC analysis
-	analysis = xmlNewChild (sim_settings_node, ctxt->ns, BAD_CAST "ac", NULL);
-	if (!analysis) {
-		g_warning ("Failed during save of AC analysis settings.\n");
-		return;
-	}
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "enabled",
-	                     BAD_CAST (sim_settings_get_ac (s) ? "true" : "false"));
+static void snapshot_property_clear (SnapshotProperty *prop) { g_free (prop->value); }
 
-	child =
-	    xmlNewChild (analysis, ctxt->ns, BAD_CAST "vout1", BAD_CAST sim_settings_get_ac_vout (s));
+static void snapshot_label_clear (SnapshotLabel *label) { g_free (label->text); }
 
-	child =
-	    xmlNewChild (analysis, ctxt->ns, BAD_CAST "type", BAD_CAST sim_settings_get_ac_type (s));
+static void snapshot_part_clear (SnapshotPart *part)
+{
+	g_array_free (part->properties, TRUE);
+	g_array_free (part->labels, TRUE);
+}
 
-	str = g_strdup_printf ("%d", sim_settings_get_ac_npoints (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "npoints", BAD_CAST str);
-	g_free (str);
+static void snapshot_wire_clear (SnapshotWire *wire) { g_array_free (wire->nodes, TRUE); }
 
-	str = g_strdup_printf ("%g", sim_settings_get_ac_start (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "start", BAD_CAST str);
-	g_free (str);
+static void snapshot_textbox_clear (SnapshotTextbox *textbox) { g_free (textbox->text); }
 
-	str = g_strdup_printf ("%g", sim_settings_get_ac_stop (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "stop", BAD_CAST str);
-	g_free (str);
+static void snapshot_part_init (SnapshotPart *copy, Part *part)
+{
+	PartPriv *priv = part->priv;
+	GSList *iter;
+
+	copy->name = g_intern_string (priv->name);
+	copy->library = priv->library ? g_intern_string (priv->library->name) : NULL;
+	copy->symbol = g_intern_string (priv->symbol_name);
+	copy->rotation = part_get_rotation (part);
+	copy->flip = priv->flip;
+	item_data_get_pos (ITEM_DATA (part), &copy->pos);
+
+	copy->properties = g_array_new (FALSE, FALSE, sizeof(SnapshotProperty));
+	g_array_set_clear_func (copy->properties, (GDestroyNotify)snapshot_property_clear);
+	for (iter = priv->properties; iter; iter = iter->next) {
+		Property *prop = iter->data;
+		SnapshotProperty p = {g_intern_string (prop->name), g_strdup (prop->value)};
+
+		g_array_append_val (copy->properties, p);
+	}
 
-	//  DC analysis
-	analysis = xmlNewChild (sim_settings_node, ctxt->ns, BAD_CAST "dc-sweep", NULL);
-	if (!analysis) {
-		g_warning ("Failed during save of DC sweep analysis settings.\n");
-		return;
+	copy->labels = g_array_new (FALSE, FALSE, sizeof(SnapshotLabel));
+	g_array_set_clear_func (copy->labels, (GDestroyNotify)snapshot_label_clear);
+	for (iter = priv->labels; iter; iter = iter->next) {
+		PartLabel *label = iter->data;
+		SnapshotLabel l = {g_intern_string (label->name), g_strdup (label->text), label->pos};
+
+		g_array_append_val (copy->labels, l);
 	}
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "enabled",
-	                     BAD_CAST (sim_settings_get_dc (s) ? "true" : "false"));
+}
 
-	child =
-	    xmlNewChild (analysis, ctxt->ns, BAD_CAST "vsrc1", BAD_CAST sim_settings_get_dc_vsrc (s));
+static void snapshot_add_part (Part *part, SchematicSnapshot *snapshot)
+{
+	SnapshotPart copy;
 
-	child =
-	    xmlNewChild (analysis, ctxt->ns, BAD_CAST "vout1", BAD_CAST sim_settings_get_dc_vout (s));
+	g_return_if_fail (part != NULL);
+	g_return_if_fail (IS_PART (part));
 
-	str = g_strdup_printf ("%g", sim_settings_get_dc_start (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "start1", BAD_CAST str);
-	g_free (str);
+	snapshot_part_init (&copy, part);
+	g_array_append_val (snapshot->parts, copy);
+}
 
-	str = g_strdup_printf ("%g", sim_settings_get_dc_stop (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "stop1", BAD_CAST str);
-	g_free (str);
+static void snapshot_wire_init (SnapshotWire *copy, Wire *wire)
+{
+	GSList *iter;
 
-	str = g_strdup_printf ("%g", sim_settings_get_dc_step (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "step1", BAD_CAST str);
-	g_free (str);
+	wire_get_start_pos (wire, &copy->start);
+	wire_get_end_pos (wire, &copy->end);
+	copy->nodes = g_array_new (FALSE, FALSE, sizeof(Coords));
+	for (iter = wire_get_nodes (wire); iter; iter = iter->next) {
+		Node *node = iter->data;
 
-	//  Fourier analysis
-	analysis = xmlNewChild (sim_settings_node, ctxt->ns, BAD_CAST "fourier", NULL);
-	if (!analysis) {
-		g_warning ("Failed during save of Fourier analysis settings.\n");
-		return;
+		if (node == NULL) {
+			g_warning ("Node of wire did not exist [%p].", node);
+			continue;
+		}
+		g_array_append_val (copy->nodes, node->key);
 	}
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "enabled",
-	                     BAD_CAST (sim_settings_get_fourier (s) ? "true" : "false"));
+}
 
-	str = g_strdup_printf ("%.3f", sim_settings_get_fourier_frequency (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "freq", BAD_CAST str);
-	g_free (str);
+static void snapshot_add_wire (Wire *wire, SchematicSnapshot *snapshot)
+{
+	SnapshotWire copy;
 
-	str = g_strdup_printf ("%s", sim_settings_get_fourier_vout (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "vout", BAD_CAST str);
-	g_free (str);
+	g_return_if_fail (wire != NULL);
+	g_return_if_fail (IS_WIRE (wire));
 
-	//  Noise analysis
-	analysis = xmlNewChild (sim_settings_node, ctxt->ns, BAD_CAST "noise", NULL);
-	if (!analysis) {
-		g_warning ("Failed during save of Noise analysis settings.\n");
+	snapshot_wire_init (&copy, wire);
+	g_array_append_val (snapshot->wires, copy);
+}
+
+static void snapshot_textbox_init (SnapshotTextbox *copy, Textbox *textbox)
+{
+	item_data_get_pos (ITEM_DATA (textbox), &copy->pos);
+	copy->text = g_strdup (textbox_get_text (textbox));
+}
+
+static void snapshot_add_textbox (Textbox *textbox, SchematicSnapshot *snapshot)
+{
+	SnapshotTextbox copy;
+
+	g_return_if_fail (textbox != NULL);
+	if (!IS_TEXTBOX (textbox))
 		return;
-	}
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "enabled",
-	                     BAD_CAST (sim_settings_get_noise (s) ? "true" : "false"));
 
-	child =
-	    xmlNewChild (analysis, ctxt->ns, BAD_CAST "vsrc1", BAD_CAST sim_settings_get_noise_vsrc (s));
+	snapshot_textbox_init (&copy, textbox);
+	g_array_append_val (snapshot->textboxes, copy);
+}
+
+/**
+ * @returns the head of the document, up to the simulation settings,
+ *  inside of the schematic element
+ */
+static GString *save_head_new (Schematic *sm)
+{
+	SaveContext ctxt = {0};
 
-	child =
-	    xmlNewChild (analysis, ctxt->ns, BAD_CAST "vout1", BAD_CAST sim_settings_get_noise_vout (s));
+	// The head, which is never flushed as there is no stream.
+	ctxt.buf = g_string_new ("<?xml version=\"1.0\"?>\n");
+	save_start (&ctxt, "schematic");
+	g_string_append (ctxt.buf, " xmlns:ogo=\"" SAVE_SCHEMATIC_NS "\"");
 
-	child =
-	    xmlNewChild (analysis, ctxt->ns, BAD_CAST "type", BAD_CAST sim_settings_get_noise_type (s));
+	// General information about the Schematic.
+	save_printf (&ctxt, "author", "%s", schematic_get_author (sm));
+	save_printf (&ctxt, "title", "%s", schematic_get_title (sm));
+	save_printf (&ctxt, "version", "%s", schematic_get_version (sm));
+	save_printf (&ctxt, "comments", "%s", schematic_get_comments (sm));
 
-	str = g_strdup_printf ("%d", sim_settings_get_noise_npoints (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "npoints", BAD_CAST str);
-	g_free (str);
+	// Grid.
+	save_start (&ctxt, "grid");
+	save_text (&ctxt, "visible", "true");
+	save_text (&ctxt, "snap", "true");
+	save_end (&ctxt, "grid");
 
-	str = g_strdup_printf ("%g", sim_settings_get_noise_start (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "start", BAD_CAST str);
-	g_free (str);
+	// Simulation settings.
+	write_xml_sim_settings (&ctxt, sm);
 
-	str = g_strdup_printf ("%g", sim_settings_get_noise_stop (s));
-	child = xmlNewChild (analysis, ctxt->ns, BAD_CAST "stop", BAD_CAST str);
-	g_free (str);
+	return ctxt.buf;
+}
 
-	// Save the options
-	list = sim_settings_get_options (s);
-	if (list) {
-		options = xmlNewChild (sim_settings_node, ctxt->ns, BAD_CAST "options", NULL);
-		if (!options) {
-			g_warning ("Failed during save of sim engine options.\n");
-			return;
-		}
+/**
+ * \brief captures the schematic for saving, call from the main thread
+ */
+SchematicSnapshot *schematic_snapshot_new (Schematic *sm)
+{
+	SchematicSnapshot *snapshot;
 
-		while (list) {
-			so = list->data;
-			child = xmlNewChild (options, ctxt->ns, BAD_CAST "option", NULL);
-			xmlNewChild (child, ctxt->ns, BAD_CAST "name", BAD_CAST so->name);
-			xmlNewChild (child, ctxt->ns, BAD_CAST "value", BAD_CAST so->value);
-			list = list->next;
-		}
-	}
+	g_return_val_if_fail (sm != NULL, NULL);
+	g_return_val_if_fail (IS_SCHEMATIC (sm), NULL);
+
+	snapshot = g_new0 (SchematicSnapshot, 1);
+	snapshot->head = save_head_new (sm);
+
+	snapshot->parts = g_array_new (FALSE, FALSE, sizeof(SnapshotPart));
+	g_array_set_clear_func (snapshot->parts, (GDestroyNotify)snapshot_part_clear);
+	schematic_parts_foreach (sm, (gpointer)snapshot_add_part, snapshot);
+
+	snapshot->wires = g_array_new (FALSE, FALSE, sizeof(SnapshotWire));
+	g_array_set_clear_func (snapshot->wires, (GDestroyNotify)snapshot_wire_clear);
+	schematic_wires_foreach (sm, (gpointer)snapshot_add_wire, snapshot);
+
+	snapshot->textboxes = g_array_new (FALSE, FALSE, sizeof(SnapshotTextbox));
+	g_array_set_clear_func (snapshot->textboxes, (GDestroyNotify)snapshot_textbox_clear);
+	schematic_items_foreach (sm, (gpointer)snapshot_add_textbox, snapshot);
+
+	return snapshot;
 }
 
-static void write_xml_property (Property *prop, parseXmlContext *ctxt)
+void schematic_snapshot_free (SchematicSnapshot *snapshot)
+{
+	if (snapshot == NULL)
+		return;
+
+	g_string_free (snapshot->head, TRUE);
+	g_array_free (snapshot->parts, TRUE);
+	g_array_free (snapshot->wires, TRUE);
+	g_array_free (snapshot->textboxes, TRUE);
+	g_free (snapshot);
+}
+
+/*
+ * What is written, either a snapshot or the schematic itself. Saving
+ * on the main thread takes the elements from the schematic one at a
+ * time, so it never holds a second copy of the whole schematic.
+ */
+typedef struct
 {
-	xmlNodePtr node_property;
+	Schematic *sm;
+	SchematicSnapshot *snapshot;
+} SaveSource;
 
-	// Create a node for the property.
-	node_property = xmlNewChild (ctxt->node_props, ctxt->ns, BAD_CAST "property", NULL);
-	if (!node_property) {
-		g_warning ("Failed during save of property %s.\n", prop->name);
+static void save_foreach_part (SaveSource *src, GFunc func, gpointer user_data)
+{
+	GList *iter;
+	guint i;
+
+	if (src->snapshot) {
+		for (i = 0; i < src->snapshot->parts->len; i++)
+			func (&g_array_index (src->snapshot->parts, SnapshotPart, i), user_data);
 		return;
 	}
 
-	// Store the name.
-	xmlNewChild (node_property, ctxt->ns, BAD_CAST "name",
-	             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST prop->name));
+	for (iter = node_store_get_parts (schematic_get_store (src->sm)); iter; iter = iter->next) {
+		SnapshotPart part;
 
-	// Store the value.
-	xmlNewChild (node_property, ctxt->ns, BAD_CAST "value",
-	             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST prop->value));
+		snapshot_part_init (&part, iter->data);
+		func (&part, user_data);
+		snapshot_part_clear (&part);
+	}
 }
 
-static void write_xml_label (PartLabel *label, parseXmlContext *ctxt)
+static void save_foreach_wire (SaveSource *src, GFunc func, gpointer user_data)
 {
-	xmlNodePtr node_label;
-	gchar *str;
+	GList *iter;
+	guint i;
 
-	// Create a node for the property.
-	node_label = xmlNewChild (ctxt->node_labels, ctxt->ns, BAD_CAST "label", NULL);
-	if (!node_label) {
-		g_warning ("Failed during save of label %s.\n", label->name);
+	if (src->snapshot) {
+		for (i = 0; i < src->snapshot->wires->len; i++)
+			func (&g_array_index (src->snapshot->wires, SnapshotWire, i), user_data);
 		return;
 	}
 
-	// Store the name.
-	xmlNewChild (node_label, ctxt->ns, BAD_CAST "name",
-	             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST label->name));
-
-	// Store the value.
-	xmlNewChild (node_label, ctxt->ns, BAD_CAST "text",
-	             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST label->text));
+	for (iter = node_store_get_wires (schematic_get_store (src->sm)); iter; iter = iter->next) {
+		SnapshotWire wire;
 
-	str = g_strdup_printf ("(%g %g)", label->pos.x, label->pos.y);
-	xmlNewChild (node_label, ctxt->ns, BAD_CAST "position", BAD_CAST str);
-	g_free (str);
+		snapshot_wire_init (&wire, iter->data);
+		func (&wire, user_data);
+		snapshot_wire_clear (&wire);
+	}
 }
 
-static void write_xml_part (Part *part, parseXmlContext *ctxt)
+static void save_foreach_textbox (SaveSource *src, GFunc func, gpointer user_data)
 {
-	PartPriv *priv;
-	xmlNodePtr node_part;
-	gchar *str;
-	Coords pos;
+	GList *iter;
+	guint i;
 
-	g_return_if_fail (part != NULL);
-	g_return_if_fail (IS_PART (part));
+	if (src->snapshot) {
+		for (i = 0; i < src->snapshot->textboxes->len; i++)
+			func (&g_array_index (src->snapshot->textboxes, SnapshotTextbox, i), user_data);
+		return;
+	}
 
-	priv = part->priv;
+	for (iter = schematic_get_items (src->sm); iter; iter = iter->next) {
+		SnapshotTextbox textbox;
 
-	// Create a node for the part.
-	node_part = xmlNewChild (ctxt->node_parts, ctxt->ns, BAD_CAST "part", NULL);
-	if (!node_part) {
-		g_warning ("Failed during save of part %s.\n", priv->name);
-		return;
+		if (!IS_TEXTBOX (iter->data))
+			continue;
+		snapshot_textbox_init (&textbox, iter->data);
+		func (&textbox, user_data);
+		snapshot_textbox_clear (&textbox);
 	}
+}
 
-	str = g_strdup_printf ("%d", part_get_rotation (part));
-	xmlNewChild (node_part, ctxt->ns, BAD_CAST "rotation",
-	             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST str));
-	g_free (str);
+static void write_xml_part (SnapshotPart *part, SaveContext *ctxt)
+{
+	guint i;
+
+	save_start (ctxt, "part");
 
-	if (priv->flip & ID_FLIP_HORIZ)
-		xmlNewChild (node_part, ctxt->ns, BAD_CAST "flip",
-		             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST "horizontal"));
+	save_printf (ctxt, "rotation", "%d", part->rotation);
 
-	if (priv->flip & ID_FLIP_VERT)
-		xmlNewChild (node_part, ctxt->ns, BAD_CAST "flip",
-		             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST "vertical"));
+	if (part->flip & ID_FLIP_HORIZ)
+		save_text (ctxt, "flip", "horizontal");
+
+	if (part->flip & ID_FLIP_VERT)
+		save_text (ctxt, "flip", "vertical");
 
 	// Store the name.
-	xmlNewChild (node_part, ctxt->ns, BAD_CAST "name",
-	             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST priv->name));
+	save_text (ctxt, "name", part->name);
 
 	// Store the name of the library the part resides in.
-	xmlNewChild (node_part, ctxt->ns, BAD_CAST "library",
-	             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST priv->library->name));
+	save_text (ctxt, "library", part->library);
 
 	// Which symbol to use.
-	xmlNewChild (node_part, ctxt->ns, BAD_CAST "symbol",
-	             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST priv->symbol_name));
+	save_text (ctxt, "symbol", part->symbol);
 
 	// Position.
-	item_data_get_pos (ITEM_DATA (part), &pos);
-	str = g_strdup_printf ("(%g %g)", pos.x, pos.y);
-	xmlNewChild (node_part, ctxt->ns, BAD_CAST "position", BAD_CAST str);
-	g_free (str);
+	save_printf (ctxt, "position", "(%g %g)", part->pos.x, part->pos.y);
 
-	// Create a node for the properties.
-	ctxt->node_props = xmlNewChild (node_part, ctxt->ns, BAD_CAST "properties", NULL);
-	if (!ctxt->node_props) {
-		g_warning ("Failed during save of part %s.\n", priv->name);
-		return;
-	} else {
-		g_slist_foreach (priv->properties, (GFunc)write_xml_property, ctxt);
+	save_start (ctxt, "properties");
+	for (i = 0; i < part->properties->len; i++) {
+		SnapshotProperty *prop = &g_array_index (part->properties, SnapshotProperty, i);
+
+		save_start (ctxt, "property");
+		save_text (ctxt, "name", prop->name);
+		save_text (ctxt, "value", prop->value);
+		save_end (ctxt, "property");
 	}
+	save_end (ctxt, "properties");
 
-	// Create a node for the labels.
-	ctxt->node_labels = xmlNewChild (node_part, ctxt->ns, BAD_CAST "labels", NULL);
-	if (!ctxt->node_labels) {
-		g_warning ("Failed during save of part %s.\n", priv->name);
-		return;
-	} else {
-		g_slist_foreach (priv->labels, (GFunc)write_xml_label, ctxt);
+	save_start (ctxt, "labels");
+	for (i = 0; i < part->labels->len; i++) {
+		SnapshotLabel *label = &g_array_index (part->labels, SnapshotLabel, i);
+
+		save_start (ctxt, "label");
+		save_text (ctxt, "name", label->name);
+		save_text (ctxt, "text", label->text);
+		save_printf (ctxt, "position", "(%g %g)", label->pos.x, label->pos.y);
+		save_end (ctxt, "label");
 	}
+	save_end (ctxt, "labels");
+
+	save_end (ctxt, "part");
 }
 
 static gint cmp_nodes (gconstpointer a, gconstpointer b)
 {
-	return coords_compare (&(((const Node *)a)->key), &(((const Node *)b)->key));
+	return coords_compare ((const Coords *)a, (const Coords *)b);
 }
 
-static void write_xml_wire (Wire *wire, parseXmlContext *ctxt)
+/**
+ * splits a wire at its nodes into the segments it is saved as
+ *
+ * @points gets the start and the end of each segment
+ */
+static void snapshot_wire_get_segments (SnapshotWire *wire, GArray *points)
 {
-	xmlNodePtr node_wire;
-	gchar *str;
-	Coords start_pos, end_pos;
+	Coords current, tmp;
+	guint i;
 
-	g_return_if_fail (wire != NULL);
-	g_return_if_fail (IS_WIRE (wire));
+	g_array_set_size (points, 0);
+	g_array_sort (wire->nodes, cmp_nodes);
+	current = wire->start;
 
-	// Create a node for the wire.
-	node_wire = xmlNewChild (ctxt->node_wires, ctxt->ns, BAD_CAST "wire", NULL);
-	if (!node_wire) {
-		g_warning ("Failed during save of wire.\n");
-		return;
+	for (i = 0; i < wire->nodes->len; i++) {
+		tmp = g_array_index (wire->nodes, Coords, i);
+		if (coords_equal (&tmp, &wire->start))
+			continue;
+		if (coords_equal (&tmp, &wire->end))
+			continue;
+
+		g_array_append_val (points, current);
+		g_array_append_val (points, tmp);
+		current = tmp;
 	}
+	g_array_append_val (points, current);
+	g_array_append_val (points, wire->end);
+}
 
-	wire_get_start_pos (wire, &start_pos);
-	wire_get_end_pos (wire, &end_pos);
+static void write_xml_wire (SnapshotWire *wire, SaveContext *ctxt)
+{
+	guint i;
 
-	Node *node;
-	Coords last, current, tmp;
-	GSList *iter, *copy;
+	save_start (ctxt, "wire");
 
-	copy = g_slist_sort (g_slist_copy (wire_get_nodes (wire)), cmp_nodes);
-	current = last = start_pos;
+	snapshot_wire_get_segments (wire, ctxt->points);
+	for (i = 0; i < ctxt->points->len; i += 2) {
+		Coords *p = &g_array_index (ctxt->points, Coords, i);
 
-	for (iter = copy; iter; iter = iter->next) {
-		node = iter->data;
-		if (node == NULL) {
-			g_warning ("Node of wire did not exist [%p].", node);
-			continue;
-		}
+		save_printf (ctxt, "points", "(%g %g)(%g %g)", p[0].x, p[0].y, p[1].x, p[1].y);
+	}
 
-		tmp = node->key;
-		if (coords_equal (&tmp, &start_pos))
-			continue;
-		if (coords_equal (&tmp, &end_pos))
-			continue;
+	save_end (ctxt, "wire");
+}
 
-		last = current;
-		current = tmp;
+static void write_xml_textbox (SnapshotTextbox *textbox, SaveContext *ctxt)
+{
+	save_start (ctxt, "textbox");
+	save_printf (ctxt, "position", "(%g %g)", textbox->pos.x, textbox->pos.y);
+	save_text (ctxt, "text", textbox->text);
+	save_end (ctxt, "textbox");
+}
 
-		str = g_strdup_printf ("(%g %g)(%g %g)", last.x, last.y, current.x, current.y);
+static gboolean save_write_xml (SaveSource *src, GOutputStream *out, GError **error)
+{
+	SaveContext ctxt;
+
+	ctxt.out = out;
+	ctxt.buf = g_string_sized_new (SAVE_SCHEMATIC_BUFFER_SIZE + 4096);
+	ctxt.points = g_array_new (FALSE, FALSE, sizeof(Coords));
+	ctxt.error = NULL;
+
+	// continue after the head, inside of the schematic
+	if (src->snapshot) {
+		g_string_append_len (ctxt.buf, src->snapshot->head->str, src->snapshot->head->len);
+	} else {
+		GString *head = save_head_new (src->sm);
 
-		xmlNewChild (node_wire, ctxt->ns, BAD_CAST "points", BAD_CAST str);
-		g_free (str);
+		g_string_append_len (ctxt.buf, head->str, head->len);
+		g_string_free (head, TRUE);
 	}
-	last = current;
-	current = end_pos;
-	str = g_strdup_printf ("(%g %g)(%g %g)", last.x, last.y, current.x, current.y);
+	ctxt.depth = 1;
+	ctxt.open = FALSE;
 
-	xmlNewChild (node_wire, ctxt->ns, BAD_CAST "points", BAD_CAST str);
-	g_free (str);
+	// Parts.
+	save_start (&ctxt, "parts");
+	save_foreach_part (src, (GFunc)write_xml_part, &ctxt);
+	save_end (&ctxt, "parts");
+
+	// Wires.
+	save_start (&ctxt, "wires");
+	save_foreach_wire (src, (GFunc)write_xml_wire, &ctxt);
+	save_end (&ctxt, "wires");
+
+	// Text boxes.
+	save_start (&ctxt, "textboxes");
+	save_foreach_textbox (src, (GFunc)write_xml_textbox, &ctxt);
+	save_end (&ctxt, "textboxes");
+
+	save_end (&ctxt, "schematic");
 
-	g_slist_free (copy);
+	save_flush (&ctxt);
+	g_string_free (ctxt.buf, TRUE);
+	g_array_free (ctxt.points, TRUE);
+
+	if (ctxt.error) {
+		g_propagate_error (error, ctxt.error);
+		return FALSE;
+	}
+	return TRUE;
 }
 
-static void write_xml_textbox (Textbox *textbox, parseXmlContext *ctxt)
+/**
+ * \brief writes a snapshot as XML to a stream, without closing it
+ *
+ * May be called from any thread, but not for the same snapshot from
+ * two at once.
+ */
+gboolean schematic_snapshot_write (SchematicSnapshot *snapshot, GOutputStream *out,
+                                   GError **error)
 {
-	xmlNodePtr node_textbox;
-	gchar *str;
-	Coords pos;
+	SaveSource src = {NULL, snapshot};
 
-	g_return_if_fail (textbox != NULL);
-	if (!IS_TEXTBOX (textbox))
-		return;
+	g_return_val_if_fail (snapshot != NULL, FALSE);
+	g_return_val_if_fail (G_IS_OUTPUT_STREAM (out), FALSE);
 
-	// Create a node for the textbox.
-	node_textbox = xmlNewChild (ctxt->node_textboxes, ctxt->ns, BAD_CAST "textbox", NULL);
-	if (!node_textbox) {
-		g_warning ("Failed during save of text box.\n");
-		return;
-	}
+	return save_write_xml (&src, out, error);
+}
 
-	item_data_get_pos (ITEM_DATA (textbox), &pos);
+/*
+ * The binary format, see schematic-binary.h. The records are collected
+ * in typed arrays and written as one chunk each, with the strings they
+ * refer to stored once.
+ */
+typedef struct
+{
+	GString *strings;
+	GHashTable *string_offsets;
+	GArray *library_parts;
+	GHashTable *library_part_ids;
+} BinaryTables;
 
-	str = g_strdup_printf ("(%g %g)", pos.x, pos.y);
-	xmlNewChild (node_textbox, ctxt->ns, BAD_CAST "position", BAD_CAST str);
-	g_free (str);
+// a library part by its interned names
+typedef struct
+{
+	const gchar *library;
+	const gchar *name;
+	const gchar *symbol;
+} BinaryLibraryPartKey;
 
-	str = textbox_get_text (textbox);
-	xmlNewChild (node_textbox, ctxt->ns, BAD_CAST "text", BAD_CAST str);
+static guint binary_library_part_hash (gconstpointer key)
+{
+	const BinaryLibraryPartKey *k = key;
+
+	return g_direct_hash (k->library) ^ g_direct_hash (k->name) * 31 ^
+	       g_direct_hash (k->symbol) * 961;
 }
 
-// Create an XML subtree of doc equivalent to the given Schematic.
-static xmlNodePtr write_xml_schematic (parseXmlContext *ctxt, Schematic *sm, GError **error)
+static gboolean binary_library_part_equal (gconstpointer a, gconstpointer b)
 {
-	xmlNodePtr cur;
-	xmlNodePtr grid;
-	xmlNsPtr ogo;
-	gchar *str;
+	const BinaryLibraryPartKey *ka = a, *kb = b;
 
-	cur = xmlNewDocNode (ctxt->doc, ctxt->ns, BAD_CAST "schematic", NULL);
-	if (cur == NULL) {
-		printf ("%s:%d NULL that shall be not NULL!\n", __FILE__, __LINE__);
-		return NULL;
-	}
+	return ka->library == kb->library && ka->name == kb->name && ka->symbol == kb->symbol;
+}
 
-	if (ctxt->ns == NULL) {
-		ogo = xmlNewNs (cur, BAD_CAST "https://beerbach.me/project/oregano/ns/v1", BAD_CAST "ogo");
-		xmlSetNs (cur, ogo);
-		ctxt->ns = ogo;
-	}
+/**
+ * @returns the offset of the string in the string table, a missing
+ * string is saved empty as in XML
+ */
+static guint32 binary_string (BinaryTables *tables, const gchar *str)
+{
+	gpointer offset;
 
-	// General information about the Schematic.
-	str = g_strdup_printf ("%s", schematic_get_author (sm));
-	xmlNewChild (cur, ctxt->ns, BAD_CAST "author",
-	             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST str));
-	g_free (str);
+	if (str == NULL)
+		str = "";
+	if (g_hash_table_lookup_extended (tables->string_offsets, str, NULL, &offset))
+		return GPOINTER_TO_UINT (offset);
 
-	str = g_strdup_printf ("%s", schematic_get_title (sm));
-	xmlNewChild (cur, ctxt->ns, BAD_CAST "title",
-	             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST str));
-	g_free (str);
+	offset = GUINT_TO_POINTER (tables->strings->len);
+	g_string_append_len (tables->strings, str, strlen (str) + 1);
+	// parts taken from the schematic are dropped once written
+	g_hash_table_insert (tables->string_offsets, g_strdup (str), offset);
 
-	str = g_strdup_printf ("%s", schematic_get_version (sm));
-	xmlNewChild (cur, ctxt->ns, BAD_CAST "version",
-	             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST str));
-	g_free (str);
+	return GPOINTER_TO_UINT (offset);
+}
 
-	str = g_strdup_printf ("%s", schematic_get_comments (sm));
-	xmlNewChild (cur, ctxt->ns, BAD_CAST "comments",
-	             xmlEncodeEntitiesReentrant (ctxt->doc, BAD_CAST str));
-	g_free (str);
+static guint32 binary_library_part (BinaryTables *tables, SnapshotPart *part)
+{
+	BinaryLibraryPartKey key = {part->library, part->name, part->symbol}, *stored;
+	SchematicBinaryLibraryPart record = {0};
+	gpointer id;
+
+	if (g_hash_table_lookup_extended (tables->library_part_ids, &key, NULL, &id))
+		return GPOINTER_TO_UINT (id);
+
+	record.library = GUINT32_TO_LE (binary_string (tables, part->library));
+	record.name = GUINT32_TO_LE (binary_string (tables, part->name));
+	record.symbol = GUINT32_TO_LE (binary_string (tables, part->symbol));
+	id = GUINT_TO_POINTER (tables->library_parts->len);
+	g_array_append_val (tables->library_parts, record);
+	stored = g_new (BinaryLibraryPartKey, 1);
+	*stored = key;
+	g_hash_table_insert (tables->library_part_ids, stored, id);
+
+	return GPOINTER_TO_UINT (id);
+}
 
-	// Grid.
-	grid = xmlNewChild (cur, ctxt->ns, BAD_CAST "grid", NULL);
-	xmlNewChild (grid, ctxt->ns, BAD_CAST "visible", BAD_CAST "true");
-	xmlNewChild (grid, ctxt->ns, BAD_CAST "snap", BAD_CAST "true");
+static void write_binary_chunk (SaveContext *ctxt, guint32 tag, gconstpointer data, gsize size)
+{
+	static const gchar padding[8] = {0};
+	guint32 head[2] = {GUINT32_TO_LE (tag), 0};
+	guint64 len = GUINT64_TO_LE (size);
+
+	g_string_append_len (ctxt->buf, (const gchar *)head, sizeof(head));
+	g_string_append_len (ctxt->buf, (const gchar *)&len, sizeof(len));
+	if (size < SAVE_SCHEMATIC_BUFFER_SIZE) {
+		g_string_append_len (ctxt->buf, data, size);
+	} else {
+		// large arrays go to the stream as they are
+		save_flush (ctxt);
+		if (ctxt->error == NULL)
+			g_output_stream_write_all (ctxt->out, data, size, NULL, NULL, &ctxt->error);
+	}
+	g_string_append_len (ctxt->buf, padding, (8 - size % 8) % 8);
 
-	// Simulation settings.
-	write_xml_sim_settings (cur, ctxt, sm);
+	if (ctxt->buf->len >= SAVE_SCHEMATIC_BUFFER_SIZE)
+		save_flush (ctxt);
+}
 
-	// Parts.
-	ctxt->node_parts = xmlNewChild (cur, ctxt->ns, BAD_CAST "parts", NULL);
-	schematic_parts_foreach (sm, (gpointer)write_xml_part, ctxt);
+static void write_binary_array (SaveContext *ctxt, guint32 tag, GArray *array)
+{
+	write_binary_chunk (ctxt, tag, array->data,
+	                    (gsize)array->len * g_array_get_element_size (array));
+}
 
-	// Wires.
-	ctxt->node_wires = xmlNewChild (cur, ctxt->ns, BAD_CAST "wires", NULL);
-	schematic_wires_foreach (sm, (gpointer)write_xml_wire, ctxt);
+// the records of the binary format, collected before they are written
+typedef struct
+{
+	BinaryTables tables;
+	GArray *parts;
+	GArray *properties;
+	GArray *labels;
+	GArray *wires;
+	GArray *textboxes;
+	GArray *points;
+} BinaryRecords;
+
+static void binary_add_part (SnapshotPart *part, BinaryRecords *records)
+{
+	SchematicBinaryPart record = {0};
+	guint j;
+
+	record.library_part = GUINT32_TO_LE (binary_library_part (&records->tables, part));
+	record.rotation = GINT32_TO_LE (part->rotation);
+	record.flip = GUINT32_TO_LE (part->flip & (ID_FLIP_HORIZ | ID_FLIP_VERT));
+	record.n_properties = GUINT32_TO_LE (part->properties->len);
+	record.n_labels = GUINT32_TO_LE (part->labels->len);
+	record.x = schematic_binary_from_double (part->pos.x);
+	record.y = schematic_binary_from_double (part->pos.y);
+	g_array_append_val (records->parts, record);
+
+	for (j = 0; j < part->properties->len; j++) {
+		SnapshotProperty *prop = &g_array_index (part->properties, SnapshotProperty, j);
+		SchematicBinaryProperty p;
+
+		p.name = GUINT32_TO_LE (binary_string (&records->tables, prop->name));
+		p.value = GUINT32_TO_LE (binary_string (&records->tables, prop->value));
+		g_array_append_val (records->properties, p);
+	}
 
-	// Text boxes.
-	ctxt->node_textboxes = xmlNewChild (cur, ctxt->ns, BAD_CAST "textboxes", NULL);
-	schematic_items_foreach (sm, (gpointer)write_xml_textbox, ctxt);
+	for (j = 0; j < part->labels->len; j++) {
+		SnapshotLabel *label = &g_array_index (part->labels, SnapshotLabel, j);
+		SchematicBinaryLabel l;
 
-	return cur;
+		l.name = GUINT32_TO_LE (binary_string (&records->tables, label->name));
+		l.text = GUINT32_TO_LE (binary_string (&records->tables, label->text));
+		l.x = schematic_binary_from_double (label->pos.x);
+		l.y = schematic_binary_from_double (label->pos.y);
+		g_array_append_val (records->labels, l);
+	}
 }
 
-// schematic_write_xml
-//
-// Save a Sheet to an XML file.
-gboolean schematic_write_xml (Schematic *sm, GError **error)
+static void binary_add_wire (SnapshotWire *wire, BinaryRecords *records)
 {
-	int ret = -1;
-	xmlDocPtr xml;
-	parseXmlContext ctxt;
-	GError *err = NULL;
+	guint j;
+
+	snapshot_wire_get_segments (wire, records->points);
+	for (j = 0; j < records->points->len; j += 2) {
+		Coords *p = &g_array_index (records->points, Coords, j);
+		SchematicBinaryWire w;
+
+		w.x0 = schematic_binary_from_double (p[0].x);
+		w.y0 = schematic_binary_from_double (p[0].y);
+		w.x1 = schematic_binary_from_double (p[1].x);
+		w.y1 = schematic_binary_from_double (p[1].y);
+		g_array_append_val (records->wires, w);
+	}
+}
 
-	g_return_val_if_fail (sm != NULL, FALSE);
+static void binary_add_textbox (SnapshotTextbox *textbox, BinaryRecords *records)
+{
+	SchematicBinaryTextbox t = {0};
+
+	t.text = GUINT32_TO_LE (binary_string (&records->tables, textbox->text));
+	t.x = schematic_binary_from_double (textbox->pos.x);
+	t.y = schematic_binary_from_double (textbox->pos.y);
+	g_array_append_val (records->textboxes, t);
+}
 
-	// Create the tree.
-	xml = xmlNewDoc (BAD_CAST "1.0");
-	if (xml == NULL) {
+static gboolean save_write_binary (SaveSource *src, GOutputStream *out, GError **error)
+{
+	SaveContext ctxt = {0};
+	BinaryRecords records;
+	BinaryTables *tables = &records.tables;
+	GString *head;
+	guint32 header[4] = {0};
+
+	tables->strings = g_string_new (NULL);
+	tables->string_offsets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	tables->library_parts = g_array_new (FALSE, FALSE, sizeof(SchematicBinaryLibraryPart));
+	tables->library_part_ids = g_hash_table_new_full (binary_library_part_hash,
+	                                                  binary_library_part_equal, g_free, NULL);
+
+	records.parts = g_array_new (FALSE, FALSE, sizeof(SchematicBinaryPart));
+	records.properties = g_array_new (FALSE, FALSE, sizeof(SchematicBinaryProperty));
+	records.labels = g_array_new (FALSE, FALSE, sizeof(SchematicBinaryLabel));
+	records.wires = g_array_new (FALSE, FALSE, sizeof(SchematicBinaryWire));
+	records.textboxes = g_array_new (FALSE, FALSE, sizeof(SchematicBinaryTextbox));
+	records.points = g_array_new (FALSE, FALSE, sizeof(Coords));
+
+	save_foreach_part (src, (GFunc)binary_add_part, &records);
+	save_foreach_wire (src, (GFunc)binary_add_wire, &records);
+	save_foreach_textbox (src, (GFunc)binary_add_textbox, &records);
+
+	head = src->snapshot ? src->snapshot->head : save_head_new (src->sm);
+
+	ctxt.out = out;
+	ctxt.buf = g_string_sized_new (SAVE_SCHEMATIC_BUFFER_SIZE + 4096);
+
+	memcpy (header, SCHEMATIC_BINARY_MAGIC, sizeof(SCHEMATIC_BINARY_MAGIC));
+	header[2] = GUINT32_TO_LE (SCHEMATIC_BINARY_VERSION);
+	g_string_append_len (ctxt.buf, (const gchar *)header, sizeof(header));
+
+	write_binary_chunk (&ctxt, SCHEMATIC_BINARY_TAG_HEAD, head->str, head->len);
+	write_binary_chunk (&ctxt, SCHEMATIC_BINARY_TAG_STRINGS, tables->strings->str,
+	                    tables->strings->len);
+	write_binary_array (&ctxt, SCHEMATIC_BINARY_TAG_LIBRARY_PARTS, tables->library_parts);
+	write_binary_array (&ctxt, SCHEMATIC_BINARY_TAG_PARTS, records.parts);
+	write_binary_array (&ctxt, SCHEMATIC_BINARY_TAG_PROPERTIES, records.properties);
+	write_binary_array (&ctxt, SCHEMATIC_BINARY_TAG_LABELS, records.labels);
+	write_binary_array (&ctxt, SCHEMATIC_BINARY_TAG_WIRES, records.wires);
+	write_binary_array (&ctxt, SCHEMATIC_BINARY_TAG_TEXTBOXES, records.textboxes);
+
+	save_flush (&ctxt);
+	g_string_free (ctxt.buf, TRUE);
+
+	if (!src->snapshot)
+		g_string_free (head, TRUE);
+	g_array_free (records.parts, TRUE);
+	g_array_free (records.properties, TRUE);
+	g_array_free (records.labels, TRUE);
+	g_array_free (records.wires, TRUE);
+	g_array_free (records.textboxes, TRUE);
+	g_array_free (records.points, TRUE);
+	g_string_free (tables->strings, TRUE);
+	g_hash_table_destroy (tables->string_offsets);
+	g_array_free (tables->library_parts, TRUE);
+	g_hash_table_destroy (tables->library_part_ids);
+
+	if (ctxt.error) {
+		g_propagate_error (error, ctxt.error);
 		return FALSE;
 	}
+	return TRUE;
+}
+
+/**
+ * \brief writes a snapshot in the binary format to a stream, without
+ * closing it
+ *
+ * May be called from any thread, but not for the same snapshot from
+ * two at once.
+ */
+gboolean schematic_snapshot_write_binary (SchematicSnapshot *snapshot, GOutputStream *out,
+                                          GError **error)
+{
+	SaveSource src = {NULL, snapshot};
+
+	g_return_val_if_fail (snapshot != NULL, FALSE);
+	g_return_val_if_fail (G_IS_OUTPUT_STREAM (out), FALSE);
+
+	return save_write_binary (&src, out, error);
+}
 
-	ctxt.ns = NULL;
-	ctxt.doc = xml;
+typedef gboolean (*SaveWriteFunc) (SaveSource *src, GOutputStream *out, GError **error);
 
-	xmlDocSetRootElement (xml, write_xml_schematic (&ctxt, sm, &err));
+static gboolean save_to_file (SaveSource *src, const gchar *filename, gboolean compress,
+                              SaveWriteFunc write_func, GError **error)
+{
+	GFile *file;
+	GFileOutputStream *file_out;
+	GOutputStream *out;
+	gboolean ret;
+
+	g_return_val_if_fail (filename != NULL, FALSE);
 
-	if (err) {
-		g_propagate_error (error, err);
+	file = g_file_new_for_path (filename);
+	file_out = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+	g_object_unref (file);
+	if (file_out == NULL)
 		return FALSE;
-	}
 
-	// Dump the tree.
-	xmlSetDocCompressMode (xml, oregano.compress_files ? 9 : 0);
+	if (compress) {
+		// the same gzip stream libxml2 writes at compression level 9
+		GZlibCompressor *compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP, 9);
 
-	{
-		char *s = schematic_get_filename (sm);
-		if (s != NULL) {
-			ret = xmlSaveFormatFile (s, xml, 1);
-		} else {
-			g_warning ("Schematic has no filename!!\n");
-		}
+		out = g_converter_output_stream_new (G_OUTPUT_STREAM (file_out), G_CONVERTER (compressor));
+		g_object_unref (compressor);
+		g_object_unref (file_out);
+	} else {
+		out = G_OUTPUT_STREAM (file_out);
 	}
 
-	if (xml != NULL) {
-		xmlFreeDoc (xml);
+	ret = write_func (src, out, error);
+	if (ret) {
+		ret = g_output_stream_close (out, NULL, error);
 	} else {
-		g_warning ("XML object is NULL\n");
+		// a cancelled close leaves the file as it was
+		GCancellable *cancellable = g_cancellable_new ();
+
+		g_cancellable_cancel (cancellable);
+		g_output_stream_close (out, cancellable, NULL);
+		g_object_unref (cancellable);
+	}
+	g_object_unref (out);
+
+	return ret;
+}
+
+/**
+ * \brief writes a snapshot to a file, gzip compressed if asked to
+ *
+ * The file is only replaced once the snapshot is written completely.
+ * May be called from any thread.
+ */
+gboolean schematic_snapshot_save (SchematicSnapshot *snapshot, const gchar *filename,
+                                  gboolean compress, GError **error)
+{
+	SaveSource src = {NULL, snapshot};
+
+	g_return_val_if_fail (snapshot != NULL, FALSE);
+
+	return save_to_file (&src, filename, compress, save_write_xml, error);
+}
+
+/**
+ * writes the schematic as XML to a stream, without closing it
+ */
+gboolean schematic_write_xml_stream (Schematic *sm, GOutputStream *out, GError **error)
+{
+	SaveSource src = {sm, NULL};
+
+	g_return_val_if_fail (sm != NULL, FALSE);
+	g_return_val_if_fail (G_IS_OUTPUT_STREAM (out), FALSE);
+
+	return save_write_xml (&src, out, error);
+}
+
+// schematic_write_xml
+//
+// Save a Sheet to an XML file.
+gboolean schematic_write_xml (Schematic *sm, GError **error)
+{
+	SaveSource src = {sm, NULL};
+	gchar *filename;
+
+	g_return_val_if_fail (sm != NULL, FALSE);
+
+	filename = schematic_get_filename (sm);
+	if (filename == NULL) {
+		g_warning ("Schematic has no filename!!\n");
+		return FALSE;
 	}
 
-	if (ret < 0)
+	return save_to_file (&src, filename, oregano.compress_files, save_write_xml, error);
+}
+
+/**
+ * \brief saves the schematic in the binary format, which is never
+ * compressed as it is meant to load fast
+ */
+gboolean schematic_write_binary (Schematic *sm, GError **error)
+{
+	SaveSource src = {sm, NULL};
+	gchar *filename;
+
+	g_return_val_if_fail (sm != NULL, FALSE);
+
+	filename = schematic_get_filename (sm);
+	if (filename == NULL) {
+		g_warning ("Schematic has no filename!!\n");
 		return FALSE;
+	}
 
-	return TRUE;
+	return save_to_file (&src, filename, FALSE, save_write_binary, error);
 }
@@ -34,9 +34,23 @@
 #define _SAVE_SCHEMATIC_H
 
 #include <glib.h>
+#include <gio/gio.h>
 
 #include "schematic.h"
 
+typedef struct _SchematicSnapshot SchematicSnapshot;
+
 gboolean schematic_write_xml (Schematic *sm, GError **error);
+gboolean schematic_write_xml_stream (Schematic *sm, GOutputStream *out, GError **error);
+gboolean schematic_write_binary (Schematic *sm, GError **error);
+
+SchematicSnapshot *schematic_snapshot_new (Schematic *sm);
+void schematic_snapshot_free (SchematicSnapshot *snapshot);
+gboolean schematic_snapshot_write (SchematicSnapshot *snapshot, GOutputStream *out,
+                                   GError **error);
+gboolean schematic_snapshot_write_binary (SchematicSnapshot *snapshot, GOutputStream *out,
+                                          GError **error);
+gboolean schematic_snapshot_save (SchematicSnapshot *snapshot, const gchar *filename,
+                                  gboolean compress, GError **error);
 
 #endif
@@ -0,0 +1,152 @@
+/*
+ * schematic-binary.h
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SCHEMATIC_BINARY_H
+#define __SCHEMATIC_BINARY_H
+
+#include <glib.h>
+
+/*
+ * Layout of the binary schematic files (.orebin), which hold the same
+ * schematic as the XML files but load without tokenising the parts and
+ * wires.
+ *
+ * All numbers are little endian, doubles are stored by their bits. The
+ * file starts with SCHEMATIC_BINARY_MAGIC and a guint32 version, padded
+ * to 16 bytes, followed by chunks. A chunk is a guint32 tag, 4 reserved
+ * bytes, a guint64 size and the data, padded to a multiple of 8 bytes.
+ * Chunks with unknown tags are skipped.
+ *
+ * HEAD  the XML document up to the simulation settings, as the XML
+ *       writer starts it, parsed with the XML loader
+ * STRS  NUL terminated strings, referenced by their offset
+ * LPRT  SchematicBinaryLibraryPart records, referenced by their index
+ * PART  SchematicBinaryPart records
+ * PROP  SchematicBinaryProperty records of all parts, in part order
+ * LABL  SchematicBinaryLabel records of all parts, in part order
+ * WIRE  SchematicBinaryWire records, one for each wire segment the XML
+ *       writer saves as points
+ * TBOX  SchematicBinaryTextbox records
+ */
+
+#define SCHEMATIC_BINARY_MAGIC "OREGBIN"
+#define SCHEMATIC_BINARY_VERSION 1
+#define SCHEMATIC_BINARY_HEADER_SIZE 16
+#define SCHEMATIC_BINARY_CHUNK_HEADER_SIZE 16
+
+#define SCHEMATIC_BINARY_TAG(a, b, c, d)                                                           \
+	((guint32)(a) | ((guint32)(b) << 8) | ((guint32)(c) << 16) | ((guint32)(d) << 24))
+
+#define SCHEMATIC_BINARY_TAG_HEAD SCHEMATIC_BINARY_TAG ('H', 'E', 'A', 'D')
+#define SCHEMATIC_BINARY_TAG_STRINGS SCHEMATIC_BINARY_TAG ('S', 'T', 'R', 'S')
+#define SCHEMATIC_BINARY_TAG_LIBRARY_PARTS SCHEMATIC_BINARY_TAG ('L', 'P', 'R', 'T')
+#define SCHEMATIC_BINARY_TAG_PARTS SCHEMATIC_BINARY_TAG ('P', 'A', 'R', 'T')
+#define SCHEMATIC_BINARY_TAG_PROPERTIES SCHEMATIC_BINARY_TAG ('P', 'R', 'O', 'P')
+#define SCHEMATIC_BINARY_TAG_LABELS SCHEMATIC_BINARY_TAG ('L', 'A', 'B', 'L')
+#define SCHEMATIC_BINARY_TAG_WIRES SCHEMATIC_BINARY_TAG ('W', 'I', 'R', 'E')
+#define SCHEMATIC_BINARY_TAG_TEXTBOXES SCHEMATIC_BINARY_TAG ('T', 'B', 'O', 'X')
+
+// the name of a part in a library, and the symbol it is drawn with
+typedef struct
+{
+	guint32 library;
+	guint32 name;
+	guint32 symbol;
+	guint32 reserved;
+} SchematicBinaryLibraryPart;
+
+typedef struct
+{
+	guint32 library_part;
+	gint32 rotation;
+	// IDFlip
+	guint32 flip;
+	guint32 n_properties;
+	guint32 n_labels;
+	guint32 reserved;
+	guint64 x;
+	guint64 y;
+} SchematicBinaryPart;
+
+typedef struct
+{
+	guint32 name;
+	guint32 value;
+} SchematicBinaryProperty;
+
+typedef struct
+{
+	guint32 name;
+	guint32 text;
+	guint64 x;
+	guint64 y;
+} SchematicBinaryLabel;
+
+typedef struct
+{
+	guint64 x0;
+	guint64 y0;
+	guint64 x1;
+	guint64 y1;
+} SchematicBinaryWire;
+
+typedef struct
+{
+	guint32 text;
+	guint32 reserved;
+	guint64 x;
+	guint64 y;
+} SchematicBinaryTextbox;
+
+G_STATIC_ASSERT (sizeof(SchematicBinaryLibraryPart) == 16);
+G_STATIC_ASSERT (sizeof(SchematicBinaryPart) == 40);
+G_STATIC_ASSERT (sizeof(SchematicBinaryProperty) == 8);
+G_STATIC_ASSERT (sizeof(SchematicBinaryLabel) == 24);
+G_STATIC_ASSERT (sizeof(SchematicBinaryWire) == 32);
+G_STATIC_ASSERT (sizeof(SchematicBinaryTextbox) == 24);
+
+static inline guint64 schematic_binary_from_double (gdouble value)
+{
+	union
+	{
+		gdouble d;
+		guint64 u;
+	} v;
+
+	v.d = value;
+	return GUINT64_TO_LE (v.u);
+}
+
+static inline gdouble schematic_binary_to_double (guint64 value)
+{
+	union
+	{
+		gdouble d;
+		guint64 u;
+	} v;
+
+	v.u = GUINT64_FROM_LE (value);
+	return v.d;
+}
+
+#endif
@@ -93,6 +93,8 @@ static GtkActionEntry entries[] = {
      G_CALLBACK (schematic_view_simulate_cmd)},
     {"Netlist", NULL, N_ ("_Generate netlist"), NULL, N_ ("Generate a netlist"),
      G_CALLBACK (netlist_cmd)},
+    {"Subckt", NULL, N_ ("Generate s_ubcircuit"), NULL,
+     N_ ("Save the schematic as subcircuit definition"), G_CALLBACK (subckt_cmd)},
     {"SmartSearch", NULL, N_ ("Smart Search"), NULL, N_ ("Search a part within all the librarys"),
      G_CALLBACK (smartsearch_cmd)},
     {"Log", NULL, N_ ("_Log"), NULL, N_ ("View the latest simulation log"), G_CALLBACK (log_cmd)},
@@ -181,6 +183,7 @@ static const char *ui_description = "<ui>"
                                     "      <menuitem action='Simulate'/>"
                                     "      <separator/>"
                                     "      <menuitem action='Netlist'/>"
+                                    "      <menuitem action='Subckt'/>"
                                     "      <separator/>"
                                     "	   <menuitem action='SmartSearch'/>"
                                     "    </menu>"
@@ -49,6 +49,7 @@
 #include "stock.h"
 #include "oregano.h"
 #include "load-library.h"
+#include "library-index.h"
 #include "netlist-helper.h"
 #include "dialogs.h"
 #include "cursors.h"
@@ -759,17 +760,16 @@ static void v_clamp_cmd (SchematicView *sv)
 	Coords pos;
 	Sheet *sheet;
 	Part *part;
-	GList *lib;
-	Library *l = NULL;
+	Library *l;
 
 	set_tool (sv, SCHEMATIC_TOOL_PART);
 	sheet = sv->priv->sheet;
 
 	// Find default lib
-	for (lib = oregano.libraries; lib; lib = lib->next) {
-		l = (Library *)(lib->data);
-		if (!g_ascii_strcasecmp (l->name, "Default"))
-			break;
+	l = library_index_get_library ("Default");
+	if (l == NULL) {
+		g_warning ("Clamp not found!");
+		return;
 	}
 
 	library_part = library_get_part (l, "Test Clamp");
@@ -878,6 +878,46 @@ static void netlist_cmd (GtkWidget *widget, SchematicView *sv)
 	}
 }
 
+/**
+ * saves the schematic as .subckt definition, which can be placed
+ * as hierarchical block by a library part with a "Subckt" property
+ */
+static void subckt_cmd (GtkWidget *widget, SchematicView *sv)
+{
+	Schematic *sm;
+	gchar *subckt_name, *filename, *name, *definition;
+	GError *e = NULL;
+
+	g_return_if_fail (sv != NULL);
+
+	sm = sv->priv->schematic;
+
+	subckt_name = dialog_netlist_file (sv);
+	if (subckt_name == NULL)
+		return;
+
+	// the block is named after the schematic file
+	filename = schematic_get_filename (sm);
+	name = g_path_get_basename (filename ? filename : _ ("Untitled"));
+	if (strrchr (name, '.'))
+		*strrchr (name, '.') = '\0';
+	g_strdelimit (name, " \t.", '_');
+
+	definition = netlist_helper_create_subckt (sm, name, NULL, &e);
+	if (definition)
+		g_file_set_contents (subckt_name, definition, -1, &e);
+
+	g_free (definition);
+	g_free (name);
+	g_free (subckt_name);
+
+	if (e) {
+		log_append_error (schematic_get_log_store (sm), _ ("SchematicView"),
+		                  _ ("Could not create a subcircuit."), e);
+		g_clear_error (&e);
+	}
+}
+
 static void netlist_view_cmd (GtkWidget *widget, SchematicView *sv)
 {
 	netlist_editor_new_from_schematic_view (sv);
@@ -47,6 +47,7 @@
 #include "dialogs.h"
 #include "oregano-utils.h"
 #include "oregano-config.h"
+#include "autosave.h"
 
 typedef struct
 {
@@ -57,6 +58,7 @@ typedef struct
 	GtkWidget *w_show_log;
 
 	GtkWidget *w_compress_files;
+	GtkWidget *w_autosave_interval;
 	GtkWidget *w_engine;
 } Settings;
 
@@ -69,6 +71,9 @@ static void apply_callback (GtkWidget *w, Settings *s)
 {
 	oregano.engine = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (s->w_engine), "id"));
 	oregano.compress_files = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (s->w_compress_files));
+	oregano.autosave_interval =
+	    gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (s->w_autosave_interval));
+	autosave_set_interval (oregano.autosave_interval);
 	if (s->w_show_log)
 		oregano.show_log = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (s->w_show_log));
 	else
@@ -195,6 +200,10 @@ void settings_show (GtkWidget *widget, SchematicView *sv)
 	w = GTK_WIDGET (gtk_builder_get_object (gui, "compress-enable"));
 	s->w_compress_files = w;
 	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (w), oregano.compress_files);
+
+	w = GTK_WIDGET (gtk_builder_get_object (gui, "autosave-interval"));
+	s->w_autosave_interval = w;
+	gtk_spin_button_set_value (GTK_SPIN_BUTTON (w), oregano.autosave_interval);
 	if (engine_available) {
 		w = GTK_WIDGET (gtk_builder_get_object (gui, "log-enable"));
 		s->w_show_log = w;
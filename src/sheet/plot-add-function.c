@@ -37,6 +37,15 @@
 #include "plot-add-function.h"
 #include "dialogs.h"
 #include "simulation.h"
+#include "simulation-function.h"
+
+// unary functions only take the first operand
+static void function_type_changed (GtkComboBox *functiontype, GtkWidget *op2)
+{
+	gint type = gtk_combo_box_get_active (functiontype);
+
+	gtk_widget_set_sensitive (op2, type == -1 || !simulation_function_is_unary (type));
+}
 
 void plot_add_function_show (OreganoEngine *engine, SimulationData *current)
 {
@@ -46,6 +55,7 @@ void plot_add_function_show (OreganoEngine *engine, SimulationData *current)
 	GtkComboBoxText *op1, *op2, *functiontype;
 	int i;
 	gint result = 0;
+	gboolean need_op2;
 	GtkWidget *warning;
 	GtkWidget *container_temp;
 
@@ -96,13 +106,17 @@ void plot_add_function_show (OreganoEngine *engine, SimulationData *current)
 	}
 	gtk_combo_box_set_active (GTK_COMBO_BOX (op1), 0);
 	gtk_combo_box_set_active (GTK_COMBO_BOX (op2), 1);
+	g_signal_connect (G_OBJECT (functiontype), "changed", G_CALLBACK (function_type_changed), op2);
 	gtk_combo_box_set_active (GTK_COMBO_BOX (functiontype), 0);
 
 	result = gtk_dialog_run (GTK_DIALOG (dialog));
 
+	need_op2 = gtk_combo_box_get_active (GTK_COMBO_BOX (functiontype)) == -1 ||
+	           !simulation_function_is_unary (gtk_combo_box_get_active (GTK_COMBO_BOX (functiontype)));
+
 	if ((result == GTK_RESPONSE_OK) &&
 	    ((gtk_combo_box_get_active (GTK_COMBO_BOX (op1)) == -1) ||
-	     (gtk_combo_box_get_active (GTK_COMBO_BOX (op2)) == -1) ||
+	     (need_op2 && gtk_combo_box_get_active (GTK_COMBO_BOX (op2)) == -1) ||
 	     (gtk_combo_box_get_active (GTK_COMBO_BOX (functiontype)) == -1))) {
 		warning = gtk_message_dialog_new_with_markup (
 		    NULL, GTK_DIALOG_MODAL, GTK_MESSAGE_WARNING, GTK_BUTTONS_OK,
@@ -121,7 +135,7 @@ void plot_add_function_show (OreganoEngine *engine, SimulationData *current)
 
 	if ((result == GTK_RESPONSE_OK) &&
 	    ((gtk_combo_box_get_active (GTK_COMBO_BOX (op1)) != -1) &&
-	     (gtk_combo_box_get_active (GTK_COMBO_BOX (op2)) != -1) &&
+	     (!need_op2 || gtk_combo_box_get_active (GTK_COMBO_BOX (op2)) != -1) &&
 	     (gtk_combo_box_get_active (GTK_COMBO_BOX (functiontype)) != -1))) {
 
 		func->type = gtk_combo_box_get_active (GTK_COMBO_BOX (functiontype));
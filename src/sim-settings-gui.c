@@ -381,6 +381,24 @@ static void noise_enable_cb (GtkWidget *widget, SimSettingsGui *s)
 	gtk_widget_set_sensitive (s->w_noise_frame, enable);
 }
 
+/**
+ * adds the check button to keep the results of an analysis compact
+ * below its other settings
+ */
+static GtkWidget *compact_check_new (GtkWidget *grid, gint row, gboolean active)
+{
+	GtkWidget *w;
+
+	w = gtk_check_button_new_with_label (_ ("Compact Results"));
+	gtk_widget_set_tooltip_text (
+	    w, _ ("Keep the results in single precision, which takes about half the memory"));
+	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (w), active);
+	gtk_grid_attach (GTK_GRID (grid), w, 0, row, 2, 1);
+	gtk_widget_show (w);
+
+	return w;
+}
+
 static void response_callback (GtkButton *button, SchematicView *sv)
 {
 	g_return_if_fail (sv != NULL);
@@ -419,9 +437,13 @@ static void response_callback (GtkButton *button, SchematicView *sv)
 	s->trans_analyze_all =
 	    gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (s_gui->w_trans_analyze_all));
 
+	s->trans_compact = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (s_gui->w_trans_compact));
+
 	// DC
 	s->dc_enable = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (s_gui->w_dc_enable));
 
+	s->dc_compact = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (s_gui->w_dc_compact));
+
 	g_free (s->dc_vin);
 	s->dc_vin = gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT (s_gui->w_dc_vin));
 
@@ -457,6 +479,8 @@ static void response_callback (GtkButton *button, SchematicView *sv)
 	// AC
 	s->ac_enable = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (s_gui->w_ac_enable));
 
+	s->ac_compact = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (s_gui->w_ac_compact));
+
 	g_free (s->ac_vout);
 	s->ac_vout = NULL;
 	tmp = gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT (s_gui->w_ac_vout));
@@ -498,6 +522,8 @@ static void response_callback (GtkButton *button, SchematicView *sv)
 	// Noise
 	s->noise_enable = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (s_gui->w_noise_enable));
 
+	s->noise_compact = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (s_gui->w_noise_compact));
+
 	g_free (s->noise_vin);
 	s->noise_vin = gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT (s_gui->w_noise_vin));
 
@@ -845,6 +871,9 @@ void sim_settings_show (GtkWidget *widget, SchematicView *sv)
 	// - user opened old file in which there was set the checkbox state to true
 	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (w), s->trans_analyze_all);
 
+	w1 = GTK_WIDGET (gtk_builder_get_object (builder, "grid11"));
+	s_gui->w_trans_compact = compact_check_new (w1, 3, s->trans_compact);
+
 	// AC  //
 	// *** //
 	w = GTK_WIDGET (gtk_builder_get_object (builder, "ac_enable"));
@@ -853,6 +882,7 @@ void sim_settings_show (GtkWidget *widget, SchematicView *sv)
 	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (w), s->ac_enable);
 
 	w1 = GTK_WIDGET (gtk_builder_get_object (builder, "grid14"));
+	s_gui->w_ac_compact = compact_check_new (w1, 5, s->ac_compact);
 
 	// FIXME: Should enable more than just one output as in the Fourier analysis
 	w = GTK_WIDGET (gtk_builder_get_object (builder, "ac_vout"));
@@ -918,6 +948,7 @@ void sim_settings_show (GtkWidget *widget, SchematicView *sv)
 	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (w), s->dc_enable);
 
 	w1 = GTK_WIDGET (gtk_builder_get_object (builder, "grid13"));
+	s_gui->w_dc_compact = compact_check_new (w1, 5, s->dc_compact);
 	w = GTK_WIDGET (gtk_builder_get_object (builder, "dc_vin"));
 	gtk_widget_destroy (w); // FIXME wtf??
 	combo_box = gtk_combo_box_text_new ();
@@ -1090,6 +1121,7 @@ void sim_settings_show (GtkWidget *widget, SchematicView *sv)
 	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (w), s->noise_enable);
 
 	w1 = GTK_WIDGET (gtk_builder_get_object (builder, "grid1"));
+	s_gui->w_noise_compact = compact_check_new (w1, 6, s->noise_compact);
 
 	w = GTK_WIDGET (gtk_builder_get_object (builder, "noise_vin"));
 	gtk_widget_destroy (w); // FIXME wtf??
@@ -59,6 +59,7 @@ struct _SimSettingsGui {
 	          *w_trans_step_enable,
 	          *w_trans_init_cond,
 	          *w_trans_analyze_all,
+	          *w_trans_compact,
 	          *w_trans_frame;
 
 	// AC
@@ -68,6 +69,7 @@ struct _SimSettingsGui {
 	          *w_ac_npoints,
 	          *w_ac_start,
 	          *w_ac_stop,
+	          *w_ac_compact,
 	          *w_ac_frame;
 
 	// DC
@@ -77,6 +79,7 @@ struct _SimSettingsGui {
 		  *w_dc_start,
 	          *w_dc_stop,
 	          *w_dc_step,
+	          *w_dc_compact,
 	          *w_dcsweep_frame;
 
 	// Fourier analysis. Replace with something sane later.
@@ -96,6 +99,7 @@ struct _SimSettingsGui {
 	          *w_noise_npoints,
 	          *w_noise_start,
 	          *w_noise_stop,
+	          *w_noise_compact,
 	          *w_noise_frame;
 
 	GtkEntry *w_opt_value;
@@ -141,6 +141,57 @@ void sim_settings_finalize(SimSettings *sim_settings) {
 	g_free(sim_settings);
 }
 
+static gpointer sim_option_copy (gconstpointer src, gpointer user_data)
+{
+	const SimOption *option = src;
+	SimOption *copy = g_new0 (SimOption, 1);
+
+	copy->name = g_strdup (option->name);
+	copy->value = g_strdup (option->value);
+	return copy;
+}
+
+/**
+ * @returns a deep copy of the settings, which does not change when the
+ * user edits the original
+ */
+SimSettings *sim_settings_copy (const SimSettings *sim_settings)
+{
+	SimSettings *copy;
+
+	copy = g_memdup (sim_settings, sizeof(SimSettings));
+
+	copy->trans_start = g_strdup (sim_settings->trans_start);
+	copy->trans_stop = g_strdup (sim_settings->trans_stop);
+	copy->trans_step = g_strdup (sim_settings->trans_step);
+
+	copy->ac_vout = g_strdup (sim_settings->ac_vout);
+	copy->ac_type = g_strdup (sim_settings->ac_type);
+	copy->ac_npoints = g_strdup (sim_settings->ac_npoints);
+	copy->ac_start = g_strdup (sim_settings->ac_start);
+	copy->ac_stop = g_strdup (sim_settings->ac_stop);
+
+	copy->dc_vin = g_strdup (sim_settings->dc_vin);
+	copy->dc_vout = g_strdup (sim_settings->dc_vout);
+	copy->dc_start = g_strdup (sim_settings->dc_start);
+	copy->dc_stop = g_strdup (sim_settings->dc_stop);
+	copy->dc_step = g_strdup (sim_settings->dc_step);
+
+	copy->fourier_frequency = g_strdup (sim_settings->fourier_frequency);
+	copy->fourier_vout = g_slist_copy_deep (sim_settings->fourier_vout, (GCopyFunc)g_strdup, NULL);
+
+	copy->noise_vin = g_strdup (sim_settings->noise_vin);
+	copy->noise_vout = g_strdup (sim_settings->noise_vout);
+	copy->noise_type = g_strdup (sim_settings->noise_type);
+	copy->noise_npoints = g_strdup (sim_settings->noise_npoints);
+	copy->noise_start = g_strdup (sim_settings->noise_start);
+	copy->noise_stop = g_strdup (sim_settings->noise_stop);
+
+	copy->options = g_list_copy_deep (sim_settings->options, sim_option_copy, NULL);
+
+	return copy;
+}
+
 gchar *fourier_add_vout(SimSettings *sim_settings, guint node_index) {
 	gboolean result;
 	guint i;
@@ -277,6 +328,16 @@ void sim_settings_set_trans_analyze_all (SimSettings *sim_settings, gboolean ena
 	sim_settings->trans_analyze_all = enable;
 }
 
+gboolean sim_settings_get_trans_compact (const SimSettings *sim_settings)
+{
+	return sim_settings->trans_compact;
+}
+
+void sim_settings_set_trans_compact (SimSettings *sim_settings, gboolean enable)
+{
+	sim_settings->trans_compact = enable;
+}
+
 void sim_settings_set_trans_stop (SimSettings *sim_settings, gchar *str)
 {
 	if (sim_settings->trans_stop)
@@ -322,6 +383,16 @@ void sim_settings_set_ac (SimSettings *sim_settings, gboolean enable)
 	sim_settings->ac_enable = enable;
 }
 
+gboolean sim_settings_get_ac_compact (const SimSettings *sim_settings)
+{
+	return sim_settings->ac_compact;
+}
+
+void sim_settings_set_ac_compact (SimSettings *sim_settings, gboolean enable)
+{
+	sim_settings->ac_compact = enable;
+}
+
 void sim_settings_set_ac_vout (SimSettings *sim_settings, gchar *str)
 {
 	g_free (sim_settings->ac_vout);
@@ -378,6 +449,16 @@ void sim_settings_set_dc (SimSettings *sim_settings, gboolean enable)
 	sim_settings->dc_enable = enable;
 }
 
+gboolean sim_settings_get_dc_compact (const SimSettings *sim_settings)
+{
+	return sim_settings->dc_compact;
+}
+
+void sim_settings_set_dc_compact (SimSettings *sim_settings, gboolean enable)
+{
+	sim_settings->dc_compact = enable;
+}
+
 void sim_settings_set_dc_vsrc (SimSettings *sim_settings, gchar *str)
 {
 	g_free (sim_settings->dc_vin);
@@ -550,6 +631,16 @@ void sim_settings_set_noise (SimSettings *sim_settings, gboolean enable)
 	sim_settings->noise_enable = enable;
 }
 
+gboolean sim_settings_get_noise_compact (const SimSettings *sim_settings)
+{
+	return sim_settings->noise_compact;
+}
+
+void sim_settings_set_noise_compact (SimSettings *sim_settings, gboolean enable)
+{
+	sim_settings->noise_compact = enable;
+}
+
 void sim_settings_set_noise_vsrc (SimSettings *sim_settings, gchar *str)
 {
 	g_free (sim_settings->noise_vin);
@@ -43,6 +43,8 @@ typedef struct {
 	gboolean trans_enable;
 	gboolean trans_init_cond;
 	gboolean trans_analyze_all;
+	// keep the results as floats or progressions, see SimulationColumn
+	gboolean trans_compact;
 	gchar *trans_start;
 	gchar *trans_stop;
 	gchar *trans_step;
@@ -50,6 +52,7 @@ typedef struct {
 
 	// AC
 	gboolean ac_enable;
+	gboolean ac_compact;
 	gchar *ac_vout;
 	gchar *ac_type;
 	gchar *ac_npoints;
@@ -58,6 +61,7 @@ typedef struct {
 
 	// DC
 	gboolean dc_enable;
+	gboolean dc_compact;
 	gchar *dc_vin;
 	gchar *dc_vout;
 	gchar *dc_start, *dc_stop, *dc_step;
@@ -70,6 +74,7 @@ typedef struct {
 
 	// Noise
 	gboolean noise_enable;
+	gboolean noise_compact;
 	gchar *noise_vin;
 	gchar *noise_vout;
 	gchar *noise_type;
@@ -91,6 +96,8 @@ SimSettings *sim_settings_new ();
 
 void sim_settings_finalize(SimSettings *s);
 
+SimSettings *sim_settings_copy (const SimSettings *s);
+
 gdouble sim_settings_get_trans_start (const SimSettings *sim_settings);
 
 gdouble sim_settings_get_trans_stop (const SimSettings *sim_settings);
@@ -119,6 +126,10 @@ void sim_settings_set_trans_init_cond (SimSettings *sim_settings, gboolean enabl
 
 void sim_settings_set_trans_analyze_all (SimSettings *sim_settings, gboolean enable);
 
+gboolean sim_settings_get_trans_compact (const SimSettings *sim_settings);
+
+void sim_settings_set_trans_compact (SimSettings *sim_settings, gboolean enable);
+
 gboolean sim_settings_get_dc (const SimSettings *);
 
 gchar *sim_settings_get_dc_vsrc (const SimSettings *);
@@ -135,6 +146,10 @@ gdouble sim_settings_get_dc_step (const SimSettings *);
 
 void sim_settings_set_dc (SimSettings *, gboolean);
 
+gboolean sim_settings_get_dc_compact (const SimSettings *);
+
+void sim_settings_set_dc_compact (SimSettings *, gboolean);
+
 void sim_settings_set_dc_vsrc (SimSettings *, gchar *);
 
 void sim_settings_set_dc_vout (SimSettings *, gchar *);
@@ -159,6 +174,10 @@ gdouble sim_settings_get_ac_stop (const SimSettings *);
 
 void sim_settings_set_ac (SimSettings *, gboolean);
 
+gboolean sim_settings_get_ac_compact (const SimSettings *);
+
+void sim_settings_set_ac_compact (SimSettings *, gboolean);
+
 void sim_settings_set_ac_vout (SimSettings *, gchar *);
 
 void sim_settings_set_ac_type (SimSettings *, gchar *);
@@ -199,6 +218,10 @@ gdouble sim_settings_get_noise_stop (const SimSettings *);
 
 void sim_settings_set_noise (SimSettings *, gboolean);
 
+gboolean sim_settings_get_noise_compact (const SimSettings *);
+
+void sim_settings_set_noise_compact (SimSettings *, gboolean);
+
 void sim_settings_set_noise_vsrc (SimSettings *, gchar *);
 
 void sim_settings_set_noise_vout (SimSettings *, gchar *);
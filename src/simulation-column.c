@@ -0,0 +1,209 @@
+/*
+ * simulation-column.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <math.h>
+#include <float.h>
+#include <string.h>
+
+#include "simulation-column.h"
+
+#include "debug.h"
+
+// the residuals of an affine column must be this much smaller than
+// its samples, else floats are as good
+#define SIMULATION_COLUMN_AFFINE_RATIO (1. / 16.)
+
+/**
+ * \brief encodes a column of doubles
+ *
+ * Picks the smallest encoding which keeps at least float precision.
+ */
+SimulationColumn *simulation_column_encode (const gdouble *values, guint len)
+{
+	SimulationColumn *column;
+	gdouble max_value = 0., max_residual = 0.;
+	guint i;
+
+	column = g_new0 (SimulationColumn, 1);
+	column->len = len;
+
+	for (i = 0; i < len; i++)
+		max_value = MAX (max_value, fabs (values[i]));
+
+	if (len >= 2 && isfinite (max_value)) {
+		column->offset = values[0];
+		column->step = (values[len - 1] - values[0]) / (len - 1);
+		for (i = 0; i < len; i++)
+			max_residual =
+			    MAX (max_residual, fabs (values[i] - (column->offset + column->step * i)));
+
+		if (max_residual == 0.) {
+			column->encoding = SIMULATION_COLUMN_AFFINE;
+			return column;
+		}
+		if (max_residual < max_value * SIMULATION_COLUMN_AFFINE_RATIO) {
+			gfloat *residuals = g_new (gfloat, len);
+
+			for (i = 0; i < len; i++)
+				residuals[i] = values[i] - (column->offset + column->step * i);
+			column->encoding = SIMULATION_COLUMN_AFFINE;
+			column->values = residuals;
+			return column;
+		}
+	}
+
+	if (max_value <= FLT_MAX) {
+		gfloat *samples = g_new (gfloat, len);
+
+		for (i = 0; i < len; i++)
+			samples[i] = values[i];
+		column->encoding = SIMULATION_COLUMN_FLOAT;
+		column->values = samples;
+	} else {
+		column->encoding = SIMULATION_COLUMN_DOUBLE;
+		column->values = g_new (gdouble, len);
+		memcpy (column->values, values, len * sizeof(gdouble));
+	}
+	return column;
+}
+
+/**
+ * @param out room for column->len doubles
+ */
+void simulation_column_decode (const SimulationColumn *column, gdouble *out)
+{
+	const gfloat *samples = column->values;
+	guint i;
+
+	switch (column->encoding) {
+	case SIMULATION_COLUMN_DOUBLE:
+		memcpy (out, column->values, column->len * sizeof(gdouble));
+		break;
+	case SIMULATION_COLUMN_FLOAT:
+		for (i = 0; i < column->len; i++)
+			out[i] = samples[i];
+		break;
+	case SIMULATION_COLUMN_AFFINE:
+		for (i = 0; i < column->len; i++)
+			out[i] = column->offset + column->step * i;
+		if (samples)
+			for (i = 0; i < column->len; i++)
+				out[i] += samples[i];
+		break;
+	}
+}
+
+/**
+ * @returns the bytes held by the column
+ */
+gsize simulation_column_get_size (const SimulationColumn *column)
+{
+	gsize size = sizeof(SimulationColumn);
+
+	if (column->encoding == SIMULATION_COLUMN_DOUBLE)
+		size += column->len * sizeof(gdouble);
+	else if (column->values)
+		size += column->len * sizeof(gfloat);
+	return size;
+}
+
+void simulation_column_free (SimulationColumn *column)
+{
+	if (column == NULL)
+		return;
+	g_free (column->values);
+	g_free (column);
+}
+
+/**
+ * \brief replaces the in-memory columns of an analysis by encoded ones
+ *
+ * Does nothing for analyses which are compact already or kept in a
+ * SimulationStore.
+ */
+void simulation_data_compact (SimulationData *data)
+{
+	gsize before = 0, after = 0;
+	gint i;
+
+	g_return_if_fail (data != NULL);
+
+	if (data->compact || data->mapped || !data->data)
+		return;
+
+	data->compact = g_new0 (SimulationColumn *, data->n_variables + 1);
+	for (i = 0; i < data->n_variables; i++) {
+		GArray *array = data->data[i];
+
+		data->compact[i] = simulation_column_encode ((const gdouble *)array->data, array->len);
+		before += array->len * sizeof(gdouble);
+		after += simulation_column_get_size (data->compact[i]);
+		g_array_unref (array);
+		data->data[i] = NULL;
+	}
+	NG_DEBUG ("compacted %d columns from %" G_GSIZE_FORMAT " to %" G_GSIZE_FORMAT " bytes",
+	          data->n_variables, before, after);
+}
+
+/**
+ * \brief a column of an analysis as doubles
+ *
+ * Columns in memory are shared, encoded ones are decoded and mapped
+ * ones copied.
+ *
+ * @param keep keep the decoded column with data, for columns used over
+ * and over like x
+ * @returns a new reference
+ */
+GArray *simulation_data_decode_column (SimulationData *data, guint i, gboolean keep)
+{
+	const gdouble *values;
+	GArray *array;
+	guint len;
+
+	g_return_val_if_fail (data != NULL, NULL);
+	g_return_val_if_fail (i < data->n_variables, NULL);
+
+	if (data->data && data->data[i])
+		return g_array_ref (data->data[i]);
+
+	if (data->compact) {
+		len = data->compact[i]->len;
+		array = g_array_sized_new (FALSE, FALSE, sizeof(gdouble), len);
+		g_array_set_size (array, len);
+		simulation_column_decode (data->compact[i], (gdouble *)array->data);
+		if (keep) {
+			if (!data->data)
+				data->data = g_new0 (GArray *, data->n_variables + 1);
+			data->data[i] = g_array_ref (array);
+		}
+		return array;
+	}
+
+	g_return_val_if_fail (data->mapped != NULL, NULL);
+	values = g_bytes_get_data (data->mapped[i], NULL);
+	len = g_bytes_get_size (data->mapped[i]) / sizeof(gdouble);
+	array = g_array_sized_new (FALSE, FALSE, sizeof(gdouble), len);
+	g_array_append_vals (array, values, len);
+	return array;
+}
@@ -0,0 +1,64 @@
+/*
+ * simulation-column.h
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SIMULATION_COLUMN_H
+#define __SIMULATION_COLUMN_H
+
+#include <glib.h>
+
+#include "simulation.h"
+
+typedef enum {
+	SIMULATION_COLUMN_DOUBLE = 0, ///< doubles, for values beyond the float range
+	SIMULATION_COLUMN_FLOAT,      ///< float samples
+	SIMULATION_COLUMN_AFFINE      ///< offset + i * step, plus float residuals if not exact
+} SimulationColumnEncoding;
+
+/**
+ * A result column in less memory than plain doubles.
+ *
+ * Node voltages and currents are kept as floats. Columns which are
+ * nearly arithmetic, like the time of a transient analysis, are kept
+ * as a line through the first and last sample plus the float distance
+ * of each sample from it, which keeps more precision than floats. Exact
+ * progressions need no samples at all.
+ */
+struct _SimulationColumn
+{
+	SimulationColumnEncoding encoding;
+	guint len;
+	gdouble offset;
+	gdouble step;
+	// the samples or residuals, NULL for exact progressions
+	gpointer values;
+};
+
+SimulationColumn *simulation_column_encode (const gdouble *values, guint len);
+void simulation_column_decode (const SimulationColumn *column, gdouble *out);
+gsize simulation_column_get_size (const SimulationColumn *column);
+void simulation_column_free (SimulationColumn *column);
+
+void simulation_data_compact (SimulationData *data);
+GArray *simulation_data_decode_column (SimulationData *data, guint i, gboolean keep);
+
+#endif
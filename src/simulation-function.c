@@ -0,0 +1,410 @@
+/*
+ * simulation-function.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <glib/gi18n.h>
+
+#include "simulation-function.h"
+#include "simulation-store.h"
+
+#include "debug.h"
+
+gboolean simulation_function_is_unary (SimulationFunctionType type)
+{
+	switch (type) {
+	case FUNCTION_SUBTRACT:
+	case FUNCTION_DIVIDE:
+	case FUNCTION_ADD:
+	case FUNCTION_MULTIPLY:
+		return FALSE;
+	default:
+		return TRUE;
+	}
+}
+
+static GArray *simulation_function_column_new (guint len)
+{
+	GArray *column;
+
+	column = g_array_sized_new (FALSE, FALSE, sizeof(gdouble), len);
+	g_array_set_size (column, len);
+	return column;
+}
+
+/**
+ * element-wise operators of two columns, the switch is hoisted out of
+ * the loops so each of them is a plain candidate for vectorisation
+ */
+static void simulation_function_binary (SimulationFunctionType type,
+                                        const gdouble *restrict a, const gdouble *restrict b,
+                                        gdouble *restrict out, guint len)
+{
+	guint start, end, i;
+
+	for (start = 0; start < len; start += SIMULATION_FUNCTION_BLOCK) {
+		end = MIN (start + SIMULATION_FUNCTION_BLOCK, len);
+
+		switch (type) {
+		case FUNCTION_SUBTRACT:
+			for (i = start; i < end; i++)
+				out[i] = a[i] - b[i];
+			break;
+		case FUNCTION_ADD:
+			for (i = start; i < end; i++)
+				out[i] = a[i] + b[i];
+			break;
+		case FUNCTION_MULTIPLY:
+			for (i = start; i < end; i++)
+				out[i] = a[i] * b[i];
+			break;
+		case FUNCTION_DIVIDE:
+			// small or negative divisors saturate, as they always did
+			for (i = start; i < end; i++) {
+				gdouble saturated = a[i] < 0 ? -G_MAXDOUBLE : G_MAXDOUBLE;
+				gdouble quotient = a[i] / b[i];
+				out[i] = b[i] < 0.000001f ? saturated : quotient;
+			}
+			break;
+		default:
+			g_assert_not_reached ();
+		}
+	}
+}
+
+static void simulation_function_abs (const gdouble *restrict a, gdouble *restrict out, guint len,
+                                     gboolean decibel)
+{
+	guint start, end, i;
+
+	for (start = 0; start < len; start += SIMULATION_FUNCTION_BLOCK) {
+		end = MIN (start + SIMULATION_FUNCTION_BLOCK, len);
+
+		for (i = start; i < end; i++)
+			out[i] = fabs (a[i]);
+		if (decibel)
+			for (i = start; i < end; i++)
+				out[i] = 20. * log10 (MAX (out[i], DBL_MIN));
+	}
+}
+
+/**
+ * central differences, one sided at both ends, 0 where x does not move
+ */
+static void simulation_function_derivative (const gdouble *restrict x, const gdouble *restrict a,
+                                            gdouble *restrict out, guint len)
+{
+	guint start, end, i;
+
+	if (len < 2) {
+		if (len == 1)
+			out[0] = 0.;
+		return;
+	}
+
+	for (start = 1; start < len - 1; start += SIMULATION_FUNCTION_BLOCK) {
+		end = MIN (start + SIMULATION_FUNCTION_BLOCK, len - 1);
+
+		for (i = start; i < end; i++) {
+			gdouble dx = x[i + 1] - x[i - 1];
+			gdouble slope = (a[i + 1] - a[i - 1]) / dx;
+			out[i] = dx != 0. ? slope : 0.;
+		}
+	}
+
+	out[0] = x[1] != x[0] ? (a[1] - a[0]) / (x[1] - x[0]) : 0.;
+	out[len - 1] = x[len - 1] != x[len - 2]
+	                   ? (a[len - 1] - a[len - 2]) / (x[len - 1] - x[len - 2])
+	                   : 0.;
+}
+
+/**
+ * running integral by the trapezoidal rule, starting at 0
+ */
+static void simulation_function_integral (const gdouble *restrict x, const gdouble *restrict a,
+                                          gdouble *restrict out, guint len)
+{
+	guint start, end, i;
+	gdouble sum = 0.;
+
+	if (len == 0)
+		return;
+
+	out[0] = 0.;
+	for (start = 1; start < len; start += SIMULATION_FUNCTION_BLOCK) {
+		end = MIN (start + SIMULATION_FUNCTION_BLOCK, len);
+
+		// the areas of the block vectorise, only the sum is sequential
+		for (i = start; i < end; i++)
+			out[i] = 0.5 * (a[i] + a[i - 1]) * (x[i] - x[i - 1]);
+		for (i = start; i < end; i++) {
+			sum += out[i];
+			out[i] = sum;
+		}
+	}
+}
+
+/**
+ * centred moving average, the window shrinks towards both ends
+ */
+static void simulation_function_moving_average (const gdouble *restrict a, gdouble *restrict out,
+                                                guint len, guint window)
+{
+	guint half = window / 2, i, lo, hi;
+	gdouble sum = 0.;
+
+	if (len == 0)
+		return;
+
+	// the window around sample 0
+	hi = MIN (half, len - 1);
+	for (i = 0; i <= hi; i++)
+		sum += a[i];
+
+	for (i = 0; i < len; i++) {
+		lo = i > half ? i - half : 0;
+		out[i] = sum / (hi - lo + 1);
+
+		// slide to sample i + 1
+		if (i + half + 1 < len) {
+			hi = i + half + 1;
+			sum += a[hi];
+		}
+		if (i >= half)
+			sum -= a[i - half];
+	}
+}
+
+/**
+ * in place radix 2 FFT, n has to be a power of 2
+ */
+static void simulation_function_fft (gdouble *re, gdouble *im, guint n)
+{
+	gdouble *twiddle_re, *twiddle_im;
+	guint i, j, k, len, step;
+
+	for (i = 1, j = 0; i < n; i++) {
+		guint bit = n >> 1;
+
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j) {
+			gdouble t;
+
+			t = re[i], re[i] = re[j], re[j] = t;
+			t = im[i], im[i] = im[j], im[j] = t;
+		}
+	}
+
+	// a table is more precise than rotating the twiddle factor
+	twiddle_re = g_new (gdouble, n / 2 + 1);
+	twiddle_im = g_new (gdouble, n / 2 + 1);
+	for (k = 0; k < n / 2; k++) {
+		twiddle_re[k] = cos (-2. * G_PI * k / n);
+		twiddle_im[k] = sin (-2. * G_PI * k / n);
+	}
+
+	for (len = 2; len <= n; len <<= 1) {
+		step = n / len;
+		for (i = 0; i < n; i += len) {
+			for (k = 0; k < len / 2; k++) {
+				guint a = i + k, b = i + k + len / 2;
+				gdouble wre = twiddle_re[k * step], wim = twiddle_im[k * step];
+				gdouble tre = re[b] * wre - im[b] * wim;
+				gdouble tim = re[b] * wim + im[b] * wre;
+
+				re[b] = re[a] - tre;
+				im[b] = im[a] - tim;
+				re[a] += tre;
+				im[a] += tim;
+			}
+		}
+	}
+
+	g_free (twiddle_re);
+	g_free (twiddle_im);
+}
+
+/**
+ * single sided amplitude spectrum of a, linearly resampled onto an even
+ * grid of a power of 2 points first, as simulators use variable steps
+ */
+static gboolean simulation_function_fft_magnitude (const gdouble *x, const gdouble *a, guint len,
+                                                   GArray **x_out, GArray **y_out)
+{
+	gdouble *re, *im, *freq, *mag;
+	gdouble dt;
+	guint n, k, i;
+
+	if (len < 2 || !(x[len - 1] > x[0]))
+		return FALSE;
+	for (i = 1; i < len; i++)
+		if (x[i] < x[i - 1])
+			return FALSE;
+
+	for (n = 2; n < len && n < SIMULATION_FUNCTION_FFT_MAX_POINTS; n <<= 1)
+		;
+	dt = (x[len - 1] - x[0]) / (n - 1);
+
+	re = g_new (gdouble, n);
+	im = g_new0 (gdouble, n);
+	for (k = 0, i = 0; k < n; k++) {
+		gdouble t = x[0] + k * dt;
+
+		while (i + 2 < len && x[i + 1] < t)
+			i++;
+		if (x[i + 1] > x[i])
+			re[k] = a[i] + (a[i + 1] - a[i]) * (t - x[i]) / (x[i + 1] - x[i]);
+		else
+			re[k] = a[i];
+	}
+
+	simulation_function_fft (re, im, n);
+
+	*x_out = simulation_function_column_new (n / 2 + 1);
+	*y_out = simulation_function_column_new (n / 2 + 1);
+	freq = (gdouble *)(*x_out)->data;
+	mag = (gdouble *)(*y_out)->data;
+	for (k = 0; k <= n / 2; k++) {
+		freq[k] = k / (n * dt);
+		mag[k] = hypot (re[k], im[k]) / n * ((k == 0 || k == n / 2) ? 1. : 2.);
+	}
+
+	g_free (re);
+	g_free (im);
+	return TRUE;
+}
+
+/**
+ * \brief computes the trace of a derived function
+ *
+ * @param func the function, unary ones only use func->first
+ * @param data the analysis holding the operand columns
+ * @param x [out] the x column, a new reference
+ * @param y [out] the computed y column, a new reference
+ * @returns FALSE if the function can not be computed for data
+ */
+gboolean simulation_function_evaluate (const SimulationFunction *func, SimulationData *data,
+                                       GArray **x, GArray **y)
+{
+	const gdouble *xs, *a, *b = NULL;
+	gdouble *out;
+	guint len, x_len, a_len, b_len;
+
+	g_return_val_if_fail (func != NULL, FALSE);
+	g_return_val_if_fail (data != NULL, FALSE);
+	g_return_val_if_fail (func->first < data->n_variables, FALSE);
+
+	xs = simulation_data_get_column (data, 0, &x_len);
+	a = simulation_data_get_column (data, func->first, &a_len);
+	len = MIN (x_len, a_len);
+
+	if (func->type == FUNCTION_FFT_MAGNITUDE)
+		return simulation_function_fft_magnitude (xs, a, len, x, y);
+
+	if (!simulation_function_is_unary (func->type)) {
+		g_return_val_if_fail (func->second < data->n_variables, FALSE);
+		b = simulation_data_get_column (data, func->second, &b_len);
+		len = MIN (len, b_len);
+	}
+
+	*y = simulation_function_column_new (len);
+	out = (gdouble *)(*y)->data;
+
+	switch (func->type) {
+	case FUNCTION_SUBTRACT:
+	case FUNCTION_DIVIDE:
+	case FUNCTION_ADD:
+	case FUNCTION_MULTIPLY:
+		simulation_function_binary (func->type, a, b, out, len);
+		break;
+	case FUNCTION_ABS:
+		simulation_function_abs (a, out, len, FALSE);
+		break;
+	case FUNCTION_DB:
+		simulation_function_abs (a, out, len, TRUE);
+		break;
+	case FUNCTION_DERIVATIVE:
+		simulation_function_derivative (xs, a, out, len);
+		break;
+	case FUNCTION_INTEGRAL:
+		simulation_function_integral (xs, a, out, len);
+		break;
+	case FUNCTION_MOVING_AVERAGE:
+		simulation_function_moving_average (
+		    a, out, len, func->window > 0 ? func->window : SIMULATION_FUNCTION_DEFAULT_WINDOW);
+		break;
+	default:
+		g_array_unref (*y);
+		*y = NULL;
+		return FALSE;
+	}
+
+	if (data->mapped) {
+		// mapped columns can not be shared as GArray
+		*x = simulation_function_column_new (x_len);
+		memcpy ((*x)->data, xs, x_len * sizeof(gdouble));
+	} else {
+		*x = g_array_ref (data->data[0]);
+	}
+	return TRUE;
+}
+
+/**
+ * @returns the name of a derived trace, free with g_free
+ */
+gchar *simulation_function_get_label (const SimulationFunction *func, SimulationData *data)
+{
+	const gchar *first, *second = NULL;
+
+	first = func->first < data->n_variables ? data->var_names[func->first] : "?";
+	if (!simulation_function_is_unary (func->type))
+		second = func->second < data->n_variables ? data->var_names[func->second] : "?";
+
+	switch (func->type) {
+	case FUNCTION_SUBTRACT:
+		return g_strdup_printf ("%s - %s", first, second);
+	case FUNCTION_DIVIDE:
+		return g_strdup_printf ("%s(%s, %s)", _ ("TRANSFER"), first, second);
+	case FUNCTION_ADD:
+		return g_strdup_printf ("%s + %s", first, second);
+	case FUNCTION_MULTIPLY:
+		return g_strdup_printf ("%s * %s", first, second);
+	case FUNCTION_ABS:
+		return g_strdup_printf ("abs(%s)", first);
+	case FUNCTION_DB:
+		return g_strdup_printf ("dB(%s)", first);
+	case FUNCTION_DERIVATIVE:
+		return g_strdup_printf ("d/dx(%s)", first);
+	case FUNCTION_INTEGRAL:
+		return g_strdup_printf ("%s(%s)", _ ("integral"), first);
+	case FUNCTION_MOVING_AVERAGE:
+		return g_strdup_printf ("%s(%s)", _ ("average"), first);
+	case FUNCTION_FFT_MAGNITUDE:
+		return g_strdup_printf ("|FFT(%s)|", first);
+	default:
+		return g_strdup (first);
+	}
+}
@@ -0,0 +1,52 @@
+/*
+ * simulation-function.h
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SIMULATION_FUNCTION_H
+#define __SIMULATION_FUNCTION_H
+
+#include <glib.h>
+
+#include "simulation.h"
+
+// samples processed per pass, small enough to stay in the L1 cache
+#define SIMULATION_FUNCTION_BLOCK 1024
+
+// samples averaged by FUNCTION_MOVING_AVERAGE unless the function sets a window
+#define SIMULATION_FUNCTION_DEFAULT_WINDOW 9
+
+// FUNCTION_FFT_MAGNITUDE resamples to at most this many points
+#define SIMULATION_FUNCTION_FFT_MAX_POINTS (1 << 20)
+
+/**
+ * Derived traces computed from the columns of SimulationData.
+ *
+ * All operators work on whole columns, in blocks of straight loops the
+ * compiler can vectorise. The result shares the x column of the
+ * simulation data, except for the FFT which has its own frequency axis.
+ */
+gboolean simulation_function_is_unary (SimulationFunctionType type);
+gboolean simulation_function_evaluate (const SimulationFunction *func, SimulationData *data,
+                                       GArray **x, GArray **y);
+gchar *simulation_function_get_label (const SimulationFunction *func, SimulationData *data);
+
+#endif
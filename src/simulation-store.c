@@ -0,0 +1,367 @@
+/*
+ * simulation-store.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#include "simulation-store.h"
+#include "simulation-column.h"
+#include "errors.h"
+
+#include "debug.h"
+
+#define SIMULATION_STORE_INDEX "index"
+#define SIMULATION_STORE_GROUP "analysis"
+
+struct _SimulationStore
+{
+	gchar *path;
+	AnalysisType type;
+	GKeyFile *index;
+	guint columns;
+};
+
+static void simulation_store_free (SimulationStore *store);
+
+static gchar *simulation_store_column_path (const gchar *path, guint position)
+{
+	gchar *name = g_strdup_printf ("%u.col", position);
+	gchar *ret = g_build_filename (path, name, NULL);
+
+	g_free (name);
+	return ret;
+}
+
+static gchar *simulation_store_column_group (guint position)
+{
+	return g_strdup_printf ("column %u", position);
+}
+
+static gint simulation_store_compare_age (gconstpointer a, gconstpointer b)
+{
+	GStatBuf sa, sb;
+
+	if (g_stat (*(const gchar **)a, &sa) != 0 || g_stat (*(const gchar **)b, &sb) != 0)
+		return 0;
+	// newest first
+	return (sb.st_mtime > sa.st_mtime) - (sb.st_mtime < sa.st_mtime);
+}
+
+static void simulation_store_remove (const gchar *path)
+{
+	GDir *dir;
+	const gchar *name;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (!dir)
+		return;
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		gchar *file = g_build_filename (path, name, NULL);
+		g_unlink (file);
+		g_free (file);
+	}
+	g_dir_close (dir);
+	g_rmdir (path);
+}
+
+/**
+ * removes all but the newest stores, so the cache does not grow forever
+ */
+static void simulation_store_prune (const gchar *parent, guint keep)
+{
+	GPtrArray *stores;
+	GDir *dir;
+	const gchar *name;
+	guint i;
+
+	dir = g_dir_open (parent, 0, NULL);
+	if (!dir)
+		return;
+
+	stores = g_ptr_array_new_with_free_func (g_free);
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		gchar *path = g_build_filename (parent, name, NULL);
+		gchar *index = g_build_filename (path, SIMULATION_STORE_INDEX, NULL);
+
+		// only directories which look like a store are touched
+		if (g_file_test (index, G_FILE_TEST_EXISTS))
+			g_ptr_array_add (stores, path);
+		else
+			g_free (path);
+		g_free (index);
+	}
+	g_dir_close (dir);
+
+	g_ptr_array_sort (stores, simulation_store_compare_age);
+	for (i = keep; i < stores->len; i++)
+		simulation_store_remove (g_ptr_array_index (stores, i));
+	g_ptr_array_free (stores, TRUE);
+}
+
+/**
+ * \brief creates an empty store in a new directory
+ *
+ * @param parent the directory to create the store in, NULL for the
+ * results directory in the user cache directory
+ */
+SimulationStore *simulation_store_new (const gchar *parent, AnalysisType type, GError **error)
+{
+	SimulationStore *store;
+	gchar *cache = NULL, *template;
+
+	if (parent == NULL)
+		parent = cache = g_build_filename (g_get_user_cache_dir (), "oregano", "results", NULL);
+
+	if (g_mkdir_with_parents (parent, 0700) != 0) {
+		g_set_error (error, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_IO_ERROR,
+		             _ ("Could not create the results directory %s."), parent);
+		g_free (cache);
+		return NULL;
+	}
+	simulation_store_prune (parent, SIMULATION_STORE_KEEP - 1);
+
+	template = g_build_filename (parent, "store-XXXXXX", NULL);
+	if (g_mkdtemp (template) == NULL) {
+		g_set_error (error, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_IO_ERROR,
+		             _ ("Could not create a results store in %s."), parent);
+		g_free (template);
+		g_free (cache);
+		return NULL;
+	}
+	g_free (cache);
+
+	store = g_new0 (SimulationStore, 1);
+	store->path = template;
+	store->type = type;
+	store->index = g_key_file_new ();
+	g_key_file_set_integer (store->index, SIMULATION_STORE_GROUP, "type", type);
+
+	return store;
+}
+
+const gchar *simulation_store_get_path (SimulationStore *store) { return store->path; }
+
+/**
+ * \brief writes a finished column, the caller may free its values afterwards
+ *
+ * Columns can be added in any order, position is the index of the
+ * column in the resulting SimulationData.
+ */
+gboolean simulation_store_add_column (SimulationStore *store, guint position, const gchar *name,
+                                      const gchar *unit, const gdouble *values, guint len,
+                                      gdouble min, gdouble max, GError **error)
+{
+	gchar *path, *group;
+	gboolean ret;
+
+	g_return_val_if_fail (store != NULL, FALSE);
+
+	path = simulation_store_column_path (store->path, position);
+	ret = g_file_set_contents (path, (const gchar *)values, (gssize)len * sizeof(gdouble), error);
+	g_free (path);
+	if (!ret)
+		return FALSE;
+
+	group = simulation_store_column_group (position);
+	g_key_file_set_string (store->index, group, "name", name);
+	g_key_file_set_string (store->index, group, "unit", unit);
+	g_key_file_set_double (store->index, group, "min", min);
+	g_key_file_set_double (store->index, group, "max", max);
+	g_free (group);
+
+	store->columns = MAX (store->columns, position + 1);
+	return TRUE;
+}
+
+/**
+ * \brief writes the index and maps the columns
+ *
+ * The store is freed, its files stay in place.
+ */
+SimulationData *simulation_store_finish (SimulationStore *store, GError **error)
+{
+	gchar *index;
+	gboolean ret;
+
+	g_return_val_if_fail (store != NULL, NULL);
+
+	g_key_file_set_integer (store->index, SIMULATION_STORE_GROUP, "columns", store->columns);
+	index = g_build_filename (store->path, SIMULATION_STORE_INDEX, NULL);
+	ret = g_key_file_save_to_file (store->index, index, error);
+	g_free (index);
+
+	if (ret) {
+		SimulationData *data = simulation_store_open (store->path, error);
+		simulation_store_free (store);
+		return data;
+	}
+
+	simulation_store_remove (store->path);
+	simulation_store_free (store);
+	return NULL;
+}
+
+static void simulation_store_free (SimulationStore *store)
+{
+	g_key_file_free (store->index);
+	g_free (store->path);
+	g_free (store);
+}
+
+/**
+ * removes an unfinished store and its files
+ */
+void simulation_store_discard (SimulationStore *store)
+{
+	if (store == NULL)
+		return;
+	simulation_store_remove (store->path);
+	simulation_store_free (store);
+}
+
+/**
+ * \brief maps the columns of a finished store
+ *
+ * @param path the directory of the store
+ * @returns a SimulationData whose columns are mapped, free with
+ * simulation_data_free ()
+ */
+SimulationData *simulation_store_open (const gchar *path, GError **error)
+{
+	SimulationData *data;
+	GKeyFile *index;
+	gchar *file;
+	guint i, columns;
+
+	index = g_key_file_new ();
+	file = g_build_filename (path, SIMULATION_STORE_INDEX, NULL);
+	if (!g_key_file_load_from_file (index, file, G_KEY_FILE_NONE, error)) {
+		g_free (file);
+		g_key_file_free (index);
+		return NULL;
+	}
+	g_free (file);
+
+	columns = g_key_file_get_integer (index, SIMULATION_STORE_GROUP, "columns", NULL);
+
+	data = SIM_DATA (g_new0 (Analysis, 1));
+	data->type = g_key_file_get_integer (index, SIMULATION_STORE_GROUP, "type", NULL);
+	data->var_names = g_new0 (gchar *, columns + 1);
+	data->var_units = g_new0 (gchar *, columns + 1);
+	data->mapped = g_new0 (GBytes *, columns + 1);
+	data->min_data = g_new0 (gdouble, columns + 1);
+	data->max_data = g_new0 (gdouble, columns + 1);
+	data->n_variables = columns;
+	data->got_var = columns;
+
+	for (i = 0; i < columns; i++) {
+		gchar *group = simulation_store_column_group (i);
+		GMappedFile *mapped;
+
+		data->var_names[i] = g_key_file_get_string (index, group, "name", NULL);
+		data->var_units[i] = g_key_file_get_string (index, group, "unit", NULL);
+		data->min_data[i] = g_key_file_get_double (index, group, "min", NULL);
+		data->max_data[i] = g_key_file_get_double (index, group, "max", NULL);
+		g_free (group);
+
+		file = simulation_store_column_path (path, i);
+		mapped = g_mapped_file_new (file, FALSE, error);
+		g_free (file);
+		if (!mapped) {
+			g_key_file_free (index);
+			simulation_data_free (data);
+			return NULL;
+		}
+		data->mapped[i] = g_mapped_file_get_bytes (mapped);
+		g_mapped_file_unref (mapped);
+	}
+	g_key_file_free (index);
+
+	data->got_points = columns > 0 ? g_bytes_get_size (data->mapped[0]) / sizeof(gdouble) : 0;
+
+	return data;
+}
+
+/**
+ * \brief the values of a column, wherever they are kept
+ *
+ * Compact columns are decoded and kept with data from then on.
+ *
+ * @param len [out] the number of values
+ * @returns the values, owned by data
+ */
+const gdouble *simulation_data_get_column (SimulationData *data, guint i, guint *len)
+{
+	g_return_val_if_fail (data != NULL, NULL);
+	g_return_val_if_fail (i < data->n_variables, NULL);
+
+	if (data->compact && !(data->data && data->data[i])) {
+		GArray *array = simulation_data_decode_column (data, i, TRUE);
+
+		// data keeps the decoded column
+		g_array_unref (array);
+	}
+
+	if (data->mapped) {
+		gsize size;
+		const gdouble *values = g_bytes_get_data (data->mapped[i], &size);
+
+		*len = size / sizeof(gdouble);
+		return values;
+	}
+
+	*len = data->data[i]->len;
+	return (const gdouble *)data->data[i]->data;
+}
+
+/**
+ * frees the names, units and columns of an analysis and the analysis
+ * itself, plot functions may still share the columns
+ */
+void simulation_data_free (SimulationData *data)
+{
+	gint i;
+
+	if (data == NULL)
+		return;
+
+	for (i = 0; i < data->n_variables; i++) {
+		g_free (data->var_names[i]);
+		g_free (data->var_units[i]);
+		if (data->mapped && data->mapped[i])
+			g_bytes_unref (data->mapped[i]);
+		if (data->compact)
+			simulation_column_free (data->compact[i]);
+		if (data->data && data->data[i])
+			g_array_unref (data->data[i]);
+	}
+	g_free (data->var_names);
+	g_free (data->var_units);
+	g_free (data->data);
+	g_free (data->mapped);
+	g_free (data->compact);
+	g_free (data->min_data);
+	g_free (data->max_data);
+	g_free (data);
+}
@@ -0,0 +1,59 @@
+/*
+ * simulation-store.h
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SIMULATION_STORE_H
+#define __SIMULATION_STORE_H
+
+#include <glib.h>
+
+#include "simulation.h"
+
+// analyses with more values than this keep their columns in a store
+#define SIMULATION_STORE_MIN_VALUES (16 * 1024 * 1024)
+
+// stores kept in the cache directory, older ones are removed
+#define SIMULATION_STORE_KEEP 4
+
+/**
+ * Results kept in files instead of RAM.
+ *
+ * Each column of an analysis is a file of native doubles in its own
+ * directory below the user cache directory, next to an index with the
+ * names and units. Finished columns are mapped, so the OS pages them in
+ * and out, and a store can be opened again without simulating.
+ */
+typedef struct _SimulationStore SimulationStore;
+
+SimulationStore *simulation_store_new (const gchar *parent, AnalysisType type, GError **error);
+gboolean simulation_store_add_column (SimulationStore *store, guint position, const gchar *name,
+                                      const gchar *unit, const gdouble *values, guint len,
+                                      gdouble min, gdouble max, GError **error);
+SimulationData *simulation_store_finish (SimulationStore *store, GError **error);
+void simulation_store_discard (SimulationStore *store);
+const gchar *simulation_store_get_path (SimulationStore *store);
+SimulationData *simulation_store_open (const gchar *path, GError **error);
+
+const gdouble *simulation_data_get_column (SimulationData *data, guint i, guint *len);
+void simulation_data_free (SimulationData *data);
+
+#endif
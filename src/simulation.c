@@ -51,6 +51,14 @@
 const char *SimulationFunctionTypeString[] = {
 		"Subtraction",
 		"Division",
+		"Addition",
+		"Multiplication",
+		"Absolute value",
+		"Decibel",
+		"Derivative",
+		"Integral",
+		"Moving average",
+		"FFT magnitude",
 		NULL
 };
 
@@ -65,6 +73,7 @@ typedef struct
 	GtkProgressBar *progress_reader;
 	GtkLabel *progress_label_reader;
 	int progress_timeout_id;
+	gboolean live_plot; // a plot window follows the running simulation
 	Log *logstore;
 } Simulation;
 
@@ -187,6 +196,14 @@ static int progress_bar_timeout_cb (Simulation *s)
 	gtk_label_set_markup (s->progress_label_reader, str);
 	g_free (str);
 
+	// open the plot as soon as the first transient rows are read
+	if (!s->live_plot) {
+		gboolean grew;
+
+		if (oregano_engine_get_live_results (s->engine, &grew) != NULL)
+			s->live_plot = plot_show_live (s->engine);
+	}
+
 	return TRUE;
 }
 
@@ -204,7 +221,9 @@ static void engine_done_cb (OreganoEngine *engine, Simulation *s)
 	gtk_widget_destroy (GTK_WIDGET (s->dialog));
 	s->dialog = NULL;
 
-	plot_show (s->engine);
+	// the live plot window takes over the results by itself
+	if (!s->live_plot)
+		plot_show (s->engine);
 
 	if (oregano_engine_has_warnings (s->engine)) {
 		log_append (s->logstore, _ ("Simulation"),
@@ -277,6 +296,7 @@ static gboolean simulate_cmd (Simulation *s)
 		return FALSE;
 
 	s->engine = engine;
+	s->live_plot = FALSE;
 
 	s->progress_timeout_id = g_timeout_add (250, (GSourceFunc)progress_bar_timeout_cb, s);
 
@@ -41,6 +41,7 @@
 #include "schematic-view.h"
 
 typedef struct _SimulationData SimulationData;
+typedef struct _SimulationColumn SimulationColumn;
 
 typedef enum {
 	ANALYSIS_TYPE_NONE,
@@ -62,16 +63,26 @@ typedef enum {
 //keep in mind the relation to global variable
 //const char const *SimulationFunctionTypeString[]
 //in simulation.c (strings representing the functions in GUI)
+//evaluated by simulation-function.c
 typedef enum {
 	FUNCTION_SUBTRACT = 0,
-	FUNCTION_DIVIDE
+	FUNCTION_DIVIDE,
+	FUNCTION_ADD,
+	FUNCTION_MULTIPLY,
+	FUNCTION_ABS,
+	FUNCTION_DB,
+	FUNCTION_DERIVATIVE,
+	FUNCTION_INTEGRAL,
+	FUNCTION_MOVING_AVERAGE,
+	FUNCTION_FFT_MAGNITUDE
 } SimulationFunctionType;
 
 typedef struct _SimulationFunction
 {
 	SimulationFunctionType type;
 	guint first;
-	guint second;
+	guint second; ///< unused by unary functions
+	guint window; ///< samples of the moving average, 0 for the default
 } SimulationFunction;
 
 struct _SimulationData
@@ -81,6 +92,11 @@ struct _SimulationData
 	gchar **var_names;
 	gchar **var_units;
 	GArray **data;
+	// the columns of results kept in a SimulationStore, NULL if in RAM
+	GBytes **mapped;
+	// the encoded columns of compact results, NULL if not compact,
+	// data then only holds the columns decoded to be kept
+	SimulationColumn **compact;
 	gdouble *min_data;
 	gdouble *max_data;
 	gint got_var;
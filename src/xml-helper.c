@@ -73,6 +73,35 @@ gboolean oreganoXmlSAXParseFile (xmlSAXHandlerPtr sax, gpointer user_data, const
 	return ret;
 }
 
+// The same for a document in memory.
+gboolean oreganoXmlSAXParseMemory (xmlSAXHandlerPtr sax, gpointer user_data, const gchar *buffer,
+                                   gint size)
+{
+	g_return_val_if_fail (buffer != NULL, FALSE);
+
+	gboolean ret;
+	xmlParserCtxtPtr ctxt;
+
+	ctxt = xmlCreateMemoryParserCtxt (buffer, size);
+	if (ctxt == NULL)
+		return FALSE;
+
+	ctxt->sax = sax;
+	ctxt->userData = user_data;
+
+	xmlKeepBlanksDefault (0);
+	if (xmlParseDocument (ctxt) < 0) {
+		g_message ("Failed to parse document in memory");
+		ret = FALSE;
+	} else {
+		ret = ctxt->wellFormed ? TRUE : FALSE;
+	}
+	ctxt->sax = NULL;
+	xmlFreeParserCtxt (ctxt);
+
+	return ret;
+}
+
 // Set coodinate for a node, carried as the content of a child.
 void xmlSetCoordinate (xmlNodePtr node, const char *name, double x, double y)
 {
@@ -39,6 +39,8 @@
 #include "xml-compat.h"
 
 gboolean oreganoXmlSAXParseFile (xmlSAXHandlerPtr sax, gpointer user_data, const gchar *filename);
+gboolean oreganoXmlSAXParseMemory (xmlSAXHandlerPtr sax, gpointer user_data, const gchar *buffer,
+                                   gint size);
 
 void xmlSetValue (xmlNodePtr node, const char *name, const char *val);
 
@@ -12,6 +12,19 @@
 #include "test_update_connection_designators.c"
 #include "test_thread_pipe.c"
 #include "test_engine_ngspice.c"
+#include "test_netlist_helper.c"
+#include "test_model_index.c"
+#include "test_simulation_function.c"
+#include "test_simulation_store.c"
+#include "test_simulation_column.c"
+#include "test_library_cache.c"
+#include "test_library_index.c"
+#include "test_library_search.c"
+#include "test_save_schematic.c"
+#include "test_schematic_binary.c"
+#include "test_load_schematic.c"
+#include "test_batch.c"
+#include "test_gplot_lines.c"
 
 #if DEBUG_FORCE_FAIL
 void
@@ -34,10 +47,24 @@ main (int argc, char *argv[])
 	g_test_add_func ("/core/model/wire/intersection", test_wire_intersection);
 	g_test_add_func ("/core/model/wire/tcrossing", test_wire_tcrossing);
 	g_test_add_func ("/core/model/nodestore", test_nodestore);
+	g_test_add_func ("/core/model/nodestore/add-items", test_nodestore_add_items);
 	g_test_add_func ("/core/engine", test_engine);
 	add_funcs_test_update_connection_designators();
 	add_funcs_test_thread_pipe_buffered();
 	add_funcs_test_engine_ngspice();
+	add_funcs_test_netlist_helper();
+	add_funcs_test_model_index();
+	add_funcs_test_simulation_function();
+	add_funcs_test_simulation_store();
+	add_funcs_test_simulation_column();
+	add_funcs_test_library_cache();
+	add_funcs_test_library_index();
+	add_funcs_test_library_search();
+	add_funcs_test_save_schematic();
+	add_funcs_test_schematic_binary();
+	add_funcs_test_load_schematic();
+	add_funcs_test_batch();
+	add_funcs_test_gplot_lines();
 #if DEBUG_FORCE_FAIL
 	g_test_add_func ("/false", test_false);
 #endif
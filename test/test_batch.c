@@ -0,0 +1,144 @@
+/*
+ * test_batch.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_BATCH
+#define TEST_BATCH
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+#include "../src/batch.h"
+#include "../src/engines/engine.h"
+#include "../src/simulation-store.h"
+
+static void test_batch_output_path ();
+static void test_batch_csv ();
+
+void
+add_funcs_test_batch ()
+{
+	g_test_add_func ("/core/batch/output-path", test_batch_output_path);
+	g_test_add_func ("/core/batch/csv", test_batch_csv);
+}
+
+/**
+ * a file is written as given, into a directory named after the schematic
+ */
+static void
+test_batch_output_path ()
+{
+	gchar *dir, *path, *expected;
+	GError *e = NULL;
+
+	dir = g_dir_make_tmp ("oregano-test-XXXXXX", &e);
+	g_assert_no_error (e);
+
+	path = batch_get_output_path ("out.csv", "/some/where/rc.oregano", "csv");
+	g_assert_cmpstr (path, ==, "out.csv");
+	g_free (path);
+
+	path = batch_get_output_path (dir, "/some/where/rc.filter.oregano", "cir");
+	expected = g_build_filename (dir, "rc.filter.cir", NULL);
+	g_assert_cmpstr (path, ==, expected);
+	g_free (expected);
+	g_free (path);
+
+	g_rmdir (dir);
+	g_free (dir);
+}
+
+/**
+ * @returns an analysis kept in RAM, with a column for each name and
+ * values of column * 0.1 + point
+ */
+static SimulationData *
+test_batch_data_new (AnalysisType type, const gchar *const *names, guint n_points)
+{
+	SimulationData *data = g_new0 (SimulationData, 1);
+	gint i;
+	guint j;
+
+	data->type = type;
+	data->n_variables = g_strv_length ((gchar **)names);
+	data->var_names = g_new0 (gchar *, data->n_variables);
+	data->var_units = g_new0 (gchar *, data->n_variables);
+	data->data = g_new0 (GArray *, data->n_variables);
+	for (i = 0; i < data->n_variables; i++) {
+		data->var_names[i] = g_strdup (names[i]);
+		data->data[i] = g_array_new (FALSE, FALSE, sizeof(gdouble));
+		for (j = 0; j < n_points; j++) {
+			gdouble value = i * 0.1 + j;
+			g_array_append_val (data->data[i], value);
+		}
+	}
+	return data;
+}
+
+/**
+ * each analysis is a section of a name comment, a header and the
+ * points, names are quoted where needed
+ */
+static void
+test_batch_csv ()
+{
+	const gchar *const transient[] = {"time", "v(out)", "i(\"v1\",x)", NULL};
+	const gchar *const op[] = {"v(1)", NULL};
+	g_autofree gchar *transient_name =
+	    oregano_engine_get_analysis_name_by_type (ANALYSIS_TYPE_TRANSIENT);
+	g_autofree gchar *op_name = oregano_engine_get_analysis_name_by_type (ANALYSIS_TYPE_OP_POINT);
+	GList *analyses = NULL;
+	GOutputStream *stream;
+	gchar *csv, *expected;
+	GError *e = NULL;
+
+	analyses =
+	    g_list_append (analyses, test_batch_data_new (ANALYSIS_TYPE_TRANSIENT, transient, 2));
+	analyses = g_list_append (analyses, test_batch_data_new (ANALYSIS_TYPE_OP_POINT, op, 1));
+
+	stream = g_memory_output_stream_new_resizable ();
+	g_assert_true (batch_write_csv (analyses, stream, &e));
+	g_assert_no_error (e);
+	g_output_stream_close (stream, NULL, &e);
+	g_assert_no_error (e);
+
+	csv = g_strndup (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (stream)),
+	                 g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (stream)));
+	expected = g_strdup_printf ("# %s\n"
+	                            "time,v(out),\"i(\"\"v1\"\",x)\"\n"
+	                            "0,0.10000000000000001,0.20000000000000001\n"
+	                            "1,1.1000000000000001,1.2\n"
+	                            "\n"
+	                            "# %s\n"
+	                            "v(1)\n"
+	                            "0\n",
+	                            transient_name, op_name);
+	g_assert_cmpstr (csv, ==, expected);
+
+	g_free (expected);
+	g_free (csv);
+	g_object_unref (stream);
+	g_list_free_full (analyses, (GDestroyNotify)simulation_data_free);
+}
+
+#endif
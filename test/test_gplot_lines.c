@@ -0,0 +1,209 @@
+/*
+ * test_gplot_lines.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_GPLOT_LINES
+#define TEST_GPLOT_LINES
+
+#include <glib.h>
+
+#include "../src/gplot/gplotlines-private.h"
+
+static void test_gplot_lines_lod ();
+static void test_gplot_lines_extend_lod ();
+static void test_gplot_lines_visible_range ();
+
+void
+add_funcs_test_gplot_lines ()
+{
+	g_test_add_func ("/core/gplot/lines/lod", test_gplot_lines_lod);
+	g_test_add_func ("/core/gplot/lines/extend-lod", test_gplot_lines_extend_lod);
+	g_test_add_func ("/core/gplot/lines/visible-range", test_gplot_lines_visible_range);
+}
+
+/**
+ * every bucket of every level holds the smallest and the largest
+ * sample of the 2^(level+1) samples it covers, the top level covers
+ * all of them
+ */
+static void
+test_gplot_lines_check_lod (GPlotLinesPriv *priv)
+{
+	guint points = priv->points;
+	guint level, bucket, point;
+
+	g_assert_nonnull (priv->lod);
+	g_assert_cmpuint (priv->lod_levels, ==, g_bit_storage (points - 1));
+
+	for (level = 0; level < priv->lod_levels; level++) {
+		GPlotLinesLevel *lod = &priv->lod[level];
+		guint size = 2u << level;
+
+		g_assert_cmpuint (lod->buckets, ==, (points + size - 1) / size);
+		for (bucket = 0; bucket < lod->buckets; bucket++) {
+			guint first = bucket * size, last = MIN (first + size, points);
+			gdouble min = G_MAXDOUBLE, max = -G_MAXDOUBLE;
+
+			for (point = first; point < last; point++) {
+				min = MIN (min, priv->y[point]);
+				max = MAX (max, priv->y[point]);
+			}
+			g_assert_cmpuint (lod->imin[bucket], >=, first);
+			g_assert_cmpuint (lod->imin[bucket], <, last);
+			g_assert_cmpuint (lod->imax[bucket], >=, first);
+			g_assert_cmpuint (lod->imax[bucket], <, last);
+			g_assert_cmpfloat (priv->y[lod->imin[bucket]], ==, min);
+			g_assert_cmpfloat (priv->y[lod->imax[bucket]], ==, max);
+		}
+	}
+	g_assert_cmpuint (priv->lod[priv->lod_levels - 1].buckets, ==, 1);
+}
+
+static void
+test_gplot_lines_append (GArray *x, GArray *y, GRand *rand, guint points)
+{
+	guint point;
+
+	for (point = x->len; point < points; point++) {
+		gdouble xv = point * 1e-3;
+		gdouble yv = g_rand_double_range (rand, -1., 1.);
+
+		g_array_append_val (x, xv);
+		g_array_append_val (y, yv);
+	}
+}
+
+static void
+test_gplot_lines_lod ()
+{
+	const guint points = 10000;
+	gdouble *x = g_new (gdouble, points);
+	gdouble *y = g_new (gdouble, points);
+	GRand *rand = g_rand_new_with_seed (31);
+	GPlotFunction *f;
+	GPlotLinesPriv *priv;
+	guint point;
+
+	for (point = 0; point < points; point++) {
+		x[point] = point;
+		y[point] = g_rand_double_range (rand, -1., 1.);
+	}
+	// a single sample spike is kept up to the top level
+	y[4321] = 5.;
+
+	f = g_plot_lines_new (x, y, points);
+	priv = ((GPlotLines *)f)->priv;
+	test_gplot_lines_check_lod (priv);
+	g_assert_cmpuint (priv->lod[priv->lod_levels - 1].imax[0], ==, 4321);
+
+	g_object_unref (f);
+	g_rand_free (rand);
+}
+
+/**
+ * growing columns only redo the buckets at the end, every level is
+ * still right afterwards, also when the pyramid gets another one
+ */
+static void
+test_gplot_lines_extend_lod ()
+{
+	GArray *x = g_array_new (FALSE, FALSE, sizeof(gdouble));
+	GArray *y = g_array_new (FALSE, FALSE, sizeof(gdouble));
+	GRand *rand = g_rand_new_with_seed (32);
+	GPlotFunction *f;
+	GPlotLinesPriv *priv;
+
+	// too short for a pyramid
+	test_gplot_lines_append (x, y, rand, G_PLOT_LINES_LOD_MIN_POINTS - 1);
+	f = g_plot_lines_new_from_columns (x, y);
+	priv = ((GPlotLines *)f)->priv;
+	g_assert_null (priv->lod);
+
+	test_gplot_lines_append (x, y, rand, 5001);
+	g_plot_lines_update_columns (f);
+	test_gplot_lines_check_lod (priv);
+
+	test_gplot_lines_append (x, y, rand, 8192);
+	g_array_index (y, gdouble, 8191) = 5.;
+	g_plot_lines_update_columns (f);
+	test_gplot_lines_check_lod (priv);
+
+	test_gplot_lines_append (x, y, rand, 9000);
+	g_plot_lines_update_columns (f);
+	test_gplot_lines_check_lod (priv);
+	g_assert_cmpuint (priv->lod[priv->lod_levels - 1].imax[0], ==, 8191);
+
+	g_object_unref (f);
+	g_array_unref (x);
+	g_array_unref (y);
+	g_rand_free (rand);
+}
+
+/**
+ * the samples inside of the window and one on each side of it
+ */
+static void
+test_gplot_lines_visible_range ()
+{
+	const guint points = 100;
+	gdouble *x = g_new (gdouble, points);
+	gdouble *y = g_new0 (gdouble, points);
+	GPlotFunctionBBox bbox = {10.5, -1., 20., 1.};
+	GPlotFunction *f;
+	GPlotLinesPriv *priv;
+	guint point, first, last;
+
+	for (point = 0; point < points; point++)
+		x[point] = point;
+	f = g_plot_lines_new (x, y, points);
+	priv = ((GPlotLines *)f)->priv;
+
+	g_assert_true (g_plot_lines_visible_range (priv, &bbox, &first, &last));
+	g_assert_cmpuint (first, ==, 10);
+	g_assert_cmpuint (last, ==, 21);
+
+	bbox.xmin = -5.;
+	bbox.xmax = 500.;
+	g_assert_true (g_plot_lines_visible_range (priv, &bbox, &first, &last));
+	g_assert_cmpuint (first, ==, 0);
+	g_assert_cmpuint (last, ==, points - 1);
+
+	// right of the last sample
+	bbox.xmin = 200.;
+	g_assert_false (g_plot_lines_visible_range (priv, &bbox, &first, &last));
+
+	// unsorted samples are all drawn
+	bbox.xmin = 10.5;
+	bbox.xmax = 20.;
+	priv->sorted = FALSE;
+	g_assert_true (g_plot_lines_visible_range (priv, &bbox, &first, &last));
+	g_assert_cmpuint (first, ==, 0);
+	g_assert_cmpuint (last, ==, points - 1);
+
+	priv->points = 0;
+	g_assert_false (g_plot_lines_visible_range (priv, &bbox, &first, &last));
+	priv->points = points;
+
+	g_object_unref (f);
+}
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * test_library_cache.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_LIBRARY_CACHE
+#define TEST_LIBRARY_CACHE
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "../src/library-cache.h"
+#include "../src/load-library.h"
+#include "../src/model/part-label.h"
+
+static const gchar test_library_cache_source[] =
+    "<?xml version=\"1.0\"?>\n"
+    "<ogo:library>\n"
+    "  <ogo:name>cached</ogo:name>\n"
+    "  <ogo:symbols>\n"
+    "    <ogo:symbol>\n"
+    "      <ogo:name>R</ogo:name>\n"
+    "      <ogo:objects>\n"
+    "        <ogo:line>0 (0 10)(10 10)(20 5)</ogo:line>\n"
+    "        <ogo:arc>(1 2)(3 4)</ogo:arc>\n"
+    "        <ogo:text>(5 6)@refdes</ogo:text>\n"
+    "      </ogo:objects>\n"
+    "      <ogo:connections>\n"
+    "        <ogo:connection>(0 10)</ogo:connection>\n"
+    "        <ogo:connection>(40 10)</ogo:connection>\n"
+    "      </ogo:connections>\n"
+    "    </ogo:symbol>\n"
+    "  </ogo:symbols>\n"
+    "  <ogo:parts>\n"
+    "    <ogo:part>\n"
+    "      <ogo:name>Resistor</ogo:name>\n"
+    "      <ogo:symbol>R</ogo:symbol>\n"
+    "      <ogo:labels>\n"
+    "        <ogo:label>\n"
+    "          <ogo:name>Reference</ogo:name>\n"
+    "          <ogo:text>@refdes</ogo:text>\n"
+    "          <ogo:position>(8 -5)</ogo:position>\n"
+    "        </ogo:label>\n"
+    "      </ogo:labels>\n"
+    "      <ogo:properties>\n"
+    "        <ogo:property><ogo:name>Refdes</ogo:name><ogo:value>R</ogo:value></ogo:property>\n"
+    "        <ogo:property><ogo:name>Res</ogo:name><ogo:value>1k</ogo:value></ogo:property>\n"
+    "      </ogo:properties>\n"
+    "    </ogo:part>\n"
+    "  </ogo:parts>\n"
+    "</ogo:library>\n";
+
+static void test_library_cache_roundtrip ();
+
+void
+add_funcs_test_library_cache ()
+{
+	g_test_add_func ("/core/library-cache/roundtrip", test_library_cache_roundtrip);
+}
+
+static void
+test_library_cache_roundtrip ()
+{
+	Library *parsed, *cached;
+	LibrarySymbol *symbol, *cached_symbol;
+	LibraryPart *part, *cached_part;
+	SymbolObject *object;
+	GList *names;
+	GSList *a, *b;
+	gchar *dir, *source, *cache;
+	GError *e = NULL;
+
+	dir = g_dir_make_tmp ("oregano-test-XXXXXX", &e);
+	g_assert_no_error (e);
+	source = g_build_filename (dir, "cached.oreglib", NULL);
+	cache = g_build_filename (dir, "cached.cache", NULL);
+	g_file_set_contents (source, test_library_cache_source, -1, &e);
+	g_assert_no_error (e);
+
+	g_assert_null (library_cache_load (cache, source));
+
+	parsed = library_parse_xml_file (source);
+	g_assert_nonnull (parsed);
+	library_cache_save (cache, source, parsed, &e);
+	g_assert_no_error (e);
+
+	cached = library_cache_load (cache, source);
+	g_assert_nonnull (cached);
+	g_assert_cmpstr (cached->name, ==, "cached");
+	g_assert_null (cached->author);
+
+	symbol = g_hash_table_lookup (parsed->symbol_hash, "R");
+	// nothing is built before it is asked for
+	g_assert_cmpuint (g_hash_table_size (cached->symbol_hash), ==, 0);
+	g_assert_cmpuint (g_hash_table_size (cached->part_hash), ==, 0);
+	names = library_cache_get_part_names (cached);
+	g_assert_cmpuint (g_list_length (names), ==, 1);
+	g_assert_cmpstr (names->data, ==, "Resistor");
+	g_list_free (names);
+
+	cached_symbol = library_cache_get_symbol (cached, "R");
+	g_assert_true (cached_symbol == library_cache_get_symbol (cached, "R"));
+	g_assert_null (library_cache_get_symbol (cached, "missing"));
+	g_assert_nonnull (cached_symbol);
+	g_assert_cmpuint (g_slist_length (cached_symbol->connections), ==, 2);
+	g_assert_cmpuint (g_slist_length (cached_symbol->symbol_objects), ==,
+	                  g_slist_length (symbol->symbol_objects));
+	for (a = symbol->symbol_objects, b = cached_symbol->symbol_objects; a; a = a->next, b = b->next)
+		g_assert_cmpint (((SymbolObject *)a->data)->type, ==, ((SymbolObject *)b->data)->type);
+
+	// the parser prepends, so the line comes last
+	object = g_slist_last (cached_symbol->symbol_objects)->data;
+	g_assert_cmpint (object->type, ==, SYMBOL_OBJECT_LINE);
+	g_assert_cmpint (object->u.uline.line->num_points, ==, 3);
+	g_assert_cmpfloat (object->u.uline.line->coords[5], ==, 5.);
+	object = cached_symbol->symbol_objects->data;
+	g_assert_cmpint (object->type, ==, SYMBOL_OBJECT_TEXT);
+	g_assert_cmpstr (object->u.text.str, ==, "@refdes");
+
+	part = g_hash_table_lookup (parsed->part_hash, "Resistor");
+	cached_part = library_cache_get_part (cached, "Resistor");
+	g_assert_cmpuint (g_hash_table_size (cached->part_hash), ==, 1);
+	g_assert_nonnull (cached_part);
+	g_assert_true (cached_part->library == cached);
+	g_assert_cmpstr (cached_part->symbol_name, ==, "R");
+	g_assert_cmpfloat (((PartLabel *)cached_part->labels->data)->pos.y, ==, -5.);
+	for (a = part->properties, b = cached_part->properties; a; a = a->next, b = b->next)
+		g_assert_cmpstr (((Property *)a->data)->value, ==, ((Property *)b->data)->value);
+	g_assert_null (b);
+
+	// a changed source invalidates the cache
+	g_file_set_contents (source, "<?xml version=\"1.0\"?>\n<ogo:library/>\n", -1, &e);
+	g_assert_no_error (e);
+	g_assert_null (library_cache_load (cache, source));
+
+	g_unlink (cache);
+	g_unlink (source);
+	g_rmdir (dir);
+	g_free (cache);
+	g_free (source);
+	g_free (dir);
+}
+
+#endif
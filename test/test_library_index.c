@@ -0,0 +1,98 @@
+/*
+ * test_library_index.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_LIBRARY_INDEX
+#define TEST_LIBRARY_INDEX
+
+#include <glib.h>
+
+#include "../src/library-index.h"
+#include "../src/load-library.h"
+
+static void test_library_index_shadowing ();
+
+void
+add_funcs_test_library_index ()
+{
+	g_test_add_func ("/core/library-index/shadowing", test_library_index_shadowing);
+}
+
+/**
+ * a library as the XML parser leaves it, with a symbol of the same
+ * name for each part
+ *
+ * @parts names of the parts, NULL terminated
+ */
+static Library *
+test_library_index_library_new (const gchar *name, const gchar *const *parts)
+{
+	Library *library = g_new0 (Library, 1);
+
+	library->name = g_strdup (name);
+	library->part_hash = g_hash_table_new (g_str_hash, g_str_equal);
+	library->symbol_hash = g_hash_table_new (g_str_hash, g_str_equal);
+	for (gint i = 0; parts[i] != NULL; i++) {
+		LibraryPart *part = g_new0 (LibraryPart, 1);
+		LibrarySymbol *symbol = g_new0 (LibrarySymbol, 1);
+
+		part->name = g_strdup (parts[i]);
+		part->symbol_name = g_strdup (parts[i]);
+		part->library = library;
+		symbol->name = g_strdup (parts[i]);
+		g_hash_table_insert (library->part_hash, part->name, part);
+		g_hash_table_insert (library->symbol_hash, symbol->name, symbol);
+	}
+
+	return library;
+}
+
+static void
+test_library_index_shadowing ()
+{
+	const gchar *const first_parts[] = {"Resistor", "Capacitor", NULL};
+	const gchar *const second_parts[] = {"Resistor", "Inductor", NULL};
+	Library *first = test_library_index_library_new ("Default", first_parts);
+	Library *second = test_library_index_library_new ("Passive", second_parts);
+
+	library_index_add (first);
+	library_index_add (second);
+
+	g_assert_true (library_index_get_library ("default") == first);
+	g_assert_true (library_index_get_library ("PASSIVE") == second);
+	g_assert_null (library_index_get_library ("missing"));
+
+	// the library added first wins
+	g_assert_true (library_index_get_part_library ("Resistor") == first);
+	g_assert_true (library_index_get_part ("Resistor")->library == first);
+	g_assert_true (library_index_get_part ("Inductor")->library == second);
+	g_assert_true (library_index_get_symbol ("Resistor") ==
+	               g_hash_table_lookup (first->symbol_hash, "Resistor"));
+	g_assert_true (library_get_symbol ("Inductor") ==
+	               g_hash_table_lookup (second->symbol_hash, "Inductor"));
+	g_assert_null (library_index_get_part ("Diode"));
+
+	library_index_clear ();
+	g_assert_null (library_index_get_symbol ("Resistor"));
+}
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * test_library_search.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_LIBRARY_SEARCH
+#define TEST_LIBRARY_SEARCH
+
+#include <glib.h>
+
+#include "../src/library-search.h"
+#include "../src/load-library.h"
+
+static void test_library_search_query ();
+
+void
+add_funcs_test_library_search ()
+{
+	g_test_add_func ("/core/library-search/query", test_library_search_query);
+}
+
+/**
+ * @parts name, description, name, description, ..., NULL
+ */
+static Library *
+test_library_search_library_new (const gchar *const *parts)
+{
+	Library *library = g_new0 (Library, 1);
+
+	library->part_hash = g_hash_table_new (g_str_hash, g_str_equal);
+	library->symbol_hash = g_hash_table_new (g_str_hash, g_str_equal);
+	for (gint i = 0; parts[i] != NULL; i += 2) {
+		LibraryPart *part = g_new0 (LibraryPart, 1);
+
+		part->name = g_strdup (parts[i]);
+		part->description = g_strdup (parts[i + 1]);
+		part->library = library;
+		g_hash_table_insert (library->part_hash, part->name, part);
+	}
+
+	return library;
+}
+
+/**
+ * @returns the names of the results, joined by spaces, free with g_free
+ */
+static gchar *
+test_library_search_names (LibrarySearch *search, const gchar *query)
+{
+	GArray *result = library_search_query (search, query);
+	GString *names = g_string_new (NULL);
+
+	for (guint i = 0; i < result->len; i++) {
+		if (i)
+			g_string_append_c (names, ' ');
+		g_string_append (names, library_search_get_name (search, g_array_index (result, guint, i)));
+	}
+
+	return g_string_free (names, FALSE);
+}
+
+#define TEST_LIBRARY_SEARCH_ASSERT(search, query, names)                     \
+	G_STMT_START                                                          \
+	{                                                                     \
+		gchar *found = test_library_search_names (search, query);    \
+		g_assert_cmpstr (found, ==, names);                           \
+		g_free (found);                                               \
+	}                                                                     \
+	G_STMT_END
+
+static void
+test_library_search_query ()
+{
+	const gchar *const first_parts[] = {"Resistor", "Linear resistor",
+	                                    "Capacitor", "Ceramic capacitor",
+	                                    "LM741", "Operational amplifier", NULL};
+	const gchar *const second_parts[] = {"Potentiometer", "Variable resistor",
+	                                     "Inductor", NULL, NULL};
+	Library *first = test_library_search_library_new (first_parts);
+	Library *second = test_library_search_library_new (second_parts);
+	GList *libraries = g_list_append (g_list_append (NULL, first), second);
+	LibrarySearch *search = library_search_new (libraries);
+
+	// ordered by name across both libraries, descriptions included
+	TEST_LIBRARY_SEARCH_ASSERT (search, "RES", "Potentiometer Resistor");
+	TEST_LIBRARY_SEARCH_ASSERT (search, "resi", "Potentiometer Resistor");
+	TEST_LIBRARY_SEARCH_ASSERT (search, "resistor", "Potentiometer Resistor");
+	TEST_LIBRARY_SEARCH_ASSERT (search, "linear resistor", "Resistor");
+	// shorter again, the previous results are not enough
+	TEST_LIBRARY_SEARCH_ASSERT (search, "or", "Capacitor Inductor Potentiometer Resistor");
+	TEST_LIBRARY_SEARCH_ASSERT (search, "c", "Capacitor Inductor");
+	TEST_LIBRARY_SEARCH_ASSERT (search, "lm7", "LM741");
+	TEST_LIBRARY_SEARCH_ASSERT (search, "xyz", "");
+
+	g_assert_true (library_search_get_library (search, 3) == second);
+
+	library_search_free (search);
+	g_list_free (libraries);
+}
+
+#endif
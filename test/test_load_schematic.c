@@ -0,0 +1,330 @@
+/*
+ * test_load_schematic.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_LOAD_SCHEMATIC
+#define TEST_LOAD_SCHEMATIC
+
+#include <glib.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "../src/library-index.h"
+#include "../src/load-library.h"
+#include "../src/model/schematic.h"
+#include "../src/model/textbox.h"
+#include "../src/model/wire.h"
+
+#define TEST_LOAD_SCHEMATIC_BENCH_PARTS 2000
+#define TEST_LOAD_SCHEMATIC_BENCH_WIRES 10000
+#define TEST_LOAD_SCHEMATIC_BENCH_RUNS 20
+
+static void test_load_schematic_numbers ();
+static void test_load_schematic_examples ();
+static void test_load_schematic_benchmark ();
+
+void
+add_funcs_test_load_schematic ()
+{
+	g_test_add_func ("/core/load-schematic/numbers", test_load_schematic_numbers);
+	g_test_add_func ("/core/load-schematic/examples", test_load_schematic_examples);
+	g_test_add_func ("/core/load-schematic/benchmark", test_load_schematic_benchmark);
+}
+
+/**
+ * @returns a schematic read from XML text, which is written to a
+ * temporary file first
+ */
+static Schematic *
+test_load_schematic_read_text (const gchar *text, gssize len)
+{
+	Schematic *sm;
+	gchar *dir, *filename;
+	GError *e = NULL;
+
+	dir = g_dir_make_tmp ("oregano-test-XXXXXX", &e);
+	g_assert_no_error (e);
+	filename = g_build_filename (dir, "text.oregano", NULL);
+	g_assert_true (g_file_set_contents (filename, text, len, &e));
+	g_assert_no_error (e);
+
+	sm = schematic_read (filename, &e);
+	g_assert_no_error (e);
+	g_assert_nonnull (sm);
+
+	g_unlink (filename);
+	g_rmdir (dir);
+	g_free (filename);
+	g_free (dir);
+
+	return sm;
+}
+
+/**
+ * positions are read from the text as they were with sscanf, foreign
+ * elements are skipped with everything inside
+ */
+static void
+test_load_schematic_numbers ()
+{
+	const gchar *text =
+	    "<?xml version=\"1.0\"?>\n"
+	    "<ogo:schematic xmlns:ogo=\"https://beerbach.me/project/oregano/ns/v1\">\n"
+	    "  <ogo:zoom>1.5</ogo:zoom>\n"
+	    "  <ogo:foreign><ogo:wires><ogo:wire><ogo:points>(1 1)(2 2)</ogo:points>"
+	    "</ogo:wire></ogo:wires></ogo:foreign>\n"
+	    "  <ogo:wires>\n"
+	    "    <ogo:wire>\n"
+	    "      <ogo:points>(10 20)( 10  6.05e1)</ogo:points>\n"
+	    "    </ogo:wire>\n"
+	    "  </ogo:wires>\n"
+	    "  <ogo:textboxes>\n"
+	    "    <ogo:textbox>\n"
+	    "      <ogo:position>(-5 7e1)</ogo:position>\n"
+	    "      <ogo:text>note</ogo:text>\n"
+	    "    </ogo:textbox>\n"
+	    "  </ogo:textboxes>\n"
+	    "</ogo:schematic>\n";
+	Schematic *sm = test_load_schematic_read_text (text, -1);
+	NodeStore *store = schematic_get_store (sm);
+	Coords start, end, pos;
+	GList *iter;
+	Textbox *textbox = NULL;
+
+	g_assert_cmpfloat (schematic_get_zoom (sm), ==, 1.5);
+
+	g_assert_cmpuint (g_list_length (store->wires), ==, 1);
+	wire_get_start_pos (store->wires->data, &start);
+	wire_get_end_pos (store->wires->data, &end);
+	g_assert_cmpfloat (start.x, ==, 10.);
+	g_assert_cmpfloat (start.y, ==, 20.);
+	g_assert_cmpfloat (end.x, ==, 10.);
+	g_assert_cmpfloat (end.y, ==, 60.5);
+
+	for (iter = store->textbox; iter; iter = iter->next)
+		textbox = iter->data;
+	g_assert_nonnull (textbox);
+	item_data_get_pos (ITEM_DATA (textbox), &pos);
+	g_assert_cmpfloat (pos.x, ==, -5.);
+	g_assert_cmpfloat (pos.y, ==, 70.);
+	g_assert_cmpstr (textbox_get_text (textbox), ==, "note");
+
+	g_object_unref (sm);
+}
+
+/**
+ * indexes the libraries shipped in data/libraries, which the parts of
+ * the examples refer to
+ */
+static void
+test_load_schematic_libraries_add ()
+{
+	g_autofree gchar *test_dir = get_test_base_dir ();
+	g_autofree gchar *dirname = g_build_filename (test_dir, "..", "data", "libraries", NULL);
+	GDir *dir;
+	const gchar *name;
+	GError *e = NULL;
+
+	dir = g_dir_open (dirname, 0, &e);
+	g_assert_no_error (e);
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		g_autofree gchar *filename = NULL;
+		Library *library;
+
+		if (!g_str_has_suffix (name, ".oreglib"))
+			continue;
+		filename = g_build_filename (dirname, name, NULL);
+		library = library_parse_xml_file (filename);
+		g_assert_nonnull (library);
+		library_index_add (library);
+	}
+	g_dir_close (dir);
+}
+
+/**
+ * @returns the paths of the bundled examples, free with g_ptr_array_unref
+ */
+static GPtrArray *
+test_load_schematic_get_examples ()
+{
+	g_autofree gchar *test_dir = get_test_base_dir ();
+	const gchar *const subdirs[] = {"", "highquality"};
+	GPtrArray *paths = g_ptr_array_new_with_free_func (g_free);
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (subdirs); i++) {
+		g_autofree gchar *dirname =
+		    g_build_filename (test_dir, "..", "data", "examples", subdirs[i], NULL);
+		GDir *dir = g_dir_open (dirname, 0, NULL);
+		const gchar *name;
+
+		g_assert_nonnull (dir);
+		while ((name = g_dir_read_name (dir)) != NULL)
+			if (g_str_has_suffix (name, ".oregano"))
+				g_ptr_array_add (paths, g_build_filename (dirname, name, NULL));
+		g_dir_close (dir);
+	}
+
+	return paths;
+}
+
+/**
+ * all examples load with every part they contain
+ */
+static void
+test_load_schematic_examples ()
+{
+	GPtrArray *paths;
+	guint i;
+
+	test_load_schematic_libraries_add ();
+	paths = test_load_schematic_get_examples ();
+	g_assert_cmpuint (paths->len, >, 0);
+
+	for (i = 0; i < paths->len; i++) {
+		const gchar *path = g_ptr_array_index (paths, i);
+		gchar *text, *p;
+		guint n_parts = 0;
+		Schematic *sm;
+		GError *e = NULL;
+
+		g_assert_true (g_file_get_contents (path, &text, NULL, &e));
+		g_assert_no_error (e);
+		for (p = strstr (text, "<ogo:part>"); p; p = strstr (p + 1, "<ogo:part>"))
+			n_parts++;
+
+		sm = schematic_read (path, &e);
+		g_assert_no_error (e);
+		g_assert_cmpuint (g_list_length (schematic_get_store (sm)->parts), ==, n_parts);
+		g_assert_cmpuint (g_list_length (schematic_get_store (sm)->wires), >, 0);
+
+		g_object_unref (sm);
+		g_free (text);
+	}
+
+	g_ptr_array_unref (paths);
+	library_index_clear ();
+}
+
+/**
+ * @returns a schematic of many sources and wires as XML text
+ */
+static GString *
+test_load_schematic_generate (guint n_parts, guint n_wires)
+{
+	GString *text = g_string_new ("<?xml version=\"1.0\"?>\n"
+	                              "<ogo:schematic "
+	                              "xmlns:ogo=\"https://beerbach.me/project/oregano/ns/v1\">\n"
+	                              "  <ogo:parts>\n");
+	guint i;
+
+	for (i = 0; i < n_parts; i++)
+		g_string_append_printf (text,
+		                        "    <ogo:part>\n"
+		                        "      <ogo:rotation>%u</ogo:rotation>\n"
+		                        "      <ogo:name>VSIN</ogo:name>\n"
+		                        "      <ogo:library>Default</ogo:library>\n"
+		                        "      <ogo:symbol>VSIN</ogo:symbol>\n"
+		                        "      <ogo:position>(%u %u)</ogo:position>\n"
+		                        "      <ogo:properties>\n"
+		                        "        <ogo:property>\n"
+		                        "          <ogo:name>Refdes</ogo:name>\n"
+		                        "          <ogo:value>V%u</ogo:value>\n"
+		                        "        </ogo:property>\n"
+		                        "      </ogo:properties>\n"
+		                        "      <ogo:labels/>\n"
+		                        "    </ogo:part>\n",
+		                        (i % 4) * 90, 100 * (i % 100), 100 * (i / 100), i + 1);
+	g_string_append (text, "  </ogo:parts>\n  <ogo:wires>\n");
+	for (i = 0; i < n_wires; i++)
+		g_string_append_printf (text,
+		                        "    <ogo:wire>\n"
+		                        "      <ogo:points>(%u %u)(%u %u)</ogo:points>\n"
+		                        "    </ogo:wire>\n",
+		                        20000 + 10 * (i % 100), 10 * (i / 100), 20005 + 10 * (i % 100),
+		                        10 * (i / 100));
+	g_string_append (text, "  </ogo:wires>\n</ogo:schematic>\n");
+
+	return text;
+}
+
+/**
+ * times opening the bundled examples and a generated large schematic,
+ * run with -m perf
+ */
+static void
+test_load_schematic_benchmark ()
+{
+	GPtrArray *paths;
+	GString *text;
+	Schematic *sm;
+	gchar *dir, *filename;
+	gdouble elapsed;
+	guint i, run;
+	GError *e = NULL;
+
+	if (!g_test_perf ()) {
+		g_test_skip ("only run with -m perf");
+		return;
+	}
+
+	test_load_schematic_libraries_add ();
+
+	paths = test_load_schematic_get_examples ();
+	g_test_timer_start ();
+	for (run = 0; run < TEST_LOAD_SCHEMATIC_BENCH_RUNS; run++)
+		for (i = 0; i < paths->len; i++) {
+			sm = schematic_read (g_ptr_array_index (paths, i), &e);
+			g_assert_no_error (e);
+			g_object_unref (sm);
+		}
+	elapsed = g_test_timer_elapsed ();
+	g_test_message ("examples: %u files, %.3f ms per file", paths->len,
+	                1000. * elapsed / (paths->len * TEST_LOAD_SCHEMATIC_BENCH_RUNS));
+	g_ptr_array_unref (paths);
+
+	text = test_load_schematic_generate (TEST_LOAD_SCHEMATIC_BENCH_PARTS,
+	                                     TEST_LOAD_SCHEMATIC_BENCH_WIRES);
+	dir = g_dir_make_tmp ("oregano-test-XXXXXX", &e);
+	g_assert_no_error (e);
+	filename = g_build_filename (dir, "generated.oregano", NULL);
+	g_assert_true (g_file_set_contents (filename, text->str, text->len, &e));
+	g_test_timer_start ();
+	sm = schematic_read (filename, &e);
+	elapsed = g_test_timer_elapsed ();
+	g_assert_no_error (e);
+	g_test_message ("generated: %u parts, %u wires, %" G_GSIZE_FORMAT " bytes, open %.3f s",
+	                TEST_LOAD_SCHEMATIC_BENCH_PARTS, TEST_LOAD_SCHEMATIC_BENCH_WIRES, text->len,
+	                elapsed);
+	g_assert_cmpuint (g_list_length (schematic_get_store (sm)->parts), ==,
+	                  TEST_LOAD_SCHEMATIC_BENCH_PARTS);
+
+	g_unlink (filename);
+	g_rmdir (dir);
+	g_free (filename);
+	g_free (dir);
+	g_object_unref (sm);
+	g_string_free (text, TRUE);
+	library_index_clear ();
+}
+
+#endif
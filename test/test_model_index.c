@@ -0,0 +1,326 @@
+/*
+ * test_model_index.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_MODEL_INDEX
+#define TEST_MODEL_INDEX
+
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "../src/engines/model-index.h"
+#include "../src/errors.h"
+
+// b is instantiated by a, both carry the same .model card
+#define TEST_MODEL_INDEX_A                                                                         \
+	"* transistor A\n"                                                                             \
+	".subckt A 1 2 3\n"                                                                            \
+	"X1 1 2 B\n"                                                                                   \
+	"Q1 1 2 3 QSHARED\n"                                                                           \
+	".ends A\n"                                                                                    \
+	".model QSHARED NPN (BF=100)\n"
+#define TEST_MODEL_INDEX_B                                                                         \
+	".subckt B 1 2\n"                                                                              \
+	"R1 1 2 1k\n"                                                                                  \
+	".ends B\n"                                                                                    \
+	".model QSHARED NPN (BF=100)\n"
+// d and e share a .model card of several lines
+#define TEST_MODEL_INDEX_D                                                                         \
+	".model QMULTI NPN (IS=1e-15\n"                                                                \
+	"+ BF=100\n"                                                                                   \
+	"+ VAF=50)\n"
+#define TEST_MODEL_INDEX_E                                                                         \
+	TEST_MODEL_INDEX_D                                                                             \
+	".model QOTHER NPN (IS=1e-15\n"                                                                \
+	"+ BF=200)\n"
+#define TEST_MODEL_INDEX_C                                                                         \
+	".subckt C 1 2 3\n"                                                                            \
+	"X1 1 2 3 A\n"                                                                                 \
+	".ends C\n"
+
+static void test_model_index_build ();
+static void test_model_index_load ();
+static void test_model_index_stamp ();
+static void test_model_index_multi_line_card ();
+
+void
+add_funcs_test_model_index ()
+{
+	g_test_add_func ("/core/engine/model-index/build", test_model_index_build);
+	g_test_add_func ("/core/engine/model-index/load", test_model_index_load);
+	g_test_add_func ("/core/engine/model-index/stamp", test_model_index_stamp);
+	g_test_add_func ("/core/engine/model-index/multi-line-card",
+	                 test_model_index_multi_line_card);
+}
+
+typedef struct
+{
+	gchar *dir;
+	gchar *models;
+	gchar *cache;
+} TestModelIndexDirs;
+
+static void
+test_model_index_write (const gchar *dir, const gchar *name, const gchar *content)
+{
+	gchar *path = g_build_filename (dir, name, NULL);
+	GError *e = NULL;
+
+	g_assert_true (g_file_set_contents (path, content, -1, &e));
+	g_assert_no_error (e);
+	g_free (path);
+}
+
+/**
+ * a model directory with a and b, and an empty cache directory, which
+ * the index uses from now on
+ */
+static void
+test_model_index_dirs_init (TestModelIndexDirs *dirs)
+{
+	GError *e = NULL;
+
+	dirs->dir = g_dir_make_tmp ("oregano-test-XXXXXX", &e);
+	g_assert_no_error (e);
+	dirs->models = g_build_filename (dirs->dir, "models", NULL);
+	dirs->cache = g_build_filename (dirs->dir, "cache", NULL);
+	g_assert_cmpint (g_mkdir (dirs->models, 0755), ==, 0);
+	g_assert_cmpint (g_mkdir (dirs->cache, 0755), ==, 0);
+
+	test_model_index_write (dirs->models, "a.model", TEST_MODEL_INDEX_A);
+	test_model_index_write (dirs->models, "b.model", TEST_MODEL_INDEX_B);
+
+	model_index_set_dirs (dirs->models, dirs->cache);
+}
+
+static void
+test_model_index_dirs_clear (TestModelIndexDirs *dirs)
+{
+	const gchar *const subdirs[] = {dirs->models, dirs->cache};
+	guint i;
+
+	model_index_set_dirs (NULL, NULL);
+
+	for (i = 0; i < G_N_ELEMENTS (subdirs); i++) {
+		GDir *dir = g_dir_open (subdirs[i], 0, NULL);
+		const gchar *name;
+
+		g_assert_nonnull (dir);
+		while ((name = g_dir_read_name (dir)) != NULL) {
+			gchar *path = g_build_filename (subdirs[i], name, NULL);
+			g_unlink (path);
+			g_free (path);
+		}
+		g_dir_close (dir);
+		g_rmdir (subdirs[i]);
+	}
+	g_rmdir (dirs->dir);
+
+	g_free (dirs->cache);
+	g_free (dirs->models);
+	g_free (dirs->dir);
+}
+
+/**
+ * @returns the model block written for a single model
+ */
+static gchar *
+test_model_index_write_model (const gchar *name)
+{
+	GList *models = g_list_append (NULL, (gpointer)name);
+	GString *out = g_string_new ("");
+	GError *e = NULL;
+
+	g_assert_true (model_index_write_models (models, out, &e));
+	g_assert_no_error (e);
+	g_list_free (models);
+
+	return g_string_free (out, FALSE);
+}
+
+/**
+ * dependencies come first, every model and every shared .model card
+ * once only, and both files are cached
+ */
+static void
+test_model_index_build ()
+{
+	TestModelIndexDirs dirs;
+	GList *models = NULL;
+	GString *out;
+	gchar *block, *path;
+	GError *e = NULL;
+
+	test_model_index_dirs_init (&dirs);
+
+	block = test_model_index_write_model ("a");
+	g_assert_cmpstr (block, ==, "* b.model\n" TEST_MODEL_INDEX_B "* a.model\n"
+	                            "* transistor A\n"
+	                            ".subckt A 1 2 3\n"
+	                            "X1 1 2 B\n"
+	                            "Q1 1 2 3 QSHARED\n"
+	                            ".ends A\n");
+	g_free (block);
+
+	path = g_build_filename (dirs.cache, "models.lib", NULL);
+	g_assert_true (g_file_test (path, G_FILE_TEST_IS_REGULAR));
+	g_free (path);
+	path = g_build_filename (dirs.cache, "models.idx", NULL);
+	g_assert_true (g_file_test (path, G_FILE_TEST_IS_REGULAR));
+	g_free (path);
+
+	// a model which is asked for twice is still written once
+	models = g_list_append (models, "b");
+	models = g_list_append (models, "a");
+	models = g_list_append (models, "b");
+	out = g_string_new ("");
+	g_assert_true (model_index_write_models (models, out, &e));
+	g_assert_no_error (e);
+	g_assert_true (g_str_has_prefix (out->str, "* b.model\n"));
+	g_assert_null (strstr (out->str + 1, "* b.model\n"));
+	g_string_free (out, TRUE);
+	g_list_free (models);
+
+	// unknown models fail
+	models = g_list_append (NULL, "nonexistent");
+	out = g_string_new ("");
+	g_assert_false (model_index_write_models (models, out, &e));
+	g_assert_error (e, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_NO_SUCH_PART);
+	g_clear_error (&e);
+	g_string_free (out, TRUE);
+	g_list_free (models);
+
+	test_model_index_dirs_clear (&dirs);
+}
+
+/**
+ * an index which is still up to date is loaded from the cache instead
+ * of reading the model files again
+ */
+static void
+test_model_index_load ()
+{
+	TestModelIndexDirs dirs;
+	gchar *block, *path, *library, *value;
+	gsize length;
+	GError *e = NULL;
+
+	test_model_index_dirs_init (&dirs);
+
+	block = test_model_index_write_model ("b");
+	g_assert_nonnull (strstr (block, "R1 1 2 1k\n"));
+	g_free (block);
+
+	// change the cached library only, keeping the offsets valid
+	path = g_build_filename (dirs.cache, "models.lib", NULL);
+	g_assert_true (g_file_get_contents (path, &library, &length, &e));
+	g_assert_no_error (e);
+	value = strstr (library, "1k");
+	g_assert_nonnull (value);
+	*value = '2';
+	g_assert_true (g_file_set_contents (path, library, length, &e));
+	g_assert_no_error (e);
+	g_free (library);
+	g_free (path);
+
+	// drop the index in memory
+	model_index_set_dirs (dirs.models, dirs.cache);
+	block = test_model_index_write_model ("b");
+	g_assert_nonnull (strstr (block, "R1 1 2 2k\n"));
+	g_free (block);
+
+	test_model_index_dirs_clear (&dirs);
+}
+
+/**
+ * adding a model file invalidates the cached index, in memory and on
+ * disk
+ */
+static void
+test_model_index_stamp ()
+{
+	TestModelIndexDirs dirs;
+	gchar *block, *path, *library, *value;
+	gsize length;
+	GError *e = NULL;
+
+	test_model_index_dirs_init (&dirs);
+
+	block = test_model_index_write_model ("a");
+	g_free (block);
+
+	// a changed cache shows whether it was rebuilt from the model files
+	path = g_build_filename (dirs.cache, "models.lib", NULL);
+	g_assert_true (g_file_get_contents (path, &library, &length, &e));
+	g_assert_no_error (e);
+	value = strstr (library, "1k");
+	g_assert_nonnull (value);
+	*value = '2';
+	g_assert_true (g_file_set_contents (path, library, length, &e));
+	g_assert_no_error (e);
+	g_free (library);
+	g_free (path);
+
+	test_model_index_write (dirs.models, "c.model", TEST_MODEL_INDEX_C);
+
+	block = test_model_index_write_model ("c");
+	g_assert_true (g_str_has_prefix (block, "* b.model\n"));
+	g_assert_nonnull (strstr (block, "R1 1 2 1k\n"));
+	g_assert_nonnull (strstr (block, "* a.model\n"));
+	g_assert_true (g_str_has_suffix (block, "* c.model\n" TEST_MODEL_INDEX_C));
+	g_free (block);
+
+	test_model_index_dirs_clear (&dirs);
+}
+
+/**
+ * a shared card is skipped with all of its + lines, the card after it
+ * is still written
+ */
+static void
+test_model_index_multi_line_card ()
+{
+	TestModelIndexDirs dirs;
+	GList *models = NULL;
+	GString *out;
+	GError *e = NULL;
+
+	test_model_index_dirs_init (&dirs);
+	test_model_index_write (dirs.models, "d.model", TEST_MODEL_INDEX_D);
+	test_model_index_write (dirs.models, "e.model", TEST_MODEL_INDEX_E);
+
+	models = g_list_append (models, "d");
+	models = g_list_append (models, "e");
+	out = g_string_new ("");
+	g_assert_true (model_index_write_models (models, out, &e));
+	g_assert_no_error (e);
+	g_assert_cmpstr (out->str, ==, "* d.model\n" TEST_MODEL_INDEX_D "* e.model\n"
+	                               ".model QOTHER NPN (IS=1e-15\n"
+	                               "+ BF=200)\n");
+	g_string_free (out, TRUE);
+	g_list_free (models);
+
+	test_model_index_dirs_clear (&dirs);
+}
+
+#endif
@@ -0,0 +1,416 @@
+/*
+ * test_netlist_helper.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_NETLIST_HELPER
+#define TEST_NETLIST_HELPER
+
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "../src/engines/netlist-helper.h"
+#include "../src/model/schematic.h"
+#include "../src/model/part-private.h"
+#include "../src/load-common.h"
+#include "../src/load-library.h"
+#include "../src/library-index.h"
+#include "../src/errors.h"
+
+#define TEST_NETLIST_HELPER_NUM_RESISTORS 1000
+
+static void test_netlist_helper_parallel ();
+static void test_netlist_helper_parallel_stream ();
+static void test_netlist_helper_snapshot ();
+static void test_netlist_helper_subckt_nested ();
+static void test_netlist_helper_subckt_cycle ();
+
+void
+add_funcs_test_netlist_helper ()
+{
+	g_test_add_func ("/core/engine/netlist-helper/parallel", test_netlist_helper_parallel);
+	g_test_add_func ("/core/engine/netlist-helper/parallel_stream", test_netlist_helper_parallel_stream);
+	g_test_add_func ("/core/engine/netlist-helper/snapshot", test_netlist_helper_snapshot);
+	g_test_add_func ("/core/engine/netlist-helper/subckt-nested", test_netlist_helper_subckt_nested);
+	g_test_add_func ("/core/engine/netlist-helper/subckt-cycle", test_netlist_helper_subckt_cycle);
+}
+
+/**
+ * places a part with one pin at x, or two pins at x and x + 10
+ *
+ * @props name, value, name, value, ..., NULL
+ */
+static void
+test_netlist_helper_add_part (NodeStore *store, gdouble x, gboolean two_pins, const gchar *const *props)
+{
+	Part *part = part_new ();
+	Pin pins[2] = {{.offset = {0., 0.}}, {.offset = {10., 0.}}};
+	Coords pos = {x, 0.};
+	GSList *list = NULL;
+
+	if (two_pins)
+		list = g_slist_prepend (list, &pins[1]);
+	list = g_slist_prepend (list, &pins[0]);
+	part_set_pins (part, list);
+	g_slist_free (list);
+
+	for (int i = 0; props[i] != NULL; i += 2) {
+		Property *prop = g_new0 (Property, 1);
+		prop->name = g_strdup (props[i]);
+		prop->value = g_strdup (props[i + 1]);
+		part->priv->properties = g_slist_prepend (part->priv->properties, prop);
+	}
+
+	item_data_set_pos (ITEM_DATA (part), &pos);
+	node_store_add_part (store, part);
+}
+
+/**
+ * a ladder of resistors from GND to a voltage clamp
+ */
+static Schematic *
+test_netlist_helper_schematic_new ()
+{
+	Schematic *sm = schematic_new ();
+	NodeStore *store = schematic_get_store (sm);
+	const gchar *const gnd[] = {"internal", "ground", NULL};
+	const gchar *const clamp[] = {"internal", "clamp", "type", "v", NULL};
+	gint i;
+
+	test_netlist_helper_add_part (store, 0., FALSE, gnd);
+	for (i = 0; i < TEST_NETLIST_HELPER_NUM_RESISTORS; i++) {
+		g_autofree gchar *refdes = g_strdup_printf ("R%d", i + 1);
+		g_autofree gchar *res = g_strdup_printf ("%dk", i % 10 + 1);
+		const gchar *const resistor[] = {"Refdes", refdes, "res", res,
+		                                 "template", "R@refdes %1 %2 @res", NULL};
+		test_netlist_helper_add_part (store, 10. * i, TRUE, resistor);
+	}
+	test_netlist_helper_add_part (store, 10. * TEST_NETLIST_HELPER_NUM_RESISTORS, FALSE, clamp);
+
+	return sm;
+}
+
+static void
+test_netlist_helper_parallel ()
+{
+	Schematic *sm = test_netlist_helper_schematic_new ();
+	Netlist serial, parallel;
+	GError *e = NULL;
+
+	netlist_helper_set_chunk_size (0);
+	netlist_helper_create (sm, &serial, &e);
+	g_assert_no_error (e);
+
+	// an odd chunk size, so the last chunk is a short one
+	netlist_helper_set_chunk_size (7);
+	netlist_helper_create (sm, &parallel, &e);
+	g_assert_no_error (e);
+
+	netlist_helper_set_chunk_size (NETLIST_HELPER_CHUNK_SIZE);
+
+	g_assert_true (g_str_has_prefix (serial.template->str, "R"));
+	g_assert_cmpuint (serial.template->len, ==, parallel.template->len);
+	g_assert_cmpstr (serial.template->str, ==, parallel.template->str);
+
+	g_string_free (serial.template, TRUE);
+	g_string_free (parallel.template, TRUE);
+	g_string_free (serial.subckts, TRUE);
+	g_string_free (parallel.subckts, TRUE);
+	g_list_free_full (serial.models, g_free);
+	g_list_free_full (parallel.models, g_free);
+	g_object_unref (sm);
+}
+
+static void
+test_netlist_helper_parallel_stream ()
+{
+	Schematic *sm = test_netlist_helper_schematic_new ();
+	Netlist serial, parallel;
+	GOutputStream *stream;
+	GError *e = NULL;
+
+	netlist_helper_set_chunk_size (0);
+	netlist_helper_create (sm, &serial, &e);
+	g_assert_no_error (e);
+
+	stream = g_memory_output_stream_new_resizable ();
+	netlist_helper_set_chunk_size (7);
+	netlist_helper_create_stream (sm, &parallel, stream, &e);
+	g_assert_no_error (e);
+	g_assert_null (parallel.template);
+
+	netlist_helper_set_chunk_size (NETLIST_HELPER_CHUNK_SIZE);
+
+	g_output_stream_close (stream, NULL, &e);
+	g_assert_no_error (e);
+	g_assert_cmpuint (serial.template->len, ==,
+	                  g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (stream)));
+	g_assert_true (memcmp (serial.template->str,
+	                       g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (stream)),
+	                       serial.template->len) == 0);
+
+	g_object_unref (stream);
+	g_string_free (serial.template, TRUE);
+	g_string_free (serial.subckts, TRUE);
+	g_string_free (parallel.subckts, TRUE);
+	g_list_free_full (serial.models, g_free);
+	g_list_free_full (parallel.models, g_free);
+	g_object_unref (sm);
+}
+
+static void
+test_netlist_helper_snapshot ()
+{
+	Schematic *sm = test_netlist_helper_schematic_new ();
+	NetlistSnapshot *snapshot;
+	Netlist netlist;
+	GOutputStream *stream;
+	GList *iter;
+	Part *clamp = NULL;
+	gchar *cards, *analysis;
+	GError *e = NULL;
+
+	snapshot = netlist_helper_snapshot_new (sm, &e);
+	g_assert_no_error (e);
+	g_assert_nonnull (snapshot);
+
+	// so are changes of the simulation settings
+	sim_settings_set_trans_start (schematic_get_sim_settings (sm), "1 ms");
+	g_assert_cmpstr (netlist_helper_snapshot_get_sim_settings (snapshot)->trans_start, ==, "0 s");
+
+	// edits after taking the snapshot must not show up in the netlist
+	for (iter = schematic_get_store (sm)->parts; iter; iter = iter->next) {
+		Part *part = iter->data;
+		gchar *type = part_get_property (part, "type");
+
+		if (g_strcmp0 (type, "v") == 0)
+			clamp = part;
+		else if (part_get_property_ref (part, "res"))
+			item_data_set_property (ITEM_DATA (part), "res", "42G");
+		g_free (type);
+	}
+	g_assert_nonnull (clamp);
+
+	stream = g_memory_output_stream_new_resizable ();
+	netlist_helper_snapshot_create_stream (snapshot, &netlist, stream, &e);
+	g_assert_no_error (e);
+	g_output_stream_close (stream, NULL, &e);
+	g_assert_no_error (e);
+
+	cards = g_strndup (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (stream)),
+	                   g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (stream)));
+	g_assert_true (g_str_has_prefix (cards, "R"));
+	g_assert_null (strstr (cards, "42G"));
+
+	// the node numbers only reach the original once applied
+	g_assert_cmpint (part_get_pins (clamp)[0].node_nr, ==, 0);
+	netlist_helper_snapshot_apply (snapshot);
+	g_assert_cmpint (part_get_pins (clamp)[0].node_nr, !=, 0);
+
+	// the clamp is printed with the node number it was netlisted with
+	analysis = g_strdup_printf (" v(%d)", part_get_pins (clamp)[0].node_nr);
+	g_assert_cmpstr (netlist_helper_snapshot_get_analysis_string (snapshot), ==, analysis);
+	g_free (analysis);
+
+	g_free (cards);
+	g_object_unref (stream);
+	g_string_free (netlist.subckts, TRUE);
+	g_list_free_full (netlist.models, g_free);
+	netlist_helper_snapshot_free (snapshot);
+	g_object_unref (sm);
+}
+
+/**
+ * a block placed in a sub-schematic file, on a two pin symbol
+ */
+#define TEST_NETLIST_HELPER_BLOCK(properties)                                                      \
+	"<?xml version=\"1.0\"?>\n"                                                                   \
+	"<ogo:schematic xmlns:ogo=\"https://beerbach.me/project/oregano/ns/v1\">\n"                     \
+	"  <ogo:parts>\n"                                                                             \
+	"    <ogo:part>\n"                                                                            \
+	"      <ogo:name>Block</ogo:name>\n"                                                          \
+	"      <ogo:library>Test</ogo:library>\n"                                                     \
+	"      <ogo:symbol>two-pin</ogo:symbol>\n"                                                    \
+	"      <ogo:position>(0 0)</ogo:position>\n"                                                  \
+	"      <ogo:properties>\n" properties "      </ogo:properties>\n"                             \
+	"    </ogo:part>\n"                                                                           \
+	"  </ogo:parts>\n"                                                                            \
+	"</ogo:schematic>\n"
+#define TEST_NETLIST_HELPER_PROPERTY(name, value)                                                  \
+	"        <ogo:property><ogo:name>" name "</ogo:name><ogo:value>" value                        \
+	"</ogo:value></ogo:property>\n"
+
+/**
+ * registers the library of the two pin symbol the sub-schematics use
+ */
+static void
+test_netlist_helper_library_add ()
+{
+	Library *library = g_new0 (Library, 1);
+	LibrarySymbol *symbol = g_new0 (LibrarySymbol, 1);
+	static Pin pins[2] = {{.offset = {0., 0.}}, {.offset = {10., 0.}}};
+
+	library->name = g_strdup ("Test");
+	library->part_hash = g_hash_table_new (g_str_hash, g_str_equal);
+	library->symbol_hash = g_hash_table_new (g_str_hash, g_str_equal);
+	symbol->name = g_strdup ("two-pin");
+	symbol->connections = g_slist_append (g_slist_append (NULL, &pins[0]), &pins[1]);
+	g_hash_table_insert (library->symbol_hash, symbol->name, symbol);
+
+	library_index_add (library);
+}
+
+/**
+ * @returns a schematic with a block between GND and a clamp, which is
+ *  saved in dir
+ */
+static Schematic *
+test_netlist_helper_block_schematic_new (const gchar *dir, const gchar *block)
+{
+	Schematic *sm = schematic_new ();
+	NodeStore *store = schematic_get_store (sm);
+	g_autofree gchar *filename = g_build_filename (dir, "top.oregano", NULL);
+	const gchar *const gnd[] = {"internal", "ground", NULL};
+	const gchar *const clamp[] = {"internal", "clamp", "type", "v", NULL};
+	const gchar *const instance[] = {"Subckt", "A", "Schematic", block,
+	                                 "template", "X1 %1 %2 @Subckt", NULL};
+
+	test_netlist_helper_add_part (store, 0., FALSE, gnd);
+	test_netlist_helper_add_part (store, 0., TRUE, instance);
+	test_netlist_helper_add_part (store, 10., FALSE, clamp);
+	schematic_set_filename (sm, filename);
+
+	return sm;
+}
+
+static void
+test_netlist_helper_write (const gchar *dir, const gchar *name, const gchar *content)
+{
+	g_autofree gchar *path = g_build_filename (dir, name, NULL);
+	GError *e = NULL;
+
+	g_assert_true (g_file_set_contents (path, content, -1, &e));
+	g_assert_no_error (e);
+}
+
+static void
+test_netlist_helper_remove (const gchar *dir, const gchar *const *names)
+{
+	for (gint i = 0; names[i] != NULL; i++) {
+		g_autofree gchar *path = g_build_filename (dir, names[i], NULL);
+		g_unlink (path);
+	}
+	g_rmdir (dir);
+}
+
+/**
+ * blocks inside of a block are looked up next to the sub-schematic
+ * which places them, and defined before it
+ */
+static void
+test_netlist_helper_subckt_nested ()
+{
+	const gchar *const files[] = {"a.oregano", "b.oregano", NULL};
+	gchar *dir, *subdir;
+	Schematic *sm;
+	Netlist netlist;
+	const gchar *a, *b;
+	GError *e = NULL;
+
+	dir = g_dir_make_tmp ("oregano-test-XXXXXX", &e);
+	g_assert_no_error (e);
+	subdir = g_build_filename (dir, "sub", NULL);
+	g_assert_cmpint (g_mkdir (subdir, 0755), ==, 0);
+
+	test_netlist_helper_library_add ();
+	test_netlist_helper_write (
+	    subdir, "a.oregano",
+	    TEST_NETLIST_HELPER_BLOCK (TEST_NETLIST_HELPER_PROPERTY ("Subckt", "B")
+	                                   TEST_NETLIST_HELPER_PROPERTY ("Schematic", "b.oregano")
+	                                       TEST_NETLIST_HELPER_PROPERTY ("template", "X1 %1 %2 B")));
+	test_netlist_helper_write (
+	    subdir, "b.oregano",
+	    TEST_NETLIST_HELPER_BLOCK (TEST_NETLIST_HELPER_PROPERTY ("template", "R1 %1 %2 1k")));
+
+	sm = test_netlist_helper_block_schematic_new (dir, "sub/a.oregano");
+	netlist_helper_create (sm, &netlist, &e);
+	g_assert_no_error (e);
+
+	g_assert_nonnull (strstr (netlist.template->str, "X1 0 "));
+	a = strstr (netlist.subckts->str, ".subckt A");
+	b = strstr (netlist.subckts->str, ".subckt B");
+	g_assert_nonnull (a);
+	g_assert_nonnull (b);
+	g_assert_true (b < a);
+	g_assert_null (strstr (a + 1, ".subckt A"));
+	g_assert_null (strstr (b + 1, ".subckt B"));
+	g_assert_nonnull (strstr (b, "R1 "));
+
+	g_string_free (netlist.template, TRUE);
+	g_string_free (netlist.subckts, TRUE);
+	g_list_free_full (netlist.models, g_free);
+	g_object_unref (sm);
+	library_index_clear ();
+	test_netlist_helper_remove (subdir, files);
+	g_rmdir (dir);
+	g_free (subdir);
+	g_free (dir);
+}
+
+/**
+ * a block which places itself fails instead of defining a recursive
+ * subcircuit
+ */
+static void
+test_netlist_helper_subckt_cycle ()
+{
+	const gchar *const files[] = {"a.oregano", NULL};
+	gchar *dir;
+	Schematic *sm;
+	Netlist netlist;
+	GError *e = NULL;
+
+	dir = g_dir_make_tmp ("oregano-test-XXXXXX", &e);
+	g_assert_no_error (e);
+
+	test_netlist_helper_library_add ();
+	test_netlist_helper_write (
+	    dir, "a.oregano",
+	    TEST_NETLIST_HELPER_BLOCK (TEST_NETLIST_HELPER_PROPERTY ("Subckt", "A")
+	                                   TEST_NETLIST_HELPER_PROPERTY ("Schematic", "a.oregano")
+	                                       TEST_NETLIST_HELPER_PROPERTY ("template", "X1 %1 %2 A")));
+
+	sm = test_netlist_helper_block_schematic_new (dir, "a.oregano");
+	netlist_helper_create (sm, &netlist, &e);
+	g_assert_error (e, OREGANO_ERROR, OREGANO_SIMULATE_ERROR_NO_SUCH_PART);
+	g_clear_error (&e);
+	g_assert_null (netlist.template);
+	g_assert_null (netlist.subckts);
+
+	g_object_unref (sm);
+	library_index_clear ();
+	test_netlist_helper_remove (dir, files);
+	g_free (dir);
+}
+
+#endif
@@ -62,4 +62,90 @@ test_nodestore ()
 	g_object_unref (store);
 }
 
+static Wire *
+test_nodestore_wire_new (gdouble x0, gdouble y0, gdouble x1, gdouble y1)
+{
+	Wire *wire = wire_new ();
+	Coords pos = {x0, y0};
+	Coords len = {x1 - x0, y1 - y0};
+
+	wire_set_length (wire, &len);
+	item_data_set_pos (ITEM_DATA (wire), &pos);
+	return wire;
+}
+
+/**
+ * @returns a part with pins at (10,10) and (40,10) and wires through a
+ * pin, at the other pin, in a T, in an L and crossing without a node
+ */
+static GList *
+test_nodestore_items_new ()
+{
+	Part *part = part_new ();
+	Pin pins[2] = {{{0., 0.}}, {{30., 0.}}};
+	Coords pos = {10., 10.};
+	GSList *list = g_slist_append (g_slist_append (NULL, &pins[0]), &pins[1]);
+	GList *items = NULL;
+
+	part_set_pins (part, list);
+	g_slist_free (list);
+	item_data_set_pos (ITEM_DATA (part), &pos);
+
+	items = g_list_append (items, part);
+	items = g_list_append (items, test_nodestore_wire_new (10., 0., 10., 50.));
+	items = g_list_append (items, test_nodestore_wire_new (10., 30., 60., 30.));
+	items = g_list_append (items, test_nodestore_wire_new (60., 30., 60., 60.));
+	items = g_list_append (items, test_nodestore_wire_new (40., 10., 50., 0.));
+	items = g_list_append (items, test_nodestore_wire_new (0., 40., 30., 40.));
+	return items;
+}
+
+/**
+ * adding all items at once connects them as adding them one by one does
+ */
+void
+test_nodestore_add_items ()
+{
+	const Coords nodes[] = {{10., 10.}, {40., 10.}, {10., 30.}, {60., 30.}};
+	const guint wires[] = {1, 1, 2, 2};
+	const guint pins[] = {1, 1, 0, 0};
+	const Coords none[] = {{10., 0.}, {10., 40.}, {0., 40.}, {60., 60.}};
+	GList *each = test_nodestore_items_new ();
+	GList *bulk = test_nodestore_items_new ();
+	NodeStore *each_store = node_store_new ();
+	NodeStore *bulk_store = node_store_new ();
+	GList *iter;
+	guint i;
+
+	for (iter = each; iter; iter = iter->next) {
+		if (IS_PART (iter->data))
+			node_store_add_part (each_store, iter->data);
+		else
+			node_store_add_wire (each_store, iter->data);
+	}
+	node_store_add_items (bulk_store, bulk);
+
+	g_assert_cmpuint (g_list_length (bulk_store->wires), ==, 5);
+	g_assert_cmpuint (g_list_length (bulk_store->parts), ==, 1);
+	g_assert_cmpuint (g_hash_table_size (bulk_store->nodes), ==, G_N_ELEMENTS (nodes));
+	g_assert_cmpuint (g_hash_table_size (each_store->nodes), ==, G_N_ELEMENTS (nodes));
+	for (i = 0; i < G_N_ELEMENTS (nodes); i++) {
+		Node *a = node_store_get_node (each_store, nodes[i]);
+		Node *b = node_store_get_node (bulk_store, nodes[i]);
+
+		g_assert_nonnull (a);
+		g_assert_nonnull (b);
+		g_assert_cmpuint (g_slist_length (a->wires), ==, wires[i]);
+		g_assert_cmpuint (g_slist_length (b->wires), ==, wires[i]);
+		g_assert_cmpuint (g_slist_length (b->pins), ==, pins[i]);
+	}
+	for (i = 0; i < G_N_ELEMENTS (none); i++)
+		g_assert_null (node_store_get_node (bulk_store, none[i]));
+
+	g_object_unref (bulk_store);
+	g_object_unref (each_store);
+	g_list_free_full (bulk, g_object_unref);
+	g_list_free_full (each, g_object_unref);
+}
+
 #endif
@@ -0,0 +1,239 @@
+/*
+ * test_save_schematic.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_SAVE_SCHEMATIC
+#define TEST_SAVE_SCHEMATIC
+
+#include <glib.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <libxml/parser.h>
+
+#include "../src/oregano.h"
+#include "../src/save-schematic.h"
+#include "../src/model/schematic.h"
+#include "../src/model/part-private.h"
+#include "../src/model/textbox.h"
+#include "../src/load-common.h"
+
+static void test_save_schematic_libxml ();
+static void test_save_schematic_compressed ();
+static void test_save_schematic_snapshot ();
+
+void
+add_funcs_test_save_schematic ()
+{
+	g_test_add_func ("/core/save-schematic/libxml", test_save_schematic_libxml);
+	g_test_add_func ("/core/save-schematic/compressed", test_save_schematic_compressed);
+	g_test_add_func ("/core/save-schematic/snapshot", test_save_schematic_snapshot);
+}
+
+static Library test_save_schematic_library = {.name = "Default & <more>"};
+
+static Schematic *
+test_save_schematic_new ()
+{
+	Schematic *sm = schematic_new ();
+	NodeStore *store = schematic_get_store (sm);
+	Part *part = part_new ();
+	Wire *wire = wire_new ();
+	Textbox *textbox = textbox_new (NULL);
+	Property *prop = g_new0 (Property, 1);
+	Coords pos = {10., 20.};
+	Coords len = {0., 30.};
+
+	part->priv->name = g_strdup ("Resistor");
+	part->priv->symbol_name = g_strdup ("R");
+	part->priv->library = &test_save_schematic_library;
+	prop->name = g_strdup ("Comment");
+	prop->value = g_strdup ("1 < 2 && \xc3\xa9t\xc3\xa9\r\n\tok");
+	part->priv->properties = g_slist_prepend (part->priv->properties, prop);
+	item_data_set_pos (ITEM_DATA (part), &pos);
+	node_store_add_part (store, part);
+
+	item_data_set_pos (ITEM_DATA (wire), &pos);
+	wire_set_length (wire, &len);
+	node_store_add_wire (store, wire);
+
+	textbox_set_text (textbox, "");
+	schematic_add_item (sm, ITEM_DATA (textbox));
+
+	return sm;
+}
+
+/**
+ * @returns the schematic as written to a stream, free with g_free
+ */
+static gchar *
+test_save_schematic_write (Schematic *sm, gsize *len)
+{
+	GOutputStream *out = g_memory_output_stream_new_resizable ();
+	GError *e = NULL;
+	gchar *data;
+
+	schematic_write_xml_stream (sm, out, &e);
+	g_assert_no_error (e);
+	g_output_stream_close (out, NULL, &e);
+	g_assert_no_error (e);
+	*len = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (out));
+	data = g_memory_output_stream_steal_data (G_MEMORY_OUTPUT_STREAM (out));
+	g_object_unref (out);
+
+	return data;
+}
+
+/**
+ * the output is the same as libxml2 saves, with formatting, once the
+ * document is read back without the indentation
+ */
+static void
+test_save_schematic_libxml ()
+{
+	Schematic *sm = test_save_schematic_new ();
+	xmlDocPtr doc;
+	xmlChar *dump;
+	gchar *data, *text;
+	gsize len;
+	int size;
+
+	data = test_save_schematic_write (sm, &len);
+	text = g_strndup (data, len);
+	g_assert_nonnull (strstr (text, "<ogo:library>Default &amp; &lt;more&gt;</ogo:library>"));
+	g_assert_nonnull (strstr (text, "1 &lt; 2 &amp;&amp; "));
+	g_assert_nonnull (strstr (text, "<ogo:labels/>"));
+
+	doc = xmlReadMemory (data, len, NULL, NULL, XML_PARSE_NOBLANKS);
+	g_assert_nonnull (doc);
+	xmlDocDumpFormatMemory (doc, &dump, &size, 1);
+	g_assert_cmpstr ((gchar *)dump, ==, text);
+
+	xmlFree (dump);
+	xmlFreeDoc (doc);
+	g_free (text);
+	g_free (data);
+	g_object_unref (sm);
+}
+
+static void
+test_save_schematic_compressed ()
+{
+	Schematic *sm = test_save_schematic_new ();
+	gboolean compress_files = oregano.compress_files;
+	GConverter *decompressor;
+	GFile *file;
+	GInputStream *file_in, *in;
+	GOutputStream *out;
+	gchar *dir, *filename, *data;
+	gsize len;
+	GError *e = NULL;
+
+	dir = g_dir_make_tmp ("oregano-test-XXXXXX", &e);
+	g_assert_no_error (e);
+	filename = g_build_filename (dir, "compressed.oregano", NULL);
+	schematic_set_filename (sm, filename);
+
+	oregano.compress_files = TRUE;
+	g_assert_true (schematic_write_xml (sm, &e));
+	g_assert_no_error (e);
+	oregano.compress_files = compress_files;
+
+	file = g_file_new_for_path (filename);
+	file_in = G_INPUT_STREAM (g_file_read (file, NULL, &e));
+	g_assert_no_error (e);
+	decompressor = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+	in = g_converter_input_stream_new (file_in, decompressor);
+	out = g_memory_output_stream_new_resizable ();
+	g_output_stream_splice (out, in, G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+	                                     G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET, NULL, &e);
+	g_assert_no_error (e);
+
+	data = test_save_schematic_write (sm, &len);
+	g_assert_cmpuint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (out)), ==, len);
+	g_assert_true (memcmp (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (out)), data,
+	                       len) == 0);
+
+	g_object_unref (out);
+	g_object_unref (in);
+	g_object_unref (decompressor);
+	g_object_unref (file_in);
+	g_object_unref (file);
+	g_unlink (filename);
+	g_rmdir (dir);
+	g_free (data);
+	g_free (filename);
+	g_free (dir);
+	g_object_unref (sm);
+}
+
+/**
+ * a snapshot keeps the schematic as it was taken, and is written on
+ * another thread
+ */
+static gpointer
+test_save_schematic_snapshot_thread (SchematicSnapshot *snapshot)
+{
+	GOutputStream *out = g_memory_output_stream_new_resizable ();
+	GError *e = NULL;
+
+	schematic_snapshot_write (snapshot, out, &e);
+	g_assert_no_error (e);
+	g_output_stream_close (out, NULL, &e);
+	g_assert_no_error (e);
+
+	return out;
+}
+
+static void
+test_save_schematic_snapshot ()
+{
+	Schematic *sm = test_save_schematic_new ();
+	SchematicSnapshot *snapshot;
+	GOutputStream *out;
+	GThread *thread;
+	Part *part;
+	Coords pos = {70., 80.};
+	gchar *before;
+	gsize len;
+
+	before = test_save_schematic_write (sm, &len);
+	snapshot = schematic_snapshot_new (sm);
+
+	part = schematic_get_store (sm)->parts->data;
+	item_data_set_pos (ITEM_DATA (part), &pos);
+	item_data_set_property (ITEM_DATA (part), "Comment", "changed");
+
+	thread = g_thread_new ("snapshot", (GThreadFunc)test_save_schematic_snapshot_thread, snapshot);
+	out = g_thread_join (thread);
+
+	g_assert_cmpuint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (out)), ==, len);
+	g_assert_true (memcmp (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (out)), before,
+	                       len) == 0);
+
+	g_object_unref (out);
+	schematic_snapshot_free (snapshot);
+	g_free (before);
+	g_object_unref (sm);
+}
+
+#endif
@@ -0,0 +1,388 @@
+/*
+ * test_schematic_binary.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_SCHEMATIC_BINARY
+#define TEST_SCHEMATIC_BINARY
+
+#include <glib.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "../src/errors.h"
+#include "../src/library-index.h"
+#include "../src/load-library.h"
+#include "../src/save-schematic.h"
+#include "../src/model/schematic.h"
+#include "../src/model/part-label.h"
+#include "../src/model/textbox.h"
+#include "../src/load-common.h"
+
+#define TEST_SCHEMATIC_BINARY_BENCH_PARTS 2000
+#define TEST_SCHEMATIC_BINARY_BENCH_WIRES 10000
+
+static void test_schematic_binary_roundtrip ();
+static void test_schematic_binary_truncated ();
+static void test_schematic_binary_benchmark ();
+
+void
+add_funcs_test_schematic_binary ()
+{
+	g_test_add_func ("/core/schematic-binary/roundtrip", test_schematic_binary_roundtrip);
+	g_test_add_func ("/core/schematic-binary/truncated", test_schematic_binary_truncated);
+	g_test_add_func ("/core/schematic-binary/benchmark", test_schematic_binary_benchmark);
+}
+
+/**
+ * indexes a library with a resistor of two pins, as the parts of the
+ * loaded schematics need their symbol
+ */
+static void
+test_schematic_binary_library_add ()
+{
+	static Connection pins[2] = {{{0., 0.}}, {{30., 0.}}};
+	Library *library = g_new0 (Library, 1);
+	LibraryPart *part = g_new0 (LibraryPart, 1);
+	LibrarySymbol *symbol = g_new0 (LibrarySymbol, 1);
+
+	library->name = g_strdup ("Bench");
+	library->part_hash = g_hash_table_new (g_str_hash, g_str_equal);
+	library->symbol_hash = g_hash_table_new (g_str_hash, g_str_equal);
+	part->name = g_strdup ("Resistor");
+	part->symbol_name = g_strdup ("Resistor");
+	part->library = library;
+	symbol->name = g_strdup ("Resistor");
+	symbol->connections = g_slist_append (g_slist_append (NULL, &pins[0]), &pins[1]);
+	g_hash_table_insert (library->part_hash, part->name, part);
+	g_hash_table_insert (library->symbol_hash, symbol->name, symbol);
+
+	library_index_add (library);
+}
+
+static void
+test_schematic_binary_add_part (Schematic *sm, gdouble x, gdouble y, gint rotation, IDFlip flip,
+                                const gchar *value)
+{
+	LibraryPart *library_part = library_index_get_part ("Resistor");
+	Property props[] = {{"Refdes", "R"},
+	                    {"res", (gchar *)value},
+	                    {"Comment", "1 < 2 && \xc3\xa9t\xc3\xa9"}};
+	PartLabel label = {"res", "@res", {5., -10.}};
+	LibraryPart copy = *library_part;
+	Coords pos = {x, y};
+	Part *part;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (props); i++)
+		copy.properties = g_slist_append (copy.properties, &props[i]);
+	copy.labels = g_slist_append (NULL, &label);
+
+	part = part_new_from_library_part (&copy);
+	g_assert_nonnull (part);
+	item_data_set_pos (ITEM_DATA (part), &pos);
+	item_data_rotate (ITEM_DATA (part), rotation, NULL);
+	if (flip & ID_FLIP_HORIZ)
+		item_data_flip (ITEM_DATA (part), ID_FLIP_HORIZ, NULL);
+	if (flip & ID_FLIP_VERT)
+		item_data_flip (ITEM_DATA (part), ID_FLIP_VERT, NULL);
+	schematic_add_item (sm, ITEM_DATA (part));
+
+	g_slist_free (copy.properties);
+	g_slist_free (copy.labels);
+}
+
+static void
+test_schematic_binary_add_wire (Schematic *sm, gdouble x0, gdouble y0, gdouble x1, gdouble y1)
+{
+	Wire *wire = wire_new ();
+	Coords pos = {x0, y0};
+	Coords len = {x1 - x0, y1 - y0};
+
+	wire_set_length (wire, &len);
+	item_data_set_pos (ITEM_DATA (wire), &pos);
+	schematic_add_item (sm, ITEM_DATA (wire));
+}
+
+/**
+ * a row of resistors in all orientations, a wire through the pins of the
+ * first ones and parallel wires below them
+ */
+static Schematic *
+test_schematic_binary_new (guint n_parts, guint n_wires)
+{
+	Schematic *sm = schematic_new ();
+	Textbox *textbox = textbox_new (NULL);
+	Coords pos = {40., 200.};
+	guint i;
+
+	schematic_set_title (sm, "Binary & <XML>");
+	schematic_set_author (sm, "Test");
+	schematic_set_comments (sm, "Two\nlines");
+
+	for (i = 0; i < n_parts; i++) {
+		g_autofree gchar *value = g_strdup_printf ("%uk", i % 10 + 1);
+
+		test_schematic_binary_add_part (sm, 50. * i + 10., 50., (i % 4) * 90, i % 3, value);
+	}
+	for (i = 0; i < n_wires; i++)
+		test_schematic_binary_add_wire (sm, 0., 100. + 10. * i, 40., 100. + 10. * i);
+	test_schematic_binary_add_wire (sm, 10., 50., 100., 50.);
+
+	textbox_set_text (textbox, "A note\n\tindented");
+	item_data_set_pos (ITEM_DATA (textbox), &pos);
+	schematic_add_item (sm, ITEM_DATA (textbox));
+
+	return sm;
+}
+
+/**
+ * @returns the schematic as saved in XML, free with g_free
+ */
+static gchar *
+test_schematic_binary_write_xml (Schematic *sm, gsize *len)
+{
+	GOutputStream *out = g_memory_output_stream_new_resizable ();
+	GError *e = NULL;
+	gchar *data;
+
+	schematic_write_xml_stream (sm, out, &e);
+	g_assert_no_error (e);
+	g_output_stream_close (out, NULL, &e);
+	g_assert_no_error (e);
+	*len = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (out));
+	data = g_memory_output_stream_steal_data (G_MEMORY_OUTPUT_STREAM (out));
+	g_object_unref (out);
+
+	return data;
+}
+
+static void
+test_schematic_binary_save_as (Schematic *sm, const gchar *filename)
+{
+	GError *e = NULL;
+
+	schematic_set_filename (sm, filename);
+	g_assert_true (schematic_save_file (sm, &e));
+	g_assert_no_error (e);
+}
+
+/**
+ * XML to binary and back gives the same file, and both load into the
+ * same schematic
+ */
+static void
+test_schematic_binary_roundtrip ()
+{
+	Schematic *sm, *from_xml, *from_binary, *from_xml_again;
+	gchar *dir, *xml_file, *binary_file, *xml_again_file;
+	gchar *xml, *xml_from_binary, *binary, *binary_again;
+	gsize xml_len, xml_from_binary_len, binary_len, binary_again_len;
+	GError *e = NULL;
+
+	test_schematic_binary_library_add ();
+	dir = g_dir_make_tmp ("oregano-test-XXXXXX", &e);
+	g_assert_no_error (e);
+	xml_file = g_build_filename (dir, "roundtrip.oregano", NULL);
+	binary_file = g_build_filename (dir, "roundtrip.orebin", NULL);
+	xml_again_file = g_build_filename (dir, "again.oregano", NULL);
+
+	sm = test_schematic_binary_new (8, 4);
+	test_schematic_binary_save_as (sm, xml_file);
+
+	from_xml = schematic_read (xml_file, &e);
+	g_assert_no_error (e);
+	xml = test_schematic_binary_write_xml (from_xml, &xml_len);
+	g_assert_nonnull (g_strstr_len (xml, xml_len, "<ogo:flip>vertical</ogo:flip>"));
+	test_schematic_binary_save_as (from_xml, binary_file);
+
+	from_binary = schematic_read (binary_file, &e);
+	g_assert_no_error (e);
+	g_assert_cmpstr (schematic_get_author (from_binary), ==, "Test");
+	g_assert_cmpuint (g_list_length (schematic_get_store (from_binary)->parts), ==, 8);
+	xml_from_binary = test_schematic_binary_write_xml (from_binary, &xml_from_binary_len);
+	g_assert_cmpuint (xml_len, ==, xml_from_binary_len);
+	g_assert_true (memcmp (xml, xml_from_binary, xml_len) == 0);
+
+	// and back to XML, which saves the same binary file again
+	test_schematic_binary_save_as (from_binary, xml_again_file);
+	from_xml_again = schematic_read (xml_again_file, &e);
+	g_assert_no_error (e);
+	g_assert_true (g_file_get_contents (binary_file, &binary, &binary_len, &e));
+	test_schematic_binary_save_as (from_xml_again, binary_file);
+	g_assert_true (g_file_get_contents (binary_file, &binary_again, &binary_again_len, &e));
+	g_assert_no_error (e);
+	g_assert_cmpuint (binary_len, ==, binary_again_len);
+	g_assert_true (memcmp (binary, binary_again, binary_len) == 0);
+
+	g_unlink (xml_file);
+	g_unlink (binary_file);
+	g_unlink (xml_again_file);
+	g_rmdir (dir);
+	g_free (binary_again);
+	g_free (binary);
+	g_free (xml_from_binary);
+	g_free (xml);
+	g_free (xml_again_file);
+	g_free (binary_file);
+	g_free (xml_file);
+	g_free (dir);
+	g_object_unref (from_xml_again);
+	g_object_unref (from_binary);
+	g_object_unref (from_xml);
+	g_object_unref (sm);
+	library_index_clear ();
+}
+
+static void
+test_schematic_binary_truncated ()
+{
+	Schematic *sm, *read;
+	gchar *dir, *filename, *data;
+	gsize len;
+	GError *e = NULL;
+
+	test_schematic_binary_library_add ();
+	dir = g_dir_make_tmp ("oregano-test-XXXXXX", &e);
+	g_assert_no_error (e);
+	filename = g_build_filename (dir, "truncated.orebin", NULL);
+
+	sm = test_schematic_binary_new (2, 2);
+	test_schematic_binary_save_as (sm, filename);
+	g_assert_true (g_file_get_contents (filename, &data, &len, &e));
+	g_assert_true (g_file_set_contents (filename, data, len - 20, &e));
+	g_assert_no_error (e);
+
+	read = schematic_read (filename, &e);
+	g_assert_null (read);
+	g_assert_error (e, OREGANO_ERROR, OREGANO_SCHEMATIC_BAD_FILE_FORMAT);
+	g_clear_error (&e);
+
+	g_unlink (filename);
+	g_rmdir (dir);
+	g_free (data);
+	g_free (filename);
+	g_free (dir);
+	g_object_unref (sm);
+	library_index_clear ();
+}
+
+/**
+ * times connecting copies of the parts and wires of @sm in a new node
+ * store, one by one and all at once
+ */
+static void
+test_schematic_binary_bench_register (Schematic *sm)
+{
+	GList *each = NULL, *bulk = NULL, *iter;
+	NodeStore *each_store = node_store_new ();
+	NodeStore *bulk_store = node_store_new ();
+	gdouble each_time, bulk_time;
+
+	for (iter = schematic_get_store (sm)->items; iter; iter = iter->next) {
+		each = g_list_prepend (each, item_data_clone (iter->data));
+		bulk = g_list_prepend (bulk, item_data_clone (iter->data));
+	}
+
+	g_test_timer_start ();
+	for (iter = each; iter; iter = iter->next) {
+		if (IS_PART (iter->data))
+			node_store_add_part (each_store, iter->data);
+		else
+			node_store_add_wire (each_store, iter->data);
+	}
+	each_time = g_test_timer_elapsed ();
+
+	g_test_timer_start ();
+	node_store_add_items (bulk_store, bulk);
+	bulk_time = g_test_timer_elapsed ();
+
+	g_assert_cmpuint (g_hash_table_size (bulk_store->nodes), ==,
+	                  g_hash_table_size (each_store->nodes));
+	g_test_message ("node store: %u items, one by one %.3f s, at once %.3f s",
+	                g_list_length (bulk), each_time, bulk_time);
+
+	g_object_unref (bulk_store);
+	g_object_unref (each_store);
+	g_list_free_full (bulk, g_object_unref);
+	g_list_free_full (each, g_object_unref);
+}
+
+/**
+ * times saving and opening a large schematic in both formats, and
+ * connecting its items in the node store, run with -m perf
+ */
+static void
+test_schematic_binary_benchmark ()
+{
+	const gchar *const extensions[] = {"oregano", "orebin"};
+	Schematic *sm;
+	gchar *dir;
+	guint i;
+	GError *e = NULL;
+
+	if (!g_test_perf ()) {
+		g_test_skip ("only run with -m perf");
+		return;
+	}
+
+	test_schematic_binary_library_add ();
+	dir = g_dir_make_tmp ("oregano-test-XXXXXX", &e);
+	g_assert_no_error (e);
+	sm = test_schematic_binary_new (TEST_SCHEMATIC_BINARY_BENCH_PARTS,
+	                                TEST_SCHEMATIC_BINARY_BENCH_WIRES);
+
+	for (i = 0; i < G_N_ELEMENTS (extensions); i++) {
+		g_autofree gchar *name = g_strdup_printf ("bench.%s", extensions[i]);
+		g_autofree gchar *filename = g_build_filename (dir, name, NULL);
+		Schematic *read;
+		GStatBuf st;
+		gdouble save, open;
+
+		g_test_timer_start ();
+		test_schematic_binary_save_as (sm, filename);
+		save = g_test_timer_elapsed ();
+
+		g_test_timer_start ();
+		read = schematic_read (filename, &e);
+		open = g_test_timer_elapsed ();
+		g_assert_no_error (e);
+
+		g_assert_cmpint (g_stat (filename, &st), ==, 0);
+		g_test_message ("%s: %u parts, %u wires, %" G_GINT64_FORMAT " bytes, "
+		                "save %.3f s, open %.3f s",
+		                extensions[i], TEST_SCHEMATIC_BINARY_BENCH_PARTS,
+		                TEST_SCHEMATIC_BINARY_BENCH_WIRES, (gint64)st.st_size, save, open);
+
+		g_object_unref (read);
+		g_unlink (filename);
+	}
+
+	test_schematic_binary_bench_register (sm);
+
+	g_rmdir (dir);
+	g_free (dir);
+	g_object_unref (sm);
+	library_index_clear ();
+}
+
+#endif
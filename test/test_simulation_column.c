@@ -0,0 +1,95 @@
+/*
+ * test_simulation_column.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_SIMULATION_COLUMN
+#define TEST_SIMULATION_COLUMN
+
+#include <math.h>
+#include <float.h>
+#include <glib.h>
+
+#include "../src/simulation-column.h"
+
+#define TEST_SIMULATION_COLUMN_POINTS 1000
+
+static void test_simulation_column_encodings ();
+
+void
+add_funcs_test_simulation_column ()
+{
+	g_test_add_func ("/core/simulation-column/encodings", test_simulation_column_encodings);
+}
+
+static void
+test_simulation_column_encodings ()
+{
+	gdouble index[TEST_SIMULATION_COLUMN_POINTS], time[TEST_SIMULATION_COLUMN_POINTS];
+	gdouble volt[TEST_SIMULATION_COLUMN_POINTS], huge[TEST_SIMULATION_COLUMN_POINTS];
+	gdouble out[TEST_SIMULATION_COLUMN_POINTS];
+	SimulationColumn *column;
+	guint i;
+
+	for (i = 0; i < TEST_SIMULATION_COLUMN_POINTS; i++) {
+		index[i] = i;
+		// nearly uniform steps, like those of an adaptive time step
+		time[i] = 1e-6 * i + 1e-9 * sin (i);
+		volt[i] = 5. * sin (i * 0.01);
+		huge[i] = i == 7 ? G_MAXDOUBLE : volt[i];
+	}
+
+	// exact progressions keep no samples at all
+	column = simulation_column_encode (index, TEST_SIMULATION_COLUMN_POINTS);
+	g_assert_cmpint (column->encoding, ==, SIMULATION_COLUMN_AFFINE);
+	g_assert_null (column->values);
+	simulation_column_decode (column, out);
+	for (i = 0; i < TEST_SIMULATION_COLUMN_POINTS; i++)
+		g_assert_cmpfloat (out[i], ==, index[i]);
+	simulation_column_free (column);
+
+	// near ones are more precise than floats
+	column = simulation_column_encode (time, TEST_SIMULATION_COLUMN_POINTS);
+	g_assert_cmpint (column->encoding, ==, SIMULATION_COLUMN_AFFINE);
+	g_assert_nonnull (column->values);
+	g_assert_cmpuint (simulation_column_get_size (column), <,
+	                  TEST_SIMULATION_COLUMN_POINTS * sizeof(gdouble));
+	simulation_column_decode (column, out);
+	for (i = 0; i < TEST_SIMULATION_COLUMN_POINTS; i++)
+		g_assert_cmpfloat (fabs (out[i] - time[i]), <=, 1e-9 * FLT_EPSILON);
+	simulation_column_free (column);
+
+	column = simulation_column_encode (volt, TEST_SIMULATION_COLUMN_POINTS);
+	g_assert_cmpint (column->encoding, ==, SIMULATION_COLUMN_FLOAT);
+	simulation_column_decode (column, out);
+	for (i = 0; i < TEST_SIMULATION_COLUMN_POINTS; i++)
+		g_assert_cmpfloat (fabs (out[i] - volt[i]), <=, 5. * FLT_EPSILON);
+	simulation_column_free (column);
+
+	// values beyond the float range stay doubles
+	column = simulation_column_encode (huge, TEST_SIMULATION_COLUMN_POINTS);
+	g_assert_cmpint (column->encoding, ==, SIMULATION_COLUMN_DOUBLE);
+	simulation_column_decode (column, out);
+	g_assert_cmpfloat (out[7], ==, G_MAXDOUBLE);
+	simulation_column_free (column);
+}
+
+#endif
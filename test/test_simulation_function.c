@@ -0,0 +1,177 @@
+/*
+ * test_simulation_function.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_SIMULATION_FUNCTION
+#define TEST_SIMULATION_FUNCTION
+
+#include <math.h>
+#include <glib.h>
+
+#include "../src/simulation-function.h"
+
+// more than a few blocks, and not a multiple of the block size
+#define TEST_SIMULATION_FUNCTION_POINTS 5000
+
+static void test_simulation_function_binary ();
+static void test_simulation_function_calculus ();
+static void test_simulation_function_fft ();
+
+void
+add_funcs_test_simulation_function ()
+{
+	g_test_add_func ("/core/simulation-function/binary", test_simulation_function_binary);
+	g_test_add_func ("/core/simulation-function/calculus", test_simulation_function_calculus);
+	g_test_add_func ("/core/simulation-function/fft", test_simulation_function_fft);
+}
+
+/**
+ * x in seconds, a = sin (2 pi 1kHz x), b = 2 + x
+ */
+static SimulationData *
+test_simulation_function_data_new ()
+{
+	SimulationData *data = g_new0 (SimulationData, 1);
+	gint i, j;
+
+	data->n_variables = 3;
+	data->data = g_new0 (GArray *, 3);
+	for (i = 0; i < 3; i++)
+		data->data[i] = g_array_new (FALSE, FALSE, sizeof(gdouble));
+
+	for (j = 0; j < TEST_SIMULATION_FUNCTION_POINTS; j++) {
+		gdouble x = j * 1e-5;
+		gdouble a = sin (2. * G_PI * 1e3 * x);
+		gdouble b = 2. + x;
+
+		g_array_append_val (data->data[0], x);
+		g_array_append_val (data->data[1], a);
+		g_array_append_val (data->data[2], b);
+	}
+	return data;
+}
+
+static void
+test_simulation_function_data_free (SimulationData *data)
+{
+	gint i;
+
+	for (i = 0; i < data->n_variables; i++)
+		g_array_unref (data->data[i]);
+	g_free (data->data);
+	g_free (data);
+}
+
+static void
+test_simulation_function_binary ()
+{
+	SimulationData *data = test_simulation_function_data_new ();
+	SimulationFunction func = {FUNCTION_DIVIDE, 1, 2, 0};
+	GArray *x, *y;
+	guint j;
+
+	g_assert_true (simulation_function_evaluate (&func, data, &x, &y));
+	// the x column is shared, not copied
+	g_assert_true (x == data->data[0]);
+	g_assert_cmpuint (y->len, ==, TEST_SIMULATION_FUNCTION_POINTS);
+	for (j = 0; j < y->len; j++)
+		g_assert_cmpfloat (fabs (g_array_index (y, gdouble, j) -
+		                         g_array_index (data->data[1], gdouble, j) /
+		                             g_array_index (data->data[2], gdouble, j)),
+		                   <, 1e-12);
+	g_array_unref (x);
+	g_array_unref (y);
+
+	// divisors below the threshold saturate
+	func.second = 0;
+	g_assert_true (simulation_function_evaluate (&func, data, &x, &y));
+	g_assert_cmpfloat (g_array_index (y, gdouble, 0), ==, G_MAXDOUBLE);
+	g_array_unref (x);
+	g_array_unref (y);
+
+	test_simulation_function_data_free (data);
+}
+
+static void
+test_simulation_function_calculus ()
+{
+	SimulationData *data = test_simulation_function_data_new ();
+	SimulationFunction func = {FUNCTION_DERIVATIVE, 2, 0, 0};
+	GArray *x, *y;
+	guint j;
+
+	// d/dx (2 + x) = 1
+	g_assert_true (simulation_function_evaluate (&func, data, &x, &y));
+	for (j = 0; j < y->len; j++)
+		g_assert_cmpfloat (fabs (g_array_index (y, gdouble, j) - 1.), <, 1e-6);
+	g_array_unref (x);
+	g_array_unref (y);
+
+	// integral of 2 + x from 0 to x is 2 x + x^2 / 2
+	func.type = FUNCTION_INTEGRAL;
+	g_assert_true (simulation_function_evaluate (&func, data, &x, &y));
+	for (j = 0; j < y->len; j++) {
+		gdouble t = g_array_index (x, gdouble, j);
+		g_assert_cmpfloat (fabs (g_array_index (y, gdouble, j) - (2. * t + t * t / 2.)), <, 1e-9);
+	}
+	g_array_unref (x);
+	g_array_unref (y);
+
+	// averaging a straight line does not change it, except at the ends
+	func.type = FUNCTION_MOVING_AVERAGE;
+	func.window = 5;
+	g_assert_true (simulation_function_evaluate (&func, data, &x, &y));
+	for (j = 2; j + 2 < y->len; j++)
+		g_assert_cmpfloat (fabs (g_array_index (y, gdouble, j) -
+		                         g_array_index (data->data[2], gdouble, j)),
+		                   <, 1e-9);
+	g_array_unref (x);
+	g_array_unref (y);
+
+	test_simulation_function_data_free (data);
+}
+
+static void
+test_simulation_function_fft ()
+{
+	SimulationData *data = test_simulation_function_data_new ();
+	SimulationFunction func = {FUNCTION_FFT_MAGNITUDE, 1, 0, 0};
+	GArray *x, *y;
+	guint j, peak = 0;
+
+	g_assert_true (simulation_function_evaluate (&func, data, &x, &y));
+	g_assert_cmpuint (x->len, ==, y->len);
+	for (j = 1; j < y->len; j++)
+		if (g_array_index (y, gdouble, j) > g_array_index (y, gdouble, peak))
+			peak = j;
+
+	// the 1kHz sine, within one bin
+	g_assert_cmpfloat (fabs (g_array_index (x, gdouble, peak) - 1e3), <,
+	                   g_array_index (x, gdouble, 1) * 1.5);
+	g_assert_cmpfloat (g_array_index (y, gdouble, peak), >, 0.5);
+
+	g_array_unref (x);
+	g_array_unref (y);
+	test_simulation_function_data_free (data);
+}
+
+#endif
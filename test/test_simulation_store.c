@@ -0,0 +1,121 @@
+/*
+ * test_simulation_store.c
+ *
+ *
+ * Web page: https://ahoi.io/project/oregano
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_SIMULATION_STORE
+#define TEST_SIMULATION_STORE
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "../src/simulation-store.h"
+
+#define TEST_SIMULATION_STORE_POINTS 1000
+
+static void test_simulation_store_roundtrip ();
+
+void
+add_funcs_test_simulation_store ()
+{
+	g_test_add_func ("/core/simulation-store/roundtrip", test_simulation_store_roundtrip);
+}
+
+static void
+test_simulation_store_roundtrip ()
+{
+	SimulationStore *store;
+	SimulationData *data, *reopened;
+	gdouble time[TEST_SIMULATION_STORE_POINTS], volt[TEST_SIMULATION_STORE_POINTS];
+	const gdouble *column;
+	gchar *parent, *path;
+	guint i, len;
+	GError *e = NULL;
+
+	for (i = 0; i < TEST_SIMULATION_STORE_POINTS; i++) {
+		time[i] = i * 1e-6;
+		volt[i] = (gdouble)(i % 10);
+	}
+
+	parent = g_dir_make_tmp ("oregano-test-XXXXXX", &e);
+	g_assert_no_error (e);
+
+	store = simulation_store_new (parent, ANALYSIS_TYPE_TRANSIENT, &e);
+	g_assert_no_error (e);
+	path = g_strdup (simulation_store_get_path (store));
+
+	// columns arrive block by block, not in order
+	simulation_store_add_column (store, 1, "V(1)", "voltage", volt, TEST_SIMULATION_STORE_POINTS,
+	                             0., 9., &e);
+	g_assert_no_error (e);
+	simulation_store_add_column (store, 0, "time", "time", time, TEST_SIMULATION_STORE_POINTS,
+	                             time[0], time[TEST_SIMULATION_STORE_POINTS - 1], &e);
+	g_assert_no_error (e);
+
+	data = simulation_store_finish (store, &e);
+	g_assert_no_error (e);
+	g_assert_nonnull (data->mapped);
+	g_assert_null (data->data);
+	g_assert_cmpint (data->type, ==, ANALYSIS_TYPE_TRANSIENT);
+	g_assert_cmpint (data->n_variables, ==, 2);
+	g_assert_cmpint (data->got_points, ==, TEST_SIMULATION_STORE_POINTS);
+	g_assert_cmpstr (data->var_names[1], ==, "V(1)");
+	g_assert_cmpfloat (data->max_data[1], ==, 9.);
+
+	column = simulation_data_get_column (data, 1, &len);
+	g_assert_cmpuint (len, ==, TEST_SIMULATION_STORE_POINTS);
+	for (i = 0; i < len; i++)
+		g_assert_cmpfloat (column[i], ==, volt[i]);
+
+	reopened = simulation_store_open (path, &e);
+	g_assert_no_error (e);
+	g_assert_cmpstr (reopened->var_names[0], ==, "time");
+	column = simulation_data_get_column (reopened, 0, &len);
+	g_assert_cmpuint (len, ==, TEST_SIMULATION_STORE_POINTS);
+	g_assert_cmpfloat (column[TEST_SIMULATION_STORE_POINTS - 1], ==,
+	                   time[TEST_SIMULATION_STORE_POINTS - 1]);
+
+	simulation_data_free (data);
+	simulation_data_free (reopened);
+
+	// a new store in the same directory keeps the finished one
+	store = simulation_store_new (parent, ANALYSIS_TYPE_TRANSIENT, &e);
+	g_assert_no_error (e);
+	g_assert_true (g_file_test (path, G_FILE_TEST_IS_DIR));
+	simulation_store_discard (store);
+
+	reopened = simulation_store_open (path, &e);
+	g_assert_no_error (e);
+	simulation_data_free (reopened);
+
+	for (i = 0; i < 3; i++) {
+		const gchar *names[] = {"0.col", "1.col", "index"};
+		gchar *file = g_build_filename (path, names[i], NULL);
+		g_unlink (file);
+		g_free (file);
+	}
+	g_rmdir (path);
+	g_rmdir (parent);
+	g_free (path);
+	g_free (parent);
+}
+
+#endif